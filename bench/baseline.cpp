@@ -0,0 +1,110 @@
+#include "harness.h"
+
+#include <linux/mman.h> // the kernel's PROT_*, MAP_*: sys/mman.h is the library's own
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <assert.h>
+#include <string>
+#include <vector>
+
+#ifndef MAP_FAILED
+#define MAP_FAILED ((void*) -1)
+#endif
+
+/**
+ * The Linux baseline backend only: the C library's `mmap` and the raw system calls,
+ * under the same names as bench/mman.cpp measures the library with. The library is
+ * exported as `memmap_posix_mmap` etc. here (see sys/mman.h), so these are the C library's.
+ */
+extern "C" {
+void* libc_mmap(void* addr, size_t length, int prot, int flags, int fd, off_t offset) __asm__("mmap");
+int libc_munmap(void* addr, size_t length) __asm__("munmap");
+int libc_mprotect(void* addr, size_t length, int prot) __asm__("mprotect");
+}
+
+namespace {
+
+constexpr std::size_t kKiB = 1024;
+constexpr std::size_t kMiB = kKiB * kKiB;
+constexpr std::size_t kBatchBytes = 64 * kMiB; // as in bench/mman.cpp
+
+std::string Label(const char* prefix, std::size_t size) {
+    std::string label(prefix);
+    label.push_back('/');
+    label.append(size % kMiB ? std::to_string(size / kKiB) + "k" : std::to_string(size / kMiB) + "m");
+    return label;
+}
+
+struct Calls {
+    const char* map_label;
+    const char* unmap_label;
+    void* (*map)(std::size_t size);
+    void (*unmap)(void* addr, std::size_t size);
+};
+
+const Calls kLibc = {
+    "libc_mmap", "libc_munmap",
+    [](std::size_t size) { return libc_mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0); },
+    [](void* addr, std::size_t size) { libc_munmap(addr, size); },
+};
+
+const Calls kSyscall = {
+    "syscall_mmap", "syscall_munmap",
+    [](std::size_t size) {
+        return (void*)syscall(SYS_mmap, nullptr, size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    },
+    [](void* addr, std::size_t size) { syscall(SYS_munmap, addr, size); },
+};
+
+} // anonymous
+
+MEMMAP_BENCHMARK(baseline_mmap_munmap) {
+    // anon_mmap_munmap without the library
+    const std::size_t sizes[] = {4 * kKiB, 64 * kKiB, kMiB, 16 * kMiB};
+    const std::size_t iters[] = {20000, 20000, 5000, 500};
+    for(const Calls& calls : {kLibc, kSyscall}) {
+        for(std::size_t s = 0; s < sizeof(sizes) / sizeof(*sizes); ++s) {
+            const std::size_t size = sizes[s];
+            const std::size_t total = run.Iterations(iters[s]);
+            const std::size_t batch = std::max<std::size_t>(1u, std::min(total, kBatchBytes / size));
+            std::vector<void*> live(batch);
+
+            bench::Measurement& maps = run.Begin(Label(calls.map_label, size));
+            bench::Measurement& unmaps = run.Begin(Label(calls.unmap_label, size));
+            for(std::size_t done = 0; done < total; done += batch) {
+                const std::size_t n = std::min(batch, total - done);
+                for(std::size_t i = 0; i < n; ++i) {
+                    const LONGLONG start = bench::Ticks();
+                    live[i] = calls.map(size);
+                    maps.samples.push_back(bench::Nanoseconds(bench::Ticks() - start));
+                    assert(live[i] != MAP_FAILED);
+                }
+                for(std::size_t i = 0; i < n; ++i) {
+                    const LONGLONG start = bench::Ticks();
+                    calls.unmap(live[i], size);
+                    unmaps.samples.push_back(bench::Nanoseconds(bench::Ticks() - start));
+                }
+            }
+        }
+    }
+}
+
+MEMMAP_BENCHMARK(baseline_mprotect_toggle) {
+    // mprotect_toggle without the library
+    const long page_size = getpagesize();
+    const std::size_t sizes[] = {(std::size_t)page_size, kMiB};
+    for(std::size_t size : sizes) {
+        char* addr = (char*)libc_mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+        assert(addr != MAP_FAILED);
+        for(std::size_t offset = 0; offset < size; offset += page_size) ((volatile char*)addr)[offset] = '#';
+        run.Measure(Label("libc_rw_r", size), run.Iterations(20000), 0, [&](std::size_t i) {
+            libc_mprotect(addr, size, (i % 2) ? PROT_READ | PROT_WRITE : PROT_READ);
+        });
+        run.Measure(Label("syscall_rw_r", size), run.Iterations(20000), 0, [&](std::size_t i) {
+            syscall(SYS_mprotect, addr, size, (i % 2) ? PROT_READ | PROT_WRITE : PROT_READ);
+        });
+        libc_munmap(addr, size);
+    }
+}
@@ -0,0 +1,57 @@
+#include "harness.h"
+
+#include "memmap/copy.h"
+
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t kBuffer = 1 << 20; // a typical read/write loop buffer
+
+} // anonymous
+
+MEMMAP_BENCHMARK(copy_file) {
+    // 1 GiB by default; MEMMAP_BENCH_COPY_GIB=16 for the large end (mind the scratch disk space: twice that)
+    const char* gib = getenv("MEMMAP_BENCH_COPY_GIB");
+    const uint64_t size = run.quick ? (64ull << 20) : ((gib && atoi(gib) > 0) ? (uint64_t)atoi(gib) : 1ull) << 30;
+    const std::string source = run.ScratchFile("copy-src");
+    const std::string target = run.ScratchFile("copy-dst");
+    {
+        int fd = open(source.c_str(), O_CREAT | O_TRUNC | O_RDWR | O_BINARY, _S_IREAD | _S_IWRITE);
+        std::vector<char> chunk(kBuffer);
+        for(std::size_t i = 0; i < kBuffer; ++i) chunk[i] = (char)(i * 29);
+        for(uint64_t written = 0; written < size; written += kBuffer) write(fd, chunk.data(), kBuffer);
+        close(fd);
+    }
+
+    run.Measure("read_write", run.Iterations(3), size, [&](std::size_t) {
+        int in = open(source.c_str(), O_RDONLY | O_BINARY);
+        int out = open(target.c_str(), O_CREAT | O_TRUNC | O_WRONLY | O_BINARY, _S_IREAD | _S_IWRITE);
+        std::vector<char> buffer(kBuffer);
+        int got = 0;
+        while((got = read(in, buffer.data(), kBuffer)) > 0) write(out, buffer.data(), got);
+        close(out);
+        close(in);
+    });
+
+    run.Measure("copy_file_range", run.Iterations(3), size, [&](std::size_t) {
+        int in = open(source.c_str(), O_RDONLY | O_BINARY);
+        int out = open(target.c_str(), O_CREAT | O_TRUNC | O_WRONLY | O_BINARY, _S_IREAD | _S_IWRITE);
+        off64_t off_in = 0, off_out = 0;
+        while(off_in < (off64_t)size) {
+            const ssize_t copied = memmap_copy_file_range(in, &off_in, out, &off_out, size - off_in, 0);
+            assert(copied > 0);
+        }
+        close(out);
+        close(in);
+    });
+
+    DeleteFileA(source.c_str());
+    DeleteFileA(target.c_str());
+}
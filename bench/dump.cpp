@@ -0,0 +1,35 @@
+#include "harness.h"
+
+#include "sys/mman.h"
+#include "memmap/dump.h"
+#include "memmap/proc.h"
+
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#include <assert.h>
+#include <string.h>
+
+MEMMAP_BENCHMARK(dump_process) {
+    // 256 MiB of touched private memory on top of whatever the process already holds
+    const std::size_t size = 256 << 20;
+    void* ballast = mmap(nullptr, size, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    assert(ballast != MAP_FAILED);
+    memset(ballast, 0x5a, size);
+
+    // bytes_per_op is the ballast only; "dumped_bytes" is the whole process
+    const std::string path = run.ScratchFile("dump");
+    memmap_dump_header header = {};
+    run.Measure("write", run.Iterations(5), size, [&](std::size_t) {
+        assert(!memmap_dump_write(path.c_str()));
+    });
+    int fd = open(path.c_str(), O_RDONLY | O_BINARY);
+    if(fd >= 0) {
+        read(fd, &header, sizeof(header));
+        close(fd);
+    }
+    run.Counter("regions", (double)header.region_count);
+    run.Counter("dumped_bytes", (double)header.data_bytes);
+    DeleteFileA(path.c_str());
+    munmap(ballast, size);
+}
@@ -0,0 +1,49 @@
+#include "harness.h"
+
+#include "sys/mman.h"
+#include "memmap/proc.h"
+#include "memmap/fault.h"
+
+#include <windows.h>
+#include <assert.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t kTouchEvery = 20; // a restored process touches 1 page in 20
+
+} // anonymous
+
+MEMMAP_BENCHMARK(fault_restore) {
+    // "restoring a snapshot": a blob copied in whole versus filled on first touch
+    const std::size_t size = run.quick ? (32 << 20) : (256 << 20);
+    const std::size_t page_size = getpagesize();
+    std::vector<char> snapshot(size, 0x3c);
+
+    run.Measure("eager_copy", run.Iterations(8), size, [&](std::size_t) {
+        char* heap = (char*)VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        memcpy(heap, snapshot.data(), size);
+        for(std::size_t offset = 0; offset < size; offset += kTouchEvery * page_size) {
+            assert(((volatile char*)heap)[offset] == 0x3c);
+        }
+        VirtualFree(heap, 0, MEM_RELEASE);
+    });
+
+    for(std::size_t batch : {1, 16}) {
+        std::size_t faults = 0;
+        run.Measure(batch == 1 ? "lazy_fill" : "lazy_fill/16", run.Iterations(8), size, [&](std::size_t) {
+            mem::LazyRegion heap(size, PROT_READ | PROT_WRITE, batch, [&](char* dest, std::size_t length, std::size_t offset) {
+                memcpy(dest, snapshot.data() + offset, length);
+                return true;
+            });
+            for(std::size_t offset = 0; offset < size; offset += kTouchEvery * page_size) {
+                assert(((volatile char*)heap.Data())[offset] == 0x3c);
+            }
+            memmap_fault_stats stats;
+            memmap_fault_get_stats(heap.get(), &stats);
+            faults = stats.faults;
+        });
+        run.Counter("faults", (double)faults);
+    }
+}
@@ -0,0 +1,64 @@
+#include "harness.h"
+
+#include "sys/mman.h"
+#include "memmap/conf.h"
+#include "memmap/proc.h"
+
+#include <windows.h>
+
+#include <algorithm>
+#include <assert.h>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// A churn of small and medium mappings with a few large ones, sized for a 32-bit address space.
+constexpr std::size_t kLive = 2000;
+constexpr std::size_t kSmall = 16 << 10;
+constexpr std::size_t kMedium = 256 << 10;
+constexpr std::size_t kLarge = 8 << 20;
+constexpr unsigned kLargeEvery = 200; // one large mapping per this many
+
+std::size_t SizeOf(std::size_t i, std::mt19937& random) {
+    if(i % kLargeEvery == kLargeEvery - 1) return kLarge;
+    return (random() % 4) ? kSmall : kMedium;
+}
+
+} // anonymous
+
+MEMMAP_BENCHMARK(placement_fragmentation) {
+    const enum mmap_placement_policy policies[] = {mmap_placement_policy__system, mmap_placement_policy__best_fit};
+    for(auto policy : policies) {
+        set_mmap_placement_policy(policy, 0);
+        const std::string suffix = (policy == mmap_placement_policy__system) ? "system" : "best_fit";
+        const std::size_t total = run.Iterations(50000);
+        std::mt19937 random(42); // the same churn for both policies
+        std::vector<std::pair<void*, std::size_t>> live(kLive, {nullptr, 0});
+
+        bench::Measurement& maps = run.Begin("mmap/" + suffix);
+        std::size_t failures = 0;
+        for(std::size_t i = 0; i < total; ++i) {
+            auto& slot = live[random() % kLive]; // replace a random survivor
+            if(slot.first) munmap(slot.first, slot.second);
+            const std::size_t size = SizeOf(i, random);
+            const LONGLONG start = bench::Ticks();
+            void* addr = mmap(nullptr, size, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+            maps.samples.push_back(bench::Nanoseconds(bench::Ticks() - start));
+            slot = (addr != MAP_FAILED) ? std::make_pair(addr, size) : std::make_pair((void*)nullptr, (std::size_t)0);
+            failures += (addr == MAP_FAILED);
+        }
+
+        memmap_fragmentation report;
+        memmap_fragmentation_get(&report);
+        run.Counter("failures", failures);
+        run.Counter("largest_free_mib", report.largest_free / double(1 << 20));
+        run.Counter("free_blocks", report.free_blocks);
+        run.Counter("unusable_kib", report.unusable_bytes / 1024.);
+        for(auto& slot : live) {
+            if(slot.first) munmap(slot.first, slot.second);
+        }
+    }
+    set_mmap_placement_policy(mmap_placement_policy__system, 0); // the default
+}
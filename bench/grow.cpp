@@ -0,0 +1,61 @@
+#include "harness.h"
+
+#include "sys/mman.h"
+#include "memmap/grow.h"
+
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#include <assert.h>
+#include <string.h>
+
+namespace {
+
+constexpr std::size_t kRecord = 256;
+
+} // anonymous
+
+MEMMAP_BENCHMARK(grow_append) {
+    // an append-only log of 256-byte records, starting from an empty file
+    const std::size_t total = run.quick ? (16 << 20) : (256 << 20);
+    const std::size_t records = total / kRecord;
+    const std::string path = run.ScratchFile("grow");
+    char record[kRecord];
+    memset(record, 0x6c, sizeof(record));
+
+    // the status quo: unmap, extend the file (zero-filled), map again, doubling each time
+    run.Measure("remap", run.Iterations(3), total, [&](std::size_t) {
+        int fd = open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR | O_BINARY, _S_IREAD | _S_IWRITE);
+        std::size_t size = 1 << 20;
+        assert(!_chsize_s(fd, size));
+        char* log = (char*)mmap(nullptr, size, PROT_DATA, MAP_SHARED, fd, 0);
+        for(std::size_t i = 0, length = 0; i < records; ++i, length += kRecord) {
+            if(length + kRecord > size) {
+                munmap(log, size);
+                size *= 2;
+                assert(!_chsize_s(fd, size));
+                log = (char*)mmap(nullptr, size, PROT_DATA, MAP_SHARED, fd, 0);
+            }
+            memcpy(log + length, record, kRecord);
+        }
+        munmap(log, size);
+        close(fd);
+    });
+
+    std::size_t mapped = 0;
+    run.Measure("growable", run.Iterations(3), total, [&](std::size_t) {
+        int fd = open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR | O_BINARY, _S_IREAD | _S_IWRITE);
+        {
+            mem::GrowableFile log(fd, total);
+            assert(log);
+            for(std::size_t i = 0; i < records; ++i) {
+                log.Append(record, kRecord);
+            }
+            mapped = memmap_grow_mapped(log.get());
+        } // truncates the file to the appended length
+        close(fd);
+    });
+    run.Counter("mapped_bytes", (double)mapped);
+    DeleteFileA(path.c_str());
+}
@@ -0,0 +1,173 @@
+#include "harness.h"
+
+#include "memmap/proc.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+struct Entry {
+    const char* name;
+    bench::Body body;
+};
+
+std::vector<Entry>& Registry() {
+    static std::vector<Entry> registry; // function-local: registrars run during static init
+    return registry;
+}
+
+double _ns_per_tick = 0.;
+
+double Percentile(const std::vector<double>& sorted, double p) {
+    if(sorted.empty()) return 0.;
+    std::size_t idx = (std::size_t)(p * (sorted.size() - 1) + .5);
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+void PrintString(FILE* out, const std::string& s) {
+    fputc('"', out);
+    for(char c : s) {
+        if(c == '"' || c == '\\') fputc('\\', out);
+        fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+void PrintMeasurement(FILE* out, const char* suite, const bench::Measurement& m) {
+    std::vector<double> sorted = m.samples;
+    std::sort(sorted.begin(), sorted.end());
+    const double total = std::accumulate(sorted.begin(), sorted.end(), 0.);
+    const std::size_t n = sorted.size();
+
+    fprintf(out, "    {\"suite\": ");
+    PrintString(out, suite);
+    fprintf(out, ", \"name\": ");
+    PrintString(out, m.name);
+    fprintf(out, ", \"iterations\": %zu, \"total_ns\": %.0f", n, total);
+    fprintf(out, ", \"ns_mean\": %.1f, \"ns_min\": %.1f, \"ns_p50\": %.1f, \"ns_p90\": %.1f, \"ns_p99\": %.1f, \"ns_max\": %.1f",
+            n ? total / n : 0., n ? sorted.front() : 0., Percentile(sorted, .5), Percentile(sorted, .9),
+            Percentile(sorted, .99), n ? sorted.back() : 0.);
+    if(m.bytes_per_op && total > 0.) {
+        fprintf(out, ", \"bytes_per_op\": %zu, \"bytes_per_second\": %.0f",
+                m.bytes_per_op, 1e9 * m.bytes_per_op * n / total);
+    }
+    if(!m.counters.empty()) {
+        fprintf(out, ", \"counters\": {");
+        for(std::size_t i = 0; i < m.counters.size(); ++i) {
+            fprintf(out, i ? ", " : "");
+            PrintString(out, m.counters[i].first);
+            fprintf(out, ": %.17g", m.counters[i].second);
+        }
+        fprintf(out, "}");
+    }
+    fprintf(out, "}");
+}
+
+void Usage(const char* argv0) {
+    fprintf(stderr, "usage: %s [--quick] [--filter SUBSTRING] [--output FILE.json] [--list]\n", argv0);
+}
+
+} // anonymous
+
+namespace bench {
+
+double Nanoseconds(LONGLONG ticks) {
+    return ticks * _ns_per_tick;
+}
+
+Measurement& Run::Begin(const std::string& name, std::size_t bytes_per_op) {
+    _results.emplace_back();
+    _results.back().name = name;
+    _results.back().bytes_per_op = bytes_per_op;
+    return _results.back();
+}
+
+void Run::Counter(const std::string& key, double value) {
+    if(!_results.empty()) {
+        _results.back().counters.emplace_back(key, value);
+    }
+}
+
+std::size_t Run::Iterations(std::size_t nominal) const {
+    return quick ? std::max<std::size_t>(1u, nominal / 16) : nominal;
+}
+
+std::string Run::ScratchFile(const char* tag) const {
+    char dir[MAX_PATH + 1];
+    DWORD len = GetTempPathA(MAX_PATH, dir);
+    std::string path(dir, len);
+    path.append("bench-memmap-");
+    path.append(std::to_string(GetCurrentProcessId()));
+    path.push_back('-');
+    path.append(tag);
+    path.append(".dat");
+    return path;
+}
+
+Registrar::Registrar(const char* name, Body body) {
+    Registry().push_back({name, body});
+}
+
+} // namespace bench
+
+int main(int argc, char** argv) {
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+    _ns_per_tick = 1e9 / freq.QuadPart;
+
+    bench::Run run;
+    const char* filter = nullptr;
+    const char* output = nullptr;
+    bool list = false;
+    for(int i = 1; i < argc; ++i) {
+        if(!strcmp(argv[i], "--quick")) {
+            run.quick = true;
+        } else if(!strcmp(argv[i], "--list")) {
+            list = true;
+        } else if(!strcmp(argv[i], "--filter") && i + 1 < argc) {
+            filter = argv[++i];
+        } else if(!strcmp(argv[i], "--output") && i + 1 < argc) {
+            output = argv[++i];
+        } else {
+            return Usage(argv[0]), 2;
+        }
+    }
+
+    if(list) {
+        for(const Entry& entry : Registry()) printf("%s\n", entry.name);
+        return 0;
+    }
+
+    FILE* out = output ? fopen(output, "w") : stdout;
+    if(!out) {
+        perror(output);
+        return 1;
+    }
+
+    fprintf(out, "{\n  \"library\": \"libmemmap\",\n");
+    fprintf(out, "  \"page_size\": %ld, \"allocation_granularity\": %d, \"large_page_size\": %d,\n",
+            memmap_sysconf(_SC_PAGESIZE), get_allocation_granularity(), gethugepagesize());
+    fprintf(out, "  \"pointer_bits\": %u, \"quick\": %s,\n", (unsigned)(8 * sizeof(void*)), run.quick ? "true" : "false");
+    fprintf(out, "  \"benchmarks\": [\n");
+
+    bool first = true;
+    for(const Entry& entry : Registry()) {
+        if(filter && !strstr(entry.name, filter)) continue;
+        fprintf(stderr, "running %s...\n", entry.name);
+        const std::size_t done = run.Results().size();
+        entry.body(run);
+        for(std::size_t i = done; i < run.Results().size(); ++i) {
+            fprintf(out, first ? "" : ",\n");
+            PrintMeasurement(out, entry.name, run.Results()[i]);
+            first = false;
+        }
+        fflush(out);
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+    if(out != stdout) fclose(out);
+    return 0;
+}
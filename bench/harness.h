@@ -0,0 +1,90 @@
+#ifndef _MEMMAP_BENCH_HARNESS_H_
+#define _MEMMAP_BENCH_HARNESS_H_
+
+/* Minimal benchmark harness: per-call latency samples, throughput and JSON output. */
+
+#include <windows.h>
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+/* QueryPerformanceCounter ticks converted to nanoseconds. */
+double Nanoseconds(LONGLONG ticks);
+
+inline LONGLONG Ticks() {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return now.QuadPart;
+}
+
+struct Measurement {
+    std::string name;
+    std::size_t bytes_per_op = 0; // 0 => no throughput figure
+    std::vector<double> samples; // ns per call
+    std::vector<std::pair<std::string, double>> counters;
+};
+
+class Run {
+public:
+    /**
+     * Time `iterations` calls of `op(i)` one by one. Every call is a latency sample;
+     * `bytes_per_op` (if nonzero) turns the total into a throughput figure.
+     * Setup and teardown belong outside of `op` (e.g. in a separate `Measure`).
+     */
+    template<typename Op>
+    void Measure(const std::string& name, std::size_t iterations, std::size_t bytes_per_op, Op&& op) {
+        Measurement m;
+        m.name = name;
+        m.bytes_per_op = bytes_per_op;
+        m.samples.reserve(iterations);
+        for(std::size_t i = 0; i < iterations; ++i) {
+            const LONGLONG start = Ticks();
+            op(i);
+            m.samples.push_back(Nanoseconds(Ticks() - start));
+        }
+        _results.push_back(std::move(m));
+    }
+
+    /**
+     * Open a measurement to be filled by hand (`samples.push_back(Nanoseconds(...))`),
+     * for operations that cannot be timed in isolation by `Measure` (e.g. mmap and
+     * munmap of the same batch). References stay valid for the lifetime of the run.
+     */
+    Measurement& Begin(const std::string& name, std::size_t bytes_per_op = 0);
+
+    /* Attach a named figure (e.g. bytes reserved) to the most recent measurement. */
+    void Counter(const std::string& key, double value);
+
+    /* Iteration count adjusted for `--quick` runs. Never returns 0. */
+    std::size_t Iterations(std::size_t nominal) const;
+
+    /* A scratch file path in %TEMP%, unique per benchmark process. */
+    std::string ScratchFile(const char* tag) const;
+
+    bool quick = false;
+    const std::deque<Measurement>& Results() const { return _results; }
+
+private:
+    std::deque<Measurement> _results; // stable references for `Begin`
+};
+
+using Body = void(*)(Run&);
+
+struct Registrar {
+    Registrar(const char* name, Body body);
+};
+
+} // namespace bench
+
+/* Defines and registers a benchmark body. `name` must be a valid identifier. */
+#define MEMMAP_BENCHMARK(name) \
+    static void name(bench::Run&); \
+    static const bench::Registrar name##_registrar(#name, &name); \
+    static void name(bench::Run& run)
+
+#endif /* _MEMMAP_BENCH_HARNESS_H_ */
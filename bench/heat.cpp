@@ -0,0 +1,35 @@
+#include "harness.h"
+
+#include "sys/mman.h"
+#include "memmap/proc.h"
+#include "memmap/heat.h"
+
+#include <windows.h>
+#include <assert.h>
+#include <string.h>
+
+MEMMAP_BENCHMARK(heat_sample) {
+    // the cost of one sample (the overhead bound), and of the soft faults it causes
+    const std::size_t size = run.quick ? (16 << 20) : (256 << 20);
+    const std::size_t page_size = getpagesize();
+    char* buffer = (char*)mmap(nullptr, size, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    assert(buffer != MAP_FAILED);
+    memset(buffer, 1, size);
+
+    for(std::size_t pages_per_sample : {256, 4096}) {
+        memmap_heat_config config = {};
+        config.pages_per_sample = pages_per_sample;
+        mem::HeatProfiler profiler(&config);
+        assert(profiler && profiler.Add(buffer, size) == 0);
+        run.Measure(pages_per_sample == 256 ? "sample/256" : "sample/4096", run.Iterations(200),
+                    pages_per_sample * page_size, [&](std::size_t i) {
+            profiler.Sample();
+            // touch what was just trimmed, so that the next pass finds it resident again
+            const std::size_t first = (i * pages_per_sample * page_size) % size;
+            for(std::size_t offset = 0; offset < pages_per_sample * page_size && first + offset < size; offset += page_size) {
+                ((volatile char*)buffer)[first + offset] += 1;
+            }
+        });
+    }
+    munmap(buffer, size);
+}
@@ -0,0 +1,75 @@
+#include "harness.h"
+
+#include "sys/mman.h"
+#include "memmap/conf.h"
+#include "memmap/huge.h"
+#include "memmap/proc.h"
+
+#include <windows.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace {
+
+constexpr std::size_t kTable = 64 << 20; // a long-lived lookup table, well beyond the TLB reach of small pages
+constexpr std::size_t kProbes = 1 << 16; // random reads per sample
+
+volatile uint64_t _sink;
+
+/* Reads `kProbes` random words of the table (xorshift indices: no allocation, no division). */
+void Probe(const uint64_t* table, uint64_t& state) {
+    uint64_t sum = 0;
+    for(std::size_t i = 0; i < kProbes; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        sum += table[state & (kTable / sizeof(uint64_t) - 1)];
+    }
+    _sink = sum;
+}
+
+} // anonymous
+
+MEMMAP_BENCHMARK(hugepage_table) {
+    // the same table read at random before and after MADV_HUGEPAGE moves it to large pages
+    const std::size_t iterations = run.Iterations(200);
+    set_mmap_hugepage_promotable(true);
+    uint64_t* table = (uint64_t*)mmap(nullptr, kTable, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    assert(table != MAP_FAILED);
+    memset(table, 0x5a, kTable);
+    uint64_t state = 88172645463325252ull;
+
+    run.Measure("random_read/small", iterations, kProbes * sizeof(uint64_t), [&](std::size_t) { Probe(table, state); });
+
+    memmap_hugepage_stats before, after;
+    memmap_hugepage_get_stats(&before);
+    bench::Measurement& advice = run.Begin("madvise", kTable);
+    const LONGLONG start = bench::Ticks();
+    const int advised = madvise(table, kTable, MADV_HUGEPAGE);
+    advice.samples.push_back(bench::Nanoseconds(bench::Ticks() - start));
+    assert(!advised);
+    memmap_hugepage_get_stats(&after);
+    run.Counter("promoted_mib", (after.promoted_bytes - before.promoted_bytes) / double(1 << 20));
+    run.Counter("fallbacks", (double)(after.fallbacks - before.fallbacks));
+    assert(table[kTable / sizeof(uint64_t) - 1] == 0x5a5a5a5a5a5a5a5aull); // the data moved along
+
+    run.Measure("random_read/advised", iterations, kProbes * sizeof(uint64_t), [&](std::size_t) { Probe(table, state); });
+    munmap(table, kTable);
+    set_mmap_hugepage_promotable(false);
+}
+
+MEMMAP_BENCHMARK(hugepage_mmap) {
+    // what `set_mmap_hugepage_promotable` adds to every anonymous mmap of a large page or more
+    const std::size_t iterations = run.Iterations(2000);
+    const std::size_t length = gethugepagesize() ? gethugepagesize() : (2 << 20);
+    for(const bool promotable : {false, true}) {
+        set_mmap_hugepage_promotable(promotable);
+        run.Measure(promotable ? "mmap_munmap/promotable" : "mmap_munmap/default", iterations, length, [&](std::size_t) {
+            void* addr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            assert(addr != MAP_FAILED);
+            munmap(addr, length);
+        });
+    }
+    set_mmap_hugepage_promotable(false);
+}
@@ -0,0 +1,62 @@
+#include "harness.h"
+
+#include "sys/mman.h"
+#include "memmap/jit.h"
+#include "memmap/proc.h"
+
+#include <windows.h>
+#include <assert.h>
+#include <string.h>
+
+namespace {
+
+constexpr std::size_t kStub = 64;
+constexpr std::size_t kCodeSize = 1024 * 1024;
+
+} // anonymous
+
+MEMMAP_BENCHMARK(jit_patch) {
+    // patch one stub and make it executable again, the way an inline cache update does
+    const std::size_t page_size = getpagesize();
+    const std::size_t stubs = kCodeSize / kStub;
+
+    void* code = mmap(nullptr, kCodeSize, PROT_CODE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    assert(code != MAP_FAILED);
+    run.Measure("mprotect_roundtrip", run.Iterations(20000), kStub, [&](std::size_t i) {
+        char* stub = (char*)code + (i * 7919 % stubs) * kStub;
+        char* page = stub - (uintptr_t)stub % page_size;
+        mprotect(page, page_size, PROT_DATA);
+        memset(stub, 0xcc, kStub);
+        mprotect(page, page_size, PROT_CODE);
+        FlushInstructionCache(GetCurrentProcess(), stub, kStub);
+    });
+    munmap(code, kCodeSize);
+
+    mem::jit::CodeRegion region(kCodeSize);
+    assert(region);
+    char* rw = (char*)region.Alloc(kCodeSize - kStub);
+    assert(rw);
+    region.Publish();
+    run.Measure("dual_mapped", run.Iterations(20000), kStub, [&](std::size_t i) {
+        char* stub = rw + (i * 7919 % (stubs - 1)) * kStub;
+        memset(stub, 0xcc, kStub);
+        region.Dirty(stub, kStub);
+        region.Publish();
+    });
+
+    // many small patches, one publish: the batched flush
+    run.Measure("dual_mapped_batch64", run.Iterations(2000), 64 * kStub, [&](std::size_t i) {
+        for(std::size_t k = 0; k < 64; ++k) {
+            char* stub = rw + ((i * 64 + k) * 7919 % (stubs - 1)) * kStub;
+            memset(stub, 0xcc, kStub);
+            region.Dirty(stub, kStub);
+        }
+        region.Publish();
+    });
+
+    run.Measure("stub_alloc", run.Iterations(100000), 0, [&](std::size_t i) {
+        if(!(i % (stubs / 2))) region.Reset();
+        void* rx = nullptr;
+        region.Alloc(kStub / 2, 16, &rx);
+    });
+}
@@ -0,0 +1,78 @@
+#include "harness.h"
+
+#include "sys/mman.h"
+#include "memmap/proc.h"
+#include "memmap/iter.h"
+
+#include <windows.h>
+#include <psapi.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+/* The test-memdmp way: one GetMappedFileNameA and one snprintf per region. */
+std::size_t NaiveMaps(std::string& text) {
+    text.clear();
+    mem::TraverseAllProcessMemory([&](const MEMORY_BASIC_INFORMATION& mbi, const MEMMAP_RANGE& range) {
+        char name[MAX_PATH + 1];
+        const DWORD length = GetMappedFileNameA(GetCurrentProcess(), range.lower, name, MAX_PATH);
+        name[length] = '\0';
+        char line[MAX_PATH + 128];
+        const int n = snprintf(line, sizeof(line), "%p-%p %08lx %08lx %s\n",
+                               range.lower, range.upper, (unsigned long)mbi.Protect, (unsigned long)mbi.Type, name);
+        text.append(line, n > 0 ? n : 0);
+    }, &mem::Reserved);
+    return text.size();
+}
+
+} // anonymous
+
+MEMMAP_BENCHMARK(maps_export) {
+    // a few hundred file views of one file, with alternating protections, to give
+    // every allocation several regions sharing one name
+    const std::string path = run.ScratchFile("maps");
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+    const std::size_t page_size = getpagesize();
+    const std::size_t view_size = 16 * page_size;
+    HANDLE section = CreateFileMappingW(file, nullptr, PAGE_READWRITE, 0, (DWORD)view_size, nullptr);
+    std::vector<char*> views;
+    for(int i = 0; section && i < 512; ++i) {
+        char* view = (char*)MapViewOfFile(section, FILE_MAP_WRITE, 0, 0, view_size);
+        if(!view) break;
+        DWORD old;
+        for(std::size_t page = 0; page < 16; page += 2) {
+            VirtualProtect(view + page * page_size, page_size, PAGE_READONLY, &old);
+        }
+        views.push_back(view);
+    }
+
+    std::size_t regions = 0;
+    mem::TraverseAllProcessMemory([&](const MEMORY_BASIC_INFORMATION&, const MEMMAP_RANGE&) {
+        ++regions;
+    }, &mem::Reserved);
+    run.Counter("regions", (double)regions);
+
+    std::string naive;
+    run.Measure("naive", run.Iterations(20), 0, [&](std::size_t) {
+        NaiveMaps(naive);
+    });
+
+    std::vector<char> buffer(memmap_maps_text(nullptr, 0) * 2 + 4096);
+    std::size_t length = 0;
+    run.Measure("text", run.Iterations(20), 0, [&](std::size_t) {
+        length = memmap_maps_text(buffer.data(), buffer.size());
+    });
+    run.Counter("text_bytes", (double)length);
+
+    run.Measure("binary", run.Iterations(20), 0, [&](std::size_t) {
+        length = memmap_maps_binary(buffer.data(), buffer.size());
+    });
+    run.Counter("binary_bytes", (double)length);
+
+    for(char* view : views) UnmapViewOfFile(view);
+    if(section) CloseHandle(section);
+    CloseHandle(file);
+}
@@ -0,0 +1,256 @@
+#include "harness.h"
+
+#include "sys/mman.h"
+#include "memmap/conf.h"
+#include "memmap/proc.h"
+#include "memmap/iter.h"
+
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t kKiB = 1024;
+constexpr std::size_t kMiB = kKiB * kKiB;
+
+// Live mappings per batch are capped so that 32-bit builds don't run out of address space.
+constexpr std::size_t kBatchBytes = 64 * kMiB;
+
+constexpr std::size_t kScratchFileSize = 64 * kMiB;
+
+std::string Label(const char* prefix, std::size_t size) {
+    std::string label(prefix);
+    label.push_back('/');
+    label.append(size % kMiB ? std::to_string(size / kKiB) + "k" : std::to_string(size / kMiB) + "m");
+    return label;
+}
+
+/* Creates (or truncates) a scratch file of `size` bytes and returns its CRT descriptor. */
+int CreateScratchFile(const std::string& path, std::size_t size) {
+    int fd = open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR | O_BINARY, _S_IREAD | _S_IWRITE);
+    assert(fd >= 0);
+    std::vector<char> chunk(kMiB, '\7');
+    for(std::size_t done = 0; done < size; done += chunk.size()) {
+        const int written = write(fd, chunk.data(), chunk.size());
+        assert(written == (int)chunk.size());
+        (void) written;
+    }
+    _commit(fd);
+    return fd;
+}
+
+void DropScratchFile(int fd, const std::string& path) {
+    close(fd);
+    unlink(path.c_str());
+}
+
+void Touch(void* addr, std::size_t length, std::size_t stride) {
+    for(std::size_t offset = 0; offset < length; offset += stride) {
+        ((volatile char*)addr)[offset] = '#';
+    }
+}
+
+} // anonymous
+
+MEMMAP_BENCHMARK(anon_mmap_munmap) {
+    const std::size_t sizes[] = {4 * kKiB, 64 * kKiB, kMiB, 16 * kMiB};
+    const std::size_t iters[] = {20000, 20000, 5000, 500};
+    for(std::size_t s = 0; s < sizeof(sizes) / sizeof(*sizes); ++s) {
+        const std::size_t size = sizes[s];
+        const std::size_t total = run.Iterations(iters[s]);
+        const std::size_t batch = std::max<std::size_t>(1u, std::min(total, kBatchBytes / size));
+        std::vector<void*> live(batch);
+
+        bench::Measurement& maps = run.Begin(Label("mmap", size));
+        bench::Measurement& unmaps = run.Begin(Label("munmap", size));
+        for(std::size_t done = 0; done < total; done += batch) {
+            const std::size_t n = std::min(batch, total - done);
+            for(std::size_t i = 0; i < n; ++i) {
+                const LONGLONG start = bench::Ticks();
+                live[i] = mmap(nullptr, size, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+                maps.samples.push_back(bench::Nanoseconds(bench::Ticks() - start));
+                assert(live[i] != MAP_FAILED);
+            }
+            for(std::size_t i = 0; i < n; ++i) {
+                const LONGLONG start = bench::Ticks();
+                munmap(live[i], size);
+                unmaps.samples.push_back(bench::Nanoseconds(bench::Ticks() - start));
+            }
+        }
+    }
+}
+
+MEMMAP_BENCHMARK(anon_populate) {
+    // mmap + first touch of every page + munmap: the demand-zero page fault cost
+    const long page_size = getpagesize();
+    const std::size_t sizes[] = {64 * kKiB, kMiB, 16 * kMiB};
+    const std::size_t iters[] = {5000, 1000, 100};
+    for(std::size_t s = 0; s < sizeof(sizes) / sizeof(*sizes); ++s) {
+        const std::size_t size = sizes[s];
+        run.Measure(Label("mmap_touch_munmap", size), run.Iterations(iters[s]), size, [&](std::size_t) {
+            void* addr = mmap(nullptr, size, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+            assert(addr != MAP_FAILED);
+            Touch(addr, size, page_size);
+            munmap(addr, size);
+        });
+    }
+}
+
+MEMMAP_BENCHMARK(file_view) {
+    const std::string path = run.ScratchFile("view");
+    const int fd = CreateScratchFile(path, kScratchFileSize);
+    const std::size_t granularity = get_allocation_granularity();
+    const long page_size = getpagesize();
+
+    const std::size_t sizes[] = {64 * kKiB, kMiB, 16 * kMiB};
+    const std::size_t iters[] = {5000, 2000, 200};
+    for(std::size_t s = 0; s < sizeof(sizes) / sizeof(*sizes); ++s) {
+        const std::size_t size = sizes[s];
+        const std::size_t slots = (kScratchFileSize - size) / granularity;
+        // odd page offsets exercise the allocation granularity padding in `mmap`
+        run.Measure(Label("mmap_munmap", size), run.Iterations(iters[s]), 0, [&](std::size_t i) {
+            const off_t off = (off_t)((i * 7 % slots) * granularity + (i % 2) * page_size);
+            void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, off);
+            assert(addr != MAP_FAILED);
+            munmap(addr, size);
+        });
+    }
+
+    void* view = mmap(nullptr, kScratchFileSize, PROT_READ, MAP_SHARED, fd, 0);
+    assert(view != MAP_FAILED);
+    volatile uint64_t sink = 0;
+    run.Measure("read_sequential/64m", run.Iterations(20), kScratchFileSize, [&](std::size_t) {
+        const uint64_t* words = (const uint64_t*)view;
+        uint64_t sum = 0;
+        for(std::size_t i = 0; i < kScratchFileSize / sizeof(uint64_t); ++i) sum += words[i];
+        sink = sink + sum;
+    });
+    munmap(view, kScratchFileSize);
+    DropScratchFile(fd, path);
+}
+
+MEMMAP_BENCHMARK(mprotect_toggle) {
+    const long page_size = getpagesize();
+    const std::size_t sizes[] = {(std::size_t)page_size, kMiB};
+    for(std::size_t size : sizes) {
+        void* addr = mmap(nullptr, size, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+        assert(addr != MAP_FAILED);
+        Touch(addr, size, page_size);
+        run.Measure(Label("rw_r", size), run.Iterations(20000), 0, [&](std::size_t i) {
+            mprotect(addr, size, (i % 2) ? PROT_DATA : PROT_READ);
+        });
+        munmap(addr, size);
+    }
+}
+
+MEMMAP_BENCHMARK(madvise_cycle) {
+    const long page_size = getpagesize();
+    const std::size_t size = kMiB;
+    void* addr = mmap(nullptr, size, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    assert(addr != MAP_FAILED);
+
+    const int decommit_modes[] = {0, 1};
+    for(int decommit : decommit_modes) {
+        set_madvise_dontneed_decommits(decommit);
+        // DONTNEED + WILLNEED + retouch, as an allocator recycling a span would do
+        run.Measure(Label(decommit ? "offer_reclaim_touch" : "discard_touch", size), run.Iterations(2000), size, [&](std::size_t) {
+            madvise(addr, size, MADV_DONTNEED);
+            madvise(addr, size, MADV_WILLNEED);
+            Touch(addr, size, page_size);
+        });
+    }
+    set_madvise_dontneed_decommits(0); // the default
+
+    munmap(addr, size);
+}
+
+MEMMAP_BENCHMARK(msync_dirty) {
+    const std::string path = run.ScratchFile("sync");
+    const int fd = CreateScratchFile(path, kScratchFileSize);
+    const long page_size = getpagesize();
+    const std::size_t view_size = 16 * kMiB;
+    const std::size_t total_pages = view_size / page_size;
+
+    void* view = mmap(nullptr, view_size, PROT_DATA, MAP_SHARED, fd, 0);
+    assert(view != MAP_FAILED);
+    const std::size_t dirty_counts[] = {1, 16, 256};
+    for(std::size_t dirty : dirty_counts) {
+        bench::Measurement& m = run.Begin("msync/" + std::to_string(dirty) + "_of_" + std::to_string(total_pages), dirty * page_size);
+        for(std::size_t i = 0, n = run.Iterations(200); i < n; ++i) {
+            for(std::size_t page = 0; page < dirty; ++page) {
+                ((volatile char*)view)[(page * total_pages / dirty) * page_size] = (char)i;
+            }
+            const LONGLONG start = bench::Ticks();
+            msync(view, view_size, MS_SYNC);
+            m.samples.push_back(bench::Nanoseconds(bench::Ticks() - start));
+        }
+    }
+    munmap(view, view_size);
+    DropScratchFile(fd, path);
+}
+
+MEMMAP_BENCHMARK(mincore_range) {
+    // alternate committed and reserved stretches to maximize the number of VirtualQuery calls
+    const long page_size = getpagesize();
+    const std::size_t size = 256 * kMiB;
+    const std::size_t stretch = kMiB;
+    char* base = (char*)VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+    assert(base);
+    for(std::size_t offset = 0; offset < size; offset += 2 * stretch) {
+        VirtualAlloc(base + offset, stretch, MEM_COMMIT, PAGE_READWRITE);
+    }
+    std::vector<unsigned char> status(size / page_size + 1);
+    run.Measure("mincore/256m", run.Iterations(200), size, [&](std::size_t) {
+        mincore(base, size, status.data());
+    });
+    run.Counter("regions", (double)(size / stretch));
+    VirtualFree(base, 0, MEM_RELEASE);
+}
+
+MEMMAP_BENCHMARK(sysconf_query) {
+    // what an allocator pays to size its arenas: the system call vs the cached topology
+    volatile long sink = 0;
+    run.Measure("GetSystemInfo", run.Iterations(100000), 0, [&](std::size_t) {
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        sink = si.dwAllocationGranularity;
+    });
+    run.Measure("get_allocation_granularity", run.Iterations(100000), 0, [&](std::size_t) {
+        sink = get_allocation_granularity();
+    });
+    run.Measure("sysconf/_SC_LEVEL1_DCACHE_LINESIZE", run.Iterations(100000), 0, [&](std::size_t) {
+        sink = memmap_sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+    });
+    (void)sink;
+}
+
+MEMMAP_BENCHMARK(traverse_process) {
+    std::size_t regions = 0;
+    run.Measure("reserved", run.Iterations(200), 0, [&](std::size_t) {
+        regions = 0;
+        mem::TraverseAllProcessMemory([&](const MEMORY_BASIC_INFORMATION&, const MEMMAP_RANGE&) {
+            ++regions;
+        }, &mem::Reserved);
+    });
+    run.Counter("regions", (double)regions);
+
+    static std::size_t committed; // the C API visitor takes no context
+    run.Measure("committed_c_api", run.Iterations(200), 0, [&](std::size_t) {
+        committed = 0;
+        memmap_traverse_all_process_memory([](const MEMORY_BASIC_INFORMATION*, const MEMMAP_RANGE*) {
+            ++committed;
+        }, [](const MEMORY_BASIC_INFORMATION* mbi) {
+            return mem::Committed(*mbi);
+        });
+    });
+    run.Counter("regions", (double)committed);
+}
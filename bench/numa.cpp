@@ -0,0 +1,52 @@
+#include "harness.h"
+
+#include "sys/mman.h"
+#include "memmap/proc.h"
+
+#include <windows.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+namespace {
+
+constexpr std::size_t kBuffer = 64 * 1024 * 1024;
+
+} // anonymous
+
+MEMMAP_BENCHMARK(numa_bandwidth) {
+    // The thread runs on node 0; memory is placed on node 0 (local) or on the last node (remote).
+    // On single-node systems both figures describe the same node, which the counter reveals.
+    const long nodes = memmap_sysconf(_SC_NUMA_NODES);
+    ULONGLONG node0_cpus = 0;
+    DWORD_PTR previous = 0;
+    if(GetNumaNodeProcessorMask(0, &node0_cpus) && node0_cpus) {
+        previous = SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)node0_cpus);
+    }
+
+    const long targets[] = {0, nodes - 1};
+    for(long node : targets) {
+        const std::string label = (node ? "remote/node" : "local/node") + std::to_string(node);
+        void* buffer = mmap(nullptr, kBuffer, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE | MAP_NUMA_NODE(node), -1, 0);
+        assert(buffer != MAP_FAILED);
+        memset(buffer, 1, kBuffer); // first touch
+
+        run.Measure("write/" + label, run.Iterations(20), kBuffer, [&](std::size_t i) {
+            memset(buffer, (int)i, kBuffer);
+        });
+        run.Counter("nodes", (double)nodes);
+
+        volatile uint64_t sink = 0;
+        run.Measure("read/" + label, run.Iterations(20), kBuffer, [&](std::size_t) {
+            const uint64_t* words = (const uint64_t*)buffer;
+            uint64_t sum = 0;
+            for(std::size_t k = 0; k < kBuffer / sizeof(uint64_t); ++k) sum += words[k];
+            sink = sink + sum;
+        });
+        run.Counter("nodes", (double)nodes);
+        munmap(buffer, kBuffer);
+    }
+
+    if(previous) SetThreadAffinityMask(GetCurrentThread(), previous);
+}
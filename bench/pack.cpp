@@ -0,0 +1,70 @@
+#include "harness.h"
+
+#include "sys/mman.h"
+#include "memmap/conf.h"
+#include "memmap/proc.h"
+#include "memmap/iter.h"
+
+#include <windows.h>
+
+#include <algorithm>
+#include <assert.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t kMaps = 100000;
+// Live maps per round; unpacked, a round reserves kRound * 64 KiB, which a 32-bit process can afford.
+constexpr std::size_t kRound = 10000;
+
+/* Address space reserved by private (VirtualAlloc) regions of the whole process. */
+std::size_t ReservedPrivateBytes() {
+    std::size_t total = 0;
+    mem::TraverseAllProcessMemory([&](const MEMORY_BASIC_INFORMATION& mbi, const MEMMAP_RANGE& range) {
+        if(mbi.Type == MEM_PRIVATE) total += MEMMAP_RANGE_SIZE(range);
+    }, &mem::Reserved);
+    return total;
+}
+
+} // anonymous
+
+MEMMAP_BENCHMARK(pack_small_anon) {
+    const std::size_t page_size = getpagesize();
+    const std::size_t sizes[] = {page_size, 4 * page_size};
+    const bool modes[] = {false, true};
+    for(std::size_t size : sizes) {
+        for(bool packed : modes) {
+            set_mmap_pack_small_anonymous(packed ? size : 0);
+            const std::string suffix = std::string(packed ? "packed/" : "plain/") + std::to_string(size / 1024) + "k";
+            const std::size_t total = run.Iterations(kMaps);
+            const std::size_t round = std::min(total, kRound);
+            std::vector<void*> live(round);
+
+            bench::Measurement& maps = run.Begin("mmap/" + suffix, size);
+            bench::Measurement& unmaps = run.Begin("munmap/" + suffix, size);
+            double reserved_per_map = 0.;
+            for(std::size_t done = 0; done < total; done += round) {
+                const std::size_t n = std::min(round, total - done);
+                const std::size_t before = done ? 0 : ReservedPrivateBytes();
+                for(std::size_t i = 0; i < n; ++i) {
+                    const LONGLONG start = bench::Ticks();
+                    live[i] = mmap(nullptr, size, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+                    maps.samples.push_back(bench::Nanoseconds(bench::Ticks() - start));
+                    assert(live[i] != MAP_FAILED);
+                }
+                if(!done) {
+                    reserved_per_map = double(ReservedPrivateBytes() - before) / n;
+                }
+                for(std::size_t i = 0; i < n; ++i) {
+                    const LONGLONG start = bench::Ticks();
+                    munmap(live[i], size);
+                    unmaps.samples.push_back(bench::Nanoseconds(bench::Ticks() - start));
+                }
+            }
+            run.Counter("reserved_bytes_per_map", reserved_per_map);
+            run.Counter("address_space_efficiency", size / reserved_per_map);
+        }
+    }
+    set_mmap_pack_small_anonymous(0); // the default
+}
@@ -0,0 +1,39 @@
+#include "harness.h"
+
+#include "sys/mman.h"
+#include "memmap/purge.h"
+
+#include <windows.h>
+#include <assert.h>
+#include <string.h>
+
+namespace {
+
+constexpr std::size_t kEntry = 4 << 20; // a decoded image
+
+} // anonymous
+
+MEMMAP_BENCHMARK(purge_cycle) {
+    // an idle cache entry given back and reused: free + rebuild versus unpin + pin
+    const std::size_t iterations = run.Iterations(64);
+
+    run.Measure("unmap_rebuild", iterations, kEntry, [&](std::size_t) {
+        void* entry = mmap(nullptr, kEntry, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        assert(entry != MAP_FAILED);
+        memset(entry, 0x5a, kEntry); // "decode"
+        munmap(entry, kEntry);
+    });
+
+    mem::PurgeableRegion entry(kEntry, 2);
+    assert(entry);
+    memset(entry.Data(), 0x5a, kEntry);
+    std::size_t lost = 0;
+    run.Measure("unpin_pin", iterations, kEntry, [&](std::size_t) {
+        entry.Unpin();
+        if(entry.Pin() != MEMMAP_PURGE_INTACT) {
+            memset(entry.Data(), 0x5a, kEntry); // rebuild only when purged
+            ++lost;
+        }
+    });
+    run.Counter("purged", (double)lost);
+}
@@ -0,0 +1,31 @@
+#include "harness.h"
+
+#include "sys/mman.h"
+#include "memmap/conf.h"
+#include "memmap/proc.h"
+
+#include <assert.h>
+#include <string>
+
+MEMMAP_BENCHMARK(recycle_anon) {
+    // an allocator cycling same-sized spans: mmap + touch + munmap
+    const std::size_t page_size = getpagesize();
+    const std::size_t sizes[] = {64 * 1024, 1024 * 1024};
+    const int modes[] = {0, MAP_ANONYMOUS, MAP_ANONYMOUS | MAP_UNINITIALIZED}; // 0 => cache off
+    for(std::size_t size : sizes) {
+        for(int mode : modes) {
+            set_mmap_recycle_policy(mode ? 64 * size : 0, size, 1000);
+            const int flags = MAP_ANONYMOUS | MAP_PRIVATE | (mode & MAP_UNINITIALIZED);
+            const char* label = !mode ? "off/" : (mode & MAP_UNINITIALIZED) ? "uninitialized/" : "zeroed/";
+            run.Measure(label + std::to_string(size / 1024) + "k", run.Iterations(5000), size, [&](std::size_t) {
+                void* addr = mmap(nullptr, size, PROT_DATA, flags, -1, 0);
+                assert(addr != MAP_FAILED);
+                for(std::size_t offset = 0; offset < size; offset += page_size) {
+                    ((volatile char*)addr)[offset] = '#';
+                }
+                munmap(addr, size);
+            });
+        }
+    }
+    set_mmap_recycle_policy(0, 0, 0); // the default; drained by the trimmer
+}
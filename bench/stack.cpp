@@ -0,0 +1,66 @@
+#include "harness.h"
+
+#include "sys/mman.h"
+#include "memmap/proc.h"
+#include "memmap/stack.h"
+
+#include <windows.h>
+#include <assert.h>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t kStackSize = 256 << 10;
+constexpr std::size_t kFrameDepth = 8 << 10; // what a typical coroutine touches
+
+/* A coroutine's lifetime, as far as its stack is concerned: frames from the top down. */
+void Run(char* stack, std::size_t size, std::size_t depth) {
+    const std::size_t page_size = getpagesize();
+    for(std::size_t offset = page_size; offset <= depth; offset += page_size) {
+        ((volatile char*)stack)[size - offset] = 1;
+    }
+}
+
+std::size_t Resident(char* stack, std::size_t size) {
+    const std::size_t page_size = getpagesize();
+    std::vector<unsigned char> status(size / page_size);
+    mincore(stack, size, status.data());
+    std::size_t pages = 0;
+    for(unsigned char page : status) pages += page & 1;
+    return pages * page_size;
+}
+
+} // anonymous
+
+MEMMAP_BENCHMARK(stack_coroutines) {
+    // many coroutines alive at once, each touching a few pages of its stack
+    const std::size_t count = run.quick ? 1000 : 10000;
+    std::vector<char*> stacks(count);
+
+    // the status quo: MAP_STACK is a hint, so the whole stack is committed
+    bench::Measurement& plain = run.Begin("mmap_stack");
+    for(std::size_t i = 0; i < count; ++i) {
+        const LONGLONG start = bench::Ticks();
+        stacks[i] = (char*)mmap(nullptr, kStackSize, PROT_DATA, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+        Run(stacks[i], kStackSize, kFrameDepth);
+        plain.samples.push_back(bench::Nanoseconds(bench::Ticks() - start));
+    }
+    run.Counter("resident_per_stack", (double)Resident(stacks[0], kStackSize));
+    run.Counter("committed_per_stack", (double)kStackSize);
+    for(char* stack : stacks) munmap(stack, kStackSize);
+
+    mem::StackPool pool(kStackSize, count);
+    assert(pool);
+    for(const char* phase : {"pool_cold", "pool_warm"}) {
+        bench::Measurement& pooled = run.Begin(phase);
+        for(std::size_t i = 0; i < count; ++i) {
+            const LONGLONG start = bench::Ticks();
+            stacks[i] = pool.Acquire();
+            Run(stacks[i], kStackSize, kFrameDepth); // grows through the guard page once or twice
+            pooled.samples.push_back(bench::Nanoseconds(bench::Ticks() - start));
+        }
+        run.Counter("resident_per_stack", (double)Resident(stacks[0], kStackSize));
+        run.Counter("committed_per_stack", (double)memmap_stack_committed(stacks[0]));
+        for(char* stack : stacks) pool.Release(stack);
+    }
+}
@@ -0,0 +1,47 @@
+#include "harness.h"
+
+#include "sys/mman.h"
+#include "memmap/tags.h"
+
+#include <assert.h>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t kMappings = 256; // per sample
+constexpr std::size_t kLength = 64 << 10;
+
+/* Maps and unmaps `kMappings` anonymous mappings. */
+void Churn(std::vector<void*>& mappings) {
+    for(void*& mapping : mappings) {
+        mapping = mmap(nullptr, kLength, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        assert(mapping != MAP_FAILED);
+    }
+    for(void* mapping : mappings) munmap(mapping, kLength);
+}
+
+} // anonymous
+
+MEMMAP_BENCHMARK(tags_mmap) {
+    // the cost of tagging on the mmap path: with no tag set, and with this thread's
+    const std::size_t iterations = run.Iterations(200);
+    std::vector<void*> mappings(kMappings);
+    run.Measure("untagged", iterations, kMappings * kLength, [&](std::size_t) { Churn(mappings); });
+    run.Measure("tagged", iterations, kMappings * kLength, [&](std::size_t) {
+        mem::TagScope scope("bench churn");
+        Churn(mappings);
+    });
+
+    // totals over many small tagged ranges
+    for(void*& mapping : mappings) {
+        mem::TagScope scope((&mapping - mappings.data()) % 2 ? "bench odd" : "bench even");
+        mapping = mmap(nullptr, kLength, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        assert(mapping != MAP_FAILED);
+        *(volatile char*)mapping = 1;
+    }
+    memmap_tag_usage usage[16];
+    std::size_t tags = 0;
+    run.Measure("usage", run.Iterations(50), 0, [&](std::size_t) { tags = memmap_tag_usage_get(usage, 16); });
+    run.Counter("tags", (double)tags);
+    for(void* mapping : mappings) munmap(mapping, kLength);
+}
@@ -0,0 +1,64 @@
+#include "harness.h"
+
+#include "memmap/window.h"
+
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#include <assert.h>
+#include <stdint.h>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t kReadChunk = 1 << 20;
+
+/* Something the compiler cannot drop: a sum of 64-bit words. */
+uint64_t Checksum(const char* data, std::size_t size) {
+    uint64_t sum = 0;
+    const std::size_t words = size / sizeof(uint64_t);
+    for(std::size_t i = 0; i < words; ++i) sum += ((const uint64_t*)data)[i];
+    for(std::size_t i = words * sizeof(uint64_t); i < size; ++i) sum += (unsigned char)data[i];
+    return sum;
+}
+
+} // anonymous
+
+MEMMAP_BENCHMARK(window_scan) {
+    // a sequential pass over a file several times larger than one window
+    const uint64_t size = run.quick ? (64ull << 20) : (1ull << 30);
+    const std::string path = run.ScratchFile("window");
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_TEMPORARY, nullptr);
+    assert(file != INVALID_HANDLE_VALUE);
+    std::vector<char> chunk(kReadChunk);
+    for(std::size_t i = 0; i < kReadChunk; ++i) chunk[i] = (char)(i * 131);
+    DWORD io = 0;
+    for(uint64_t written = 0; written < size; written += kReadChunk) {
+        WriteFile(file, chunk.data(), kReadChunk, &io, nullptr);
+    }
+    CloseHandle(file);
+
+    uint64_t expected = 0;
+    run.Measure("readfile", run.Iterations(4), size, [&](std::size_t) {
+        HANDLE in = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        uint64_t sum = 0;
+        while(ReadFile(in, chunk.data(), kReadChunk, &io, nullptr) && io) sum += Checksum(chunk.data(), io);
+        CloseHandle(in);
+        expected = sum;
+    });
+
+    int fd = open(path.c_str(), O_RDONLY | O_BINARY);
+    assert(fd >= 0);
+    run.Measure("file_window", run.Iterations(4), size, [&](std::size_t) {
+        mem::FileWindow window(fd, 64 << 20, 0);
+        uint64_t sum = 0;
+        window.Scan([&](const char* data, std::size_t available, uint64_t) {
+            sum += Checksum(data, available);
+        });
+        assert(sum == expected);
+    });
+    close(fd);
+    DeleteFileA(path.c_str());
+}
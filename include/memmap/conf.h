@@ -63,23 +63,21 @@ typedef HANDLE(*handle_from_posix_fd_hook)(int fd, void* hint);
 int set_handle_from_posix_fd_hook(handle_from_posix_fd_hook hook, void * hint);
 
 /**
- * As there is no obvious way to determine `fd` access mode from itself or the
- * corresponding file HANDLE, and there is at most one FileMapping object per
- * file handle (and, therefore, per file descriptor), the following modes have
- * been suggested to infer the "write" and "access" bits:
+ * A CRT file descriptor opened read-only (or any CRT descriptor, for the execute bit)
+ * has a file HANDLE without the access a writable (executable) section requires, so
+ * such views would fail where POSIX allows them. The access of each handle is queried
+ * once and cached; when a view needs more, the handle is reopened (`ReOpenFile`) and
+ * the reopened handle is kept for the fd's later views. For the "write" and "execute"
+ * bits separately:
  *
- * *_eager => assume maximum access;
- * *_probe => try grabbing as much as possible;
- * *_asreq => request as much access as the specific mapping requests.
+ * *_eager => reopen with the bit on the first mapping of the fd, needed or not;
+ * *_probe => reopen when a view first needs a bit, grabbing all probed bits at once;
+ * *_asreq => never reopen: the view gets the access the fd has, or fails with EACCES.
  *
- * This is, of course, a hackaround. A better solution would rather duplicate
- * and/or reopen file handles when an incompatible access mode is required.
- * However, in practice, this is mostly needed to support executable files
- * (that contain code, readonly data and modifiable "initial" data together),
- * and that case is covered by `set_mmap_apply_executable_image_sections()`.
- * 
- * Therefore, this API should be considered unstable and *_asreq assumed to
- * be the current hardcoded behavior; but we will monitor real-life use cases.
+ * Rights the file refuses are remembered and not asked for again; a descriptor that
+ * is not open for reading fails with EACCES under any policy. The default is *_probe.
+ * Without NtQueryObject, for handles it does not describe, or in emergency mode, the
+ * access is not inferred and the section fails as it would (EACCES).
  */
 enum fd_access_inference_policy
 {
@@ -124,6 +122,80 @@ void set_madvise_dontneed_decommits(int decommit);
  */
 void set_madvise_offer_resoluteness(int res);
 
+/**
+ * Pass nonzero to make anonymous mappings of a large page or more (see `gethugepagesize`)
+ * from a placeholder, so that MADV_HUGEPAGE can move them to large pages in place (see
+ * memmap/huge.h). It costs one more VirtualAlloc2 per such `mmap`. The default is off:
+ * MADV_HUGEPAGE then leaves every mapping on small pages and counts a fallback.
+ */
+void set_mmap_hugepage_promotable(int promotable);
+
+/**
+ * Pack anonymous mappings of up to `max_length` bytes into shared reservations.
+ * `VirtualAlloc` reserves address space in allocation granularity units (64 KiB),
+ * so an unpacked one-page `mmap` occupies 16 pages of address space. Packed mappings
+ * are committed page by page inside shared granules; `munmap` decommits their pages
+ * and releases a granule once it is empty. Requests with an address hint, MAP_HUGETLB
+ * or in emergency mode are never packed. 0 (the default) disables packing; values are
+ * capped at one granule minus one page.
+ * NOTE: packed mappings share their AllocationBase. Release them with `munmap`, not with
+ *       VirtualFree(..., MEM_RELEASE).
+ */
+void set_mmap_pack_small_anonymous(size_t max_length);
+
+/**
+ * Recycle unmapped anonymous regions. `munmap` parks whole, unmodified anonymous
+ * mappings of up to `max_length` bytes in a cache instead of freeing them, and `mmap`
+ * requests of the same length (without an address hint or MAP_HUGETLB) reuse them.
+ * MAP_HUGETLB and NUMA-placed mappings (MAP_NUMA_NODE, a process policy, `mbind`)
+ * are never cached.
+ * Reused memory is zero-filled unless MAP_UNINITIALIZED is passed.
+ * A background thread decommits entries idle for `max_idle_ms` or exceeding `budget`
+ * bytes, and releases decommitted entries idle for another `max_idle_ms`.
+ * `budget` == 0 (the default) disables the cache and drains it in the background.
+ */
+void set_mmap_recycle_policy(size_t budget, size_t max_length, unsigned max_idle_ms);
+
+/**
+ * Process-wide NUMA placement of new mappings (`mmap` without MAP_NUMA_NODE):
+ * *_default => wherever the first touch happens (plain VirtualAlloc);
+ * *_preferred => on `node` (VirtualAllocExNuma/MapViewOfFileExNuma);
+ * *_interleave => anonymous mappings alternate between all nodes one allocation
+ *                 granule at a time; file views alternate mapping by mapping.
+ * `set_mempolicy` (numaif.h) sets the same policy with a Linux-style nodemask.
+ * The node count is available as `memmap_sysconf(_SC_NUMA_NODES)`.
+ */
+enum mmap_numa_policy
+{
+    mmap_numa_policy__default = 0,
+    mmap_numa_policy__preferred,
+    mmap_numa_policy__interleave,
+};
+
+void set_mmap_numa_policy(enum mmap_numa_policy policy, int node);
+
+/**
+ * Placement of mappings without an address hint:
+ * *_system => wherever `VirtualAlloc`/`MapViewOfFile` put them (the lowest fitting address);
+ * *_best_fit => in the free block of address space of the smallest size class that fits
+ *               (see `memmap_fragmentation_get`): at the bottom of the lowest such block
+ *               for mappings under `large_length` bytes (0 means 1 MiB), at the top of the
+ *               highest one for larger mappings, so that small ones do not splinter the
+ *               large free blocks. Meant for 32-bit processes whose large mappings fail
+ *               on a fragmented address space.
+ * The free blocks are indexed; `mmap` and `munmap` keep the index current, and it is
+ * rescanned every 256 placements to catch up with other allocators (the loader, heaps,
+ * thread stacks). Packed, recycled, NUMA-placed, MAP_GROWSDOWN and MAP_HUGETLB mappings
+ * keep their own placement, and so does everything in emergency mode.
+ */
+enum mmap_placement_policy
+{
+    mmap_placement_policy__system = 0,
+    mmap_placement_policy__best_fit,
+};
+
+void set_mmap_placement_policy(enum mmap_placement_policy policy, size_t large_length);
+
 /**
  * strict => ENOMEM if `mincore` range exceeds memory available to applications;
  *           ENOMEM if `mincore` range contains logically unmapped memory;
@@ -148,6 +220,7 @@ const char* get_shared_memory_dir();
  * All internal bookkeeping is thence stopped, as no graceful termination is expected to follow.
  * `mmap` is the primary API call expected to respect this mode. `mincore` switches to no-alloc,
  * more CPU-intensive algorithms. `munmap` should be left to bacteria and scavengers.
+ * The C traversal API (memmap/iter.h) and the dump writer (memmap/dump.h) never allocate.
  */
 void emergency_mode_assume_unreliable_heap();
 
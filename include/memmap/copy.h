@@ -0,0 +1,50 @@
+#ifndef _MEMMAP_COPY_H_
+#define _MEMMAP_COPY_H_
+
+#include "sys/mman.h" /* off64_t */
+
+#include <stddef.h>
+#include <sys/types.h> /* ssize_t */
+
+/**
+ * File copies without a bounce buffer.
+ *
+ * The source is mapped a window at a time (the file-view path of `mmap`, granularity
+ * padding included) and each window goes straight to `WriteFile` in large chunks,
+ * so the data crosses memory once instead of twice (read into a buffer, then write
+ * out of it). The next window is prefetched while the current one is written. A disk
+ * destination is extended to its final size once, before the first write.
+ *
+ * File descriptors go through the same fd-to-HANDLE conversion as `mmap` (see
+ * `set_handle_from_posix_fd_func`); a converter that knows about sockets makes
+ * `memmap_sendfile` work for them. The source must be a regular file.
+ */
+
+/* __BEGIN_DECLS */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Linux `copy_file_range`: copies up to `len` bytes from `fd_in` at `*off_in` to
+ * `fd_out` at `*off_out`, and advances the offsets. A NULL offset means the file
+ * position, which is used and advanced instead. `flags` must be 0. Returns the number
+ * of bytes copied (less than `len` at the end of the source, 0 past it), or -1 and
+ * `errno` (EBADF, EINVAL, EIO, ENOMEM) if nothing could be copied. The ranges must
+ * not overlap if both descriptors refer to the same file.
+ */
+ssize_t memmap_copy_file_range(int fd_in, off64_t* off_in, int fd_out, off64_t* off_out, size_t len, unsigned flags);
+
+/**
+ * Linux `sendfile`: writes up to `count` bytes of `in_fd`, from `*offset` (or the
+ * file position if NULL), to `out_fd` at its current position (a file, pipe or socket
+ * handle). Returns the number of bytes written, or -1 and `errno`.
+ */
+ssize_t memmap_sendfile(int out_fd, int in_fd, off64_t* offset, size_t count);
+
+/* __END_DECLS */
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MEMMAP_COPY_H_ */
@@ -0,0 +1,90 @@
+#ifndef _MEMMAP_DUMP_H_
+#define _MEMMAP_DUMP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <windows.h>
+
+/**
+ * Heap-free memory dump writer for crash handlers.
+ *
+ * The writer uses only static storage: no heap, no std::function, no CRT stdio.
+ * It streams every committed, readable region of the process straight from memory
+ * into the file with large unbuffered `WriteFile` calls, skipping ranges excluded
+ * with MADV_DONTDUMP, MAP_CONCEAL or `memmap_dump_exclude`. WER is not involved.
+ *
+ * File layout (all offsets in bytes, all blocks MEMMAP_DUMP_BLOCK aligned):
+ *
+ *   [header block][region data...][index block]...[region data...][index block]
+ *
+ * Region data is written in address order. Index blocks follow the data they
+ * describe and are chained backwards (`prev_index`); the header, rewritten last,
+ * points to the final index block. A reader walks the chain from there.
+ */
+
+#define MEMMAP_DUMP_BLOCK 4096
+#define MEMMAP_DUMP_MAGIC "MMAPDUMP"
+#define MEMMAP_DUMP_VERSION 1
+
+/* memmap_dump_region.flags */
+#define MEMMAP_DUMP_PARTIAL 0x1 /* some pages became unreadable while dumping; zeroes written instead */
+
+typedef struct memmap_dump_header {
+    char magic[8];        /* MEMMAP_DUMP_MAGIC, not NUL terminated */
+    uint32_t version;     /* MEMMAP_DUMP_VERSION */
+    uint32_t page_size;
+    uint32_t pointer_bits;
+    uint32_t process_id;
+    uint64_t region_count;
+    uint64_t data_bytes;  /* sum of region sizes */
+    uint64_t last_index;  /* offset of the last index block; 0 if there are no regions */
+    uint64_t excluded_bytes;
+} memmap_dump_header;
+
+typedef struct memmap_dump_region {
+    uint64_t base;        /* virtual address */
+    uint64_t size;
+    uint64_t offset;      /* file offset of the contents */
+    uint32_t protect;     /* MEMORY_BASIC_INFORMATION.Protect */
+    uint16_t type;        /* MEM_IMAGE, MEM_MAPPED, MEM_PRIVATE >> 16 */
+    uint16_t flags;       /* MEMMAP_DUMP_* */
+} memmap_dump_region;
+
+typedef struct memmap_dump_index {
+    uint64_t prev_index;  /* offset of the previous index block; 0 for the first one */
+    uint32_t count;       /* valid entries */
+    uint32_t reserved;
+    memmap_dump_region regions[(MEMMAP_DUMP_BLOCK - 16) / sizeof(memmap_dump_region)];
+} memmap_dump_index;
+
+/* __BEGIN_DECLS */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Writes a dump of the calling process to a new file at `path` (opened unbuffered).
+ * Safe to call from a crash handler with a corrupted heap. Not reentrant: concurrent
+ * calls fail with EBUSY. Returns 0 on success, -1 and `errno` on failure.
+ */
+int memmap_dump_write(const char* path);
+
+/* Same, to an open handle (written from its current position, which must be block aligned). */
+int memmap_dump_write_handle(HANDLE file);
+
+/**
+ * Excludes [addr, addr+length) from dumps (`madvise(MADV_DONTDUMP)` and MAP_CONCEAL
+ * call this too). The exclusion table has a fixed capacity; ENOMEM when it is full.
+ * `munmap` cancels the exclusions of what it unmaps.
+ */
+int memmap_dump_exclude(const void* addr, size_t length);
+
+/* Cancels exclusions overlapping [addr, addr+length), in whole pages (`madvise(MADV_DODUMP)`). */
+int memmap_dump_include(const void* addr, size_t length);
+
+/* __END_DECLS */
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MEMMAP_DUMP_H_ */
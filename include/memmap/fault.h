@@ -0,0 +1,109 @@
+#ifndef _MEMMAP_FAULT_H_
+#define _MEMMAP_FAULT_H_
+
+#include <stddef.h>
+
+/**
+ * Lazily materialized memory: pages are filled by a callback on first access
+ * (the use case of Linux `userfaultfd`, e.g. restoring a snapshot in O(touched pages)).
+ *
+ * A fault region is pagefile-backed and mapped twice: the view handed out starts out
+ * PAGE_NOACCESS, and a private read-write alias is where the callback writes. The
+ * first access to a page raises an access violation; a library-owned vectored
+ * exception handler calls the fill callback for the chunk of `batch` pages around it
+ * (through the alias), opens the chunk up with the requested protection and resumes
+ * the thread. Other threads touching the chunk meanwhile wait for the fill to finish
+ * and never see it half-written. Pages are charged against the commit limit up front,
+ * but occupy RAM only once filled.
+ *
+ * The callback runs on the faulting thread, inside the exception handler and under a
+ * per-region lock: it must not touch unfilled pages of any fault region, and it should
+ * not throw. Reads from files, decompression and copies are fine.
+ */
+
+/* __BEGIN_DECLS */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct memmap_fault_region memmap_fault_region;
+
+/**
+ * Fills `length` bytes at `dest` with the contents of the region at `offset` (both
+ * page-aligned; `length` is one chunk, or less at the end of the region). Returns 0
+ * on success. Nonzero leaves the chunk inaccessible: the fault is passed on to other
+ * handlers (and usually crashes the process), and the next access tries again.
+ */
+typedef int (*memmap_fault_fill)(void* dest, size_t length, size_t offset, void* ctx);
+
+/**
+ * Creates a region of `length` bytes (rounded up to the page size) filled on demand in
+ * chunks of `batch` pages (0 means 1). `prot` is PROT_READ or PROT_READ | PROT_WRITE.
+ * Returns NULL and sets `errno` (EINVAL, ENOMEM) on failure.
+ */
+memmap_fault_region* memmap_fault_register(size_t length, int prot, size_t batch, memmap_fault_fill fill, void* ctx);
+
+/* Waits for fills in progress and unmaps the region. */
+void memmap_fault_unregister(memmap_fault_region* region);
+
+/* The address of the region and its (rounded) length. */
+void* memmap_fault_base(const memmap_fault_region* region);
+size_t memmap_fault_length(const memmap_fault_region* region);
+
+/**
+ * Fills the chunks overlapping [offset, offset+length) that have not been filled yet,
+ * ahead of access (like MADV_WILLNEED). Returns 0, or -1 and `errno` (EINVAL, or EIO if
+ * the callback failed).
+ */
+int memmap_fault_populate(memmap_fault_region* region, size_t offset, size_t length);
+
+typedef struct memmap_fault_stats {
+    size_t faults;   /* accesses that triggered a fill */
+    size_t fills;    /* chunks filled, by faults or `memmap_fault_populate` */
+    size_t failures; /* fill callbacks that returned nonzero */
+} memmap_fault_stats;
+
+void memmap_fault_get_stats(const memmap_fault_region* region, memmap_fault_stats* stats);
+
+/* __END_DECLS */
+#ifdef __cplusplus
+}
+
+#include <functional>
+#include <utility>
+
+namespace mem {
+
+/* RAII owner of a `memmap_fault_region` with a `std::function` fill callback. */
+class LazyRegion {
+public:
+    using Fill = std::function<bool(char* dest, size_t length, size_t offset)>;
+
+    LazyRegion(size_t length, int prot, size_t batch, Fill fill)
+        : _fill(std::move(fill)), _region(memmap_fault_register(length, prot, batch, &Trampoline, this)) {}
+    ~LazyRegion() { if(_region) memmap_fault_unregister(_region); }
+    LazyRegion(const LazyRegion&) = delete;
+    LazyRegion& operator=(const LazyRegion&) = delete;
+
+    explicit operator bool() const { return _region; }
+    memmap_fault_region* get() const { return _region; }
+
+    char* Data() const { return (char*)memmap_fault_base(_region); }
+    size_t Length() const { return memmap_fault_length(_region); }
+
+    bool Populate(size_t offset, size_t length) { return !memmap_fault_populate(_region, offset, length); }
+
+private:
+    static int Trampoline(void* dest, size_t length, size_t offset, void* ctx) {
+        return ((LazyRegion*)ctx)->_fill((char*)dest, length, offset) ? 0 : -1;
+    }
+
+    Fill _fill;
+    memmap_fault_region* _region;
+};
+
+} // namespace mem
+
+#endif // __cplusplus
+
+#endif /* _MEMMAP_FAULT_H_ */
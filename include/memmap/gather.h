@@ -0,0 +1,80 @@
+#ifndef _MEMMAP_GATHER_H_
+#define _MEMMAP_GATHER_H_
+
+#include "sys/mman.h"
+
+#include <stddef.h>
+
+/**
+ * Scatter-gather mapping: one contiguous virtual range over file segments that are
+ * scattered across one or more files.
+ *
+ * The range is reserved as a whole (a placeholder, see memmap/grow.h for the caveats
+ * on systems older than Windows 10 1803), and each extent is mapped into its slot,
+ * in order, right behind the previous one. File descriptors go through the same
+ * fd-to-HANDLE conversion as `mmap` (see `set_handle_from_posix_fd_func`).
+ *
+ * Alignment constraints (G is the allocation granularity, usually 64 KiB):
+ *  - the first extent may start at any file offset; as with `mmap`, the view then
+ *    starts at the granule containing it and the returned address is offset into it;
+ *  - every other extent must start at a multiple of G in its file;
+ *  - every extent but the last must end at a multiple of G in the virtual range:
+ *    for the first one, (offset % G + length) % G == 0; for the others, length % G == 0;
+ *  - the last extent may have any length.
+ * Violations fail with EINVAL.
+ */
+
+/* __BEGIN_DECLS */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct memmap_extent {
+    int fd;
+    off64_t offset;
+    size_t length;
+} memmap_extent;
+
+/**
+ * Maps `count` extents back to back with `mmap`-style `prot` and `flags` (MAP_SHARED
+ * or MAP_PRIVATE). Returns the address of the first byte of the first extent and
+ * stores the total length in `*length` (if not NULL). Returns MAP_FAILED and sets
+ * `errno` (EINVAL, EBADF, EACCES, ENOMEM) on failure; nothing stays mapped then.
+ */
+void* memmap_gather(const memmap_extent* extents, size_t count, int prot, int flags, size_t* length);
+
+/* Unmaps a range returned by `memmap_gather` (`addr` and `length` as returned). */
+int memmap_gather_unmap(void* addr, size_t length);
+
+/* __END_DECLS */
+#ifdef __cplusplus
+}
+
+#include <vector>
+
+namespace mem {
+
+/* RAII owner of a gathered range. */
+class GatheredView {
+public:
+    GatheredView(const std::vector<memmap_extent>& extents, int prot, int flags = MAP_SHARED)
+        : _data(memmap_gather(extents.data(), extents.size(), prot, flags, &_length)) {}
+    ~GatheredView() { if(_data != MAP_FAILED) memmap_gather_unmap(_data, _length); }
+    GatheredView(const GatheredView&) = delete;
+    GatheredView& operator=(const GatheredView&) = delete;
+
+    explicit operator bool() const { return _data != MAP_FAILED; }
+
+    char* Data() const { return (char*)_data; }
+    size_t Length() const { return _length; }
+
+private:
+    size_t _length = 0;
+    void* _data;
+};
+
+} // namespace mem
+
+#endif // __cplusplus
+
+#endif /* _MEMMAP_GATHER_H_ */
@@ -0,0 +1,102 @@
+#ifndef _MEMMAP_GROW_H_
+#define _MEMMAP_GROW_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Growable file mappings for append-only files (logs, journals).
+ *
+ * `memmap_grow_open` reserves `capacity` bytes of address space and maps the file
+ * at its start. Appending past the mapped part extends the file and maps the new
+ * part right behind the old one, so the mapping grows in place: the base address
+ * never changes and pointers into the file stay valid for the lifetime of the
+ * mapping. The file is made sparse, so extending it costs no zero-filling I/O.
+ *
+ * The file is extended ahead of the data, in steps of at least the allocation
+ * granularity; `memmap_grow_close` truncates it back to the appended length.
+ *
+ * The reservation is a placeholder on Windows 10 1803 and newer. Older systems
+ * have no placeholders: the range is found free at open time but not held, and
+ * growth fails with ENOMEM if something else has been mapped there since.
+ */
+
+/* __BEGIN_DECLS */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct memmap_growable memmap_growable;
+
+/**
+ * Maps the file behind `fd` (which must stay open, and writable) read-write and
+ * shared, with `capacity` bytes of address space (rounded up to the allocation
+ * granularity; the size limit of the file). The appended length starts at the
+ * current file size. Returns NULL and sets `errno` (EBADF, EINVAL, EACCES, ENOMEM)
+ * on failure.
+ */
+memmap_growable* memmap_grow_open(int fd, size_t capacity);
+
+/**
+ * Unmaps the file and truncates it to the appended length. Returns 0 on success,
+ * -1 and `errno` if the file could not be truncated (the mapping is gone anyway).
+ */
+int memmap_grow_close(memmap_growable* growable);
+
+/* The stable start address of the mapping. */
+void* memmap_grow_base(const memmap_growable* growable);
+
+/* Bytes appended (including the initial file contents), mapped, and reserved. */
+size_t memmap_grow_length(const memmap_growable* growable);
+size_t memmap_grow_mapped(const memmap_growable* growable);
+size_t memmap_grow_capacity(const memmap_growable* growable);
+
+/* Makes sure [0, length) is mapped, growing the file and the view as needed. Returns 0 or -1 and `errno`. */
+int memmap_grow_reserve(memmap_growable* growable, size_t length);
+
+/**
+ * Claims the next `size` bytes of the file and returns their address (zeroes until
+ * written). Thread safe. Returns NULL and sets `errno` (ENOMEM when the capacity is
+ * exhausted or the view cannot grow).
+ */
+void* memmap_grow_append(memmap_growable* growable, size_t size);
+
+/* __END_DECLS */
+#ifdef __cplusplus
+}
+
+#include <string.h>
+
+namespace mem {
+
+/* RAII owner of a `memmap_growable`. */
+class GrowableFile {
+public:
+    GrowableFile(int fd, size_t capacity) : _growable(memmap_grow_open(fd, capacity)) {}
+    ~GrowableFile() { if(_growable) memmap_grow_close(_growable); }
+    GrowableFile(const GrowableFile&) = delete;
+    GrowableFile& operator=(const GrowableFile&) = delete;
+
+    explicit operator bool() const { return _growable; }
+    memmap_growable* get() const { return _growable; }
+
+    char* Base() const { return (char*)memmap_grow_base(_growable); }
+    size_t Length() const { return memmap_grow_length(_growable); }
+
+    void* Claim(size_t size) { return memmap_grow_append(_growable, size); }
+
+    /* Copies `data` to the end of the file. Returns its address in the mapping, or nullptr. */
+    void* Append(const void* data, size_t size) {
+        void* at = Claim(size);
+        return at ? memcpy(at, data, size) : nullptr;
+    }
+
+private:
+    memmap_growable* _growable;
+};
+
+} // namespace mem
+
+#endif // __cplusplus
+
+#endif /* _MEMMAP_GROW_H_ */
@@ -0,0 +1,124 @@
+#ifndef _MEMMAP_HEAT_H_
+#define _MEMMAP_HEAT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Page heat profiling: which pages of a mapping are hot, and which are cold.
+ *
+ * The profiler samples working set membership (`QueryWorkingSetEx`) of the pages of
+ * registered regions. After reading a page, it removes it from the working set
+ * (`VirtualUnlock` on unlocked pages does that; locked and large pages are left
+ * alone), so a page found resident at the next sample has been accessed since. The
+ * page comes back with a soft fault, without I/O. Each page has an access counter.
+ * The report condenses them into a histogram per region.
+ *
+ * Overhead is bounded by the sampling interval and by the number of pages examined
+ * per sample. Regions are visited round robin, so a pass over large regions takes
+ * several samples. A region's first pass only primes it, because residency from
+ * before the profiler started says nothing about recent accesses.
+ */
+
+/* __BEGIN_DECLS */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct memmap_heat_profiler memmap_heat_profiler;
+
+typedef struct memmap_heat_config {
+    unsigned interval_ms;   /* between samples (0 means 100) */
+    size_t pages_per_sample; /* the overhead bound (0 means 4096) */
+    int keep_resident;      /* nonzero: never trim, i.e. count residency rather than accesses */
+} memmap_heat_config;
+
+/* Creates a stopped profiler (`config` NULL for the defaults). Returns NULL and sets `errno` (ENOMEM). */
+memmap_heat_profiler* memmap_heat_create(const memmap_heat_config* config);
+
+/* Stops the profiler and frees it. */
+void memmap_heat_destroy(memmap_heat_profiler* profiler);
+
+/* Registers [addr, addr+length) (rounded out to pages). Returns the region index, or -1 and `errno`. */
+int memmap_heat_add(memmap_heat_profiler* profiler, void* addr, size_t length);
+
+/**
+ * Registers every committed private and mapped (not image) region of the process,
+ * as found by the traversal API (memmap/iter.h) right now. Returns the number of
+ * regions added, or -1 and `errno`.
+ */
+int memmap_heat_add_process(memmap_heat_profiler* profiler);
+
+/* Starts and stops the sampling thread. Return 0, or -1 and `errno`. */
+int memmap_heat_start(memmap_heat_profiler* profiler);
+int memmap_heat_stop(memmap_heat_profiler* profiler);
+
+/* Takes one sample on the calling thread (for manual pacing, e.g. between workload phases). */
+void memmap_heat_sample(memmap_heat_profiler* profiler);
+
+/**
+ * The histogram of a region: bucket 0 holds the pages never accessed; bucket b > 0
+ * the pages accessed in at least (b-1)/7 (but less than b/7) of the passes, the last
+ * bucket including those accessed in every pass.
+ */
+#define MEMMAP_HEAT_BUCKETS 8
+
+typedef struct memmap_heat_histogram {
+    void* addr;
+    size_t length;
+    unsigned passes; /* counted passes over the region */
+    size_t pages[MEMMAP_HEAT_BUCKETS];
+} memmap_heat_histogram;
+
+/**
+ * Stores the histograms of up to `capacity` regions in `out`. Returns the number of
+ * registered regions (which may exceed `capacity`).
+ */
+size_t memmap_heat_report(memmap_heat_profiler* profiler, memmap_heat_histogram* out, size_t capacity);
+
+/**
+ * Copies the per-page access counts of region `index` (up to `capacity` pages) to
+ * `counts`. Returns the number of pages in the region, or 0 and EINVAL.
+ */
+size_t memmap_heat_counts(memmap_heat_profiler* profiler, int index, uint16_t* counts, size_t capacity);
+
+/* __END_DECLS */
+#ifdef __cplusplus
+}
+
+#include <vector>
+
+namespace mem {
+
+/* RAII owner of a `memmap_heat_profiler`. */
+class HeatProfiler {
+public:
+    explicit HeatProfiler(const memmap_heat_config* config = nullptr) : _profiler(memmap_heat_create(config)) {}
+    ~HeatProfiler() { if(_profiler) memmap_heat_destroy(_profiler); }
+    HeatProfiler(const HeatProfiler&) = delete;
+    HeatProfiler& operator=(const HeatProfiler&) = delete;
+
+    explicit operator bool() const { return _profiler; }
+    memmap_heat_profiler* get() const { return _profiler; }
+
+    int Add(void* addr, size_t length) { return memmap_heat_add(_profiler, addr, length); }
+    bool Start() { return !memmap_heat_start(_profiler); }
+    bool Stop() { return !memmap_heat_stop(_profiler); }
+    void Sample() { memmap_heat_sample(_profiler); }
+
+    std::vector<memmap_heat_histogram> Report() {
+        std::vector<memmap_heat_histogram> report(memmap_heat_report(_profiler, nullptr, 0));
+        const size_t regions = memmap_heat_report(_profiler, report.data(), report.size());
+        if(regions < report.size()) report.resize(regions);
+        return report;
+    }
+
+private:
+    memmap_heat_profiler* _profiler;
+};
+
+} // namespace mem
+
+#endif // __cplusplus
+
+#endif /* _MEMMAP_HEAT_H_ */
@@ -0,0 +1,56 @@
+#ifndef _MEMMAP_HUGE_H_
+#define _MEMMAP_HUGE_H_
+
+#include <stddef.h>
+
+/**
+ * Large pages for regions found hot at run time (`madvise(MADV_HUGEPAGE)`).
+ *
+ * MAP_HUGETLB has to be chosen when memory is allocated; MADV_HUGEPAGE migrates an
+ * existing anonymous read-write mapping instead. The part of the advised range that
+ * is aligned to the large page size (`gethugepagesize`) moves to a pagefile-backed
+ * section of large pages: the section is filled with a copy of the data, and the
+ * range is swapped for a view of it with placeholder replacement (VirtualAlloc2 and
+ * MapViewOfFile3, Windows 10 1803+). The small pages around it, up to the ends of
+ * the allocation, are copied back into private memory of their own.
+ *
+ * The advice is taken synchronously, and only for whole allocations: the advised
+ * range must cover the allocation but for less than a large page at either end.
+ * To make the swap possible in place, `mmap` creates anonymous mappings of a large
+ * page or more from a placeholder, once `set_mmap_hugepage_promotable` (memmap/conf.h)
+ * is on: only those mappings can be promoted. During the swap the allocation reverts to that
+ * placeholder, so its addresses are never free for another allocation to take, but
+ * its pages are briefly inaccessible: no other thread may touch the mapping until
+ * `madvise` returns. Anything that does not qualify -- other memory, a lack of
+ * SeLockMemoryPrivilege (see MAP_HUGETLB), an older system -- stays on small pages
+ * and is counted as a fallback; `madvise` succeeds either way, as on Linux. If a
+ * failed swap cannot put the data back, `madvise` fails with ENOMEM: the range stays
+ * reserved but its contents are gone.
+ *
+ * A promoted mapping is several allocations (a view and up to two private ones):
+ * `munmap` releases them together when the whole mapping goes, and a partial `munmap`
+ * decommits the small pages it covers but leaves the large ones mapped. `mprotect`
+ * must not span two of them. MADV_NOHUGEPAGE is accepted and changes nothing.
+ */
+
+/* __BEGIN_DECLS */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct memmap_hugepage_stats {
+    size_t promotions;     /* advised mappings moved to large pages */
+    size_t promoted_bytes; /* ...and the bytes now on large pages */
+    size_t fallbacks;      /* advised ranges left on small pages */
+    size_t promoted;       /* promoted mappings currently mapped */
+} memmap_hugepage_stats;
+
+/* Process-wide counters since startup. */
+void memmap_hugepage_get_stats(memmap_hugepage_stats* stats);
+
+/* __END_DECLS */
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MEMMAP_HUGE_H_ */
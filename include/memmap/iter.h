@@ -54,6 +54,30 @@ void Traverse(const MEMMAP_RANGE& range, RangeVisitor visitor, RangePredicate pr
 
 void TraverseAllProcessMemory(RangeVisitor visitor, RangePredicate predicate = &Committed);
 
+/* The application address space: from lpMinimumApplicationAddress to lpMaximumApplicationAddress. */
+MEMMAP_RANGE ProcessRange();
+
+/**
+ * Allocation-free `Traverse`, usable in emergency mode: `visitor` and `predicate`
+ * are invoked directly rather than through std::function.
+ */
+template<typename Visitor, typename Predicate>
+void TraverseInPlace(const MEMMAP_RANGE& range, Visitor&& visitor, Predicate&& predicate) {
+    MEMMAP_RANGE subrange = range;
+    MEMORY_BASIC_INFORMATION mbi;
+    while((uintptr_t)subrange.lower < (uintptr_t)range.upper) {
+        if(!VirtualQuery(subrange.lower, &mbi, sizeof(mbi))) break; // beyond the address space
+        void* homog_until = (void*)((uintptr_t)mbi.BaseAddress + mbi.RegionSize);
+
+        if(predicate(mbi)) {
+            subrange.upper = (uintptr_t)homog_until < (uintptr_t)range.upper ? homog_until : range.upper;
+            visitor(mbi, subrange);
+        }
+
+        subrange.lower = homog_until;
+    }
+}
+
 } // namespace mem
 
 #endif // __cplusplus
@@ -0,0 +1,99 @@
+#ifndef _MEMMAP_JIT_H_
+#define _MEMMAP_JIT_H_
+
+#include <stddef.h>
+
+/**
+ * W^X code regions for code generators.
+ *
+ * A region is one pagefile-backed section mapped twice: once read-write (where the
+ * generator emits and patches code) and once read-execute (where the code runs).
+ * No page is ever writable and executable at the same address, and no `mprotect`
+ * round trip is needed per patch. Writes are tracked as dirty ranges and
+ * `memmap_jit_publish` flushes the instruction cache over exactly those ranges
+ * (which matters on ARM, where the data and instruction caches are not coherent).
+ *
+ * Addresses returned by the allocator are pairs: `rw` for writing, `rx` for calling.
+ * Both views have the same layout; `memmap_jit_exec_address` and
+ * `memmap_jit_write_address` translate between them.
+ */
+
+/* __BEGIN_DECLS */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct memmap_jit_region memmap_jit_region;
+
+/**
+ * Creates a region of at least `capacity` bytes (rounded up to the allocation
+ * granularity). Returns NULL and sets `errno` (ENOMEM, EACCES) on failure.
+ */
+memmap_jit_region* memmap_jit_create(size_t capacity);
+
+/* Unmaps both views. Code in the region must no longer be running. */
+void memmap_jit_destroy(memmap_jit_region* region);
+
+/**
+ * Bump-allocates `size` bytes aligned to `align` (a power of two; 0 means 16),
+ * so small stubs share pages. Returns the writable address and stores the
+ * executable one in `*rx` (if not NULL). The new block is marked dirty.
+ * Returns NULL and sets `errno` to ENOMEM when the region is exhausted.
+ */
+void* memmap_jit_alloc(memmap_jit_region* region, size_t size, size_t align, void** rx);
+
+/* Rewinds the bump allocator. Previously handed out code must no longer be used. */
+void memmap_jit_reset(memmap_jit_region* region);
+
+/* Marks [rw, rw+length) as modified (e.g. after patching previously published code). */
+void memmap_jit_dirty(memmap_jit_region* region, const void* rw, size_t length);
+
+/**
+ * Makes modified code visible to the instruction stream: one `FlushInstructionCache`
+ * per coalesced dirty range. Returns 0 on success, -1 (EFAULT) if a flush failed.
+ */
+int memmap_jit_publish(memmap_jit_region* region);
+
+/* Address translation between the two views; NULL if the address is outside the region. */
+void* memmap_jit_exec_address(const memmap_jit_region* region, const void* rw);
+void* memmap_jit_write_address(const memmap_jit_region* region, const void* rx);
+
+/* Bytes handed out by the bump allocator so far, and the total capacity. */
+size_t memmap_jit_used(const memmap_jit_region* region);
+size_t memmap_jit_capacity(const memmap_jit_region* region);
+
+/* __END_DECLS */
+#ifdef __cplusplus
+}
+
+namespace mem {
+namespace jit {
+
+/* RAII owner of a `memmap_jit_region`. */
+class CodeRegion {
+public:
+    explicit CodeRegion(size_t capacity) : _region(memmap_jit_create(capacity)) {}
+    ~CodeRegion() { if(_region) memmap_jit_destroy(_region); }
+    CodeRegion(const CodeRegion&) = delete;
+    CodeRegion& operator=(const CodeRegion&) = delete;
+
+    explicit operator bool() const { return _region; }
+    memmap_jit_region* get() const { return _region; }
+
+    void* Alloc(size_t size, size_t align = 0, void** rx = nullptr) { return memmap_jit_alloc(_region, size, align, rx); }
+    void Dirty(const void* rw, size_t length) { memmap_jit_dirty(_region, rw, length); }
+    bool Publish() { return !memmap_jit_publish(_region); }
+    void Reset() { memmap_jit_reset(_region); }
+
+    template<typename F> F* Exec(const void* rw) const { return (F*)memmap_jit_exec_address(_region, rw); }
+
+private:
+    memmap_jit_region* _region;
+};
+
+} // namespace jit
+} // namespace mem
+
+#endif // __cplusplus
+
+#endif /* _MEMMAP_JIT_H_ */
@@ -0,0 +1,21 @@
+#ifndef _MEMMAP_MAPS_H_
+#define _MEMMAP_MAPS_H_
+
+/* C++ conveniences over the address space rendering of memmap/proc.h */
+
+#ifndef __cplusplus
+#error "memmap/maps.h is C++ only: C code calls `memmap_maps_text` (memmap/proc.h)"
+#endif
+
+#include "memmap/proc.h"
+
+#include <string>
+
+namespace mem {
+
+/* `memmap_maps_text` into a string, retried until the address space holds still. */
+std::string ProcessMaps();
+
+} // namespace mem
+
+#endif /* _MEMMAP_MAPS_H_ */
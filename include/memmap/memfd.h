@@ -0,0 +1,93 @@
+#ifndef _MEMMAP_MEMFD_H_
+#define _MEMMAP_MEMFD_H_
+
+#include "sys/mman.h" /* memfd_create, MFD_*, off64_t */
+
+#include <windows.h>
+#include <stdint.h>
+
+/**
+ * Anonymous memory with a file descriptor (Linux `memfd_create`).
+ *
+ * The memory is an unnamed section backed by the page file, reserved at its maximum
+ * size (SEC_RESERVE) and committed as `memmap_ftruncate` grows it. Unlike anonymous
+ * `mmap`, it can be mapped any number of times, at once (`mmap` with MAP_SHARED and
+ * the fd), and shared with other processes.
+ *
+ * The CRT cannot wrap a section handle, so the fd wraps a placeholder handle (to the
+ * NUL device) which `mmap` and friends recognize through the fd-to-HANDLE conversion
+ * (see `set_handle_from_posix_fd_func`). Reading and writing the fd fails; map it.
+ * The section is released when the fd is closed and the last view is unmapped.
+ *
+ * Another process does not know the placeholder; pass it the section instead (see
+ * `memmap_memfd_section`) and let it open its own fd with `memmap_memfd_open`.
+ */
+
+/* __BEGIN_DECLS */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * `memfd_create` with an explicit maximum size (0 means the default: 1 GiB, or
+ * 256 MiB on 32-bit targets), beyond which `memmap_ftruncate` fails with EFBIG. The
+ * maximum costs no memory, but the kernel reserves page tables for it. `name` is
+ * only traced. Returns an fd, or -1 and `errno` (EFAULT, EINVAL, EMFILE, ENOMEM).
+ */
+int memmap_memfd_create(const char* name, unsigned flags, uint64_t max_size);
+
+/**
+ * `ftruncate` that understands memfds: growing one commits the new pages (ENOMEM if
+ * the commit limit is reached), shrinking one zeroes the cut pages so that they read
+ * as zeros if it grows again (they stay committed until the memfd is released).
+ * Other fds are regular files, resized with `SetFileInformationByHandle`.
+ * Returns 0, or -1 and `errno` (EBADF, EFBIG, EINVAL, EIO, ENOMEM, ENOSPC).
+ */
+int memmap_ftruncate(int fd, off64_t length);
+
+/**
+ * The section behind a memfd (owned by the fd; NULL and EBADF if `fd` is not one).
+ * It is inheritable unless the memfd was created with MFD_CLOEXEC; otherwise hand it
+ * to another process with `DuplicateHandle`.
+ */
+HANDLE memmap_memfd_section(int fd);
+
+/**
+ * A new memfd for a section received from another process (inherited or duplicated);
+ * `section` is left open. `flags` is 0 or MFD_CLOEXEC. Returns an fd, or -1 and
+ * `errno` (EINVAL if `section` is not a page file section).
+ */
+int memmap_memfd_open(HANDLE section, unsigned flags);
+
+/* __END_DECLS */
+#ifdef __cplusplus
+}
+
+#include <io.h> /* _close */
+
+namespace mem {
+
+/* RAII owner of a memfd. */
+class MemFd {
+public:
+    explicit MemFd(const char* name, unsigned flags = 0, uint64_t max_size = 0)
+        : _fd(memmap_memfd_create(name, flags, max_size)) {}
+    ~MemFd() { if(_fd >= 0) _close(_fd); }
+    MemFd(const MemFd&) = delete;
+    MemFd& operator=(const MemFd&) = delete;
+
+    explicit operator bool() const { return _fd >= 0; }
+    int fd() const { return _fd; }
+    HANDLE section() const { return memmap_memfd_section(_fd); }
+
+    bool Truncate(off64_t length) { return !memmap_ftruncate(_fd, length); }
+
+private:
+    int _fd;
+};
+
+} // namespace mem
+
+#endif // __cplusplus
+
+#endif /* _MEMMAP_MEMFD_H_ */
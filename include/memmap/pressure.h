@@ -0,0 +1,99 @@
+#ifndef _MEMMAP_PRESSURE_H_
+#define _MEMMAP_PRESSURE_H_
+
+#include <stddef.h>
+
+/**
+ * Memory pressure notifications, so that caches can shrink before the system pages.
+ *
+ * The system maintains two memory resource notifications (see MSDN on
+ * `CreateMemoryResourceNotification`): "low" when available physical memory drops
+ * below a threshold the memory manager derives from the installed size, and "high"
+ * when plenty is available. In between, neither is signaled. One watcher thread,
+ * started on the first subscription, follows the transitions between these three
+ * levels and calls the subscribers with each new level. Unlike Linux PSI triggers,
+ * the thresholds are system-wide and cannot be tuned.
+ *
+ * Regions offered with `memmap_pressure_offer` are also released automatically when
+ * the level drops to low, with `madvise(MADV_DONTNEED)`, i.e. discarded, or offered
+ * with the resoluteness set by `set_madvise_offer_resoluteness` when
+ * `set_madvise_dontneed_decommits` is on (memmap/conf.h). Their contents are lost
+ * either way; the owner learns about it from its own subscription.
+ */
+
+/* __BEGIN_DECLS */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum memmap_pressure_level
+{
+    memmap_pressure__low = -1,  /* available memory is low: shrink */
+    memmap_pressure__normal = 0,
+    memmap_pressure__high = 1,  /* available memory is plentiful: caches may grow */
+};
+
+typedef void (*memmap_pressure_callback)(enum memmap_pressure_level level, void* ctx);
+
+/**
+ * Subscribes `callback` to level transitions. It runs on the watcher thread, which
+ * it should not block for long. Only transitions are reported: a later subscriber
+ * should check `memmap_pressure_current` for the level it starts at. Returns a positive subscription ID, or -1 and
+ * `errno` (ENOMEM, EAGAIN if the watcher could not be started).
+ */
+int memmap_on_pressure(memmap_pressure_callback callback, void* ctx);
+
+/**
+ * Cancels a subscription. Once this returns, the callback is no longer running
+ * (unless called from the callback itself). Returns 0, or -1 and EINVAL.
+ */
+int memmap_pressure_unsubscribe(int id);
+
+/* The current level, queried from the system. */
+enum memmap_pressure_level memmap_pressure_current(void);
+
+/**
+ * Registers [addr, addr+length) to be released automatically (see above) on every
+ * transition to low. Returns 0, or -1 and `errno` (EINVAL, ENOMEM, EAGAIN).
+ */
+int memmap_pressure_offer(void* addr, size_t length);
+
+/* Unregisters the region starting at `addr`. Returns 0, or -1 and EINVAL if unknown. */
+int memmap_pressure_withdraw(void* addr);
+
+/* __END_DECLS */
+#ifdef __cplusplus
+}
+
+#include <functional>
+#include <utility>
+
+namespace mem {
+
+/* RAII subscription to memory pressure transitions. */
+class PressureSubscription {
+public:
+    using Callback = std::function<void(memmap_pressure_level)>;
+
+    explicit PressureSubscription(Callback callback)
+        : _callback(std::move(callback)), _id(memmap_on_pressure(&Trampoline, this)) {}
+    ~PressureSubscription() { if(_id > 0) memmap_pressure_unsubscribe(_id); }
+    PressureSubscription(const PressureSubscription&) = delete;
+    PressureSubscription& operator=(const PressureSubscription&) = delete;
+
+    explicit operator bool() const { return _id > 0; }
+
+private:
+    static void Trampoline(memmap_pressure_level level, void* ctx) {
+        ((PressureSubscription*)ctx)->_callback(level);
+    }
+
+    Callback _callback;
+    int _id;
+};
+
+} // namespace mem
+
+#endif // __cplusplus
+
+#endif /* _MEMMAP_PRESSURE_H_ */
@@ -3,6 +3,13 @@
 
 /* process memory layout query */
 
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __linux__
+#include <unistd.h> /* the Linux baseline backend: ahead of `getpagesize` and the _SC_* names below */
+#endif
+
 #ifdef __cplusplus
 
 /* C++ interfaces */
@@ -23,9 +30,93 @@ extern "C" {
 #define _SC_PAGE_SIZE _SC_PAGESIZE
 #endif
 
+/* Nonstandard: the number of NUMA nodes (1 on non-NUMA systems). */
+#ifndef _SC_NUMA_NODES
+#define _SC_NUMA_NODES 0x9601
+#endif
+
+/* Linux names answered from the cached topology (see `memmap_topology_get`). */
+#ifndef _SC_NPROCESSORS_CONF
+#define _SC_NPROCESSORS_CONF 0x9602
+#endif
+
+#ifndef _SC_NPROCESSORS_ONLN
+#define _SC_NPROCESSORS_ONLN 0x9603
+#endif
+
+#ifndef _SC_PHYS_PAGES
+#define _SC_PHYS_PAGES 0x9604
+#endif
+
+/* Not cached: asks the system every time. */
+#ifndef _SC_AVPHYS_PAGES
+#define _SC_AVPHYS_PAGES 0x9605
+#endif
+
+#ifndef _SC_LEVEL1_ICACHE_SIZE
+#define _SC_LEVEL1_ICACHE_SIZE 0x9610
+#define _SC_LEVEL1_ICACHE_ASSOC 0x9611
+#define _SC_LEVEL1_ICACHE_LINESIZE 0x9612
+#define _SC_LEVEL1_DCACHE_SIZE 0x9613
+#define _SC_LEVEL1_DCACHE_ASSOC 0x9614
+#define _SC_LEVEL1_DCACHE_LINESIZE 0x9615
+#define _SC_LEVEL2_CACHE_SIZE 0x9616
+#define _SC_LEVEL2_CACHE_ASSOC 0x9617
+#define _SC_LEVEL2_CACHE_LINESIZE 0x9618
+#define _SC_LEVEL3_CACHE_SIZE 0x9619
+#define _SC_LEVEL3_CACHE_ASSOC 0x961a
+#define _SC_LEVEL3_CACHE_LINESIZE 0x961b
+#endif
+
+/* Nonstandard: see `get_allocation_granularity` and `gethugepagesize`. */
+#ifndef _SC_ALLOCATION_GRANULARITY
+#define _SC_ALLOCATION_GRANULARITY 0x9620
+#endif
+
+#ifndef _SC_LARGE_PAGESIZE
+#define _SC_LARGE_PAGESIZE 0x9621
+#endif
+
+typedef struct memmap_cache_info {
+    size_t size;           /* bytes; 0 if there is no such cache (or it is unknown) */
+    unsigned line_size;
+    unsigned associativity; /* ways; 0xff is fully associative */
+} memmap_cache_info;
+
+/**
+ * Static facts about the machine, queried once (on first use) and cached for the
+ * lifetime of the process. Processor counts cover all processor groups.
+ */
+typedef struct memmap_topology {
+    size_t page_size;
+    size_t allocation_granularity;
+    size_t large_page_size;  /* 0 if large pages are not supported */
+    void* min_address;       /* lowest and highest application addresses */
+    void* max_address;
+    unsigned processors;     /* logical processors */
+    unsigned cores;          /* physical cores; equals `processors` without SMT */
+    unsigned numa_nodes;
+    uint64_t phys_pages;     /* installed memory visible to Windows, in pages */
+    unsigned cache_line;     /* the L1 data cache line size; 64 if unknown */
+    memmap_cache_info l1i;
+    memmap_cache_info l1d;
+    memmap_cache_info l2;
+    memmap_cache_info l3;
+} memmap_topology;
+
+/* The cached topology. Never NULL; the first call queries the system. */
+const memmap_topology* memmap_topology_get(void);
+
+/* Accessors for the hot paths of allocators (no system calls past the first one). */
+static inline size_t memmap_cache_line_size(void) { return memmap_topology_get()->cache_line; }
+static inline unsigned memmap_processor_count(void) { return memmap_topology_get()->processors; }
+static inline unsigned memmap_numa_node_count(void) { return memmap_topology_get()->numa_nodes; }
+static inline uint64_t memmap_phys_pages(void) { return memmap_topology_get()->phys_pages; }
+
 /**
  * Either a wrapper of runtime-provided `sysconf` or a replacement of it.
- * Provides the virtual memory allocation unit (page size).
+ * Provides the virtual memory allocation unit (page size) and the _SC_* names
+ * defined above; others are passed on to `sysconf`, if the runtime has one.
  * NOTE: hardcoded PAGE_SIZE and PAGE_SHIFT are defined in <ddk/wdm.h>
  *      from the ReactOS DDK package as:
  * `#define PAGE_SHIFT  12`
@@ -44,9 +135,69 @@ int gethugepagesize();
 int get_allocation_granularity();
 
 /**
- * We could introduce constants representing allocation granilarity etc., but if
- * the caller knows what they mean, it can as well call GetSystemInfo() directly.
+ * Renders the address space of the calling process in the format of Linux
+ * `/proc/self/maps`, one line per mapping:
+ *
+ *   lower-upper perms offset dev inode pathname
+ *
+ * `perms` are derived from the current protection; the fourth letter is `s` for
+ * shareable file views and `p` otherwise (private memory, images, copy-on-write views).
+ * Reserved (not committed) ranges appear as `---p`. `offset` is relative to the
+ * allocation base of the view (Windows does not report the file offset of a view);
+ * `dev` and `inode` are always zero. `pathname` is the UTF-8 DOS path of the mapped
+ * file or image, empty for private memory unless it is tagged (`[anon:<name>]`, see
+ * memmap/tags.h). Adjacent regions of the same allocation with identical attributes
+ * and tags are merged, and the file name is looked up once per allocation base.
+ *
+ * Writes whole lines only, followed by a NUL, into `buffer` (which may be NULL if
+ * `size` is 0). Returns the length of the complete text, like `snprintf`: a result
+ * of `size` or more means the output was truncated. The address space may change
+ * between calls (allocating a larger buffer alone can change it), so retry with
+ * some slack. Does not allocate. C++ code may use `mem::ProcessMaps` (memmap/maps.h).
  */
+size_t memmap_maps_text(char* buffer, size_t size);
+
+/**
+ * Binary form of the same, as a sequence of 8-byte aligned variable-size records:
+ * a `memmap_maps_record` immediately followed by `name_length` bytes of the name,
+ * a NUL and padding. Iterate with MEMMAP_MAPS_NEXT until the end of the data.
+ */
+typedef struct memmap_maps_record {
+    uint64_t lower;
+    uint64_t upper;
+    uint64_t offset;       /* relative to the allocation base, as above */
+    uint32_t prot;         /* PROT_* */
+    uint16_t flags;        /* MAP_SHARED or MAP_PRIVATE */
+    uint16_t name_length;  /* bytes, excluding the NUL */
+} memmap_maps_record;
+
+#define MEMMAP_MAPS_NAME(record) ((const char*)((const memmap_maps_record*)(record) + 1))
+#define MEMMAP_MAPS_RECORD_SIZE(record) \
+    ((sizeof(memmap_maps_record) + (record)->name_length + 1 + 7) & ~(size_t)7)
+#define MEMMAP_MAPS_NEXT(record) \
+    ((const memmap_maps_record*)((const char*)(record) + MEMMAP_MAPS_RECORD_SIZE(record)))
+
+/* Writes whole records into `buffer`; returns the size of the complete data, as above. */
+size_t memmap_maps_binary(void* buffer, size_t size);
+
+/**
+ * Fragmentation of the address space. A free block is usable from its first allocation
+ * granule boundary on; the rest of the granule after an allocation is unusable. Block
+ * class `c` holds the free blocks of [2^c, 2^(c+1)) granules; the last class has no
+ * upper bound. Large mappings fail when `largest_free` is small, however large
+ * `free_bytes` is. Traverses the address space; does not allocate.
+ */
+#define MEMMAP_FREE_CLASSES 24
+
+typedef struct memmap_fragmentation {
+    size_t free_bytes;      /* usable */
+    size_t largest_free;
+    size_t free_blocks;
+    size_t unusable_bytes;  /* free, but off the allocation granularity */
+    size_t blocks[MEMMAP_FREE_CLASSES];
+} memmap_fragmentation;
+
+void memmap_fragmentation_get(memmap_fragmentation* report);
 
 /* __END_DECLS */
 #ifdef __cplusplus
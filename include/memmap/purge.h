@@ -0,0 +1,114 @@
+#ifndef _MEMMAP_PURGE_H_
+#define _MEMMAP_PURGE_H_
+
+#include <stddef.h>
+
+/**
+ * Purgeable ("volatile") memory for caches whose contents can be rebuilt.
+ *
+ * An idle cache entry is offered to the system (`memmap_purge_offer`): its pages
+ * leave the working set and may be discarded instead of paged out when memory runs
+ * short. Before the entry is used again it is reclaimed (`memmap_purge_reclaim`),
+ * which tells whether the contents survived. Offered pages must not be accessed,
+ * and must be reclaimed before they are unmapped: the recycling cache (see
+ * `set_mmap_recycle_policy`) would hand them out to the next `mmap` as they are.
+ *
+ * This is `OfferVirtualMemory`/`ReclaimVirtualMemory` (Windows 8.1+), which also
+ * back `madvise(MADV_DONTNEED)` when `set_madvise_dontneed_decommits` is on; unlike
+ * `madvise`, this API reports discarded contents and takes a priority per call.
+ * It applies to private committed memory (anonymous mappings) and to pagefile-backed
+ * shared mappings. On older systems offering does nothing and contents are never lost.
+ */
+
+/* __BEGIN_DECLS */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* `memmap_purge_reclaim` results besides -1 */
+#define MEMMAP_PURGE_INTACT 0
+#define MEMMAP_PURGE_LOST   1
+
+/**
+ * Offers [addr, addr+length) (`addr` page-aligned, `length` rounded up to pages).
+ * `resoluteness` is the priority, on the scale of `set_madvise_offer_resoluteness`:
+ * from 0 (discarded last) to 3 (discarded first). Returns 0, or -1 and `errno`
+ * (EINVAL, ENOMEM if the pages are not committed private or pagefile-backed memory).
+ */
+int memmap_purge_offer(void* addr, size_t length, int resoluteness);
+
+/**
+ * Makes an offered range accessible again. Returns MEMMAP_PURGE_INTACT if the
+ * contents are unchanged, MEMMAP_PURGE_LOST if some pages were discarded (the
+ * range is accessible, but its contents are undefined), or -1 and `errno`.
+ */
+int memmap_purge_reclaim(void* addr, size_t length);
+
+typedef struct memmap_purge_stats {
+    size_t offers;        /* successful `memmap_purge_offer` calls */
+    size_t offered_bytes; /* ...and the bytes they offered */
+    size_t reclaims;      /* successful `memmap_purge_reclaim` calls */
+    size_t purges;        /* ...that returned MEMMAP_PURGE_LOST */
+    size_t purged_bytes;  /* ...and the bytes they covered */
+} memmap_purge_stats;
+
+/* Process-wide counters since startup. */
+void memmap_purge_get_stats(memmap_purge_stats* stats);
+
+/* __END_DECLS */
+#ifdef __cplusplus
+}
+
+#include "sys/mman.h"
+
+namespace mem {
+
+/**
+ * An anonymous read-write mapping that can be made purgeable while unused.
+ * It starts pinned (accessible); the destructor reclaims it if need be and unmaps it.
+ */
+class PurgeableRegion {
+public:
+    explicit PurgeableRegion(size_t length, int resoluteness = 2)
+        : _length(length), _resoluteness(resoluteness),
+          _data(mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) {}
+    ~PurgeableRegion() {
+        if(_data == MAP_FAILED) return;
+        if(!_pinned) memmap_purge_reclaim(_data, _length); // see above: never unmapped while offered
+        munmap(_data, _length);
+    }
+    PurgeableRegion(const PurgeableRegion&) = delete;
+    PurgeableRegion& operator=(const PurgeableRegion&) = delete;
+
+    explicit operator bool() const { return _data != MAP_FAILED; }
+
+    char* Data() const { return (char*)_data; }
+    size_t Length() const { return _length; }
+    bool Pinned() const { return _pinned; }
+
+    /* Offers the region. Its contents must not be touched until `Pin`. */
+    bool Unpin() {
+        if(_pinned && !memmap_purge_offer(_data, _length, _resoluteness)) _pinned = false;
+        return !_pinned;
+    }
+
+    /* Reclaims the region: MEMMAP_PURGE_INTACT, MEMMAP_PURGE_LOST (rebuild it) or -1. */
+    int Pin() {
+        if(_pinned) return MEMMAP_PURGE_INTACT;
+        const int result = memmap_purge_reclaim(_data, _length);
+        if(result >= 0) _pinned = true;
+        return result;
+    }
+
+private:
+    size_t _length;
+    int _resoluteness;
+    void* _data;
+    bool _pinned = true;
+};
+
+} // namespace mem
+
+#endif // __cplusplus
+
+#endif /* _MEMMAP_PURGE_H_ */
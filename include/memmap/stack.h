@@ -0,0 +1,93 @@
+#ifndef _MEMMAP_STACK_H_
+#define _MEMMAP_STACK_H_
+
+#include <stddef.h>
+
+/**
+ * Pooled stacks for coroutines and fibers.
+ *
+ * Stacks are MAP_GROWSDOWN mappings: the full size is reserved, but only the top
+ * few pages are committed, and a guard page below them commits more as the stack
+ * grows, the way Windows thread stacks work. A coroutine that never recurses deeply
+ * costs a few pages of commit charge and only the pages it touches in RAM.
+ *
+ * Released stacks are kept for reuse, with everything below their initially
+ * committed top decommitted, so a stack that once ran deep does not stay large.
+ * Reused stacks are not zeroed. The pool is thread safe.
+ */
+
+/* __BEGIN_DECLS */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct memmap_stack_pool memmap_stack_pool;
+
+/**
+ * Creates a pool of stacks of `stack_size` bytes each (rounded up to the page size;
+ * 0 means 1 MiB, the default thread stack size) that keeps up to `max_idle` released
+ * stacks for reuse. Returns NULL and sets `errno` (ENOMEM) on failure.
+ */
+memmap_stack_pool* memmap_stack_pool_create(size_t stack_size, size_t max_idle);
+
+/* Unmaps the idle stacks and frees the pool. All stacks must have been released. */
+void memmap_stack_pool_destroy(memmap_stack_pool* pool);
+
+/**
+ * Returns the lowest address of a stack; the stack pointer starts at that address
+ * plus `memmap_stack_size(pool)`. Returns NULL and sets `errno` (ENOMEM) on failure.
+ */
+void* memmap_stack_acquire(memmap_stack_pool* pool);
+
+/* Returns a stack to the pool (or unmaps it if the pool is full). It must no longer be in use. */
+void memmap_stack_release(memmap_stack_pool* pool, void* stack);
+
+/* The size of the pool's stacks (rounded up). */
+size_t memmap_stack_size(const memmap_stack_pool* pool);
+
+/* Bytes of a pooled (or any MAP_GROWSDOWN) stack committed so far. */
+size_t memmap_stack_committed(void* stack);
+
+typedef struct memmap_stack_stats {
+    size_t created;  /* stacks mapped */
+    size_t reused;   /* acquisitions served from idle stacks */
+    size_t idle;     /* stacks currently kept for reuse */
+    size_t trimmed;  /* bytes decommitted on release */
+} memmap_stack_stats;
+
+void memmap_stack_pool_stats(memmap_stack_pool* pool, memmap_stack_stats* stats);
+
+/* __END_DECLS */
+#ifdef __cplusplus
+}
+
+namespace mem {
+
+/* RAII owner of a `memmap_stack_pool`. */
+class StackPool {
+public:
+    explicit StackPool(size_t stack_size = 0, size_t max_idle = 64)
+        : _pool(memmap_stack_pool_create(stack_size, max_idle)) {}
+    ~StackPool() { if(_pool) memmap_stack_pool_destroy(_pool); }
+    StackPool(const StackPool&) = delete;
+    StackPool& operator=(const StackPool&) = delete;
+
+    explicit operator bool() const { return _pool; }
+    memmap_stack_pool* get() const { return _pool; }
+
+    size_t StackSize() const { return memmap_stack_size(_pool); }
+
+    /* The lowest address of a stack, and its top (the initial stack pointer). */
+    char* Acquire() { return (char*)memmap_stack_acquire(_pool); }
+    char* Top(char* stack) const { return stack + StackSize(); }
+    void Release(char* stack) { memmap_stack_release(_pool, stack); }
+
+private:
+    memmap_stack_pool* _pool;
+};
+
+} // namespace mem
+
+#endif // __cplusplus
+
+#endif /* _MEMMAP_STACK_H_ */
@@ -0,0 +1,95 @@
+#ifndef _MEMMAP_TAGS_H_
+#define _MEMMAP_TAGS_H_
+
+#include <stddef.h>
+
+/**
+ * Named mappings for memory attribution (Linux: `prctl(PR_SET_VMA, PR_SET_VMA_ANON_NAME)`).
+ *
+ * Windows knows the names of mapped files, not who allocated private memory. A tag
+ * is a short name attached to a range of mapped memory: `memmap_tag` names a range
+ * after the fact, and `memmap_tag_thread` names the anonymous mappings a thread is
+ * about to create. Anonymous tagged ranges appear in `memmap_maps_text` (and
+ * `memmap_maps_binary`) as `[anon:<name>]`, or `[anon_shmem:<name>]` for unnamed
+ * shared memory, as on Linux; mapped files keep their file names.
+ *
+ * Tags live in a side index of address ranges that `munmap` keeps up to date. Tag
+ * names are interned once and never freed, so a process should use a few of them,
+ * not one per allocation. Without a thread tag set anywhere, `mmap` pays one relaxed
+ * atomic load for the feature; `munmap` pays one as long as nothing is tagged.
+ */
+
+/* The longest tag name, as on Linux (80 bytes with the terminator). */
+#define MEMMAP_TAG_MAX 79
+
+/* __BEGIN_DECLS */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Tags [addr, addr+length) (rounded out to whole pages) with `name`, replacing any
+ * tags in the range; NULL or "" removes them. Names are printable ASCII without
+ * `[`, `]`, `\`, `$` and backquote, up to MEMMAP_TAG_MAX characters. Returns 0, or
+ * -1 with `errno` set (EINVAL for a bad name or range, ENOMEM).
+ */
+int memmap_tag(void* addr, size_t length, const char* name);
+
+/**
+ * Tags the anonymous mappings the calling thread creates with `mmap` from now on with
+ * `name`; NULL or "" stops it. Returns 0, or -1 with `errno` set (EINVAL, ENOMEM).
+ * A mapping is created untagged if the index cannot grow.
+ */
+int memmap_tag_thread(const char* name);
+
+/* The calling thread's tag for new mappings, or NULL. */
+const char* memmap_tag_thread_get(void);
+
+/* The tag of the page at `addr`, or NULL. Names stay valid for the life of the process. */
+const char* memmap_tag_get(const void* addr);
+
+typedef struct memmap_tag_usage {
+    const char* name;  /* the tag */
+    size_t reserved;   /* bytes of tagged address space still mapped */
+    size_t committed;  /* ...of which committed */
+    size_t resident;   /* ...of which in the working set */
+} memmap_tag_usage;
+
+/**
+ * Totals by tag, measured now, in the order the tags were first used. Fills up to
+ * `count` entries and returns the number of tags with ranges, which may be more;
+ * returns 0 with `errno` set (ENOMEM) if it cannot measure.
+ */
+size_t memmap_tag_usage_get(memmap_tag_usage* usage, size_t count);
+
+/* __END_DECLS */
+#ifdef __cplusplus
+}
+
+#include <vector>
+
+namespace mem {
+
+/* Tags the anonymous mappings of the calling thread while in scope, then restores the previous tag. */
+class TagScope {
+public:
+    explicit TagScope(const char* name) : _previous(memmap_tag_thread_get()), _ok(!memmap_tag_thread(name)) {}
+    ~TagScope() { memmap_tag_thread(_previous); }
+    TagScope(const TagScope&) = delete;
+    TagScope& operator=(const TagScope&) = delete;
+
+    explicit operator bool() const { return _ok; }
+
+private:
+    const char* _previous;
+    bool _ok;
+};
+
+/* `memmap_tag_usage_get` into a vector (empty if it cannot measure). */
+std::vector<memmap_tag_usage> TagUsage();
+
+} // namespace mem
+
+#endif
+
+#endif /* _MEMMAP_TAGS_H_ */
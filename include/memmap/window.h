@@ -0,0 +1,101 @@
+#ifndef _MEMMAP_WINDOW_H_
+#define _MEMMAP_WINDOW_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Streaming access to files larger than the address space.
+ *
+ * A window maps a slice of the file at a time: `window_size` bytes starting at a
+ * multiple of `window_size` (a multiple of the allocation granularity), plus an
+ * overlap of `max_span` bytes, so that any record of up to `max_span` bytes that
+ * crosses a window boundary is still contiguous in memory. When the reader moves
+ * into a window, the one after it is mapped ahead of time and prefetched in the
+ * background, and the window the reader has left is unmapped.
+ *
+ * Spans are read-only and stay valid until a span in another window is requested.
+ * A window object is meant for one reader thread.
+ */
+
+/* __BEGIN_DECLS */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct memmap_window memmap_window;
+
+/**
+ * Opens a window over the file behind `fd` (which must stay open). `window_size`
+ * is rounded up to the allocation granularity, 0 means 64 MiB; `max_span` is the
+ * largest span ever requested, 0 means 64 KiB. Returns NULL and sets `errno` on
+ * failure (EBADF, EACCES, ENOMEM).
+ */
+memmap_window* memmap_window_open(int fd, size_t window_size, size_t max_span);
+
+/* Unmaps everything. Spans obtained from the window become invalid. */
+void memmap_window_close(memmap_window* window);
+
+/* File size at the time the window was opened. */
+uint64_t memmap_window_file_size(const memmap_window* window);
+
+/**
+ * Returns the address of file offset `offset` and stores in `*available` how many
+ * bytes are contiguous from there (at least `max_span`, unless the file ends first).
+ * Returns NULL and sets `errno` (EINVAL past the end of the file, ENOMEM if mapping
+ * failed).
+ */
+const void* memmap_window_peek(memmap_window* window, uint64_t offset, size_t* available);
+
+/* [offset, offset+length) as one contiguous span; EINVAL if `length` > `max_span` or past the end. */
+const void* memmap_window_span(memmap_window* window, uint64_t offset, size_t length);
+
+/* __END_DECLS */
+#ifdef __cplusplus
+}
+
+namespace mem {
+
+/* RAII owner of a `memmap_window`. */
+class FileWindow {
+public:
+    explicit FileWindow(int fd, size_t window_size = 0, size_t max_span = 0)
+        : _window(memmap_window_open(fd, window_size, max_span)) {}
+    ~FileWindow() { if(_window) memmap_window_close(_window); }
+    FileWindow(const FileWindow&) = delete;
+    FileWindow& operator=(const FileWindow&) = delete;
+
+    explicit operator bool() const { return _window; }
+    memmap_window* get() const { return _window; }
+
+    uint64_t FileSize() const { return memmap_window_file_size(_window); }
+
+    const char* Peek(uint64_t offset, size_t* available) { return (const char*)memmap_window_peek(_window, offset, available); }
+    const char* Span(uint64_t offset, size_t length) { return (const char*)memmap_window_span(_window, offset, length); }
+
+    /**
+     * Calls `visitor(data, size, offset)` for consecutive contiguous chunks covering
+     * [offset, end of file). Stops early, returning false, if mapping fails.
+     */
+    template<typename Visitor>
+    bool Scan(Visitor&& visitor, uint64_t offset = 0) {
+        const uint64_t end = FileSize();
+        while(offset < end) {
+            size_t available = 0;
+            const char* data = Peek(offset, &available);
+            if(!data) return false;
+            visitor(data, available, offset);
+            offset += available;
+        }
+        return true;
+    }
+
+private:
+    memmap_window* _window;
+};
+
+} // namespace mem
+
+#endif // __cplusplus
+
+#endif /* _MEMMAP_WINDOW_H_ */
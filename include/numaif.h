@@ -0,0 +1,54 @@
+/**
+ * This file has no copyright assigned and is placed in the public domain.
+ * This file is part of the libmemmap compatibility library:
+ *   https://github.com/treeswift/libmemmap
+ * No warranty is given; refer to the LICENSE file in the project root.
+ */
+
+#ifndef _NUMAIF_H_
+#define _NUMAIF_H_
+
+/* NUMA memory policy, the subset of the Linux API that maps onto VirtualAllocExNuma */
+
+/* Policies. MPOL_BIND is treated as MPOL_PREFERRED: Windows node hints are never strict. */
+#define MPOL_DEFAULT    0
+#define MPOL_PREFERRED  1
+#define MPOL_BIND       2
+#define MPOL_INTERLEAVE 3 /* round robin over the nodemask, one allocation granule at a time */
+#define MPOL_LOCAL      4
+
+/* `mbind` flags */
+#define MPOL_MF_STRICT  0x1 /* EIO if committed pages could not be placed as requested */
+#define MPOL_MF_MOVE    0x2 /* migrate committed private pages (copy, decommit, recommit, copy back) */
+#define MPOL_MF_MOVE_ALL 0x4 /* same as MPOL_MF_MOVE */
+
+/* __BEGIN_DECLS */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Applies `mode` to [addr, addr+len). Windows has no per-range policy that survives
+ * later commits, so the call acts on pages committed at the time of the call:
+ * with MPOL_MF_MOVE, private pages are migrated to the requested node(s); without it,
+ * the call only validates its arguments (Linux equally leaves existing pages in place).
+ * Migration is not atomic: no other thread may access the range meanwhile. Pages are
+ * decommitted before they are recommitted; if the system then has no commit charge left,
+ * their contents are lost and the call fails with ENOMEM whatever the flags.
+ * File views cannot be migrated; with MPOL_MF_STRICT they make the call fail with EIO.
+ * New mappings take a node preference from MAP_NUMA_NODE(n) (see sys/mman.h).
+ */
+long mbind(void* addr, unsigned long len, int mode, const unsigned long* nodemask, unsigned long maxnode, unsigned flags);
+
+/* Sets the process-wide default for new mappings; see also `set_mmap_numa_policy`. */
+long set_mempolicy(int mode, const unsigned long* nodemask, unsigned long maxnode);
+
+/* Reports the process-wide default. `addr` and `flags` are not supported (EINVAL if nonzero). */
+long get_mempolicy(int* mode, unsigned long* nodemask, unsigned long maxnode, void* addr, unsigned long flags);
+
+/* __END_DECLS */
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NUMAIF_H_ */
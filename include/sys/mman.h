@@ -11,15 +11,33 @@
 #include <stddef.h>
 #include <sys/types.h> /* mode_t, off_t */
 
+/* The Linux baseline backend (meson -Dplatform=linux): the C library has them all. */
+#if defined(__linux__) && !defined(_OFF_T_DEFINED)
+#define _OFF_T_DEFINED
+#define _OFF64_T_DEFINED
+typedef off_t _off_t;
+#endif
+
+/* Fallbacks mirroring MinGW <sys/types.h>: 32-bit off_t unless _FILE_OFFSET_BITS is 64. */
 #ifndef _OFF_T_DEFINED
-#include <stdint.h>
-#ifdef _WIN64
-typedef int64_t off_t
+#define _OFF_T_DEFINED
+typedef long _off_t;
+#ifndef _OFF64_T_DEFINED
+#define _OFF64_T_DEFINED
+typedef long long off64_t;
+#endif
+#if defined(_FILE_OFFSET_BITS) && (_FILE_OFFSET_BITS == 64)
+typedef off64_t off_t;
 #else
-typedef int32_t off_t
+typedef _off_t off_t;
 #endif
 #endif
 
+#ifndef _OFF64_T_DEFINED
+#define _OFF64_T_DEFINED
+typedef long long off64_t;
+#endif
+
 #define PROT_NONE   0x0
 #define PROT_READ   0x1
 #define PROT_WRITE  0x2
@@ -30,7 +48,7 @@ typedef int32_t off_t
 #define PROT_CODE (PROT_READ | PROT_EXEC)
 #define PROT_JITC (PROT_CODE | PROT_WRITE)
 /* PROT_JITC is equivalent to PROT_MASK */
-/* PROT_WRITE | PROT_EXEC is impractical */
+/* PROT_WRITE | PROT_EXEC is impractical; see memmap/jit.h for W^X double mapping */
 
 #define MAP_SHARED  0x1 /* "sync"able to the medium; PAGE_* mode depends on flags */
 #define MAP_PRIVATE 0x2 /* copy-on-write: PAGE_WRITECOPY or PAGE_EXECUTE_WRITECOPY */
@@ -46,17 +64,24 @@ typedef int32_t off_t
 #define __MAP_NOFAULT 0x2000 /* allocate from live RAM; unsupported and unlikely */
 
 #define MAP_STACK   0x4000 /* stack segment. per documentation, may be (and is) ignored. */
-#define MAP_GROWSDOWN MAP_STACK
+#define MAP_GROWSDOWN 0x100 /* anonymous: reserved whole, committed from the top down by a guard page; see memmap/stack.h */
 
 /* BSD extensions */
-#define MAP_CONCEAL 0x8000 /* omit from core dumps (Linux: MADV_DONTDUMP) -- ignored atm */
+#define MAP_CONCEAL 0x8000000 /* omit from core dumps (Linux: MADV_DONTDUMP); see memmap/dump.h. Not OpenBSD's value */
 
 /* Linux extensions */
 #define MAP_POPULATE  0x8000 /* TODO "commit and touch" */
 #define MAP_NONBLOCK 0x10000 /* ignored */
 #define MAP_HUGETLB  0x40000 /* translates to MEM_LARGE_PAGES */
 #define MAP_SYNC     0x80000 /* persistent write guarantee; unsupported */
-#define MAP_UNINITIALIZED 0x4000000 /* don't zero out contents; ignored */
+/* libmemmap extensions */
+#define __MAP_NUMA_SHIFT 20
+#define __MAP_NUMA_MASK (0x3f << __MAP_NUMA_SHIFT)
+/* preferred NUMA node (0..62) of a new mapping; overrides the process policy (see numaif.h).
+   A node the system does not have means no preference. */
+#define MAP_NUMA_NODE(node) ((((node) + 1) << __MAP_NUMA_SHIFT) & __MAP_NUMA_MASK)
+
+#define MAP_UNINITIALIZED 0x4000000 /* don't zero out contents; honored by the recycling cache */
 
 #define MAP_FLAGMASK ~0 /* all flag bits are valid, but some are reserved for future use */
 
@@ -73,41 +98,72 @@ typedef int32_t off_t
 #define MADV_DONTNEED 0x1
 #define MADV_WILLNEED 0x2
 
+#define MADV_HUGEPAGE   0xe /* migrates the large-page-aligned part to large pages; see memmap/huge.h */
+#define MADV_NOHUGEPAGE 0xf /* accepted; promoted pages stay large */
+
 #define MADV_DONTDUMP 0x10
 #define MADV_DODUMP   0x11
 
-#define MLOCK_ONFAULT 0x10 /* unsupported on Windows */
+#define MLOCK_ONFAULT 0x10 /* accepted; pages are locked (and faulted in) immediately */
 
 #define MCL_CURRENT 0x1
-#define MCL_FUTURE  0x2 /* unsupported */
-#define MCL_ONFAULT 0x4 /* unsupported */
+#define MCL_FUTURE  0x2 /* `mmap` locks new mappings until `munlockall` */
+#define MCL_ONFAULT 0x4 /* accepted; see MLOCK_ONFAULT */
+
+#define MFD_CLOEXEC       0x1 /* the section and the fd are not inherited by child processes */
+#define MFD_ALLOW_SEALING 0x2 /* unsupported (EINVAL) */
+#define MFD_HUGETLB       0x4 /* unsupported (EINVAL) */
+
+/**
+ * On the Linux baseline backend the functions below are exported as `memmap_posix_mmap`
+ * and so on: under their POSIX names they would replace the C library's for the whole
+ * process, and leave nothing to compare against. Source code calls them as usual.
+ */
+#if defined(__linux__)
+#define __MEMMAP_NAME(name) __asm__("memmap_posix_" #name)
+#else
+#define __MEMMAP_NAME(name)
+#endif
 
 /* __BEGIN_DECLS */
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-void* mmap(void* addr, size_t length, int prot, int flags, int fd, off_t off);
-int munmap(void* addr,  size_t length);
+/**
+ * `mmap64` takes 64-bit file offsets on all targets. `mmap` keeps the 32-bit `off_t`
+ * ABI, unless _FILE_OFFSET_BITS is 64 (as in Meson builds), in which case `off_t` is
+ * 64-bit and `mmap` is an alias of `mmap64` -- like MinGW does for `lseek` et al.
+ */
+void* mmap64(void* addr, size_t length, int prot, int flags, int fd, off64_t off) __MEMMAP_NAME(mmap64);
+#if defined(_FILE_OFFSET_BITS) && (_FILE_OFFSET_BITS == 64)
+#define mmap mmap64
+#else
+void* mmap(void* addr, size_t length, int prot, int flags, int fd, off_t off) __MEMMAP_NAME(mmap);
+#endif
+int munmap(void* addr,  size_t length) __MEMMAP_NAME(munmap);
 
-int mprotect(void* addr, size_t length, int prot);
-int msync(void* addr, size_t length, int flags);
-int madvise(void* addr, size_t length, int advice);
+int mprotect(void* addr, size_t length, int prot) __MEMMAP_NAME(mprotect);
+int msync(void* addr, size_t length, int flags) __MEMMAP_NAME(msync);
+int madvise(void* addr, size_t length, int advice) __MEMMAP_NAME(madvise);
 #define posix_madvise madvise
 
-int mlock(const void* addr, size_t length);
-int mlock2(const void* addr, size_t length, int flags); /* Linux specific; our impl identical to `mlock` */
-int munlock(const void* addr, size_t length);
+int mlock(const void* addr, size_t length) __MEMMAP_NAME(mlock);
+int mlock2(const void* addr, size_t length, int flags) __MEMMAP_NAME(mlock2); /* Linux specific; our impl identical to `mlock` */
+int munlock(const void* addr, size_t length) __MEMMAP_NAME(munlock);
+
+/* Not atomic on Windows. Grows the working set limits as needed. */
+int mlockall(int flags) __MEMMAP_NAME(mlockall);
+/* Not atomic on Windows. Unlocks what has been locked with `mlock*`/`mlockall`. */
+int munlockall() __MEMMAP_NAME(munlockall);
 
-/* Not atomic on Windows */
-int mlockall(int flags);
-/* Not atomic on Windows */
-int munlockall();
+int mincore(void* start, size_t length, unsigned char* status) __MEMMAP_NAME(mincore);
 
-int mincore(void* start, size_t length, unsigned char* status);
+int shm_open(const char* filename, int open_flag, mode_t mode) __MEMMAP_NAME(shm_open);
+int shm_unlink(const char* filename) __MEMMAP_NAME(shm_unlink);
 
-int shm_open(const char* filename, int open_flag, mode_t mode);
-int shm_unlink(const char* filename);
+/* An fd backed by an unnamed page file section; see memmap/memfd.h for resizing and sharing it. */
+int memfd_create(const char* name, unsigned flags) __MEMMAP_NAME(memfd_create);
 
 /* __END_DECLS */
 #ifdef __cplusplus
@@ -1,6 +1,9 @@
 #include "sys/mman.h"
 #include "memmap/proc.h"
 #include "memmap/iter.h"
+#include "memmap/heat.h"
+#include "memmap/tags.h"
+#include "memmap/maps.h"
 
 #include <windows.h>
 #include <psapi.h> /* GetMappedFileName */
@@ -8,6 +11,8 @@
 #include <string>
 #include <functional>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 // VirtualQueryEx(HANDLE, ...) -> memory info of another process
 
@@ -50,7 +55,63 @@ std::string VisualizeProtection(DWORD prot) {
     return vis;
 }
 
-int main(int, char **) {
+/**
+ * Profile page heat of this process for `duration_ms` while it runs a skewed workload
+ * on a demo buffer: the first 1/16 is hot, the next 1/4 warm, the rest cold.
+ */
+int PrintHeat(unsigned duration_ms) {
+    constexpr size_t kDemoSize = 16 << 20;
+    const size_t page_size = getpagesize();
+    char* demo = (char*)mmap(nullptr, kDemoSize, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if(demo == MAP_FAILED) return 1;
+    memset(demo, 1, kDemoSize);
+
+    memmap_heat_config config = {};
+    config.interval_ms = 20;
+    mem::HeatProfiler profiler(&config);
+    if(!profiler || memmap_heat_add_process(profiler.get()) < 0 || !profiler.Start()) return 1;
+    const ULONGLONG until = GetTickCount64() + duration_ms;
+    for(unsigned round = 0; GetTickCount64() < until; ++round) {
+        const size_t span = (round % 4) ? kDemoSize / 16 : kDemoSize / 16 + kDemoSize / 4;
+        for(size_t offset = 0; offset < span; offset += page_size) ((volatile char*)demo)[offset] += 1;
+        Sleep(1);
+    }
+    profiler.Stop();
+
+    printf(" baseaddr-uptoaddr   length passes  never   <1/7   <2/7   <3/7   <4/7   <5/7   <6/7  <=7/7\n");
+    for(const memmap_heat_histogram& region : profiler.Report()) {
+        if(region.pages[0] * page_size == region.length) continue; // stone cold
+        printf(" %p-%p %8lx %6u", region.addr, (char*)region.addr + region.length, (unsigned long)region.length, region.passes);
+        for(size_t pages : region.pages) printf(" %6lu", (unsigned long)pages);
+        printf("%s\n", region.addr == demo ? " <- demo" : "");
+    }
+    munmap(demo, kDemoSize);
+    return 0;
+}
+
+/* Reserved, committed and resident memory by tag (see memmap/tags.h). */
+int PrintTags() {
+    printf(" reserved committed resident tag\n");
+    for(const memmap_tag_usage& usage : mem::TagUsage()) {
+        printf(" %8lx  %8lx %8lx %s\n", (unsigned long)usage.reserved, (unsigned long)usage.committed,
+               (unsigned long)usage.resident, usage.name);
+    }
+    return 0;
+}
+
+int main(int argc, char ** argv) {
+    if(argc > 1 && !strcmp(argv[1], "--maps")) { // Linux /proc/self/maps format
+        const std::string maps = mem::ProcessMaps();
+        fwrite(maps.data(), 1, maps.size(), stdout);
+        return 0;
+    }
+    if(argc > 1 && !strcmp(argv[1], "--heat")) { // optional duration in ms
+        return PrintHeat(argc > 2 ? (unsigned)atoi(argv[2]) : 2000);
+    }
+    if(argc > 1 && !strcmp(argv[1], "--tags")) {
+        return PrintTags();
+    }
+
 #ifdef PAGE_SIZE
     printf("Page size (static):\t%10ld bytes (0x%lx)\n", PAGE_SIZE, PAGE_SIZE);
 #endif
@@ -61,6 +122,10 @@ int main(int, char **) {
     printf("Large ('huge') page:\t%10ld bytes (0x%lx)\n", huge_page, huge_page);
     long allocgran = get_allocation_granularity();
     printf("Alloc-n granularity:\t%10ld bytes (0x%lx)\n", allocgran, allocgran);
+    const memmap_topology* topology = memmap_topology_get();
+    printf("Processors (cores):\t%10u (%u), %u NUMA node(s)\n", topology->processors, topology->cores, topology->numa_nodes);
+    printf("Cache line (L1d):\t%10u bytes; L1d %lu, L2 %lu, L3 %lu KiB\n", topology->cache_line,
+           (unsigned long)(topology->l1d.size >> 10), (unsigned long)(topology->l2.size >> 10), (unsigned long)(topology->l3.size >> 10));
 
     printf("\n baseaddr-uptoaddr   length req (bngrwx) -> now (bngrwx) type res name\n");
     char map_name[MAX_PATH + 1];
@@ -109,6 +174,13 @@ int main(int, char **) {
                 ? "data" :
             "----";
 
+        // anonymous memory goes by its tag, if it has one
+        const char* tag = *filename ? nullptr : memmap_tag_get(range.lower);
+        if(tag) {
+            snprintf(map_name, sizeof(map_name), "[%s]", tag);
+            filename = map_name;
+        }
+
         printf(" %p-%p %8x %s%s %s %s %s\n", range.lower, range.upper, MEMMAP_RANGE_SIZE(range),
                 vis_asreq.c_str(), vis_asnow.c_str(), vis_genre, vis_state, filename);
     }, &mem::Reserved); // show all "logical" application memory ranges, not only resident memory
@@ -1,14 +1,40 @@
 #include <stdio.h>
+#include <string.h>
 #include <fcntl.h>
+#include <sys/stat.h>
+#include <io.h>
 #include "sys/mman.h"
 #include "memmap/conf.h"
 #include "memmap/proc.h"
+#include "memmap/dump.h"
+#include "memmap/window.h"
+#include "memmap/grow.h"
+#include "memmap/gather.h"
+#include "memmap/pressure.h"
+#include "memmap/purge.h"
+#include "memmap/stack.h"
+#include "memmap/fault.h"
+#include "memmap/heat.h"
+#include "memmap/copy.h"
+#include "memmap/memfd.h"
+#include "memmap/huge.h"
+#include "memmap/tags.h"
+#include "memmap/maps.h"
+#include "memmap/jit.h"
+#include "numaif.h"
 #include <assert.h>
 #include <eh.h>
 #include <signal.h>
 #include <atomic>
+#include <vector>
 
 constexpr const char* kTestFile = "test-memmap.dat";
+constexpr const char* kDumpFile = "test-memmap.dmp";
+constexpr const char* kWindowFile = "test-memmap.win";
+constexpr const char* kSparseFile = "test-memmap.big";
+constexpr const char* kGrowFile = "test-memmap.log";
+constexpr const char* kGatherFiles[] = {"test-memmap.g0", "test-memmap.g1"};
+constexpr const char* kCopyFiles[] = {"test-memmap.src", "test-memmap.dst"};
 constexpr std::size_t kBSz = 1024;
 constexpr std::size_t kKbs = 140;
 
@@ -70,9 +96,45 @@ void test_lockall() {
     mlockall(MCL_CURRENT);
     munlockall();
     printf("m[un]lockall() test completed, errno=%d\n", errno);
+
+    GroundhogMorning();
+    assert(!mlockall(MCL_FUTURE));
+    void* future = mmap(nullptr, page_size, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    assert(future != MAP_FAILED);
+    assert(VirtualUnlock(future, page_size)); // fails unless `mmap` has locked the page
+    munlockall();
+    munmap(future, page_size);
+
+    // guard mappings are not locked (nor refused), and munmap forgets what it unlocks
+    GroundhogMorning();
+    assert(!mlockall(MCL_FUTURE));
+    void* guard = mmap(nullptr, page_size, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    assert(guard != MAP_FAILED);
+    void* gone = mmap(nullptr, page_size, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    assert(gone != MAP_FAILED);
+    munmap(gone, page_size);
+    set_mmap_strict_policy(true);
+    assert(!munlockall()); // fails if a stale range is left to unlock
+    set_mmap_strict_policy(false);
+    munmap(guard, page_size);
+    printf("mlockall(MCL_FUTURE) test completed, errno=%d\n", errno);
 }
 
 
+void test_topology() {
+    const memmap_topology* t = memmap_topology_get();
+    assert(t == memmap_topology_get()); // cached
+    assert((long)t->page_size == memmap_sysconf(_SC_PAGESIZE) && (long)t->page_size == page_size);
+    assert(memmap_sysconf(_SC_ALLOCATION_GRANULARITY) == get_allocation_granularity());
+    assert(memmap_sysconf(_SC_NPROCESSORS_ONLN) >= 1 && t->cores >= 1 && t->cores <= t->processors);
+    assert(memmap_sysconf(_SC_NUMA_NODES) >= 1);
+    assert(memmap_sysconf(_SC_AVPHYS_PAGES) > 0 && memmap_sysconf(_SC_AVPHYS_PAGES) <= memmap_sysconf(_SC_PHYS_PAGES));
+    const size_t line = memmap_cache_line_size();
+    assert(line && !(line & (line - 1)));
+    printf("topology test completed: %u processors, %u cores, %lu-byte cache lines, L2 %lu KiB.\n",
+           t->processors, t->cores, (unsigned long)line, (unsigned long)(t->l2.size >> 10));
+}
+
 void test_mincore() {
     // set_mincore_strict_policy(false); // default anyway
     GroundhogMorning();
@@ -153,6 +215,676 @@ void test_mmap() {
     printf("mmap()/msync() test completed.\n");
 }
 
+/* Finds the dump index entry covering `addr`, walking the index chain backwards. */
+bool DumpCovers(int fd, const memmap_dump_header& header, const void* addr) {
+    static memmap_dump_index index;
+    for(uint64_t pos = header.last_index; pos; pos = index.prev_index) {
+        _lseeki64(fd, pos, SEEK_SET);
+        assert(read(fd, &index, sizeof(index)) == sizeof(index));
+        for(uint32_t i = 0; i < index.count; ++i) {
+            const memmap_dump_region& r = index.regions[i];
+            if((uintptr_t)addr - r.base < r.size) return true;
+        }
+    }
+    return false;
+}
+
+void test_dump() {
+    GroundhogMorning();
+    char* pages = (char*)mmap(nullptr, 2 * page_size, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    assert(pages != MAP_FAILED);
+    pages[0] = '#';
+    pages[page_size] = '#';
+    madvise(pages + page_size, page_size, MADV_DONTDUMP);
+
+    assert(!memmap_dump_write(kDumpFile));
+    int fd = open(kDumpFile, O_RDONLY | O_BINARY);
+    memmap_dump_header header;
+    assert(read(fd, &header, sizeof(header)) == sizeof(header));
+    assert(!memcmp(header.magic, MEMMAP_DUMP_MAGIC, sizeof(header.magic)));
+    assert(header.region_count && header.last_index);
+    assert(DumpCovers(fd, header, pages));
+    assert(!DumpCovers(fd, header, pages + page_size));
+    close(fd);
+    unlink(kDumpFile);
+
+    madvise(pages + page_size, page_size, MADV_DODUMP);
+    munmap(pages, 2 * page_size);
+
+    // munmap cancels exclusions: more MAP_CONCEAL mappings than the table holds come and go
+    for(int i = 0; i < 300; ++i) {
+        void* secret = mmap(nullptr, page_size, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE | MAP_CONCEAL, -1, 0);
+        assert(secret != MAP_FAILED);
+        munmap(secret, page_size);
+    }
+    char* populated = (char*)mmap(nullptr, 2 * page_size, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE | MAP_POPULATE, -1, 0);
+    assert(populated != MAP_FAILED);
+    populated[0] = populated[page_size] = '#';
+    assert(!madvise(populated + page_size, page_size, MADV_DONTDUMP)); // the table has room left
+    assert(!memmap_dump_write(kDumpFile));
+    fd = open(kDumpFile, O_RDONLY | O_BINARY);
+    assert(read(fd, &header, sizeof(header)) == sizeof(header));
+    assert(DumpCovers(fd, header, populated)); // MAP_POPULATE is not MAP_CONCEAL
+    assert(!DumpCovers(fd, header, populated + page_size));
+    close(fd);
+    unlink(kDumpFile);
+    munmap(populated, 2 * page_size);
+    printf("memmap_dump_write() test completed: %llu regions, %llu bytes.\n",
+           (unsigned long long)header.region_count, (unsigned long long)header.data_bytes);
+}
+
+void test_maps() {
+    GroundhogMorning();
+    int fd = open(kTestFile, O_RDONLY | O_BINARY);
+    char* view = (char*)mmap(nullptr, 4 * page_size, PROT_READ, MAP_SHARED, fd, 0);
+    assert(view != MAP_FAILED);
+    mprotect(view + page_size, page_size, PROT_NONE); // two lines: r--s and ---s
+
+    const std::string maps = mem::ProcessMaps();
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "%08llx-%08llx r--s 00000000 00:00 0 ",
+             (unsigned long long)(uintptr_t)view, (unsigned long long)(uintptr_t)(view + page_size));
+    const std::size_t line = maps.find(prefix);
+    assert(line != std::string::npos);
+    assert(maps.find(kTestFile, line) < maps.find('\n', line));
+
+    // the binary form describes the same mappings
+    static char records[1 << 20];
+    const std::size_t size = memmap_maps_binary(records, sizeof(records));
+    assert(size <= sizeof(records));
+    bool found = false;
+    for(const memmap_maps_record* r = (const memmap_maps_record*)records; (const char*)r < records + size; r = MEMMAP_MAPS_NEXT(r)) {
+        if(r->lower == (uintptr_t)(view + page_size)) {
+            found = r->prot == PROT_NONE && r->flags == MAP_SHARED && r->offset == (uint64_t)page_size && strstr(MEMMAP_MAPS_NAME(r), kTestFile);
+        }
+    }
+    assert(found);
+
+    munmap(view, 4 * page_size);
+    close(fd);
+    printf("memmap_maps_text() test completed: %u bytes.\n", (unsigned)maps.size());
+}
+
+void test_window() {
+    GroundhogMorning();
+    // five windows and a bit; 13-byte records cross every window boundary
+    const std::size_t granule = get_allocation_granularity();
+    const std::size_t size = 5 * granule + 100;
+    int fd = open(kWindowFile, O_CREAT | O_TRUNC | O_RDWR | O_BINARY, _S_IREAD | _S_IWRITE);
+    assert(fd >= 0);
+    for(std::size_t i = 0; i < size; ++i) {
+        const unsigned char byte = (unsigned char)(i * 7);
+        assert(write(fd, &byte, 1) == 1);
+    }
+
+    mem::FileWindow window(fd, granule, 64);
+    assert(window && window.FileSize() == size);
+    constexpr std::size_t kRecord = 13;
+    for(uint64_t offset = 0; offset + kRecord <= size; offset += kRecord) {
+        const char* record = window.Span(offset, kRecord);
+        assert(record);
+        for(std::size_t i = 0; i < kRecord; ++i) assert((unsigned char)record[i] == (unsigned char)((offset + i) * 7));
+    }
+    assert(!window.Span(0, 65) && errno == EINVAL); // longer than max_span
+    assert(!window.Span(size - 1, 2) && errno == EINVAL); // past the end
+
+    std::size_t scanned = 0;
+    assert(window.Scan([&](const char* data, std::size_t available, uint64_t offset) {
+        assert((unsigned char)data[available - 1] == (unsigned char)((offset + available - 1) * 7));
+        scanned += available;
+    }));
+    assert(scanned == size);
+
+    close(fd);
+    unlink(kWindowFile);
+    printf("mem::FileWindow test completed.\n");
+}
+
+void test_mmap64() {
+    GroundhogMorning();
+    // a sparse file of 4 GiB and two granules, with a marker in the last granule
+    const off64_t granule = get_allocation_granularity();
+    const off64_t offset = (4ll << 30) + granule + page_size; // page aligned, granule padded
+    constexpr uint32_t kMarker = 0x6d6d3634;
+    int fd = open(kSparseFile, O_CREAT | O_TRUNC | O_RDWR | O_BINARY, _S_IREAD | _S_IWRITE);
+    assert(fd >= 0);
+    DWORD ignored = 0;
+    if(!DeviceIoControl((HANDLE)_get_osfhandle(fd), FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &ignored, nullptr)
+        || _chsize_s(fd, (4ll << 30) + 2 * granule)) {
+        printf("mmap64() test skipped: no sparse file support\n");
+        close(fd);
+        unlink(kSparseFile);
+        return;
+    }
+    assert(_lseeki64(fd, offset + 100, SEEK_SET) == offset + 100);
+    assert(write(fd, &kMarker, sizeof(kMarker)) == sizeof(kMarker));
+
+    char* view = (char*)mmap64(nullptr, page_size, PROT_READ, MAP_SHARED, fd, offset);
+    printf("mmap64(data) p=%p errno=%d\n", view, errno);
+    assert(view != MAP_FAILED);
+    assert(!memcmp(view + 100, &kMarker, sizeof(kMarker)));
+    assert(!munmap(view, page_size));
+    assert(mmap64(nullptr, page_size, PROT_READ, MAP_SHARED, fd, -page_size) == MAP_FAILED && errno == EINVAL);
+
+    close(fd);
+    unlink(kSparseFile);
+    printf("mmap64() test completed.\n");
+}
+
+void test_grow() {
+    GroundhogMorning();
+    constexpr std::size_t kChunk = 4000; // not a page multiple
+    constexpr std::size_t kChunks = 800; // about three views' worth
+    int fd = open(kGrowFile, O_CREAT | O_TRUNC | O_RDWR | O_BINARY, _S_IREAD | _S_IWRITE);
+    assert(fd >= 0);
+    {
+        mem::GrowableFile log(fd, 16 << 20);
+        assert(log && !log.Length());
+        char* const base = log.Base();
+        char chunk[kChunk];
+        for(std::size_t i = 0; i < kChunks; ++i) {
+            memset(chunk, (int)(i & 0x7f), kChunk);
+            assert(log.Append(chunk, kChunk) == base + i * kChunk);
+        }
+        assert(log.Base() == base && log.Length() == kChunks * kChunk);
+        for(std::size_t i = 0; i < kChunks; ++i) assert(base[i * kChunk + kChunk - 1] == (char)(i & 0x7f));
+        assert(!log.Claim(16 << 20) && errno == ENOMEM);
+    }
+    assert(_lseeki64(fd, 0, SEEK_END) == (off64_t)(kChunks * kChunk)); // truncated to the data
+
+    {   // reopening appends after the existing contents
+        mem::GrowableFile log(fd, 16 << 20);
+        assert(log && log.Length() == kChunks * kChunk);
+        assert(log.Base()[kChunk] == 1);
+        assert(log.Append("!", 1) == log.Base() + kChunks * kChunk);
+    }
+    close(fd);
+    unlink(kGrowFile);
+    printf("mem::GrowableFile test completed.\n");
+}
+
+void test_gather() {
+    GroundhogMorning();
+    // file #f holds bytes f*100 + offset % 97; we gather [G/2, 2G) of #0 and [0, G+100) of #1
+    const std::size_t granule = get_allocation_granularity();
+    const std::size_t sizes[] = {2 * granule, granule + 100};
+    int fds[2];
+    for(int f = 0; f < 2; ++f) {
+        fds[f] = open(kGatherFiles[f], O_CREAT | O_TRUNC | O_RDWR | O_BINARY, _S_IREAD | _S_IWRITE);
+        assert(fds[f] >= 0);
+        for(std::size_t i = 0; i < sizes[f]; ++i) {
+            const char byte = (char)(f * 100 + i % 97);
+            assert(write(fds[f], &byte, 1) == 1);
+        }
+    }
+
+    {
+        mem::GatheredView table({{fds[0], (off64_t)granule / 2, granule + granule / 2}, {fds[1], 0, granule + 100}}, PROT_READ);
+        assert(table && table.Length() == granule + granule / 2 + granule + 100);
+        for(std::size_t i = 0; i < table.Length(); ++i) {
+            const bool first = i < granule + granule / 2;
+            const std::size_t offset = first ? granule / 2 + i : i - (granule + granule / 2);
+            assert(table.Data()[i] == (char)((first ? 0 : 100) + offset % 97));
+        }
+    }
+
+    // the second extent does not start at a granule boundary of the virtual range
+    const memmap_extent misaligned[] = {{fds[0], 0, granule / 2}, {fds[1], 0, 100}};
+    assert(memmap_gather(misaligned, 2, PROT_READ, MAP_SHARED, nullptr) == MAP_FAILED && errno == EINVAL);
+
+    for(int f = 0; f < 2; ++f) {
+        close(fds[f]);
+        unlink(kGatherFiles[f]);
+    }
+    printf("memmap_gather() test completed.\n");
+}
+
+void test_pressure() {
+    GroundhogMorning();
+    // low memory cannot be staged here; check the bookkeeping and that the watcher starts
+    const memmap_pressure_level level = memmap_pressure_current();
+    assert(level >= memmap_pressure__low && level <= memmap_pressure__high);
+    std::atomic<int> transitions{0};
+    {
+        mem::PressureSubscription subscription([&](memmap_pressure_level) { ++transitions; });
+        assert(subscription);
+
+        void* cache = mmap(nullptr, kFileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        assert(cache != MAP_FAILED);
+        assert(!memmap_pressure_offer(cache, kFileSize));
+        assert(!memmap_pressure_withdraw(cache));
+        assert(memmap_pressure_withdraw(cache) == -1 && errno == EINVAL);
+        munmap(cache, kFileSize);
+    }
+    assert(memmap_pressure_unsubscribe(0) == -1 && errno == EINVAL);
+    printf("memmap_on_pressure() test completed (%d transitions seen).\n", transitions.load());
+}
+
+void test_purge() {
+    GroundhogMorning();
+    memmap_purge_stats before, after;
+    memmap_purge_get_stats(&before);
+    {
+        mem::PurgeableRegion entry(kFileSize);
+        assert(entry && entry.Pinned());
+        memset(entry.Data(), 0x5a, kFileSize);
+        assert(entry.Unpin() && !entry.Pinned());
+        const int pinned = entry.Pin(); // discarding is up to the system; both outcomes are legal
+        assert(pinned == MEMMAP_PURGE_INTACT || pinned == MEMMAP_PURGE_LOST);
+        if(pinned == MEMMAP_PURGE_INTACT) {
+            for(std::size_t i = 0; i < kFileSize; i += kBSz) assert(entry.Data()[i] == 0x5a);
+        }
+        entry.Data()[0] = 1; // accessible either way
+    }
+    memmap_purge_get_stats(&after);
+    assert(after.offers == before.offers + 1 && after.reclaims == before.reclaims + 1);
+    assert(memmap_purge_offer((void*)(uintptr_t)1, kBSz, 0) == -1 && errno == EINVAL);
+    printf("memmap_purge_offer() test completed.\n");
+}
+
+void test_stack() {
+    GroundhogMorning();
+    const std::size_t stack_size = 64 * page_size;
+    {
+        mem::StackPool pool(stack_size, 4);
+        assert(pool && pool.StackSize() == stack_size);
+        char* stack = pool.Acquire();
+        assert(stack);
+        const std::size_t initial = memmap_stack_committed(stack);
+        assert(initial && initial < stack_size);
+
+        // run "deep", page by page from the top down to just above the floor page
+        for(std::size_t offset = page_size; offset < stack_size; offset += page_size) {
+            ((volatile char*)pool.Top(stack))[-(std::ptrdiff_t)offset] = '#';
+        }
+        assert(memmap_stack_committed(stack) == stack_size - page_size);
+
+        pool.Release(stack); // trimmed back to the top
+        assert(memmap_stack_committed(stack) == initial);
+        assert(pool.Acquire() == stack);
+        memmap_stack_stats stats;
+        memmap_stack_pool_stats(pool.get(), &stats);
+        assert(stats.created == 1 && stats.reused == 1 && stats.trimmed == stack_size - page_size - initial);
+        pool.Release(stack);
+    }
+
+    // MAP_GROWSDOWN without the pool
+    char* plain = (char*)mmap(nullptr, stack_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_GROWSDOWN, -1, 0);
+    assert(plain != MAP_FAILED);
+    for(std::size_t offset = page_size; offset <= stack_size / 2; offset += page_size) {
+        write_and_read(plain + stack_size - offset); // one page further down each time
+    }
+    assert(memmap_stack_committed(plain) >= stack_size / 2);
+    assert(!munmap(plain, stack_size));
+    printf("MAP_GROWSDOWN test completed.\n");
+}
+
+void test_fault() {
+    GroundhogMorning();
+    // page #p is filled with the byte p; fills happen 4 pages at a time
+    const std::size_t pages = 64;
+    mem::LazyRegion region(pages * page_size, PROT_READ | PROT_WRITE, 4, [](char* dest, std::size_t length, std::size_t offset) {
+        for(std::size_t i = 0; i < length; ++i) dest[i] = (char)((offset + i) / page_size);
+        return true;
+    });
+    assert(region && region.Length() == pages * page_size);
+    memmap_fault_stats stats;
+
+    assert(region.Data()[10 * page_size + 5] == 10); // first touch of chunk #2 (pages 8..11)
+    write_and_read(region.Data() + 9 * page_size + 100); // same chunk: no fault
+    memmap_fault_get_stats(region.get(), &stats);
+    assert(stats.faults == 1 && stats.fills == 1 && !stats.failures);
+
+    assert(region.Populate(32 * page_size, 8 * page_size)); // chunks #8, #9
+    for(std::size_t p = 0; p < pages; ++p) assert(region.Data()[p * page_size + 1] == (char)p);
+    memmap_fault_get_stats(region.get(), &stats);
+    assert(stats.fills == pages / 4 && stats.faults == pages / 4 - 2);
+    printf("memmap_fault_register() test completed.\n");
+}
+
+void test_heat() {
+    GroundhogMorning();
+    const std::size_t pages = 64, hot = 8;
+    char* buffer = (char*)mmap(nullptr, pages * page_size, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    assert(buffer != MAP_FAILED);
+    memset(buffer, 1, pages * page_size);
+    {
+        mem::HeatProfiler profiler;
+        assert(profiler && profiler.Add(buffer, pages * page_size) == 0);
+        profiler.Sample(); // primes: everything is resident, and then nothing is
+        for(int pass = 0; pass < 2; ++pass) {
+            for(std::size_t p = 0; p < hot; ++p) ((volatile char*)buffer)[p * page_size] += 1;
+            profiler.Sample();
+        }
+        std::vector<memmap_heat_histogram> report = profiler.Report();
+        assert(report.size() == 1 && report[0].addr == buffer && report[0].passes == 2);
+        assert(report[0].pages[MEMMAP_HEAT_BUCKETS - 1] == hot && report[0].pages[0] == pages - hot);
+        uint16_t counts[pages];
+        assert(memmap_heat_counts(profiler.get(), 0, counts, pages) == pages);
+        assert(counts[0] == 2 && counts[hot] == 0);
+    }
+    munmap(buffer, pages * page_size);
+    printf("memmap_heat_sample() test completed.\n");
+}
+
+void test_copy() {
+    GroundhogMorning();
+    // byte i of the source is i * 11; the copy skips the first 1000 bytes and lands at offset 17
+    const std::size_t size = 3 * get_allocation_granularity() + 123;
+    int in = open(kCopyFiles[0], O_CREAT | O_TRUNC | O_RDWR | O_BINARY, _S_IREAD | _S_IWRITE);
+    int out = open(kCopyFiles[1], O_CREAT | O_TRUNC | O_RDWR | O_BINARY, _S_IREAD | _S_IWRITE);
+    assert(in >= 0 && out >= 0);
+    std::vector<unsigned char> bytes(size);
+    for(std::size_t i = 0; i < size; ++i) bytes[i] = (unsigned char)(i * 11);
+    assert(write(in, bytes.data(), size) == (int)size);
+
+    off64_t off_in = 1000, off_out = 17;
+    assert(memmap_copy_file_range(in, &off_in, out, &off_out, size, 0) == (ssize_t)(size - 1000)); // clipped at EOF
+    assert(off_in == (off64_t)size && off_out == (off64_t)(size - 1000 + 17));
+    assert(memmap_copy_file_range(in, &off_in, out, &off_out, 1, 0) == 0); // at EOF
+    std::vector<unsigned char> copied(size - 1000);
+    assert(_lseeki64(out, 17, SEEK_SET) == 17 && read(out, copied.data(), copied.size()) == (int)copied.size());
+    assert(!memcmp(copied.data(), bytes.data() + 1000, copied.size()));
+
+    // sendfile from the file position of `in` to the file position of `out`
+    assert(_lseeki64(in, 5, SEEK_SET) == 5 && _lseeki64(out, 0, SEEK_SET) == 0);
+    assert(memmap_sendfile(out, in, nullptr, 100) == 100);
+    assert(_lseeki64(in, 0, SEEK_CUR) == 105 && _lseeki64(out, 0, SEEK_CUR) == 100);
+    assert(_lseeki64(out, 0, SEEK_SET) == 0 && read(out, copied.data(), 100) == 100);
+    assert(!memcmp(copied.data(), bytes.data() + 5, 100));
+
+    close(in);
+    close(out);
+    unlink(kCopyFiles[0]);
+    unlink(kCopyFiles[1]);
+    printf("memmap_copy_file_range() test completed.\n");
+}
+
+void test_memfd() {
+    GroundhogMorning();
+    const std::size_t size = 4 * get_allocation_granularity();
+    mem::MemFd memfd("test-memmap", MFD_CLOEXEC, 2 * size);
+    assert(memfd && memfd.section());
+    assert(memmap_ftruncate(memfd.fd(), 4 * size) == -1 && errno == EFBIG); // beyond the maximum
+    assert(memfd.Truncate(size));
+
+    // two views of the same memory
+    char* first = (char*)mmap(nullptr, size, PROT_DATA, MAP_SHARED, memfd.fd(), 0);
+    char* second = (char*)mmap(nullptr, size, PROT_READ, MAP_SHARED, memfd.fd(), 0);
+    assert(first != MAP_FAILED && second != MAP_FAILED && first != second);
+    first[0] = 'm';
+    first[size - 1] = 'f';
+    assert(second[0] == 'm' && second[size - 1] == 'f');
+
+    // another fd for the same section, as a child process would open it
+    int other = memmap_memfd_open(memfd.section(), 0);
+    assert(other >= 0 && other != memfd.fd());
+    char* third = (char*)mmap(nullptr, page_size, PROT_READ, MAP_SHARED, other, size - page_size);
+    assert(third != MAP_FAILED && third[page_size - 1] == 'f');
+    munmap(third, page_size);
+    close(other);
+
+    // shrinking zeroes the cut bytes: they read as zeros after growing again
+    assert(memfd.Truncate(1) && memfd.Truncate(size));
+    assert(second[0] == 'm' && second[1] == 0 && second[size - 1] == 0);
+    assert(memmap_ftruncate(-1, size) == -1 && errno == EBADF);
+    assert(memmap_memfd_create("x", MFD_ALLOW_SEALING, 0) == -1 && errno == EINVAL);
+    munmap(first, size);
+    munmap(second, size);
+    printf("memfd_create() test completed.\n");
+}
+
+void test_fit() {
+    GroundhogMorning();
+    memmap_fragmentation before;
+    memmap_fragmentation_get(&before);
+    std::size_t blocks = 0;
+    for(std::size_t count : before.blocks) blocks += count;
+    assert(before.free_blocks && blocks == before.free_blocks);
+    assert(before.largest_free && before.largest_free <= before.free_bytes);
+
+    const std::size_t granule = get_allocation_granularity();
+    set_mmap_placement_policy(mmap_placement_policy__best_fit, 4 * granule);
+    char* small = (char*)mmap(nullptr, page_size, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    char* large = (char*)mmap(nullptr, 8 * granule, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    assert(small != MAP_FAILED && large != MAP_FAILED);
+    write_and_read(small);
+    write_and_read(large + 8 * granule - page_size);
+    MEMORY_BASIC_INFORMATION mbi;
+    assert(VirtualQuery(large + 8 * granule, &mbi, sizeof(mbi)) && mbi.State != MEM_FREE); // top down: at the end of its block
+
+    int fd = open(kTestFile, O_RDONLY | O_BINARY);
+    assert(fd >= 0);
+    char* view = (char*)mmap(nullptr, kFileSize, PROT_READ, MAP_SHARED, fd, 0);
+    assert(view != MAP_FAILED && *(volatile uint32_t*)(view + kFileInto) == kForeground); // written by test_mmap
+    munmap(view, kFileSize);
+    close(fd);
+
+    munmap(small, page_size);
+    munmap(large, 8 * granule);
+    set_mmap_placement_policy(mmap_placement_policy__system, 0);
+    printf("set_mmap_placement_policy() test completed.\n");
+}
+
+void test_access() {
+    GroundhogMorning();
+    // the handle of a read-only fd has neither write nor execute access: the views reopen it
+    int fd = open(kTestFile, O_RDONLY | O_BINARY);
+    assert(fd >= 0);
+    char* shared = (char*)mmap(nullptr, page_size, PROT_DATA, MAP_SHARED, fd, 0);
+    assert(shared != MAP_FAILED);
+    *(volatile uint32_t*)shared = *(volatile uint32_t*)shared; // the file stays as it is
+    assert(!msync(shared, page_size, MS_SYNC));
+    munmap(shared, page_size);
+    char* code = (char*)mmap(nullptr, page_size, PROT_READ | PROT_EXEC, MAP_PRIVATE, fd, 0);
+    assert(code != MAP_FAILED && *(volatile uint32_t*)(code + kFileInto) == kForeground);
+    munmap(code, page_size);
+    close(fd);
+
+    // as requested: a shared writable view of a read-only fd fails as on POSIX; a private one needs no write access
+    set_write_bit_inference_policy(fd_access_inference_policy__asreq);
+    fd = open(kTestFile, O_RDONLY | O_BINARY);
+    errno = 0;
+    assert(mmap(nullptr, page_size, PROT_DATA, MAP_SHARED, fd, 0) == MAP_FAILED && errno == EACCES);
+    char* cow = (char*)mmap(nullptr, page_size, PROT_DATA, MAP_PRIVATE, fd, 0);
+    assert(cow != MAP_FAILED);
+    write_and_read(cow);
+    munmap(cow, page_size);
+    close(fd);
+    set_write_bit_inference_policy(fd_access_inference_policy__probe); // the default
+    printf("set_write_bit_inference_policy() test completed.\n");
+}
+
+void test_hugepage() {
+    GroundhogMorning();
+    set_mmap_hugepage_promotable(true);
+    const std::size_t large = gethugepagesize();
+    const std::size_t length = 2 * large + page_size; // two large pages at least, whatever the alignment
+    char* table = (char*)mmap(nullptr, length, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    assert(table != MAP_FAILED);
+    for(std::size_t at = 0; at < length; at += page_size) table[at] = (char)(at / page_size);
+
+    memmap_hugepage_stats before, after;
+    memmap_hugepage_get_stats(&before);
+    assert(!madvise(table, length, MADV_HUGEPAGE)); // advice: succeeds on small pages too
+    memmap_hugepage_get_stats(&after);
+    assert(after.promotions + after.fallbacks == before.promotions + before.fallbacks + 1);
+    for(std::size_t at = 0; at < length; at += page_size) assert(table[at] == (char)(at / page_size));
+    write_and_read(table + length - 4);
+    printf("madvise(MADV_HUGEPAGE) %s\n", (after.promotions > before.promotions) ? "promoted" : "fell back");
+    assert(!madvise(table, length, MADV_NOHUGEPAGE));
+
+    munmap(table, length);
+    memmap_hugepage_get_stats(&after);
+    assert(after.promoted == before.promoted);
+    set_mmap_hugepage_promotable(false);
+    printf("madvise(MADV_HUGEPAGE) test completed.\n");
+}
+
+void test_tags() {
+    GroundhogMorning();
+    char* cache = nullptr;
+    {
+        mem::TagScope scope("test cache");
+        assert(scope && !strcmp(memmap_tag_thread_get(), "test cache"));
+        cache = (char*)mmap(nullptr, 4 * page_size, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+        assert(cache != MAP_FAILED);
+    }
+    assert(!memmap_tag_thread_get());
+    assert(!strcmp(memmap_tag_get(cache + 3 * page_size), "test cache"));
+    cache[0] = cache[page_size] = 1;
+
+    // a later tag splits the range
+    assert(!memmap_tag(cache + 2 * page_size, page_size, "test index"));
+    assert(memmap_tag(cache, page_size, "[bad]") < 0 && errno == EINVAL);
+    const std::string maps = mem::ProcessMaps();
+    char line[128];
+    snprintf(line, sizeof(line), "%08llx-%08llx rw-p 00000000 00:00 0 ",
+             (unsigned long long)(uintptr_t)cache, (unsigned long long)(uintptr_t)(cache + 2 * page_size));
+    const std::size_t at = maps.find(line);
+    assert(at != std::string::npos);
+    assert(maps.find("[anon:test cache]", at) < maps.find('\n', at));
+    assert(maps.find("[anon:test index]") != std::string::npos);
+
+    bool found = false;
+    for(const memmap_tag_usage& usage : mem::TagUsage()) {
+        if(strcmp(usage.name, "test cache")) continue;
+        found = usage.reserved == 3 * page_size && usage.committed == 3 * page_size && usage.resident >= 2 * page_size;
+    }
+    assert(found);
+
+    munmap(cache, 4 * page_size); // the tags go with the mapping
+    assert(!memmap_tag_get(cache) && !memmap_tag_get(cache + 2 * page_size));
+    printf("memmap_tag() test completed.\n");
+}
+
+void test_recycle() {
+    GroundhogMorning();
+    const std::size_t length = 4 * page_size;
+    set_mmap_recycle_policy(64 * length, length, 60000);
+    char* data = (char*)mmap(nullptr, length, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    assert(data != MAP_FAILED);
+    memset(data, 0x5a, length);
+    munmap(data, length);
+
+    // a hot hit into read-only memory: zeroed, not written to after the protection changed
+    const char* table = (const char*)mmap(nullptr, length, PROT_READ, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    assert(table == data);
+    for(std::size_t at = 0; at < length; ++at) assert(!table[at]);
+    munmap((void*)table, length);
+
+    // ...and from read-only memory back to data
+    data = (char*)mmap(nullptr, length, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    assert(data == table && !data[length - 1]);
+    write_and_read(data + length - 4);
+    munmap(data, length);
+
+    // NUMA-placed memory is never cached: its data cannot come back uninitialized
+    data = (char*)mmap(nullptr, length, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE | MAP_NUMA_NODE(0), -1, 0);
+    assert(data != MAP_FAILED);
+    memset(data, 0x5a, length);
+    munmap(data, length);
+    data = (char*)mmap(nullptr, length, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE | MAP_UNINITIALIZED, -1, 0);
+    assert(data != MAP_FAILED && !data[0]);
+    munmap(data, length);
+
+    set_mmap_recycle_policy(0, 0, 0);
+    printf("set_mmap_recycle_policy() test completed.\n");
+}
+
+void test_pack() {
+    GroundhogMorning();
+    set_mmap_pack_small_anonymous(2 * page_size);
+    char* first = (char*)mmap(nullptr, page_size, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    char* second = (char*)mmap(nullptr, 2 * page_size, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    assert(first != MAP_FAILED && second != MAP_FAILED);
+    MEMORY_BASIC_INFORMATION mbi, other;
+    assert(VirtualQuery(first, &mbi, sizeof(mbi)) && VirtualQuery(second, &other, sizeof(other)));
+    assert(mbi.AllocationBase == other.AllocationBase); // one granule
+    memset(first, 0x5a, page_size);
+    memset(second, 0xa5, 2 * page_size);
+
+    // a slot goes back alone, and comes back zeroed
+    munmap(first, page_size);
+    assert(second[0] == (char)0xa5 && second[2 * page_size - 1] == (char)0xa5);
+    char* again = (char*)mmap(nullptr, page_size, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    assert(again == first); // first fit
+    for(long at = 0; at < page_size; ++at) assert(!again[at]);
+    write_and_read(again);
+
+    // the granule goes once empty
+    munmap(second, 2 * page_size);
+    munmap(again, page_size);
+    assert(VirtualQuery(first, &mbi, sizeof(mbi)) && mbi.State == MEM_FREE);
+    set_mmap_pack_small_anonymous(0);
+    printf("set_mmap_pack_small_anonymous() test completed.\n");
+}
+
+void test_jit() {
+    GroundhogMorning();
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+    const unsigned char ret[] = {0xc3};
+#elif defined(_M_ARM64) || defined(__aarch64__)
+    const unsigned char ret[] = {0xc0, 0x03, 0x5f, 0xd6};
+#else // Thumb-2: bx lr
+    const unsigned char ret[] = {0x70, 0x47};
+#endif
+    mem::jit::CodeRegion region(page_size);
+    assert(region);
+    void* rx = nullptr;
+    unsigned char* rw = (unsigned char*)region.Alloc(sizeof(ret), 0, &rx);
+    assert(rw && rx && rx != rw);
+    assert(memmap_jit_exec_address(region.get(), rw) == rx && memmap_jit_write_address(region.get(), rx) == rw);
+
+    // one page, two addresses: writable at one, executable at the other
+    MEMORY_BASIC_INFORMATION mbi;
+    assert(VirtualQuery(rw, &mbi, sizeof(mbi)) && mbi.Protect == PAGE_READWRITE);
+    assert(VirtualQuery(rx, &mbi, sizeof(mbi)) && mbi.Protect == PAGE_EXECUTE_READ);
+    memcpy(rw, ret, sizeof(ret));
+    assert(!memcmp(rx, ret, sizeof(ret)));
+    assert(region.Publish());
+#if defined(_M_ARM) || defined(__arm__)
+    ((void (*)())((uintptr_t)rx | 1))(); // Thumb
+#else
+    ((void (*)())rx)();
+#endif
+
+    // a patch needs no mprotect either
+    rw[0] = ret[0];
+    region.Dirty(rw, 1);
+    assert(region.Publish());
+    printf("memmap_jit_create() test completed.\n");
+}
+
+void test_numa() {
+    GroundhogMorning();
+    const unsigned nodes = memmap_sysconf(_SC_NUMA_NODES);
+    assert(nodes && nodes == memmap_numa_node_count());
+    const std::size_t length = 4 * page_size;
+    char* local = (char*)mmap(nullptr, length, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE | MAP_NUMA_NODE(0), -1, 0);
+    assert(local != MAP_FAILED);
+    write_and_read(local + length - 4);
+
+    // a node the system lacks is no preference, not a failure
+    char* nowhere = (char*)mmap(nullptr, length, PROT_DATA, MAP_ANONYMOUS | MAP_PRIVATE | MAP_NUMA_NODE(nodes), -1, 0);
+    assert(nowhere != MAP_FAILED && !nowhere[0]);
+    write_and_read(nowhere);
+    int fd = open(kTestFile, O_RDONLY | O_BINARY);
+    assert(fd >= 0);
+    char* view = (char*)mmap(nullptr, kFileSize, PROT_READ, MAP_SHARED | MAP_NUMA_NODE(nodes), fd, 0);
+    assert(view != MAP_FAILED && *(volatile uint32_t*)(view + kFileInto) == kForeground); // written by test_mmap
+    munmap(view, kFileSize);
+    close(fd);
+
+    // migration keeps the contents, wherever the pages end up
+    unsigned long mask = 1;
+    assert(!mbind(nowhere, length, MPOL_PREFERRED, &mask, 1, MPOL_MF_MOVE));
+    assert(*(volatile uint32_t*)nowhere == kForeground);
+    munmap(nowhere, length);
+    munmap(local, length);
+    printf("MAP_NUMA_NODE() test completed.\n");
+}
+
 volatile bool segfault = false;
 volatile DWORD signal_id = 0;
 
@@ -216,9 +948,31 @@ int main(int, char **) {
     printf("sys/mman.h API test panel.\n\n");
     fflush(stdout);
 
+    test_topology();
     test_mincore();
     test_lockall();
     test_mmap();
+    test_dump();
+    test_maps();
+    test_window();
+    test_mmap64();
+    test_grow();
+    test_gather();
+    test_pressure();
+    test_purge();
+    test_stack();
+    test_fault();
+    test_heat();
+    test_copy();
+    test_memfd();
+    test_fit();
+    test_access();
+    test_hugepage();
+    test_tags();
+    test_recycle();
+    test_pack();
+    test_jit();
+    test_numa();
     // TODO test_munmap()
     unlink(kTestFile);
 
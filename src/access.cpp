@@ -0,0 +1,124 @@
+#include "memmap/conf.h"
+
+#include "access.h"
+#include "handles.h"
+#include "sync.h"
+#include "dbg.h" // tracing
+
+#include <windows.h>
+#include <errno.h>
+
+namespace {
+
+enum fd_access_inference_policy _exec_policy = fd_access_inference_policy__probe;
+enum fd_access_inference_policy _write_policy = fd_access_inference_policy__probe;
+
+struct Tracked {
+    HANDLE duplicate;   // ours: it tells when the fd is closed, or its handle value reused
+    HANDLE reopened;    // with more access than the fd's own handle, or nullptr
+    ACCESS_MASK access; // FILE_* rights of `reopened` if any, else of the fd's handle
+    ACCESS_MASK refused; // rights a reopen failed to get: not asked for again
+    bool mapped;        // a section has been created before
+};
+
+/* The FILE_* rights a section with page protection `protection` needs of its file. */
+ACCESS_MASK Needed(DWORD protection) {
+    ACCESS_MASK needed = FILE_READ_DATA;
+    if(protection & (PAGE_READWRITE | PAGE_EXECUTE_READWRITE)) needed |= FILE_WRITE_DATA;
+    if(protection & (PAGE_EXECUTE | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY)) needed |= FILE_EXECUTE;
+    return needed;
+}
+
+/* The rights the policies let us reopen handles for, and take before they are needed. */
+ACCESS_MASK WithPolicy(enum fd_access_inference_policy policy) {
+    return ((_write_policy == policy) ? FILE_WRITE_DATA : 0) | ((_exec_policy == policy) ? FILE_EXECUTE : 0);
+}
+
+void Release(const Tracked& tracked) {
+    _MEMMAP_LOG("access: releasing %p (reopened as %p)", tracked.duplicate, tracked.reopened);
+    CloseHandle(tracked.duplicate);
+    if(tracked.reopened) CloseHandle(tracked.reopened); // views keep their sections
+}
+
+/* By the handle behind the fd (see handles.h). */
+SRWLOCK _handles_lock = SRWLOCK_INIT;
+mem::handles::Registry<Tracked, &Release> _handles;
+
+/* Asks the system once for the rights of `hfile`. Returns nullptr if it will not tell. Call with the lock held. */
+Tracked* Track(HANDLE hfile) {
+    Tracked tracked = {nullptr, nullptr, 0, 0, false};
+    if(!mem::handles::Access(hfile, tracked.access)) return nullptr;
+    if(!DuplicateHandle(GetCurrentProcess(), hfile, GetCurrentProcess(), &tracked.duplicate, 0, FALSE, DUPLICATE_SAME_ACCESS)) {
+        return nullptr;
+    }
+    _handles.Sweep(); // closed fds are noticed here, a few at a time
+    Tracked* entered = _handles.Insert(hfile, tracked);
+    if(!entered) CloseHandle(tracked.duplicate);
+    return entered;
+}
+
+/* Reopens `hfile` with the rights of `tracked` and `more`. */
+bool Reopen(HANDLE hfile, Tracked& tracked, ACCESS_MASK more) {
+    const ACCESS_MASK rights = tracked.access | more;
+    const DWORD desired = GENERIC_READ
+        | ((rights & FILE_WRITE_DATA) ? GENERIC_WRITE : 0) | ((rights & FILE_EXECUTE) ? GENERIC_EXECUTE : 0);
+    HANDLE reopened = ReOpenFile(hfile, desired, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0);
+    _MEMMAP_LOG("ReOpenFile(%p, %lx) = %p", hfile, (DWORD)desired, reopened);
+    if(reopened == INVALID_HANDLE_VALUE) return false;
+    if(tracked.reopened) CloseHandle(tracked.reopened);
+    tracked.reopened = reopened;
+    tracked.access = rights;
+    return true;
+}
+
+} // anonymous
+
+namespace mem {
+namespace access {
+
+HANDLE ForSection(HANDLE hfile, DWORD protection) {
+    if(!mem::handles::Supported()) return hfile; // no telling: the section decides, as it used to
+    const ACCESS_MASK needed = Needed(protection);
+    mem::ExclusiveLock guard(_handles_lock);
+    Tracked* tracked = _handles.Find(hfile);
+    if(!tracked && !(tracked = Track(hfile))) return hfile;
+    if(!(tracked->access & FILE_READ_DATA)) return errno = EACCES, nullptr; // POSIX: fd not open for reading
+
+    // eager rights are taken on the first mapping; probed ones along with the first reopen
+    const ACCESS_MASK eager = tracked->mapped ? 0 : WithPolicy(fd_access_inference_policy__eager);
+    const ACCESS_MASK wanted = (needed | eager) & ~(tracked->access | tracked->refused);
+    const ACCESS_MASK allowed = wanted & ~WithPolicy(fd_access_inference_policy__asreq);
+    tracked->mapped = true;
+    if(allowed) {
+        const ACCESS_MASK required = allowed & needed;
+        const ACCESS_MASK extra = (allowed | WithPolicy(fd_access_inference_policy__probe)) & ~(required | tracked->access | tracked->refused);
+        if(!Reopen(hfile, *tracked, required | extra)) {
+            // once refused, never asked for again; but a right asked for along with another may not be the one refused
+            if(!required || !extra) {
+                tracked->refused |= required | extra;
+            } else if(Reopen(hfile, *tracked, required)) {
+                tracked->refused |= extra;
+            } else {
+                tracked->refused |= required;
+                if(!Reopen(hfile, *tracked, extra)) tracked->refused |= extra;
+            }
+        }
+    }
+    if(needed & ~tracked->access) return errno = EACCES, nullptr;
+    return tracked->reopened ? tracked->reopened : hfile;
+}
+
+} // namespace access
+} // namespace mem
+
+extern "C" {
+
+void set_exec_bit_inference_policy(enum fd_access_inference_policy policy) {
+    _exec_policy = policy;
+}
+
+void set_write_bit_inference_policy(enum fd_access_inference_policy policy) {
+    _write_policy = policy;
+}
+
+} // extern "C"
@@ -0,0 +1,22 @@
+#ifndef _MEMMAP_SRC_ACCESS_H_
+#define _MEMMAP_SRC_ACCESS_H_
+
+#include <windows.h>
+
+/* Access rights of file handles behind fds, inferred per policy (see `set_write_bit_inference_policy`) */
+
+namespace mem {
+namespace access {
+
+/**
+ * The handle to create a section with page protection `protection` from: `hfile`
+ * itself if it has the access, or a handle reopened from it with more (owned by the
+ * cache, valid while the fd is open). Returns nullptr and sets `errno` to EACCES if
+ * the policies forbid reopening, or the file refuses. Allocates: not for emergency mode.
+ */
+HANDLE ForSection(HANDLE hfile, DWORD protection);
+
+} // namespace access
+} // namespace mem
+
+#endif /* _MEMMAP_SRC_ACCESS_H_ */
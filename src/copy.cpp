@@ -0,0 +1,203 @@
+#include "sys/mman.h"
+#include "memmap/copy.h"
+#include "memmap/proc.h"
+
+#include "view.h"
+#include "dbg.h" // tracing
+
+#include <windows.h>
+#include <errno.h>
+#include <stdint.h>
+#include <algorithm>
+#include <limits>
+
+extern "C" {
+
+#if _WIN32_WINNT < _WIN32_WINNT_WIN8
+  typedef struct _WIN32_MEMORY_RANGE_ENTRY {
+    PVOID VirtualAddress;
+    SIZE_T NumberOfBytes;
+  } WIN32_MEMORY_RANGE_ENTRY, *PWIN32_MEMORY_RANGE_ENTRY;
+
+  /* WINBASEAPI */ BOOL WINAPI PrefetchVirtualMemory (HANDLE hProcess, ULONG_PTR NumberOfEntries, PWIN32_MEMORY_RANGE_ENTRY VirtualAddresses, ULONG Flags) __attribute((weak));
+#endif
+
+} // extern "C"
+
+namespace {
+
+constexpr uint64_t kWindow = 64 << 20; // source bytes mapped at a time (a multiple of the allocation granularity)
+constexpr DWORD kChunk = 16 << 20;     // bytes per WriteFile
+
+int WriteErrno() {
+    const DWORD error = GetLastError();
+    return (error == ERROR_DISK_FULL || error == ERROR_HANDLE_DISK_FULL) ? ENOSPC : EIO;
+}
+
+bool Tell(HANDLE file, uint64_t& position) {
+    LARGE_INTEGER zero, current;
+    zero.QuadPart = 0;
+    if(!SetFilePointerEx(file, zero, &current, FILE_CURRENT)) return false;
+    position = current.QuadPart;
+    return true;
+}
+
+bool Seek(HANDLE file, uint64_t position) {
+    LARGE_INTEGER to;
+    to.QuadPart = position;
+    return SetFilePointerEx(file, to, nullptr, FILE_BEGIN);
+}
+
+bool Resize(HANDLE file, uint64_t size) {
+    FILE_END_OF_FILE_INFO eof;
+    eof.EndOfFile.QuadPart = size;
+    _MEMMAP_LOG("copy: resizing %p to %llx", file, (unsigned long long)size);
+    return SetFileInformationByHandle(file, FileEndOfFileInfo, &eof, sizeof(eof));
+}
+
+/**
+ * Extends a disk file to `size` in one step, so that the writes do not grow it piecemeal.
+ * Returns true and the former size in `original` if the file was extended.
+ */
+bool Presize(HANDLE file, uint64_t size, uint64_t& original) {
+    LARGE_INTEGER current;
+    if(GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &current) || (uint64_t)current.QuadPart >= size) return false;
+    original = current.QuadPart;
+    return Resize(file, size);
+}
+
+/* Writes all of [data, data+length) at `*position`, advancing it (or at the file position if nullptr). */
+bool Write(HANDLE out, const char* data, size_t length, uint64_t* position) {
+    while(length) {
+        const DWORD chunk = (DWORD)std::min<size_t>(length, kChunk);
+        OVERLAPPED at = {};
+        if(position) {
+            at.Offset = (DWORD)*position;
+            at.OffsetHigh = (DWORD)(*position >> 32);
+        }
+        DWORD written = 0;
+        if(!WriteFile(out, data, chunk, &written, position ? &at : nullptr) || !written) return false;
+        data += written;
+        length -= written;
+        if(position) *position += written;
+    }
+    return true;
+}
+
+/* Maps source bytes [from, to); the view starts at the granule containing `from`. */
+const char* MapWindow(HANDLE section, uint64_t from, uint64_t to) {
+    return (const char*)mem::view::Map(section, from, (size_t)(to - from), FILE_MAP_READ, 0);
+}
+
+void UnmapWindow(const char* data, uint64_t from) {
+    UnmapViewOfFile(data - mem::view::Padding(from));
+}
+
+void Prefetch(const char* data, uint64_t from, uint64_t to) {
+    if(!&PrefetchVirtualMemory) return; // Windows 8+; the writes fault the pages in otherwise
+    WIN32_MEMORY_RANGE_ENTRY range = {(PVOID)data, (SIZE_T)(to - from)};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+/**
+ * Copies up to `len` bytes of `in` from `in_offset` to `out` at `*out_offset` (or at
+ * its file position). Returns the number of bytes copied, or -1 and `errno` if none.
+ */
+ssize_t Copy(HANDLE in, uint64_t in_offset, HANDLE out, uint64_t* out_offset, size_t len) {
+    LARGE_INTEGER in_size;
+    if(!GetFileSizeEx(in, &in_size)) return errno = EINVAL, -1; // not a regular file
+    if(in_offset >= (uint64_t)in_size.QuadPart || !len) return 0;
+    len = std::min<size_t>(len, std::numeric_limits<ssize_t>::max()); // as Linux, a short count
+    const uint64_t end = in_offset + std::min<uint64_t>(len, in_size.QuadPart - in_offset);
+
+    HANDLE section = mem::view::Section(in, PAGE_READONLY, PROT_READ);
+    if(!section) return -1;
+
+    uint64_t start = out_offset ? *out_offset : 0, original = 0;
+    const bool presized = (out_offset || Tell(out, start)) && Presize(out, start + (end - in_offset), original);
+
+    uint64_t from = in_offset;
+    uint64_t to = std::min(end, (from / kWindow + 1) * kWindow); // later windows start at multiples of kWindow
+    const char* data = MapWindow(section, from, to);
+    int error = data ? 0 : errno;
+    while(data) {
+        const uint64_t next_to = std::min(end, to + kWindow);
+        const char* next = (to < end) ? MapWindow(section, to, next_to) : nullptr;
+        if(next) Prefetch(next, to, next_to); // read ahead while this window is written
+        if(to < end && !next) error = errno;
+
+        const bool written = Write(out, data, (size_t)(to - from), out_offset);
+        UnmapWindow(data, from);
+        if(!written) {
+            error = WriteErrno();
+            if(next) UnmapWindow(next, to);
+            break;
+        }
+        from = to;
+        to = next_to;
+        data = next;
+    }
+    CloseHandle(section); // the views keep it alive
+    const uint64_t copied = from - in_offset;
+    if(presized && from < end) Resize(out, std::max(original, start + copied)); // no zeros past a short copy
+    return (copied || !error) ? (ssize_t)copied : (errno = error, -1);
+}
+
+} // anonymous
+
+extern "C" {
+
+ssize_t memmap_copy_file_range(int fd_in, off64_t* off_in, int fd_out, off64_t* off_out, size_t len, unsigned flags) {
+    if(flags || (off_in && *off_in < 0) || (off_out && *off_out < 0)) return errno = EINVAL, -1;
+    HANDLE in = mem::view::FileHandle(fd_in);
+    HANDLE out = mem::view::FileHandle(fd_out);
+    if(in == INVALID_HANDLE_VALUE || out == INVALID_HANDLE_VALUE) return errno = EBADF, -1;
+
+    uint64_t in_offset = 0, out_offset = 0, out_position = 0;
+    if(off_in) {
+        in_offset = *off_in;
+    } else if(!Tell(in, in_offset)) {
+        return errno = ESPIPE, -1;
+    }
+    if(off_out) {
+        out_offset = *off_out;
+        if(!Tell(out, out_position)) return errno = ESPIPE, -1; // positional writes need a seekable file
+    }
+
+    const ssize_t copied = Copy(in, in_offset, out, off_out ? &out_offset : nullptr, len);
+    if(copied > 0) {
+        if(off_in) {
+            *off_in += copied;
+        } else {
+            Seek(in, in_offset + copied);
+        }
+        if(off_out) *off_out += copied;
+    }
+    if(off_out) Seek(out, out_position); // positional writes move the file pointer on Windows; Linux leaves it
+    return copied;
+}
+
+ssize_t memmap_sendfile(int out_fd, int in_fd, off64_t* offset, size_t count) {
+    if(offset && *offset < 0) return errno = EINVAL, -1;
+    HANDLE in = mem::view::FileHandle(in_fd);
+    HANDLE out = mem::view::FileHandle(out_fd);
+    if(in == INVALID_HANDLE_VALUE || out == INVALID_HANDLE_VALUE) return errno = EBADF, -1;
+
+    uint64_t in_offset = 0;
+    if(offset) {
+        in_offset = *offset;
+    } else if(!Tell(in, in_offset)) {
+        return errno = ESPIPE, -1;
+    }
+    const ssize_t copied = Copy(in, in_offset, out, nullptr, count);
+    if(copied > 0) {
+        if(offset) {
+            *offset += copied; // Linux: the file position of `in_fd` is left alone
+        } else {
+            Seek(in, in_offset + copied);
+        }
+    }
+    return copied;
+}
+
+} // extern "C"
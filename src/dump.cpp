@@ -0,0 +1,260 @@
+#include "memmap/dump.h"
+#include "memmap/iter.h"
+#include "memmap/proc.h"
+
+#include "sync.h"
+
+#include <windows.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace {
+
+/**
+ * Everything the writer needs lives here, allocated at load time: three blocks
+ * (header, index, zeroes) aligned for unbuffered I/O, and the exclusion table.
+ * Crash handlers call the writer when the heap may be corrupt, so none of the
+ * code below allocates, and the exclusion table is read without taking its lock
+ * (the lock holder may be the thread that crashed).
+ */
+constexpr size_t kBlock = MEMMAP_DUMP_BLOCK;
+constexpr size_t kChunk = 16 << 20; // bytes per WriteFile call
+constexpr unsigned kMaxExclusions = 256;
+
+char _dump_storage[4 * kBlock];
+volatile LONG _dump_busy = 0;
+
+struct Exclusion {
+    uintptr_t lower;
+    uintptr_t upper;
+};
+
+SRWLOCK _exclusion_lock = SRWLOCK_INIT;
+Exclusion _exclusions[kMaxExclusions];
+volatile unsigned _exclusion_count = 0;
+
+char* Blocks() {
+    return _dump_storage + (kBlock - (uintptr_t)_dump_storage % kBlock) % kBlock;
+}
+
+memmap_dump_header& Header() { return *(memmap_dump_header*)Blocks(); }
+memmap_dump_index& Index() { return *(memmap_dump_index*)(Blocks() + kBlock); }
+const char* Zeroes() { return Blocks() + 2 * kBlock; }
+
+constexpr uint32_t kIndexCapacity = sizeof(memmap_dump_index::regions) / sizeof(memmap_dump_region);
+
+bool Dumpable(const MEMORY_BASIC_INFORMATION& mbi) {
+    return mem::Committed(mbi) && mbi.Protect && mbi.Protect != PAGE_EXECUTE
+        && !(mbi.Protect & (PAGE_NOACCESS | PAGE_GUARD));
+}
+
+class Writer {
+public:
+    Writer(HANDLE file, uint64_t start) : _file(file), _pos(start) {}
+
+    bool Seek(uint64_t pos) {
+        LARGE_INTEGER target;
+        target.QuadPart = (LONGLONG)pos;
+        return SetFilePointerEx(_file, target, nullptr, FILE_BEGIN) && (_pos = pos, true);
+    }
+
+    bool Write(const void* data, size_t size) {
+        DWORD written = 0;
+        if(WriteFile(_file, data, (DWORD)size, &written, nullptr) && written == size) {
+            _pos += size;
+            return true;
+        }
+        Seek(_pos); // undo a partial write
+        return false;
+    }
+
+    bool WriteZeroes(size_t size) {
+        for(size_t done = 0; done < size; done += kBlock) {
+            if(!Write(Zeroes(), kBlock)) return false;
+        }
+        return true;
+    }
+
+    /* Streams [lower, upper); pages that fault meanwhile are replaced with zeroes. */
+    bool WriteMemory(const char* lower, const char* upper, size_t page_size, bool& partial) {
+        for(const char* chunk = lower; chunk < upper; chunk += kChunk) {
+            const size_t size = (size_t)(upper - chunk) < kChunk ? (size_t)(upper - chunk) : kChunk;
+            if(Write(chunk, size)) continue;
+            for(const char* page = chunk; page < chunk + size; page += page_size) {
+                if(Write(page, page_size)) continue;
+                partial = true;
+                if(!WriteZeroes(page_size)) return false;
+            }
+        }
+        return true;
+    }
+
+    uint64_t Pos() const { return _pos; }
+
+private:
+    HANDLE _file;
+    uint64_t _pos;
+};
+
+class Dump {
+public:
+    Dump(HANDLE file, uint64_t start) : _out(file, start), _page_size(getpagesize()) {}
+
+    bool Begin() {
+        memset(Blocks(), 0, 3 * kBlock);
+        memcpy(Header().magic, MEMMAP_DUMP_MAGIC, sizeof(Header().magic));
+        Header().version = MEMMAP_DUMP_VERSION;
+        Header().page_size = (uint32_t)_page_size;
+        Header().pointer_bits = 8 * sizeof(void*);
+        Header().process_id = GetCurrentProcessId();
+        _header_pos = _out.Pos();
+        return _out.WriteZeroes(kBlock); // placeholder, rewritten by `End`
+    }
+
+    /* Dumps one region minus excluded ranges. */
+    void Region(const MEMORY_BASIC_INFORMATION& mbi, const MEMMAP_RANGE& range) {
+        uintptr_t lower = (uintptr_t)range.lower;
+        const uintptr_t upper = (uintptr_t)range.upper;
+        while(_ok && lower < upper) {
+            // the lowest exclusion overlapping [lower, upper), if any
+            uintptr_t cut = upper, resume = upper;
+            for(unsigned i = 0; i < _exclusion_count; ++i) {
+                const Exclusion& ex = _exclusions[i];
+                if(ex.lower < upper && ex.upper > lower && ex.lower < cut) {
+                    cut = ex.lower > lower ? ex.lower : lower;
+                    resume = ex.upper;
+                }
+            }
+            if(cut > lower) Piece(mbi, lower, cut);
+            Header().excluded_bytes += (resume < upper ? resume : upper) - cut;
+            lower = resume;
+        }
+    }
+
+    bool End() {
+        if(_ok && Index().count) FlushIndex();
+        const uint64_t end = _out.Pos();
+        _ok = _ok && _out.Seek(_header_pos) && _out.Write(Blocks(), kBlock) && _out.Seek(end);
+        return _ok;
+    }
+
+private:
+    void Piece(const MEMORY_BASIC_INFORMATION& mbi, uintptr_t lower, uintptr_t upper) {
+        memmap_dump_region& entry = Index().regions[Index().count];
+        entry.base = lower;
+        entry.size = upper - lower;
+        entry.offset = _out.Pos();
+        entry.protect = mbi.Protect;
+        entry.type = (uint16_t)(mbi.Type >> 16);
+        bool partial = false;
+        _ok = _out.WriteMemory((const char*)lower, (const char*)upper, _page_size, partial);
+        entry.flags = partial ? MEMMAP_DUMP_PARTIAL : 0;
+        Header().region_count++;
+        Header().data_bytes += entry.size;
+        if(_ok && ++Index().count == kIndexCapacity) FlushIndex();
+    }
+
+    void FlushIndex() {
+        const uint64_t pos = _out.Pos();
+        _ok = _out.Write(&Index(), kBlock);
+        Header().last_index = pos;
+        memset(&Index(), 0, kBlock);
+        Index().prev_index = pos;
+    }
+
+    Writer _out;
+    size_t _page_size;
+    uint64_t _header_pos = 0;
+    bool _ok = true;
+};
+
+} // anonymous
+
+extern "C" {
+
+int memmap_dump_write_handle(HANDLE file) {
+    LARGE_INTEGER zero, start;
+    zero.QuadPart = 0;
+    if(!SetFilePointerEx(file, zero, &start, FILE_CURRENT) || start.QuadPart % kBlock) {
+        return errno = EINVAL, -1;
+    }
+    if(InterlockedCompareExchange(&_dump_busy, 1, 0)) {
+        return errno = EBUSY, -1;
+    }
+
+    Dump dump(file, start.QuadPart);
+    bool ok = dump.Begin();
+    if(ok) {
+        mem::TraverseInPlace(mem::ProcessRange(), [&](const MEMORY_BASIC_INFORMATION& mbi, const MEMMAP_RANGE& range) {
+            if(ok) dump.Region(mbi, range);
+        }, &Dumpable);
+        ok = dump.End();
+    }
+
+    InterlockedExchange(&_dump_busy, 0);
+    return ok ? 0 : (errno = EIO, -1);
+}
+
+int memmap_dump_write(const char* path) {
+    HANDLE file = CreateFileA(path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING, nullptr);
+    if(file == INVALID_HANDLE_VALUE) {
+        return errno = (GetLastError() == ERROR_ACCESS_DENIED) ? EACCES : ENOENT, -1;
+    }
+    const int retval = memmap_dump_write_handle(file);
+    const int saved = errno;
+    CloseHandle(file);
+    errno = saved;
+    return retval;
+}
+
+int memmap_dump_exclude(const void* addr, size_t length) {
+    const uintptr_t page_size = getpagesize();
+    const uintptr_t lower = (uintptr_t)addr - (uintptr_t)addr % page_size;
+    uintptr_t upper = (uintptr_t)addr + length + page_size - 1;
+    upper -= upper % page_size;
+
+    mem::ExclusiveLock guard(_exclusion_lock);
+    if(_exclusion_count == kMaxExclusions) return errno = ENOMEM, -1;
+    _exclusions[_exclusion_count] = {lower, upper};
+    MemoryBarrier(); // publish the entry before the count (the dump reads without the lock)
+    _exclusion_count = _exclusion_count + 1;
+    return 0;
+}
+
+int memmap_dump_include(const void* addr, size_t length) {
+    if(!_exclusion_count) return 0; // `munmap` calls this every time
+    const uintptr_t page_size = getpagesize();
+    const uintptr_t lower = (uintptr_t)addr - (uintptr_t)addr % page_size;
+    uintptr_t upper = (uintptr_t)addr + length + page_size - 1;
+    upper -= upper % page_size;
+
+    mem::ExclusiveLock guard(_exclusion_lock);
+    for(unsigned i = 0; i < _exclusion_count;) {
+        Exclusion& ex = _exclusions[i];
+        if(ex.upper <= lower || ex.lower >= upper) {
+            ++i;
+        } else if(ex.lower < lower && ex.upper > upper) {
+            // punching a hole: the tail needs a slot of its own
+            if(_exclusion_count == kMaxExclusions) return errno = ENOMEM, -1;
+            _exclusions[_exclusion_count] = {upper, ex.upper};
+            ex.upper = lower;
+            MemoryBarrier();
+            _exclusion_count = _exclusion_count + 1;
+            ++i;
+        } else if(ex.lower < lower) {
+            ex.upper = lower;
+            ++i;
+        } else if(ex.upper > upper) {
+            ex.lower = upper;
+            ++i;
+        } else {
+            ex = _exclusions[_exclusion_count - 1];
+            _exclusion_count = _exclusion_count - 1;
+        }
+    }
+    return 0;
+}
+
+} // extern "C"
@@ -0,0 +1,176 @@
+#include "sys/mman.h"
+#include "memmap/fault.h"
+#include "memmap/proc.h"
+
+#include "sync.h"
+#include "dbg.h" // tracing
+
+#include <windows.h>
+#include <errno.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <new>
+#include <vector>
+
+struct memmap_fault_region {
+    HANDLE section = nullptr;
+    char* data = nullptr;  // the view handed out; PAGE_NOACCESS until filled
+    char* alias = nullptr; // read-write view the callback fills
+    size_t length = 0;
+    size_t chunk = 0;      // bytes filled at a time
+    DWORD protection = PAGE_NOACCESS;
+    memmap_fault_fill fill = nullptr;
+    void* ctx = nullptr;
+    SRWLOCK lock = SRWLOCK_INIT; // serializes fills
+    std::vector<bool> filled;    // per chunk
+    std::atomic<size_t> faults{0};
+    std::atomic<size_t> fills{0};
+    std::atomic<size_t> failures{0};
+};
+
+namespace {
+
+constexpr ULONG_PTR kWriteAccess = 1; // EXCEPTION_RECORD::ExceptionInformation[0]
+
+/**
+ * All regions by base address. The handler holds the lock (shared) for as long as it
+ * works on a region, so that `memmap_fault_unregister` (exclusive) waits for it.
+ */
+SRWLOCK _regions_lock = SRWLOCK_INIT;
+std::map<uintptr_t, memmap_fault_region*> _regions;
+PVOID _fault_handler = nullptr;
+
+/* Fills chunk `index` unless it is already filled. Call with `region.lock` held exclusively. */
+bool FillChunk(memmap_fault_region& region, size_t index) {
+    if(region.filled[index]) return true;
+    const size_t offset = index * region.chunk;
+    const size_t length = std::min(region.chunk, region.length - offset);
+    if(region.fill(region.alias + offset, length, offset, region.ctx)) {
+        ++region.failures;
+        return false;
+    }
+    DWORD ignored;
+    if(!VirtualProtect(region.data + offset, length, region.protection, &ignored)) return false;
+    _MEMMAP_LOG("fault: filled %p (%lx bytes)", region.data + offset, (DWORD)length);
+    region.filled[index] = true;
+    ++region.fills;
+    return true;
+}
+
+LONG CALLBACK Materialize(PEXCEPTION_POINTERS info) {
+    const EXCEPTION_RECORD* record = info->ExceptionRecord;
+    if(record->ExceptionCode != EXCEPTION_ACCESS_VIOLATION || record->NumberParameters < 2) {
+        return EXCEPTION_CONTINUE_SEARCH;
+    }
+    const uintptr_t at = record->ExceptionInformation[1];
+    mem::SharedLock registry(_regions_lock);
+    auto found = _regions.upper_bound(at);
+    if(found == _regions.begin()) return EXCEPTION_CONTINUE_SEARCH;
+    memmap_fault_region& region = *(--found)->second;
+    if(at >= (uintptr_t)region.data + region.length) return EXCEPTION_CONTINUE_SEARCH;
+
+    mem::ExclusiveLock guard(region.lock);
+    const size_t index = (at - (uintptr_t)region.data) / region.chunk;
+    if(region.filled[index]) {
+        // filled by another thread in the meantime: retry; unless it's a genuine write violation
+        const bool write = record->ExceptionInformation[0] == kWriteAccess;
+        return (write && region.protection == PAGE_READONLY) ? EXCEPTION_CONTINUE_SEARCH : EXCEPTION_CONTINUE_EXECUTION;
+    }
+    ++region.faults;
+    return FillChunk(region, index) ? EXCEPTION_CONTINUE_EXECUTION : EXCEPTION_CONTINUE_SEARCH;
+}
+
+void Destroy(memmap_fault_region* region) {
+    if(region->alias) UnmapViewOfFile(region->alias);
+    if(region->data) UnmapViewOfFile(region->data);
+    if(region->section) CloseHandle(region->section);
+    delete region;
+}
+
+} // anonymous
+
+extern "C" {
+
+memmap_fault_region* memmap_fault_register(size_t length, int prot, size_t batch, memmap_fault_fill fill, void* ctx) {
+    const size_t page_size = getpagesize();
+    if(!length || !fill || (prot & ~(PROT_READ | PROT_WRITE))) return errno = EINVAL, nullptr;
+    length += page_size - 1;
+    length -= length % page_size;
+
+    memmap_fault_region* region = new(std::nothrow) memmap_fault_region();
+    if(!region) return errno = ENOMEM, nullptr;
+    region->length = length;
+    region->chunk = (batch ? batch : 1) * page_size;
+    region->protection = (prot & PROT_WRITE) ? PAGE_READWRITE : PAGE_READONLY;
+    region->fill = fill;
+    region->ctx = ctx;
+    try {
+        region->filled.resize((length + region->chunk - 1) / region->chunk);
+    } catch(const std::bad_alloc&) {
+        delete region;
+        return errno = ENOMEM, nullptr;
+    }
+
+    const uint64_t size = length;
+    region->section = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE | SEC_COMMIT,
+                                         (DWORD)(size >> 32), (DWORD)size, nullptr);
+    if(region->section) {
+        region->data = (char*)MapViewOfFile(region->section, FILE_MAP_WRITE, 0, 0, length);
+        region->alias = (char*)MapViewOfFile(region->section, FILE_MAP_WRITE, 0, 0, length);
+    }
+    DWORD ignored;
+    if(!region->data || !region->alias || !VirtualProtect(region->data, length, PAGE_NOACCESS, &ignored)) {
+        Destroy(region);
+        return errno = ENOMEM, nullptr;
+    }
+
+    mem::ExclusiveLock registry(_regions_lock);
+    if(!_fault_handler) _fault_handler = AddVectoredExceptionHandler(1, &Materialize);
+    try {
+        if(_fault_handler) _regions[(uintptr_t)region->data] = region;
+    } catch(const std::bad_alloc&) {}
+    if(!_regions.count((uintptr_t)region->data)) {
+        Destroy(region);
+        return errno = ENOMEM, nullptr;
+    }
+    _MEMMAP_LOG("fault: region %p (%lx bytes, %lx per fill)", region->data, (DWORD)length, (DWORD)region->chunk);
+    return region;
+}
+
+void memmap_fault_unregister(memmap_fault_region* region) {
+    if(!region) return;
+    {
+        mem::ExclusiveLock registry(_regions_lock); // waits for the handler
+        _regions.erase((uintptr_t)region->data);
+    }
+    Destroy(region);
+}
+
+void* memmap_fault_base(const memmap_fault_region* region) {
+    return region->data;
+}
+
+size_t memmap_fault_length(const memmap_fault_region* region) {
+    return region->length;
+}
+
+int memmap_fault_populate(memmap_fault_region* region, size_t offset, size_t length) {
+    if(offset >= region->length || length > region->length - offset) return errno = EINVAL, -1;
+    if(!length) return 0;
+    mem::ExclusiveLock guard(region->lock);
+    const size_t last = (offset + length - 1) / region->chunk;
+    for(size_t index = offset / region->chunk; index <= last; ++index) {
+        if(!FillChunk(*region, index)) return errno = EIO, -1;
+    }
+    return 0;
+}
+
+void memmap_fault_get_stats(const memmap_fault_region* region, memmap_fault_stats* stats) {
+    stats->faults = region->faults;
+    stats->fills = region->fills;
+    stats->failures = region->failures;
+}
+
+} // extern "C"
@@ -0,0 +1,187 @@
+#include "sys/mman.h"
+#include "memmap/conf.h"
+#include "memmap/proc.h"
+#include "memmap/iter.h"
+
+#include "fit.h"
+#include "sync.h"
+#include "dbg.h" // tracing
+
+#include <windows.h>
+#include <stdint.h>
+#include <map>
+
+namespace {
+
+constexpr size_t kDefaultLarge = 1 << 20;
+constexpr unsigned kAttempts = 3;        // addresses tried before the system chooses
+constexpr unsigned kRescanEvery = 256;   // placements; other allocators change the address space too
+
+volatile bool _fit_enabled = false;
+size_t _fit_large = kDefaultLarge;
+
+/**
+ * The free blocks of the address space as last seen (lower -> upper), kept up to date
+ * by our own placements and releases. Blocks taken or freed by others are noticed
+ * when a placement fails, and by the periodic rescan.
+ */
+SRWLOCK _fit_lock = SRWLOCK_INIT;
+std::map<uintptr_t, uintptr_t> _free;
+unsigned _placements = kRescanEvery; // the first placement scans
+
+uintptr_t GranuleCeil(uintptr_t address) {
+    const uintptr_t allocgran = get_allocation_granularity();
+    return (address + allocgran - 1) / allocgran * allocgran;
+}
+
+uintptr_t GranuleFloor(uintptr_t address) {
+    const uintptr_t allocgran = get_allocation_granularity();
+    return address / allocgran * allocgran;
+}
+
+/* floor(log2(bytes in granules)), capped at the last class. */
+unsigned SizeClass(uintptr_t bytes) {
+    unsigned size_class = 0;
+    for(bytes /= get_allocation_granularity(); bytes > 1 && size_class < MEMMAP_FREE_CLASSES - 1; bytes >>= 1) {
+        ++size_class;
+    }
+    return size_class;
+}
+
+bool Free(const MEMORY_BASIC_INFORMATION& mbi) {
+    return mbi.State == MEM_FREE;
+}
+
+void Rescan() {
+    _free.clear();
+    mem::TraverseInPlace(mem::ProcessRange(), [](const MEMORY_BASIC_INFORMATION&, const MEMMAP_RANGE& range) {
+        _free[(uintptr_t)range.lower] = (uintptr_t)range.upper;
+    }, &Free);
+    _placements = 0;
+    _MEMMAP_LOG("fit: %lu free blocks", (DWORD)_free.size());
+}
+
+/* Removes [lower, upper) from the free blocks. */
+void Forget(uintptr_t lower, uintptr_t upper) {
+    auto it = _free.upper_bound(lower);
+    if(it != _free.begin()) --it;
+    while(it != _free.end() && it->first < upper) {
+        const uintptr_t block_lower = it->first;
+        const uintptr_t block_upper = it->second;
+        if(block_upper <= lower) {
+            ++it;
+            continue;
+        }
+        it = _free.erase(it);
+        if(block_lower < lower) _free[block_lower] = lower;
+        if(upper < block_upper) _free[upper] = block_upper;
+    }
+}
+
+/* Replaces what we know about the region containing `addr` with what the system says. */
+void Refresh(void* addr) {
+    MEMORY_BASIC_INFORMATION mbi;
+    if(!VirtualQuery(addr, &mbi, sizeof(mbi))) return;
+    const uintptr_t lower = (uintptr_t)mbi.BaseAddress;
+    const uintptr_t upper = lower + mbi.RegionSize;
+    Forget(lower, upper);
+    if(mbi.State == MEM_FREE) _free[lower] = upper; // free regions are maximal: no neighbor to merge with
+}
+
+/**
+ * The free block of the smallest size class that fits `length` (a multiple of the
+ * page size); the lowest such block for bottom-up placement, the highest for top-down.
+ * Stores the address at its bottom (or top) in `at`.
+ */
+bool Choose(size_t length, bool top_down, uintptr_t& at) {
+    const unsigned wanted = SizeClass(length);
+    unsigned best = MEMMAP_FREE_CLASSES;
+    for(const auto& block : _free) {
+        const uintptr_t lower = GranuleCeil(block.first);
+        const uintptr_t upper = block.second;
+        if(lower >= upper || upper - lower < length) continue;
+        const unsigned size_class = SizeClass(upper - lower);
+        if(size_class < best || (size_class == best && top_down)) { // blocks come in address order
+            best = size_class;
+            at = top_down ? GranuleFloor(upper - length) : lower;
+            if(!top_down && best == wanted) break; // nothing fits tighter, or lower
+        }
+    }
+    return best < MEMMAP_FREE_CLASSES;
+}
+
+} // anonymous
+
+namespace mem {
+namespace fit {
+
+bool Enabled() {
+    return _fit_enabled;
+}
+
+void* Place(size_t length, const std::function<void*(void*)>& map) {
+    const size_t page_size = getpagesize();
+    length += page_size - 1; length -= length % page_size;
+    if(!length) return map(nullptr);
+
+    mem::ExclusiveLock guard(_fit_lock);
+    if(_placements >= kRescanEvery) Rescan();
+    const bool top_down = length >= _fit_large;
+    bool rescanned = !_placements;
+    for(unsigned attempt = 0; attempt < kAttempts; ++attempt) {
+        uintptr_t at = 0;
+        if(!Choose(length, top_down, at)) {
+            if(rescanned) break;
+            Rescan(); // the index may have missed releases by others
+            rescanned = true;
+            if(!Choose(length, top_down, at)) break;
+        }
+        _MEMMAP_LOG("fit: %lx bytes at %p (%s)", (DWORD)length, (void*)at, top_down ? "top down" : "bottom up");
+        if(void* placed = map((void*)at)) {
+            Forget(at, at + length);
+            ++_placements;
+            return placed;
+        }
+        Refresh((void*)at); // taken behind our back (or the failure was not about the address)
+    }
+    return map(nullptr);
+}
+
+void Released(void* addr) {
+    if(!_fit_enabled) return;
+    mem::ExclusiveLock guard(_fit_lock);
+    Refresh(addr);
+}
+
+} // namespace fit
+} // namespace mem
+
+extern "C" {
+
+void set_mmap_placement_policy(enum mmap_placement_policy policy, size_t large_length) {
+    mem::ExclusiveLock guard(_fit_lock);
+    _fit_large = large_length ? large_length : kDefaultLarge;
+    _fit_enabled = (policy == mmap_placement_policy__best_fit);
+    _free.clear();
+    _placements = kRescanEvery;
+}
+
+void memmap_fragmentation_get(memmap_fragmentation* report) {
+    *report = memmap_fragmentation();
+    mem::TraverseInPlace(mem::ProcessRange(), [&](const MEMORY_BASIC_INFORMATION&, const MEMMAP_RANGE& range) {
+        const uintptr_t lower = GranuleCeil((uintptr_t)range.lower);
+        const uintptr_t upper = (uintptr_t)range.upper;
+        if(lower >= upper) { // the tail of a granule after an allocation: nothing can be placed there
+            report->unusable_bytes += MEMMAP_RANGE_SIZE(range);
+            return;
+        }
+        const size_t usable = upper - lower;
+        report->unusable_bytes += lower - (uintptr_t)range.lower;
+        report->free_bytes += usable;
+        if(usable > report->largest_free) report->largest_free = usable;
+        ++report->free_blocks;
+        ++report->blocks[SizeClass(usable)];
+    }, &Free);
+}
+
+} // extern "C"
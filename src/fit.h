@@ -0,0 +1,28 @@
+#ifndef _MEMMAP_SRC_FIT_H_
+#define _MEMMAP_SRC_FIT_H_
+
+#include <stddef.h>
+#include <functional>
+
+/* Best-fit placement of mappings without an address hint (see `set_mmap_placement_policy`) */
+
+namespace mem {
+namespace fit {
+
+/* Whether the best-fit policy is on. The index allocates: check `TrustTheHeap` as well. */
+bool Enabled();
+
+/**
+ * Calls `map(at)` with the address chosen for `length` bytes, and once more at the
+ * next choice if the system refuses it (the range was taken behind our back). Falls
+ * back to `map(nullptr)`, i.e. to the system's choice. Returns the result of `map`.
+ */
+void* Place(size_t length, const std::function<void*(void*)>& map);
+
+/* Takes note of the free range containing `addr` after a release (`munmap`). */
+void Released(void* addr);
+
+} // namespace fit
+} // namespace mem
+
+#endif /* _MEMMAP_SRC_FIT_H_ */
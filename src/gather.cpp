@@ -0,0 +1,94 @@
+#include "sys/mman.h"
+#include "memmap/gather.h"
+#include "memmap/proc.h"
+
+#include "place.h"
+#include "view.h"
+#include "dbg.h" // tracing
+
+#include <windows.h>
+#include <errno.h>
+#include <stdint.h>
+
+namespace {
+
+/* Checks the alignment constraints (see memmap/gather.h) and computes the size of the reservation. */
+bool Layout(const memmap_extent* extents, size_t count, size_t& padding, size_t& slots) {
+    const size_t granularity = get_allocation_granularity();
+    const size_t page_size = getpagesize();
+    if(!count) return false;
+    padding = mem::view::Padding(extents[0].offset);
+    slots = padding;
+    for(size_t i = 0; i < count; ++i) {
+        const memmap_extent& extent = extents[i];
+        if(extent.offset < 0 || !extent.length) return false;
+        if(i && mem::view::Padding(extent.offset)) return false;
+        slots += extent.length;
+        if(i + 1 < count && slots % granularity) return false;
+    }
+    slots += page_size - 1; // the last slot ends at a page boundary
+    slots -= slots % page_size;
+    return true;
+}
+
+} // anonymous
+
+extern "C" {
+
+void* memmap_gather(const memmap_extent* extents, size_t count, int prot, int flags, size_t* length) {
+    size_t padding = 0, slots = 0;
+    if(!Layout(extents, count, padding, slots) || !(flags & MAP_SHARED) == !(flags & MAP_PRIVATE)) {
+        return errno = EINVAL, MAP_FAILED;
+    }
+    prot &= PROT_MASK;
+    const size_t granularity = get_allocation_granularity();
+    const size_t reserved = (slots + granularity - 1) / granularity * granularity; // as `place::Reserve` takes it
+    char* base = (char*)mem::place::Reserve(reserved);
+    if(!base) return MAP_FAILED;
+
+    char* slot = base;
+    for(size_t i = 0; i < count; ++i) {
+        const memmap_extent& extent = extents[i];
+        const uint64_t offset = extent.offset - (i ? 0 : padding);
+        const size_t size = extent.length + (i ? 0 : padding); // the last one may end mid-page: its slot does not
+
+        HANDLE hfile = mem::view::FileHandle(extent.fd);
+        HANDLE section = (hfile != INVALID_HANDLE_VALUE)
+            ? mem::view::Section(hfile, mem::view::Protection(prot, flags), prot)
+            : (errno = EBADF, nullptr);
+        void* view = section ? mem::place::Map(section, offset, size, prot, flags, slot) : nullptr;
+        if(section) CloseHandle(section); // the view keeps it alive
+        if(!view) {
+            const int saved = errno;
+            memmap_gather_unmap(base, slot - base);
+            mem::place::Release(slot, base + reserved - slot);
+            return errno = saved, MAP_FAILED;
+        }
+        _MEMMAP_LOG("gather: extent #%lu (fd %d) at %p", (unsigned long)i, extent.fd, slot);
+        slot += size;
+    }
+    if(reserved > slots) mem::place::Release(base + slots, reserved - slots); // the rest of the last granule
+    if(length) {
+        size_t total = 0;
+        for(size_t i = 0; i < count; ++i) total += extents[i].length;
+        *length = total;
+    }
+    return base + padding;
+}
+
+int memmap_gather_unmap(void* addr, size_t length) {
+    char* lower = (char*)addr - mem::view::Padding((uintptr_t)addr);
+    char* const upper = (char*)addr + length;
+    MEMORY_BASIC_INFORMATION mbi;
+    while(lower < upper && VirtualQuery(lower, &mbi, sizeof(mbi))) {
+        if(mbi.Type == MEM_MAPPED && mbi.State != MEM_FREE) {
+            // one view per extent: unmap it and look at the same address again
+            if(!UnmapViewOfFile(mbi.AllocationBase)) return errno = EINVAL, -1;
+            continue;
+        }
+        lower = (char*)mbi.BaseAddress + mbi.RegionSize;
+    }
+    return 0;
+}
+
+} // extern "C"
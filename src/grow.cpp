@@ -0,0 +1,149 @@
+#include "sys/mman.h"
+#include "memmap/grow.h"
+#include "memmap/proc.h"
+
+#include "place.h"
+#include "view.h"
+#include "sync.h"
+#include "dbg.h" // tracing
+
+#include <windows.h>
+#include <errno.h>
+#include <stdint.h>
+#include <algorithm>
+#include <new>
+#include <vector>
+
+namespace {
+
+/**
+ * The file grows geometrically (by the mapped size, at least kMinStep), so that
+ * a steady stream of small appends creates a logarithmic number of views.
+ * Sparse files make the headroom free on disk until it is written.
+ */
+constexpr size_t kMinStep = 1 << 20;
+
+} // anonymous
+
+struct memmap_growable {
+    HANDLE file;
+    char* base;
+    size_t capacity;
+    size_t mapped;
+    size_t length;
+    SRWLOCK lock;
+    std::vector<void*> views;
+};
+
+namespace {
+
+bool Grow(memmap_growable& g, size_t needed) {
+    if(needed <= g.mapped) return true;
+    if(needed > g.capacity) return errno = ENOMEM, false;
+    const size_t granularity = get_allocation_granularity();
+    size_t target = std::max(needed, g.mapped + std::max(g.mapped, kMinStep));
+    target += granularity - 1;
+    target -= target % granularity;
+    target = std::min(target, g.capacity);
+
+    // every section is as large as the file has to become; its views are coherent with the earlier ones
+    HANDLE section = mem::view::Section(g.file, PAGE_READWRITE, PROT_DATA, target);
+    if(!section) return false;
+    void* view = mem::place::Map(section, g.mapped, target - g.mapped, PROT_DATA, MAP_SHARED, g.base + g.mapped);
+    CloseHandle(section); // the view keeps it alive
+    if(!view) return false;
+    g.views.push_back(view);
+    _MEMMAP_LOG("grow: %p mapped %lx -> %lx", g.base, (DWORD)g.mapped, (DWORD)target);
+    g.mapped = target;
+    return true;
+}
+
+void Unmap(memmap_growable& g) {
+    for(void* view : g.views) UnmapViewOfFile(view);
+    g.views.clear();
+    mem::place::Release(g.base + g.mapped, g.capacity - g.mapped);
+}
+
+} // anonymous
+
+extern "C" {
+
+memmap_growable* memmap_grow_open(int fd, size_t capacity) {
+    const size_t granularity = get_allocation_granularity();
+    capacity += granularity - 1;
+    capacity -= capacity % granularity;
+
+    HANDLE hfile = mem::view::FileHandle(fd);
+    LARGE_INTEGER file_size;
+    if(hfile == INVALID_HANDLE_VALUE || !GetFileSizeEx(hfile, &file_size)) {
+        return errno = EBADF, nullptr;
+    }
+    if(!capacity || (uint64_t)file_size.QuadPart > capacity) return errno = EINVAL, nullptr;
+
+    // NTFS and ReFS; elsewhere the file is zero-filled as it grows, which is slower but correct
+    DWORD ignored = 0;
+    if(!DeviceIoControl(hfile, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &ignored, nullptr)) {
+        _MEMMAP_LOG("grow: FSCTL_SET_SPARSE GetLastError()=%lx", GetLastError());
+    }
+
+    memmap_growable* g = new(std::nothrow) memmap_growable();
+    if(!g) return errno = ENOMEM, nullptr;
+    g->file = hfile;
+    g->capacity = capacity;
+    g->length = (size_t)file_size.QuadPart;
+    InitializeSRWLock(&g->lock);
+    g->base = (char*)mem::place::Reserve(capacity);
+    if(!g->base || !Grow(*g, g->length)) {
+        const int saved = errno;
+        if(g->base) Unmap(*g);
+        delete g;
+        return errno = saved, nullptr;
+    }
+    return g;
+}
+
+int memmap_grow_close(memmap_growable* g) {
+    if(!g) return 0;
+    Unmap(*g);
+    // give back the headroom: the file ends where the data does
+    LARGE_INTEGER zero, saved, length;
+    zero.QuadPart = 0;
+    length.QuadPart = g->length;
+    const bool truncated = SetFilePointerEx(g->file, zero, &saved, FILE_CURRENT)
+        && SetFilePointerEx(g->file, length, nullptr, FILE_BEGIN) && SetEndOfFile(g->file)
+        && SetFilePointerEx(g->file, saved, nullptr, FILE_BEGIN);
+    delete g;
+    return truncated ? 0 : (errno = EIO, -1);
+}
+
+void* memmap_grow_base(const memmap_growable* g) {
+    return g->base;
+}
+
+size_t memmap_grow_length(const memmap_growable* g) {
+    return g->length;
+}
+
+size_t memmap_grow_mapped(const memmap_growable* g) {
+    return g->mapped;
+}
+
+size_t memmap_grow_capacity(const memmap_growable* g) {
+    return g->capacity;
+}
+
+int memmap_grow_reserve(memmap_growable* g, size_t length) {
+    mem::ExclusiveLock guard(g->lock);
+    return Grow(*g, length) ? 0 : -1;
+}
+
+void* memmap_grow_append(memmap_growable* g, size_t size) {
+    mem::ExclusiveLock guard(g->lock);
+    if(size > g->capacity - g->length) return errno = ENOMEM, nullptr;
+    if(!Grow(*g, g->length + size)) return nullptr;
+    char* at = g->base + g->length;
+    g->length += size;
+    return at;
+}
+
+} // extern "C"
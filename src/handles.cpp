@@ -0,0 +1,69 @@
+#include "handles.h"
+
+#include <windows.h>
+
+namespace {
+
+/* Resolved from ntdll.dll and kernelbase.dll: there are no import libraries for the former. */
+struct ObjectBasicInformation {
+    ULONG attributes;
+    ACCESS_MASK access;
+    ULONG handles;
+    ULONG pointers;
+    ULONG reserved[10];
+};
+
+typedef LONG (NTAPI *NtQueryObjectFunc)(HANDLE handle, int info_class, PVOID info, ULONG length, PULONG result);
+typedef BOOL (WINAPI *CompareObjectHandlesFunc)(HANDLE first, HANDLE second);
+
+struct Functions {
+    NtQueryObjectFunc nt_query_object = nullptr;
+    CompareObjectHandlesFunc compare_object_handles = nullptr;
+
+    Functions() {
+        if(HMODULE ntdll = GetModuleHandleW(L"ntdll.dll")) {
+            nt_query_object = (NtQueryObjectFunc)(void*)GetProcAddress(ntdll, "NtQueryObject");
+        }
+        if(HMODULE kernelbase = GetModuleHandleW(L"kernelbase.dll")) {
+            compare_object_handles = (CompareObjectHandlesFunc)(void*)GetProcAddress(kernelbase, "CompareObjectHandles");
+        }
+    }
+};
+
+const Functions& Api() {
+    static const Functions api;
+    return api;
+}
+
+bool Query(HANDLE handle, ObjectBasicInformation& info) {
+    return Api().nt_query_object
+        && Api().nt_query_object(handle, 0 /*ObjectBasicInformation*/, &info, sizeof(info), nullptr) >= 0;
+}
+
+} // anonymous
+
+namespace mem {
+namespace handles {
+
+bool Supported() {
+    return Api().nt_query_object;
+}
+
+bool Access(HANDLE handle, ACCESS_MASK& access) {
+    ObjectBasicInformation info;
+    if(!Query(handle, info)) return false;
+    access = info.access;
+    return true;
+}
+
+bool Alive(HANDLE duplicate) {
+    ObjectBasicInformation info;
+    return !Query(duplicate, info) || info.handles > 1; // ours is not the only handle to the object
+}
+
+bool Same(HANDLE handle, HANDLE duplicate) {
+    return Api().compare_object_handles ? Api().compare_object_handles(handle, duplicate) : Alive(duplicate);
+}
+
+} // namespace handles
+} // namespace mem
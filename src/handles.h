@@ -0,0 +1,92 @@
+#ifndef _MEMMAP_SRC_HANDLES_H_
+#define _MEMMAP_SRC_HANDLES_H_
+
+#include <windows.h>
+#include <stddef.h>
+#include <map>
+#include <new>
+
+/**
+ * State kept per CRT fd, by the file handle behind it (see access.cpp, memfd.cpp).
+ * A handle value is only unique while its fd is open, and the CRT does not say when an
+ * fd is closed: each entry holds a duplicate of the handle, and the fd is gone once the
+ * duplicate is the last handle to the object. Built on NtQueryObject and
+ * CompareObjectHandles (Windows 10+), looked up at run time.
+ */
+
+namespace mem {
+namespace handles {
+
+/* Entries a sweep looks at: each new fd retires up to this many closed ones. */
+constexpr size_t kSweepBudget = 4;
+
+/* Whether NtQueryObject is available: without it, nothing is known of handles. */
+bool Supported();
+
+/* The access mask of `handle` in `access`. False if the system will not tell. */
+bool Access(HANDLE handle, ACCESS_MASK& access);
+
+/* Whether the fd `duplicate` was taken from is still open somewhere (true if unknown). */
+bool Alive(HANDLE duplicate);
+
+/* Whether `handle` still refers to the object `duplicate` was taken from, rather than being a reused value. */
+bool Same(HANDLE handle, HANDLE duplicate);
+
+/**
+ * Entries by handle; `Entry` has a `HANDLE duplicate` member. `release` is called on
+ * every entry that is dropped. Call with the owner's lock held, exclusively for the
+ * methods that change the registry.
+ */
+template<typename Entry, void (*release)(const Entry&)>
+class Registry {
+public:
+    bool Empty() const { return _entries.empty(); }
+
+    /* The entry of `hfile`, or nullptr (also if the value now belongs to another object). */
+    Entry* Find(HANDLE hfile) {
+        auto found = _entries.find(hfile);
+        if(found == _entries.end() || !Same(hfile, found->second.duplicate)) return nullptr;
+        return &found->second;
+    }
+
+    /* Enters `entry` for `hfile`, dropping a stale one. nullptr (and `entry` not released) without memory. */
+    Entry* Insert(HANDLE hfile, const Entry& entry) {
+        auto found = _entries.find(hfile);
+        if(found != _entries.end()) {
+            release(found->second);
+            return &(found->second = entry);
+        }
+        try {
+            return &_entries.emplace(hfile, entry).first->second;
+        } catch(const std::bad_alloc&) {
+            return nullptr;
+        }
+    }
+
+    /**
+     * Drops the entries whose fds have been closed, looking at `budget` of them at most
+     * (one NtQueryObject each), round robin from where the previous sweep stopped.
+     */
+    void Sweep(size_t budget = kSweepBudget) {
+        auto it = _entries.lower_bound(_cursor);
+        for(size_t seen = 0, count = _entries.size(); seen < budget && seen < count && !_entries.empty(); ++seen) {
+            if(it == _entries.end()) it = _entries.begin();
+            if(Alive(it->second.duplicate)) {
+                ++it;
+            } else {
+                release(it->second);
+                it = _entries.erase(it);
+            }
+        }
+        _cursor = (it != _entries.end()) ? it->first : nullptr;
+    }
+
+private:
+    std::map<HANDLE, Entry> _entries;
+    HANDLE _cursor = nullptr; // where the next sweep starts
+};
+
+} // namespace handles
+} // namespace mem
+
+#endif /* _MEMMAP_SRC_HANDLES_H_ */
@@ -0,0 +1,228 @@
+#include "sys/mman.h"
+#include "memmap/heat.h"
+#include "memmap/proc.h"
+#include "memmap/iter.h"
+
+#include "sync.h"
+#include "dbg.h" // tracing
+
+#include <windows.h>
+#include <psapi.h> /* QueryWorkingSetEx */
+#include <errno.h>
+#include <algorithm>
+#include <new>
+#include <vector>
+
+namespace {
+
+constexpr unsigned kDefaultInterval = 100;
+constexpr size_t kDefaultPagesPerSample = 4096;
+constexpr uint16_t kMaxCount = UINT16_MAX;
+
+struct Region {
+    char* addr;
+    size_t pages;
+    unsigned passes = 0;
+    bool primed = false;
+    std::vector<uint16_t> counts; // accesses per page
+};
+
+} // anonymous
+
+struct memmap_heat_profiler {
+    memmap_heat_config config;
+    size_t page_size;
+    SRWLOCK lock = SRWLOCK_INIT; // guards everything below
+    std::vector<Region> regions;
+    size_t cursor_region = 0;
+    size_t cursor_page = 0;
+    std::vector<PSAPI_WORKING_SET_EX_INFORMATION> batch; // one sample's worth
+    HANDLE sampler = nullptr;
+    HANDLE stop = nullptr;
+};
+
+namespace {
+
+/* Removes [lower, upper) from the working set. `VirtualUnlock` "fails" with ERROR_NOT_LOCKED, as intended. */
+void Trim(char* lower, char* upper) {
+    if(lower < upper) VirtualUnlock(lower, upper - lower);
+}
+
+/* Samples up to `pages` pages of `region` starting at page `first`. Call with the lock held. */
+void SampleRun(memmap_heat_profiler& profiler, Region& region, size_t first, size_t pages) {
+    PSAPI_WORKING_SET_EX_INFORMATION* batch = profiler.batch.data();
+    for(size_t i = 0; i < pages; ++i) {
+        batch[i].VirtualAddress = region.addr + (first + i) * profiler.page_size;
+    }
+    if(!QueryWorkingSetEx(GetCurrentProcess(), batch, (DWORD)(pages * sizeof(*batch)))) return;
+
+    char* trim_from = nullptr; // start of the current run of trimmable pages
+    for(size_t i = 0; i < pages; ++i) {
+        const PSAPI_WORKING_SET_EX_BLOCK& page = batch[i].VirtualAttributes;
+        if(page.Valid && region.primed && region.counts[first + i] < kMaxCount) {
+            ++region.counts[first + i];
+        }
+        const bool trimmable = page.Valid && !page.Locked && !page.LargePage && !profiler.config.keep_resident;
+        if(trimmable && !trim_from) {
+            trim_from = (char*)batch[i].VirtualAddress;
+        } else if(!trimmable && trim_from) {
+            Trim(trim_from, (char*)batch[i].VirtualAddress);
+            trim_from = nullptr;
+        }
+    }
+    if(trim_from) Trim(trim_from, region.addr + (first + pages) * profiler.page_size);
+}
+
+/* One sample: up to `pages_per_sample` pages, continuing where the previous sample stopped. */
+void Sample(memmap_heat_profiler& profiler) {
+    mem::ExclusiveLock guard(profiler.lock);
+    size_t budget = profiler.config.pages_per_sample;
+    size_t visited = 0; // regions; never more than one round per sample
+    while(budget && !profiler.regions.empty() && visited <= profiler.regions.size()) {
+        if(profiler.cursor_region >= profiler.regions.size()) profiler.cursor_region = 0;
+        Region& region = profiler.regions[profiler.cursor_region];
+        const size_t pages = std::min(budget, region.pages - profiler.cursor_page);
+        SampleRun(profiler, region, profiler.cursor_page, pages);
+        budget -= pages;
+        profiler.cursor_page += pages;
+        if(profiler.cursor_page == region.pages) {
+            if(region.primed) ++region.passes;
+            region.primed = true;
+            profiler.cursor_page = 0;
+            ++profiler.cursor_region;
+            ++visited;
+        }
+    }
+}
+
+DWORD WINAPI Sampler(LPVOID context) {
+    memmap_heat_profiler& profiler = *(memmap_heat_profiler*)context;
+    while(WaitForSingleObject(profiler.stop, profiler.config.interval_ms) == WAIT_TIMEOUT) {
+        Sample(profiler);
+    }
+    return 0;
+}
+
+bool AddRegion(memmap_heat_profiler& profiler, void* addr, size_t length) {
+    const uintptr_t lower = (uintptr_t)addr - (uintptr_t)addr % profiler.page_size;
+    const uintptr_t upper = ((uintptr_t)addr + length + profiler.page_size - 1) / profiler.page_size * profiler.page_size;
+    Region region;
+    region.addr = (char*)lower;
+    region.pages = (upper - lower) / profiler.page_size;
+    region.counts.resize(region.pages);
+    profiler.regions.push_back(std::move(region));
+    return true;
+}
+
+bool Profiled(const MEMORY_BASIC_INFORMATION& mbi) {
+    return mbi.State == MEM_COMMIT && mbi.Type != MEM_IMAGE && !(mbi.Protect & (PAGE_NOACCESS | PAGE_GUARD));
+}
+
+} // anonymous
+
+extern "C" {
+
+memmap_heat_profiler* memmap_heat_create(const memmap_heat_config* config) {
+    memmap_heat_profiler* profiler = new(std::nothrow) memmap_heat_profiler();
+    if(!profiler) return errno = ENOMEM, nullptr;
+    if(config) profiler->config = *config;
+    if(!profiler->config.interval_ms) profiler->config.interval_ms = kDefaultInterval;
+    if(!profiler->config.pages_per_sample) profiler->config.pages_per_sample = kDefaultPagesPerSample;
+    profiler->page_size = getpagesize();
+    try {
+        profiler->batch.resize(profiler->config.pages_per_sample);
+    } catch(const std::bad_alloc&) {
+        delete profiler;
+        return errno = ENOMEM, nullptr;
+    }
+    return profiler;
+}
+
+void memmap_heat_destroy(memmap_heat_profiler* profiler) {
+    if(!profiler) return;
+    memmap_heat_stop(profiler);
+    delete profiler;
+}
+
+int memmap_heat_add(memmap_heat_profiler* profiler, void* addr, size_t length) {
+    if(!addr || !length) return errno = EINVAL, -1;
+    mem::ExclusiveLock guard(profiler->lock);
+    try {
+        AddRegion(*profiler, addr, length);
+    } catch(const std::bad_alloc&) {
+        return errno = ENOMEM, -1;
+    }
+    return (int)profiler->regions.size() - 1;
+}
+
+int memmap_heat_add_process(memmap_heat_profiler* profiler) {
+    mem::ExclusiveLock guard(profiler->lock);
+    const size_t before = profiler->regions.size();
+    try {
+        // the profiler's own bookkeeping is heap memory too, and grows while we add; it stays in
+        mem::TraverseAllProcessMemory([&](const MEMORY_BASIC_INFORMATION&, const MEMMAP_RANGE& range) {
+            AddRegion(*profiler, range.lower, MEMMAP_RANGE_SIZE(range));
+        }, &Profiled);
+    } catch(const std::bad_alloc&) {
+        return errno = ENOMEM, -1;
+    }
+    return (int)(profiler->regions.size() - before);
+}
+
+int memmap_heat_start(memmap_heat_profiler* profiler) {
+    if(profiler->sampler) return 0;
+    if(!profiler->stop) profiler->stop = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if(!profiler->stop) return errno = EAGAIN, -1;
+    ResetEvent(profiler->stop);
+    profiler->sampler = CreateThread(nullptr, 0, &Sampler, profiler, 0, nullptr);
+    if(!profiler->sampler) return errno = EAGAIN, -1;
+    SetThreadPriority(profiler->sampler, THREAD_PRIORITY_BELOW_NORMAL);
+    return 0;
+}
+
+int memmap_heat_stop(memmap_heat_profiler* profiler) {
+    if(profiler->sampler) {
+        SetEvent(profiler->stop);
+        WaitForSingleObject(profiler->sampler, INFINITE);
+        CloseHandle(profiler->sampler);
+        profiler->sampler = nullptr;
+    }
+    if(profiler->stop) {
+        CloseHandle(profiler->stop);
+        profiler->stop = nullptr;
+    }
+    return 0;
+}
+
+void memmap_heat_sample(memmap_heat_profiler* profiler) {
+    Sample(*profiler);
+}
+
+size_t memmap_heat_report(memmap_heat_profiler* profiler, memmap_heat_histogram* out, size_t capacity) {
+    mem::SharedLock guard(profiler->lock);
+    const size_t regions = profiler->regions.size();
+    for(size_t r = 0; r < regions && r < capacity; ++r) {
+        const Region& region = profiler->regions[r];
+        memmap_heat_histogram& histogram = out[r];
+        histogram = memmap_heat_histogram();
+        histogram.addr = region.addr;
+        histogram.length = region.pages * profiler->page_size;
+        histogram.passes = region.passes;
+        const size_t top = MEMMAP_HEAT_BUCKETS - 1;
+        for(uint16_t count : region.counts) {
+            const size_t bucket = !count ? 0 : 1 + std::min(top - 1, (size_t)count * top / std::max(region.passes, 1u));
+            ++histogram.pages[bucket];
+        }
+    }
+    return regions;
+}
+
+size_t memmap_heat_counts(memmap_heat_profiler* profiler, int index, uint16_t* counts, size_t capacity) {
+    mem::SharedLock guard(profiler->lock);
+    if(index < 0 || (size_t)index >= profiler->regions.size()) return errno = EINVAL, 0;
+    const Region& region = profiler->regions[index];
+    std::copy_n(region.counts.begin(), std::min(capacity, region.pages), counts);
+    return region.pages;
+}
+
+} // extern "C"
@@ -0,0 +1,296 @@
+#include "sys/mman.h"
+#include "memmap/conf.h"
+#include "memmap/huge.h"
+#include "memmap/proc.h"
+
+#include "huge.h"
+#include "place.h"
+#include "sync.h"
+#include "dbg.h" // tracing
+
+#include <windows.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <new>
+
+#ifndef MEM_RESERVE_PLACEHOLDER
+#define MEM_RESERVE_PLACEHOLDER 0x00040000
+#endif
+#ifndef MEM_REPLACE_PLACEHOLDER
+#define MEM_REPLACE_PLACEHOLDER 0x00004000
+#endif
+#ifndef MEM_COALESCE_PLACEHOLDERS
+#define MEM_COALESCE_PLACEHOLDERS 0x00000001
+#endif
+#ifndef MEM_PRESERVE_PLACEHOLDER
+#define MEM_PRESERVE_PLACEHOLDER 0x00000002
+#endif
+#ifndef FILE_MAP_LARGE_PAGES
+#define FILE_MAP_LARGE_PAGES 0x20000000
+#endif
+
+namespace {
+
+/* Resolved from kernelbase.dll, as in place.cpp. */
+typedef PVOID (WINAPI *VirtualAlloc2Func)(HANDLE process, PVOID base, SIZE_T size, ULONG type,
+                                         ULONG protection, void* params, ULONG param_count);
+typedef PVOID (WINAPI *MapViewOfFile3Func)(HANDLE section, HANDLE process, PVOID base, ULONG64 offset,
+                                          SIZE_T size, ULONG type, ULONG protection, void* params, ULONG param_count);
+typedef BOOL (WINAPI *UnmapViewOfFile2Func)(HANDLE process, PVOID base, ULONG flags);
+
+struct Functions {
+    VirtualAlloc2Func virtual_alloc2 = nullptr;
+    MapViewOfFile3Func map_view_of_file3 = nullptr;
+    UnmapViewOfFile2Func unmap_view_of_file2 = nullptr;
+
+    Functions() {
+        HMODULE kernelbase = GetModuleHandleW(L"kernelbase.dll");
+        if(!kernelbase) return;
+        virtual_alloc2 = (VirtualAlloc2Func)(void*)GetProcAddress(kernelbase, "VirtualAlloc2");
+        map_view_of_file3 = (MapViewOfFile3Func)(void*)GetProcAddress(kernelbase, "MapViewOfFile3");
+        unmap_view_of_file2 = (UnmapViewOfFile2Func)(void*)GetProcAddress(kernelbase, "UnmapViewOfFile2");
+    }
+
+    bool Supported() const { return virtual_alloc2 && map_view_of_file3 && unmap_view_of_file2; }
+};
+
+const Functions& Api() {
+    static const Functions api;
+    return api;
+}
+
+/**
+ * A promoted mapping: the view of large pages [lower, upper) and the private
+ * allocations [base, lower) and [upper, base+size) around it, if not empty.
+ */
+struct Promoted {
+    size_t size;
+    uintptr_t lower;
+    uintptr_t upper;
+};
+
+SRWLOCK _huge_lock = SRWLOCK_INIT;
+std::map<uintptr_t, Promoted> _promoted; // by base address
+std::atomic<size_t> _count{0};           // of `_promoted`, for `Unmap` to skip the lock
+
+std::atomic<size_t> _promotions{0};
+std::atomic<size_t> _promoted_bytes{0};
+std::atomic<size_t> _fallbacks{0};
+
+volatile bool _huge_promotable = false; // see `set_mmap_hugepage_promotable`
+
+int Fallback(const char* why) {
+    (void) why; // tracing only
+    _MEMMAP_LOG("hugepage: left on small pages (%s)", why);
+    ++_fallbacks;
+    return 0;
+}
+
+/* The promoted mapping containing `addr`, or `_promoted.end()`. Call with the lock held. */
+std::map<uintptr_t, Promoted>::iterator Containing(uintptr_t addr) {
+    auto it = _promoted.upper_bound(addr);
+    if(it == _promoted.begin()) return _promoted.end();
+    --it;
+    return (addr < it->first + it->second.size) ? it : _promoted.end();
+}
+
+/* The bounds of the allocation containing `addr` if it is committed read-write private memory throughout. */
+bool Allocation(void* addr, uintptr_t& base, uintptr_t& end) {
+    MEMORY_BASIC_INFORMATION mbi;
+    if(!VirtualQuery(addr, &mbi, sizeof(mbi)) || mbi.Type != MEM_PRIVATE) return false;
+    base = (uintptr_t)mbi.AllocationBase;
+    for(end = base; VirtualQuery((void*)end, &mbi, sizeof(mbi)) && (uintptr_t)mbi.AllocationBase == base; end += mbi.RegionSize) {
+        if(mbi.State != MEM_COMMIT || mbi.Protect != PAGE_READWRITE) return false;
+    }
+    return end > base;
+}
+
+/* Replaces the placeholder [lower, upper) with private memory holding `data`. */
+bool Replace(uintptr_t lower, uintptr_t upper, const char* data) {
+    if(lower == upper) return true;
+    if(!Api().virtual_alloc2(nullptr, (void*)lower, upper - lower, MEM_RESERVE | MEM_COMMIT | MEM_REPLACE_PLACEHOLDER,
+                             PAGE_READWRITE, nullptr, 0)) return false;
+    memcpy((void*)lower, data, upper - lower);
+    return true;
+}
+
+/**
+ * After a failed swap: puts [base, end) back on small pages, from the copies. The range
+ * is turned back into placeholders and coalesced first, so it is ours throughout.
+ * Returns false if the data could not be put back.
+ */
+bool Restore(uintptr_t base, uintptr_t end, const Promoted& promoted, HANDLE section, const char* saved) {
+    MEMORY_BASIC_INFORMATION mbi;
+    for(uintptr_t at = base; at < end && VirtualQuery((void*)at, &mbi, sizeof(mbi)); at = (uintptr_t)mbi.BaseAddress + mbi.RegionSize) {
+        if(mbi.Type == MEM_MAPPED) {
+            Api().unmap_view_of_file2(GetCurrentProcess(), mbi.AllocationBase, MEM_PRESERVE_PLACEHOLDER);
+        } else if(mbi.State == MEM_COMMIT) {
+            VirtualFree(mbi.AllocationBase, mbi.RegionSize, MEM_RELEASE | MEM_PRESERVE_PLACEHOLDER);
+        }
+    }
+    VirtualFree((void*)base, end - base, MEM_RELEASE | MEM_COALESCE_PLACEHOLDERS); // fails if already one
+    const size_t head = promoted.lower - base;
+    const size_t size = promoted.upper - promoted.lower;
+    char* data = (char*)Api().virtual_alloc2(nullptr, (void*)base, end - base, MEM_RESERVE | MEM_COMMIT | MEM_REPLACE_PLACEHOLDER,
+                                             PAGE_READWRITE, nullptr, 0);
+    const char* large = data ? (const char*)MapViewOfFile(section, FILE_MAP_READ, 0, 0, size) : nullptr;
+    if(large) {
+        memcpy(data + head, large, size);
+        if(saved) {
+            memcpy(data, saved, head);
+            memcpy(data + head + size, saved + head, end - promoted.upper);
+        }
+        UnmapViewOfFile(large);
+    }
+    return large;
+}
+
+} // anonymous
+
+namespace mem {
+namespace huge {
+
+void* Map(void* addr, size_t length, DWORD vm_request, DWORD protection) {
+    const size_t large = gethugepagesize();
+    const bool candidate = _huge_promotable && large && length >= large && !(vm_request & MEM_LARGE_PAGES)
+        && !((uintptr_t)addr % get_allocation_granularity()) && Api().Supported();
+    if(!candidate) {
+        _MEMMAP_LOG("VirtualAlloc(%p, %lx, %lx, %lx)", addr, (DWORD)length, vm_request, protection);
+        return VirtualAlloc(addr, length, vm_request, protection);
+    }
+    _MEMMAP_LOG("VirtualAlloc2(%p, %lx, MEM_RESERVE_PLACEHOLDER) + replace (%lx)", addr, (DWORD)length, protection);
+    void* placeholder = Api().virtual_alloc2(nullptr, addr, length, MEM_RESERVE | MEM_RESERVE_PLACEHOLDER,
+                                             PAGE_NOACCESS, nullptr, 0);
+    if(!placeholder) return nullptr;
+    void* mapping = Api().virtual_alloc2(nullptr, placeholder, length, MEM_RESERVE | MEM_COMMIT | MEM_REPLACE_PLACEHOLDER,
+                                         protection, nullptr, 0);
+    if(!mapping) {
+        const DWORD error = GetLastError(); // for `mmap` to tell EINVAL from ENOMEM
+        VirtualFree(placeholder, 0, MEM_RELEASE);
+        SetLastError(error);
+    }
+    return mapping;
+}
+
+int Promote(void* addr, size_t length) {
+    const uintptr_t large = gethugepagesize();
+    if(!large || !Api().Supported()) return Fallback("no placeholder API");
+    mem::ExclusiveLock guard(_huge_lock);
+    uintptr_t base, end;
+    if(Containing((uintptr_t)addr) != _promoted.end() || !Allocation(addr, base, end)) {
+        return Fallback("not an anonymous read-write mapping");
+    }
+    const uintptr_t first = (uintptr_t)addr;
+    const uintptr_t last = std::min<uintptr_t>(first + length, end);
+    Promoted promoted = {end - base, (first + large - 1) / large * large, last / large * large};
+    if(promoted.lower >= promoted.upper || first - base >= large || end - last >= large) {
+        return Fallback("not a whole mapping");
+    }
+
+    // the data goes into large pages first, and the small pages around them aside
+    const size_t size = promoted.upper - promoted.lower;
+    const size_t head = promoted.lower - base;
+    const size_t tail = end - promoted.upper;
+    HANDLE section = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE | SEC_COMMIT | SEC_LARGE_PAGES,
+                                        (DWORD)((uint64_t)size >> 32), (DWORD)size, nullptr);
+    if(!section) return Fallback("no large pages"); // SeLockMemoryPrivilege, or fragmented memory
+    char* staging = (char*)MapViewOfFile(section, FILE_MAP_WRITE | FILE_MAP_LARGE_PAGES, 0, 0, size);
+    char* saved = (head + tail) ? (char*)VirtualAlloc(nullptr, head + tail, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE) : nullptr;
+    bool tracked = true;
+    try {
+        _promoted[base] = promoted; // before the swap: `munmap` must not miss any of the pieces
+    } catch(const std::bad_alloc&) {
+        tracked = false;
+    }
+    auto discard = [&]() {
+        if(saved) VirtualFree(saved, 0, MEM_RELEASE);
+        if(tracked) _promoted.erase(base);
+        CloseHandle(section);
+    };
+    if(!staging || (head + tail && !saved) || !tracked) {
+        if(staging) UnmapViewOfFile(staging);
+        discard();
+        return Fallback("out of memory");
+    }
+    memcpy(staging, (void*)promoted.lower, size);
+    UnmapViewOfFile(staging);
+    if(saved) {
+        memcpy(saved, (void*)base, head);
+        memcpy(saved + head, (void*)promoted.upper, tail);
+    }
+
+    // the swap: the allocation goes back to the placeholder it was made from (see `Map`), so
+    // the addresses stay ours throughout; only its own users must keep off (see memmap/huge.h)
+    if(!VirtualFree((void*)base, end - base, MEM_RELEASE | MEM_PRESERVE_PLACEHOLDER)) {
+        discard();
+        return Fallback("not made from a placeholder");
+    }
+    _MEMMAP_LOG("hugepage: %p..%p -> %lx bytes of large pages at %p", (void*)base, (void*)end, (DWORD)size, (void*)promoted.lower);
+    const bool swapped = mem::place::Carve((char*)promoted.lower, size)
+        && Api().map_view_of_file3(section, GetCurrentProcess(), (void*)promoted.lower, 0, size,
+                                   MEM_REPLACE_PLACEHOLDER | MEM_LARGE_PAGES, PAGE_READWRITE, nullptr, 0)
+        && Replace(base, promoted.lower, saved) && Replace(promoted.upper, end, saved + head);
+    const bool restored = !swapped && Restore(base, end, promoted, section, saved);
+    if(saved) VirtualFree(saved, 0, MEM_RELEASE);
+    CloseHandle(section); // the view keeps it
+    if(!swapped) {
+        _promoted.erase(base);
+        if(restored) return Fallback("swap failed");
+        _MEMMAP_LOG("hugepage: %p..%p lost", (void*)base, (void*)end); // still reserved: nothing else lands there
+        return errno = ENOMEM, -1;
+    }
+    _count = _promoted.size();
+    ++_promotions;
+    _promoted_bytes += size;
+    return 0;
+}
+
+bool Unmap(void* addr, size_t length) {
+    if(!_count) return false;
+    mem::ExclusiveLock guard(_huge_lock);
+    auto it = Containing((uintptr_t)addr);
+    if(it == _promoted.end()) return false;
+    const uintptr_t base = it->first;
+    const Promoted& promoted = it->second;
+    const uintptr_t end = base + promoted.size;
+    const size_t page_size = getpagesize();
+    const uintptr_t lower = (uintptr_t)addr;
+    const uintptr_t upper = std::min<uintptr_t>(end, (lower + length + page_size - 1) / page_size * page_size);
+    if(lower == base && upper == end) {
+        _MEMMAP_LOG("hugepage: releasing %p..%p", (void*)base, (void*)end);
+        UnmapViewOfFile((void*)promoted.lower);
+        if(base < promoted.lower) VirtualFree((void*)base, 0, MEM_RELEASE);
+        if(promoted.upper < end) VirtualFree((void*)promoted.upper, 0, MEM_RELEASE);
+        _promoted.erase(it);
+        _count = _promoted.size();
+        return true;
+    }
+    // the large pages stay until the whole mapping goes
+    if(lower < promoted.lower) VirtualFree((void*)lower, std::min(upper, promoted.lower) - lower, MEM_DECOMMIT);
+    if(upper > promoted.upper) {
+        const uintptr_t from = std::max(lower, promoted.upper);
+        VirtualFree((void*)from, upper - from, MEM_DECOMMIT);
+    }
+    return true;
+}
+
+} // namespace huge
+} // namespace mem
+
+extern "C" {
+
+void set_mmap_hugepage_promotable(int promotable) {
+    _huge_promotable = promotable;
+}
+
+void memmap_hugepage_get_stats(memmap_hugepage_stats* stats) {
+    stats->promotions = _promotions;
+    stats->promoted_bytes = _promoted_bytes;
+    stats->fallbacks = _fallbacks;
+    stats->promoted = _count;
+}
+
+} // extern "C"
@@ -0,0 +1,37 @@
+#ifndef _MEMMAP_SRC_HUGE_H_
+#define _MEMMAP_SRC_HUGE_H_
+
+#include <windows.h>
+#include <stddef.h>
+
+/* Mappings migrated to large pages by MADV_HUGEPAGE (see memmap/huge.h) */
+
+namespace mem {
+namespace huge {
+
+/**
+ * `VirtualAlloc` for anonymous mappings: with `set_mmap_hugepage_promotable` on, those
+ * that could be promoted later are made from a placeholder, which `Promote` can turn
+ * them back into without letting go of the addresses.
+ */
+void* Map(void* addr, size_t length, DWORD vm_request, DWORD protection);
+
+/**
+ * Moves the large-page-aligned part of [addr, addr+length) to large pages if the range
+ * covers an anonymous read-write allocation made by `Map` (see memmap/huge.h). Returns 0
+ * whether or not it did (the counters tell promotions from fallbacks), and -1 with `errno`
+ * (ENOMEM) if a failed swap could not put the data back: the mapping is lost.
+ */
+int Promote(void* addr, size_t length);
+
+/**
+ * Unmaps [addr, addr+length) if it lies in a promoted mapping: all of its pieces if it
+ * covers the mapping, the small pages it covers otherwise. Returns false (and does
+ * nothing) for any other memory.
+ */
+bool Unmap(void* addr, size_t length);
+
+} // namespace huge
+} // namespace mem
+
+#endif /* _MEMMAP_SRC_HUGE_H_ */
@@ -0,0 +1,187 @@
+#include "memmap/jit.h"
+#include "memmap/proc.h"
+
+#include "sync.h"
+#include "dbg.h" // tracing
+
+#include <windows.h>
+#include <errno.h>
+#include <stdint.h>
+#include <algorithm>
+#include <new>
+
+namespace {
+
+/**
+ * Dirty ranges are kept as a short list of disjoint [lower, upper) offsets. Adjacent and
+ * overlapping ranges merge on insertion; when the list is full, a new range merges with
+ * its nearest neighbor, trading a slightly larger flush for bounded bookkeeping.
+ */
+constexpr unsigned kMaxDirtyRanges = 32;
+
+struct DirtyRange {
+    size_t lower;
+    size_t upper;
+};
+
+constexpr size_t kDefaultAlignment = 16;
+
+} // anonymous
+
+struct memmap_jit_region {
+    char* rw;
+    char* rx;
+    size_t capacity;
+    size_t used;
+    SRWLOCK lock;
+    unsigned dirty_count;
+    DirtyRange dirty[kMaxDirtyRanges];
+};
+
+namespace {
+
+void MarkDirty(memmap_jit_region& region, size_t lower, size_t upper) {
+    DirtyRange* dirty = region.dirty;
+    unsigned& count = region.dirty_count;
+    for(unsigned i = 0; i < count;) {
+        if(dirty[i].upper >= lower && dirty[i].lower <= upper) {
+            // absorb the overlapping (or touching) range and look again
+            lower = std::min(lower, dirty[i].lower);
+            upper = std::max(upper, dirty[i].upper);
+            dirty[i] = dirty[--count];
+            i = 0;
+        } else {
+            ++i;
+        }
+    }
+    if(count == kMaxDirtyRanges) {
+        // merge the new range with its nearest neighbor
+        unsigned nearest = 0;
+        size_t best_gap = SIZE_MAX;
+        for(unsigned i = 0; i < count; ++i) {
+            const size_t gap = dirty[i].lower > upper ? dirty[i].lower - upper : lower - dirty[i].upper;
+            if(gap < best_gap) {
+                best_gap = gap;
+                nearest = i;
+            }
+        }
+        lower = std::min(lower, dirty[nearest].lower);
+        upper = std::max(upper, dirty[nearest].upper);
+        dirty[nearest] = dirty[--count];
+    }
+    dirty[count++] = {lower, upper};
+}
+
+bool Contains(const char* base, size_t capacity, const void* addr) {
+    return (uintptr_t)addr - (uintptr_t)base < capacity;
+}
+
+} // anonymous
+
+extern "C" {
+
+memmap_jit_region* memmap_jit_create(size_t capacity) {
+    const size_t granularity = get_allocation_granularity();
+    capacity += granularity - 1;
+    capacity -= capacity % granularity;
+    if(!capacity) return errno = EINVAL, nullptr;
+
+    memmap_jit_region* region = new(std::nothrow) memmap_jit_region();
+    if(!region) return errno = ENOMEM, nullptr;
+
+    // SEC_COMMIT charges the whole section against the commit limit up front, exactly
+    // like an anonymous `mmap` would. PAGE_EXECUTE_READWRITE is the maximum protection
+    // of the section, not of any view.
+    const uint64_t size = capacity;
+    HANDLE section = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_EXECUTE_READWRITE | SEC_COMMIT,
+                                        (DWORD)(size >> 32), (DWORD)size, nullptr);
+    if(!section) {
+        _MEMMAP_LOG("jit: CreateFileMappingW GetLastError()=%lx", GetLastError());
+        delete region;
+        return errno = ENOMEM, nullptr;
+    }
+    region->rw = (char*)MapViewOfFile(section, FILE_MAP_WRITE, 0, 0, capacity);
+    region->rx = (char*)MapViewOfFile(section, FILE_MAP_READ | FILE_MAP_EXECUTE, 0, 0, capacity);
+    CloseHandle(section); // the views keep the section alive
+    if(!region->rw || !region->rx) {
+        _MEMMAP_LOG("jit: MapViewOfFile GetLastError()=%lx", GetLastError());
+        if(region->rw) UnmapViewOfFile(region->rw);
+        if(region->rx) UnmapViewOfFile(region->rx);
+        delete region;
+        return errno = EACCES, nullptr;
+    }
+    region->capacity = capacity;
+    InitializeSRWLock(&region->lock);
+    _MEMMAP_LOG("jit: region rw=%p rx=%p (%lx bytes)", region->rw, region->rx, (DWORD)capacity);
+    return region;
+}
+
+void memmap_jit_destroy(memmap_jit_region* region) {
+    if(!region) return;
+    UnmapViewOfFile(region->rx);
+    UnmapViewOfFile(region->rw);
+    delete region;
+}
+
+void* memmap_jit_alloc(memmap_jit_region* region, size_t size, size_t align, void** rx) {
+    if(!align) align = kDefaultAlignment;
+    if(align & (align - 1)) return errno = EINVAL, nullptr;
+
+    mem::ExclusiveLock guard(region->lock);
+    const size_t offset = (region->used + align - 1) & ~(align - 1);
+    if(offset > region->capacity || size > region->capacity - offset) {
+        return errno = ENOMEM, nullptr;
+    }
+    region->used = offset + size;
+    MarkDirty(*region, offset, offset + size);
+    if(rx) *rx = region->rx + offset;
+    return region->rw + offset;
+}
+
+void memmap_jit_reset(memmap_jit_region* region) {
+    mem::ExclusiveLock guard(region->lock);
+    region->used = 0;
+    region->dirty_count = 0;
+}
+
+void memmap_jit_dirty(memmap_jit_region* region, const void* rw, size_t length) {
+    if(!Contains(region->rw, region->capacity, rw)) return;
+    const size_t lower = (const char*)rw - region->rw;
+    const size_t upper = std::min(region->capacity, lower + length);
+    mem::ExclusiveLock guard(region->lock);
+    MarkDirty(*region, lower, upper);
+}
+
+int memmap_jit_publish(memmap_jit_region* region) {
+    mem::ExclusiveLock guard(region->lock);
+    int retval = 0;
+    HANDLE self = GetCurrentProcess();
+    for(unsigned i = 0; i < region->dirty_count; ++i) {
+        const DirtyRange& range = region->dirty[i];
+        _MEMMAP_LOG("FlushInstructionCache(%p, %lx)", region->rx + range.lower, (DWORD)(range.upper - range.lower));
+        if(!FlushInstructionCache(self, region->rx + range.lower, range.upper - range.lower)) {
+            errno = EFAULT;
+            retval = -1;
+        }
+    }
+    region->dirty_count = 0;
+    return retval;
+}
+
+void* memmap_jit_exec_address(const memmap_jit_region* region, const void* rw) {
+    return Contains(region->rw, region->capacity, rw) ? region->rx + ((const char*)rw - region->rw) : nullptr;
+}
+
+void* memmap_jit_write_address(const memmap_jit_region* region, const void* rx) {
+    return Contains(region->rx, region->capacity, rx) ? region->rw + ((const char*)rx - region->rx) : nullptr;
+}
+
+size_t memmap_jit_used(const memmap_jit_region* region) {
+    return region->used;
+}
+
+size_t memmap_jit_capacity(const memmap_jit_region* region) {
+    return region->capacity;
+}
+
+} // extern "C"
@@ -0,0 +1,35 @@
+#ifndef _MEMMAP_SRC_LINUX_IO_H_
+#define _MEMMAP_SRC_LINUX_IO_H_
+
+/* The Linux baseline backend (see windows.h): the MSVCRT descriptor functions the library uses */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define O_BINARY 0
+#define _O_BINARY 0
+#define _O_NOINHERIT O_CLOEXEC
+#define _S_IREAD S_IRUSR
+#define _S_IWRITE S_IWUSR
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The handle behind `fd`: the one given to `_open_osfhandle`, or one that refers to the descriptor. */
+intptr_t _get_osfhandle(int fd);
+
+/* A descriptor that takes over `handle` (a file handle); closing it with `_close` releases the handle. */
+int _open_osfhandle(intptr_t handle, int flags);
+
+int _close(int fd);
+int _commit(int fd);
+int _chsize_s(int fd, long long size); /* 0 or an errno value */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MEMMAP_SRC_LINUX_IO_H_ */
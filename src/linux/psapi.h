@@ -0,0 +1,41 @@
+#ifndef _MEMMAP_SRC_LINUX_PSAPI_H_
+#define _MEMMAP_SRC_LINUX_PSAPI_H_
+
+/* The Linux baseline backend (see windows.h): the process status functions the library uses */
+
+#include <windows.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef union _PSAPI_WORKING_SET_EX_BLOCK {
+    ULONG_PTR Flags;
+    __extension__ struct {
+        ULONG_PTR Valid : 1;
+        ULONG_PTR ShareCount : 3;
+        ULONG_PTR Win32Protection : 11;
+        ULONG_PTR Shared : 1;
+        ULONG_PTR Node : 6;
+        ULONG_PTR Locked : 1;
+        ULONG_PTR LargePage : 1;
+    };
+} PSAPI_WORKING_SET_EX_BLOCK;
+
+typedef struct _PSAPI_WORKING_SET_EX_INFORMATION {
+    PVOID VirtualAddress;
+    PSAPI_WORKING_SET_EX_BLOCK VirtualAttributes;
+} PSAPI_WORKING_SET_EX_INFORMATION;
+
+/* Residency from mincore(2): only `Valid` is filled in. */
+BOOL QueryWorkingSetEx(HANDLE process, PVOID info, DWORD size);
+
+/* The path of the file mapped at `addr`, from /proc/self/maps (no NT device prefix to translate). */
+DWORD GetMappedFileNameW(HANDLE process, LPVOID addr, LPWSTR name, DWORD length);
+DWORD GetMappedFileNameA(HANDLE process, LPVOID addr, LPSTR name, DWORD length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MEMMAP_SRC_LINUX_PSAPI_H_ */
@@ -0,0 +1,1632 @@
+/* The Win32 subset of the Linux baseline backend (see windows.h). */
+
+#include <windows.h>
+#include <psapi.h>
+#include <io.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <linux/mman.h>   // the kernel's PROT_*, MAP_*, MADV_*: sys/mman.h is the library's own
+#include <limits.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <algorithm>
+#include <map>
+#include <new>
+#include <vector>
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x1
+#endif
+
+namespace {
+
+constexpr uintptr_t kGranularity = 64 << 10;  // as on Windows: reservations and views start at multiples
+constexpr uintptr_t kMinAddress = kGranularity;
+constexpr uintptr_t kMaxAddress = (sizeof(void*) > 4) ? 0x7FFFFFFEFFFFull : 0xBFFEFFFFul;
+constexpr DWORD kErrorProcNotFound = 127;
+constexpr HRESULT kNotImplemented = (HRESULT)0x80004001;
+
+/**
+ * The system calls themselves, as the Win32 calls they stand in for are: no C library
+ * wrapper in between (the library's `mmap` and the rest are `memmap_posix_mmap` etc.).
+ */
+namespace kernel {
+
+void* Map(void* addr, size_t length, int prot, int flags, int fd, off_t offset) {
+#ifdef SYS_mmap2
+    return (void*)syscall(SYS_mmap2, addr, length, prot, flags, fd, (long)(offset >> 12));
+#else
+    return (void*)syscall(SYS_mmap, addr, length, prot, flags, fd, offset);
+#endif
+}
+
+void* const kFailed = (void*)-1; // MAP_FAILED
+
+int Unmap(void* addr, size_t length) {
+    return (int)syscall(SYS_munmap, addr, length);
+}
+
+int Protect(void* addr, size_t length, int prot) {
+    return (int)syscall(SYS_mprotect, addr, length, prot);
+}
+
+int Advise(void* addr, size_t length, int advice) {
+    return (int)syscall(SYS_madvise, addr, length, advice);
+}
+
+int Sync(void* addr, size_t length, int flags) {
+    return (int)syscall(SYS_msync, addr, length, flags);
+}
+
+int Lock(const void* addr, size_t length) {
+    return (int)syscall(SYS_mlock, addr, length);
+}
+
+int Unlock(const void* addr, size_t length) {
+    return (int)syscall(SYS_munlock, addr, length);
+}
+
+int Residency(void* addr, size_t length, unsigned char* vec) {
+    return (int)syscall(SYS_mincore, addr, length, vec);
+}
+
+int MemfdCreate(const char* name, unsigned flags) {
+    return (int)syscall(SYS_memfd_create, name, flags);
+}
+
+} // namespace kernel
+
+thread_local DWORD _last_error = ERROR_SUCCESS;
+
+template<typename T>
+T Fail(DWORD error, T result) {
+    _last_error = error;
+    return result;
+}
+
+/* The Win32 error for the `errno` of a failed system call. */
+DWORD ErrorFromErrno(int error) {
+    switch(error) {
+    case ENOENT:            return ERROR_FILE_NOT_FOUND;
+    case ENOTDIR:           return ERROR_PATH_NOT_FOUND;
+    case EMFILE:
+    case ENFILE:            return ERROR_TOO_MANY_OPEN_FILES;
+    case EBADF:             return ERROR_INVALID_HANDLE;
+    case ENOMEM:            return ERROR_NOT_ENOUGH_MEMORY;
+    case EEXIST:            return ERROR_FILE_EXISTS;
+    case EINVAL:            return ERROR_INVALID_PARAMETER;
+    case ENOSPC:
+    case EFBIG:             return ERROR_DISK_FULL;
+    case EFAULT:            return ERROR_NOACCESS;
+    case EAGAIN:            return ERROR_WORKING_SET_QUOTA;
+    default:                return ERROR_ACCESS_DENIED;
+    }
+}
+
+size_t PageSize() {
+    static const size_t page_size = sysconf(_SC_PAGESIZE);
+    return page_size;
+}
+
+uintptr_t Floor(uintptr_t value, uintptr_t unit) {
+    return value / unit * unit;
+}
+
+uintptr_t Ceil(uintptr_t value, uintptr_t unit) {
+    return (value + unit - 1) / unit * unit;
+}
+
+int ProtFrom(DWORD protect) {
+    if(protect & PAGE_GUARD) return PROT_NONE;
+    switch(protect & 0xff) {
+    case PAGE_READONLY:             return PROT_READ;
+    case PAGE_READWRITE:
+    case PAGE_WRITECOPY:            return PROT_READ | PROT_WRITE;
+    case PAGE_EXECUTE:              return PROT_EXEC;
+    case PAGE_EXECUTE_READ:         return PROT_READ | PROT_EXEC;
+    case PAGE_EXECUTE_READWRITE:
+    case PAGE_EXECUTE_WRITECOPY:    return PROT_READ | PROT_WRITE | PROT_EXEC;
+    default:                        return PROT_NONE;
+    }
+}
+
+/* Exactly one of the PAGE_* values, with the modifiers Linux has no use for. */
+bool ValidProtection(DWORD protect) {
+    const DWORD base = protect & 0xff;
+    return base && !(base & (base - 1)) && !(protect & ~(0xffu | PAGE_GUARD | PAGE_NOCACHE | PAGE_WRITECOMBINE));
+}
+
+///////////////////////////////////
+// Reservations, commits, views  //
+///////////////////////////////////
+
+/**
+ * What Windows would know about an allocation (a reservation or a view): its size
+ * and, per page, the protection, or 0 for a page reserved but not committed.
+ */
+struct Allocation {
+    size_t size;
+    DWORD type;     // MEM_PRIVATE or MEM_MAPPED
+    DWORD protect;  // as allocated
+    std::vector<DWORD> pages;
+};
+
+/* By base address. Held while the kernel mappings change, so that both agree. */
+pthread_mutex_t _vm_lock = PTHREAD_MUTEX_INITIALIZER;
+std::map<uintptr_t, Allocation> _allocations;
+
+class VmLock {
+public:
+    VmLock() { pthread_mutex_lock(&_vm_lock); }
+    ~VmLock() { pthread_mutex_unlock(&_vm_lock); }
+};
+
+/* The allocation containing [lower, upper), or nullptr. Call with the lock held. */
+Allocation* Find(uintptr_t lower, uintptr_t upper, uintptr_t* base) {
+    auto it = _allocations.upper_bound(lower);
+    if(it == _allocations.begin()) return nullptr;
+    --it;
+    if(upper > it->first + it->second.size) return nullptr;
+    *base = it->first;
+    return &it->second;
+}
+
+/**
+ * Reserves `length` bytes (a multiple of the page size) at `at`, which must be free,
+ * or anywhere if `at` is 0, at a multiple of the allocation granularity.
+ */
+void* Reserve(uintptr_t at, size_t length) {
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+    if(at) {
+        void* reserved = kernel::Map((void*)at, length, PROT_NONE, flags | MAP_FIXED_NOREPLACE, -1, 0);
+        if(reserved == kernel::kFailed) return nullptr;
+        if((uintptr_t)reserved != at) { // kernels before 4.17 take the flag for a hint
+            kernel::Unmap(reserved, length);
+            return errno = EEXIST, nullptr;
+        }
+        return reserved;
+    }
+    const size_t slack = kGranularity - PageSize();
+    char* const reserved = (char*)kernel::Map(nullptr, length + slack, PROT_NONE, flags, -1, 0);
+    if(reserved == kernel::kFailed) return nullptr;
+    char* const base = (char*)Ceil((uintptr_t)reserved, kGranularity);
+    if(base > reserved) kernel::Unmap(reserved, base - reserved);
+    if(reserved + slack > base) kernel::Unmap(base + length, reserved + slack - base);
+    return base;
+}
+
+/* Applies `protect` to the pages [lower, upper) of `allocation` (at `base`). Call with the lock held. */
+bool SetProtection(Allocation& allocation, uintptr_t base, uintptr_t lower, uintptr_t upper, DWORD protect) {
+    if(kernel::Protect((void*)lower, upper - lower, ProtFrom(protect))) return false;
+    const size_t page_size = PageSize();
+    std::fill(allocation.pages.begin() + (lower - base) / page_size,
+              allocation.pages.begin() + (upper - base) / page_size, protect);
+    return true;
+}
+
+/////////////////////////////
+// The rest of the process //
+/////////////////////////////
+
+/* A line of /proc/self/maps. */
+struct Mapping {
+    uintptr_t lower;
+    uintptr_t upper;
+    char perms[5];
+    char path[PATH_MAX]; // empty if anonymous
+};
+
+/**
+ * The PROCMAP_QUERY request of Linux 6.11: the line covering an address (or the next
+ * one) without formatting, let alone reading, the whole file. Declared here for older
+ * kernel headers; older kernels refuse it and we read the file instead.
+ */
+struct ProcmapQuery {
+    uint64_t size;
+    uint64_t query_flags;
+    uint64_t query_addr;
+    uint64_t vma_start;
+    uint64_t vma_end;
+    uint64_t vma_flags;
+    uint64_t vma_page_size;
+    uint64_t vma_offset;
+    uint64_t inode;
+    uint32_t dev_major;
+    uint32_t dev_minor;
+    uint32_t vma_name_size;
+    uint32_t build_id_size;
+    uint64_t vma_name_addr;
+    uint64_t build_id_addr;
+};
+
+constexpr unsigned long kProcmapQuery = _IOWR('f', 17, ProcmapQuery);
+constexpr uint64_t kProcmapReadable = 0x01;
+constexpr uint64_t kProcmapWritable = 0x02;
+constexpr uint64_t kProcmapExecutable = 0x04;
+constexpr uint64_t kProcmapShared = 0x08;
+constexpr uint64_t kProcmapCoveringOrNext = 0x10;
+
+int _maps_fd = -1;        // /proc/self/maps of `_maps_pid`, for PROCMAP_QUERY; under `_vm_lock`
+pid_t _maps_pid = 0;
+bool _maps_query = true;  // until the kernel says otherwise
+
+/* Parses a line of /proc/self/maps into `mapping`; false if malformed. */
+bool ParseLine(const char* line, Mapping& mapping) {
+    unsigned long lower, upper;
+    int path_at = 0;
+    if(sscanf(line, "%lx-%lx %4s %*s %*s %*s %n", &lower, &upper, mapping.perms, &path_at) < 3) return false;
+    mapping.lower = lower;
+    mapping.upper = upper;
+    const size_t length = std::min(strlen(line + path_at), sizeof(mapping.path) - 1);
+    memcpy(mapping.path, line + path_at, length);
+    mapping.path[length] = 0;
+    return true;
+}
+
+/**
+ * Reads /proc/self/maps up to the line ending above `address`, in pieces into a
+ * stack buffer: no allocation. The fallback of `FindMapping`.
+ */
+bool ScanMappings(uintptr_t address, Mapping& mapping) {
+    const int fd = open("/proc/self/maps", O_RDONLY | O_CLOEXEC);
+    if(fd < 0) return false;
+    char buffer[8192];
+    size_t held = 0;
+    bool found = false;
+    while(!found) {
+        const ssize_t got = read(fd, buffer + held, sizeof(buffer) - 1 - held);
+        if(got < 0 && errno == EINTR) continue;
+        if(got <= 0) {
+            buffer[held] = 0; // the last line, if it has no newline
+            found = held && ParseLine(buffer, mapping) && mapping.upper > address;
+            break;
+        }
+        held += got;
+        buffer[held] = 0;
+        char* line = buffer;
+        while(char* end = strchr(line, '\n')) {
+            *end = 0;
+            found = ParseLine(line, mapping) && mapping.upper > address;
+            line = end + 1;
+            if(found) break;
+        }
+        held -= line - buffer;
+        if(held == sizeof(buffer) - 1) held = 0; // no path is that long: drop the garbage
+        memmove(buffer, line, held);
+    }
+    close(fd);
+    return found;
+}
+
+/**
+ * The line of /proc/self/maps covering `address`, or else the next one; false past
+ * the last line. Call with the lock held: the descriptor is shared.
+ */
+bool FindMapping(uintptr_t address, Mapping& mapping) {
+    if(_maps_query && _maps_pid != getpid()) { // a forked child must not see its parent
+        if(_maps_fd >= 0) close(_maps_fd);
+        _maps_fd = open("/proc/self/maps", O_RDONLY | O_CLOEXEC);
+        _maps_pid = getpid();
+        _maps_query = _maps_fd >= 0;
+    }
+    if(!_maps_query) return ScanMappings(address, mapping);
+    ProcmapQuery query = {};
+    query.size = sizeof(query);
+    query.query_flags = kProcmapCoveringOrNext;
+    query.query_addr = address;
+    query.vma_name_size = sizeof(mapping.path);
+    query.vma_name_addr = (uintptr_t)mapping.path;
+    if(ioctl(_maps_fd, kProcmapQuery, &query)) {
+        if(errno == ENOENT) return false; // nothing above
+        if(errno != ENOTTY && errno != EINVAL) return ScanMappings(address, mapping);
+        _maps_query = false;
+        return ScanMappings(address, mapping);
+    }
+    if(!query.vma_name_size) mapping.path[0] = 0;
+    mapping.lower = query.vma_start;
+    mapping.upper = query.vma_end;
+    mapping.perms[0] = (query.vma_flags & kProcmapReadable) ? 'r' : '-';
+    mapping.perms[1] = (query.vma_flags & kProcmapWritable) ? 'w' : '-';
+    mapping.perms[2] = (query.vma_flags & kProcmapExecutable) ? 'x' : '-';
+    mapping.perms[3] = (query.vma_flags & kProcmapShared) ? 's' : 'p';
+    mapping.perms[4] = 0;
+    return true;
+}
+
+DWORD ProtectionFrom(const char* perms) {
+    const bool r = perms[0] == 'r';
+    const bool w = perms[1] == 'w';
+    const bool x = perms[2] == 'x';
+    const bool copy = perms[3] == 'p';
+    if(x) return w ? (copy ? PAGE_EXECUTE_WRITECOPY : PAGE_EXECUTE_READWRITE) : r ? PAGE_EXECUTE_READ : PAGE_EXECUTE;
+    return w ? (copy ? PAGE_WRITECOPY : PAGE_READWRITE) : r ? PAGE_READONLY : PAGE_NOACCESS;
+}
+
+/**
+ * VirtualQuery of an address outside our allocations: each line of /proc/self/maps
+ * is taken for an allocation of its own (file-backed ones for images), with the
+ * parts that are ours cut off; the gaps are free. Call with the lock held.
+ */
+void QueryForeign(uintptr_t address, PMEMORY_BASIC_INFORMATION mbi) {
+    uintptr_t lower = kMinAddress;          // the bounds set by our allocations
+    uintptr_t upper = kMaxAddress + 1;
+    auto next = _allocations.upper_bound(address);
+    if(next != _allocations.end()) upper = next->first;
+    if(next != _allocations.begin()) {
+        --next;
+        lower = std::max<uintptr_t>(lower, next->first + next->second.size);
+    }
+    mbi->BaseAddress = (void*)Floor(address, PageSize());
+    Mapping mapping;
+    if(FindMapping(address, mapping) && mapping.lower < upper) {
+        if(mapping.lower > address) {
+            upper = mapping.lower; // free up to the next line
+        } else {
+            mbi->AllocationBase = (void*)std::max(mapping.lower, lower);
+            mbi->AllocationProtect = ProtectionFrom(mapping.perms);
+            mbi->RegionSize = std::min(mapping.upper, upper) - (uintptr_t)mbi->BaseAddress;
+            mbi->State = MEM_COMMIT;
+            mbi->Protect = mbi->AllocationProtect;
+            mbi->Type = (mapping.path[0] == '/') ? MEM_IMAGE : (mapping.perms[3] == 's') ? MEM_MAPPED : MEM_PRIVATE;
+            return;
+        }
+    }
+    mbi->AllocationBase = nullptr;
+    mbi->AllocationProtect = 0;
+    mbi->RegionSize = upper - (uintptr_t)mbi->BaseAddress;
+    mbi->State = MEM_FREE;
+    mbi->Protect = PAGE_NOACCESS;
+    mbi->Type = 0;
+}
+
+/////////////
+// Handles //
+/////////////
+
+/* Kernel objects. CRT descriptors without one are handles too (see `FdHandle`). */
+struct Object {
+    virtual ~Object() {}
+};
+
+struct File : Object {
+    int fd;
+    explicit File(int fd) : fd(fd) {}
+    ~File() { if(fd >= 0) close(fd); }
+};
+
+struct Section : Object {
+    int fd;
+    uint64_t size;
+    DWORD protect;
+    Section(int fd, uint64_t size, DWORD protect) : fd(fd), size(size), protect(protect) {}
+    ~Section() { close(fd); }
+};
+
+struct Thread : Object {
+    pthread_t thread;
+    LPTHREAD_START_ROUTINE start;
+    LPVOID arg;
+    bool joined = false;
+    ~Thread() { if(!joined) pthread_detach(thread); }
+};
+
+struct Event : Object {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool manual_reset;
+    bool signaled;
+    Event(bool manual_reset, bool signaled) : manual_reset(manual_reset), signaled(signaled) {
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&cond, &attr);
+        pthread_condattr_destroy(&attr);
+        pthread_mutex_init(&mutex, nullptr);
+    }
+    ~Event() {
+        pthread_cond_destroy(&cond);
+        pthread_mutex_destroy(&mutex);
+    }
+};
+
+HANDLE const kCurrentProcess = (HANDLE)(intptr_t)-1;
+HANDLE const kCurrentThread = (HANDLE)(intptr_t)-2;
+
+/* A CRT descriptor as a handle: objects are aligned, so tagged values cannot be one. */
+HANDLE FdHandle(int fd) {
+    return (HANDLE)(((intptr_t)fd << 2) | 2);
+}
+
+bool IsFdHandle(HANDLE handle) {
+    return ((intptr_t)handle & 3) == 2;
+}
+
+Object* ObjectOf(HANDLE handle) {
+    return (handle && !((intptr_t)handle & 3)) ? (Object*)handle : nullptr;
+}
+
+template<typename T>
+T* As(HANDLE handle) {
+    return dynamic_cast<T*>(ObjectOf(handle));
+}
+
+/* The descriptor behind a file handle, or -1. */
+int FdOf(HANDLE handle) {
+    if(IsFdHandle(handle)) return (int)((intptr_t)handle >> 2);
+    const File* file = As<File>(handle);
+    return file ? file->fd : -1;
+}
+
+/* The handles taken over by `_open_osfhandle`, by descriptor. */
+pthread_mutex_t _osf_lock = PTHREAD_MUTEX_INITIALIZER;
+std::map<int, HANDLE> _osf_handles;
+
+bool Closed(int error) {
+    return Fail(ErrorFromErrno(error), FALSE);
+}
+
+/* UTF-8 from UTF-32, into `bytes` if it is large enough; returns the length either way. */
+size_t Utf8(const WCHAR* wide, size_t length, char* bytes, size_t capacity) {
+    size_t n = 0;
+    for(size_t i = 0; i < length; ++i) {
+        const uint32_t c = (uint32_t)wide[i];
+        char encoded[4];
+        size_t k = 0;
+        if(c < 0x80) {
+            encoded[k++] = (char)c;
+        } else if(c < 0x800) {
+            encoded[k++] = (char)(0xC0 | (c >> 6));
+            encoded[k++] = (char)(0x80 | (c & 0x3F));
+        } else if(c < 0x10000) {
+            encoded[k++] = (char)(0xE0 | (c >> 12));
+            encoded[k++] = (char)(0x80 | ((c >> 6) & 0x3F));
+            encoded[k++] = (char)(0x80 | (c & 0x3F));
+        } else {
+            encoded[k++] = (char)(0xF0 | ((c >> 18) & 0x07));
+            encoded[k++] = (char)(0x80 | ((c >> 12) & 0x3F));
+            encoded[k++] = (char)(0x80 | ((c >> 6) & 0x3F));
+            encoded[k++] = (char)(0x80 | (c & 0x3F));
+        }
+        if(bytes && n + k <= capacity) memcpy(bytes + n, encoded, k);
+        n += k;
+    }
+    return n;
+}
+
+/* UTF-32 from UTF-8 (malformed bytes pass through as they are). Returns the length. */
+size_t Utf32(const char* bytes, WCHAR* wide, size_t capacity) {
+    size_t n = 0;
+    for(const unsigned char* at = (const unsigned char*)bytes; *at && n < capacity; ++n) {
+        uint32_t c = *at++;
+        const int more = (c >= 0xF0) ? 3 : (c >= 0xE0) ? 2 : (c >= 0xC0) ? 1 : 0;
+        if(more) c &= 0x3F >> more;
+        for(int i = 0; i < more && (*at & 0xC0) == 0x80; ++i) c = (c << 6) | (*at++ & 0x3F);
+        wide[n] = (WCHAR)c;
+    }
+    return n;
+}
+
+HANDLE OpenFile(const char* path, DWORD access, LPSECURITY_ATTRIBUTES sa, DWORD disposition, DWORD flags) {
+    if(!strcmp(path, "NUL")) path = "/dev/null";
+    const bool reads = access & GENERIC_READ;
+    const bool writes = access & GENERIC_WRITE;
+    int oflags = (reads && writes) ? O_RDWR : writes ? O_WRONLY : O_RDONLY;
+    switch(disposition) {
+    case CREATE_NEW:        oflags |= O_CREAT | O_EXCL; break;
+    case CREATE_ALWAYS:     oflags |= O_CREAT | O_TRUNC; break;
+    case OPEN_EXISTING:     break;
+    case OPEN_ALWAYS:       oflags |= O_CREAT; break;
+    case TRUNCATE_EXISTING: oflags |= O_TRUNC; break;
+    default:                return Fail(ERROR_INVALID_PARAMETER, INVALID_HANDLE_VALUE);
+    }
+    if(!(sa && sa->bInheritHandle)) oflags |= O_CLOEXEC;
+    const int fd = open(path, oflags, 0666);
+    if(fd < 0) return Fail(ErrorFromErrno(errno), INVALID_HANDLE_VALUE);
+    if(flags & FILE_FLAG_DELETE_ON_CLOSE) unlink(path);
+    File* file = new(std::nothrow) File(fd);
+    if(!file) {
+        close(fd);
+        return Fail(ERROR_NOT_ENOUGH_MEMORY, INVALID_HANDLE_VALUE);
+    }
+    return file;
+}
+
+void* StartThread(void* arg) {
+    Thread* thread = (Thread*)arg;
+    return (void*)(uintptr_t)thread->start(thread->arg);
+}
+
+/* `now` plus `milliseconds` on `clock`. */
+timespec Deadline(clockid_t clock, DWORD milliseconds) {
+    timespec deadline;
+    clock_gettime(clock, &deadline);
+    deadline.tv_sec += milliseconds / 1000;
+    deadline.tv_nsec += (long)(milliseconds % 1000) * 1000000;
+    if(deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000;
+    }
+    return deadline;
+}
+
+///////////////////////////////////////
+// Vectored exception handlers (VEH) //
+///////////////////////////////////////
+
+constexpr unsigned kMaxHandlers = 16;
+
+/* In calling order. Changes take the lock; the signal handler reads without it. */
+pthread_mutex_t _veh_lock = PTHREAD_MUTEX_INITIALIZER;
+PVECTORED_EXCEPTION_HANDLER volatile _handlers[kMaxHandlers] = {};
+struct sigaction _previous_segv;
+struct sigaction _previous_bus;
+bool _installed = false;
+
+/* Turns a PAGE_GUARD page back into an ordinary one, as the first touch does on Windows. */
+bool Unguard(uintptr_t address) {
+    const size_t page_size = PageSize();
+    const uintptr_t page = Floor(address, page_size);
+    VmLock guard;
+    uintptr_t base;
+    Allocation* allocation = Find(page, page + page_size, &base);
+    if(!allocation) return false;
+    DWORD& protect = allocation->pages[(page - base) / page_size];
+    if(!(protect & PAGE_GUARD)) return false;
+    protect &= ~PAGE_GUARD;
+    return !kernel::Protect((void*)page, page_size, ProtFrom(protect));
+}
+
+void* ProgramCounter(const ucontext_t* context) {
+#if defined(__x86_64__)
+    return (void*)context->uc_mcontext.gregs[REG_RIP];
+#elif defined(__i386__)
+    return (void*)context->uc_mcontext.gregs[REG_EIP];
+#elif defined(__aarch64__)
+    return (void*)context->uc_mcontext.pc;
+#else
+    (void) context;
+    return nullptr;
+#endif
+}
+
+/* 1 for a write, 0 for a read (or if the architecture doesn't tell). */
+ULONG_PTR Writing(const ucontext_t* context) {
+#if defined(__x86_64__)
+    return (context->uc_mcontext.gregs[REG_ERR] & 2) ? 1 : 0;
+#elif defined(__i386__)
+    return (context->uc_mcontext.gregs[REG_ERR] & 2) ? 1 : 0;
+#else
+    (void) context;
+    return 0;
+#endif
+}
+
+void OnFault(int signal, siginfo_t* info, void* ucontext) {
+    const int saved_errno = errno;
+    const ucontext_t* context = (const ucontext_t*)ucontext;
+    EXCEPTION_RECORD record = {};
+    record.ExceptionCode = (signal == SIGBUS) ? EXCEPTION_IN_PAGE_ERROR : EXCEPTION_ACCESS_VIOLATION;
+    record.ExceptionAddress = ProgramCounter(context);
+    record.NumberParameters = 2;
+    record.ExceptionInformation[0] = Writing(context);
+    record.ExceptionInformation[1] = (ULONG_PTR)info->si_addr;
+    if(signal == SIGSEGV && Unguard((uintptr_t)info->si_addr)) record.ExceptionCode = STATUS_GUARD_PAGE_VIOLATION;
+    CONTEXT cpu = {ucontext};
+    EXCEPTION_POINTERS pointers = {&record, &cpu};
+    for(unsigned i = 0; i < kMaxHandlers; ++i) {
+        PVECTORED_EXCEPTION_HANDLER handler = _handlers[i];
+        if(handler && handler(&pointers) == EXCEPTION_CONTINUE_EXECUTION) {
+            errno = saved_errno;
+            return;
+        }
+    }
+    if(record.ExceptionCode == STATUS_GUARD_PAGE_VIOLATION) { // a one-shot alarm: the access goes through
+        errno = saved_errno;
+        return;
+    }
+    const struct sigaction& previous = (signal == SIGBUS) ? _previous_bus : _previous_segv;
+    if((previous.sa_flags & SA_SIGINFO) && previous.sa_sigaction) {
+        previous.sa_sigaction(signal, info, ucontext);
+    } else if(previous.sa_handler != SIG_DFL && previous.sa_handler != SIG_IGN) {
+        previous.sa_handler(signal);
+    } else {
+        ::signal(signal, SIG_DFL); // the access faults again, with nobody to catch it
+    }
+    errno = saved_errno;
+}
+
+void InstallFaultHandler() {
+    struct sigaction action = {};
+    action.sa_sigaction = &OnFault;
+    action.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGSEGV, &action, &_previous_segv);
+    sigaction(SIGBUS, &action, &_previous_bus);
+    _installed = true;
+}
+
+/////////////////////
+// System figures  //
+/////////////////////
+
+/* A "Name: value kB" line of /proc/meminfo, in bytes; 0 if missing. */
+uint64_t MemInfo(const char* name) {
+    FILE* meminfo = fopen("/proc/meminfo", "re");
+    if(!meminfo) return 0;
+    const size_t length = strlen(name);
+    char line[256];
+    unsigned long long kib = 0;
+    while(fgets(line, sizeof(line), meminfo)) {
+        if(!strncmp(line, name, length) && line[length] == ':') {
+            sscanf(line + length + 1, "%llu", &kib);
+            break;
+        }
+    }
+    fclose(meminfo);
+    return (uint64_t)kib << 10;
+}
+
+/* The quota that `SetProcessWorkingSetSizeEx` sets: only remembered (Windows defaults). */
+SIZE_T _working_set_min = 50 << 12;
+SIZE_T _working_set_max = 345 << 12;
+DWORD _working_set_flags = QUOTA_LIMITS_HARDWS_MIN_DISABLE | QUOTA_LIMITS_HARDWS_MAX_DISABLE;
+
+} // anonymous
+
+extern "C" {
+
+////////////
+// Errors //
+////////////
+
+DWORD GetLastError(void) {
+    return _last_error;
+}
+
+void SetLastError(DWORD error) {
+    _last_error = error;
+}
+
+////////////////////
+// System figures //
+////////////////////
+
+void GetSystemInfo(LPSYSTEM_INFO info) {
+    *info = SYSTEM_INFO();
+#if defined(__x86_64__)
+    info->wProcessorArchitecture = 9;  // PROCESSOR_ARCHITECTURE_AMD64
+#elif defined(__aarch64__)
+    info->wProcessorArchitecture = 12; // PROCESSOR_ARCHITECTURE_ARM64
+#endif
+    info->dwPageSize = (DWORD)PageSize();
+    info->lpMinimumApplicationAddress = (LPVOID)kMinAddress;
+    info->lpMaximumApplicationAddress = (LPVOID)kMaxAddress;
+    info->dwNumberOfProcessors = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+    info->dwActiveProcessorMask = (info->dwNumberOfProcessors >= sizeof(DWORD_PTR) * 8)
+        ? ~(DWORD_PTR)0 : ((DWORD_PTR)1 << info->dwNumberOfProcessors) - 1;
+    info->dwAllocationGranularity = (DWORD)kGranularity;
+}
+
+SIZE_T GetLargePageMinimum(void) {
+    static const SIZE_T large_page_size = MemInfo("Hugepagesize");
+    return large_page_size;
+}
+
+BOOL GlobalMemoryStatusEx(LPMEMORYSTATUSEX status) {
+    if(status->dwLength != sizeof(*status)) return Fail(ERROR_INVALID_PARAMETER, FALSE);
+    const uint64_t total = MemInfo("MemTotal");
+    if(!total) return Fail(ERROR_NOT_SUPPORTED, FALSE);
+    const uint64_t available = std::min(MemInfo("MemAvailable"), total);
+    status->ullTotalPhys = total;
+    status->ullAvailPhys = available;
+    status->dwMemoryLoad = (DWORD)(100 - available * 100 / total);
+    status->ullTotalPageFile = total + MemInfo("SwapTotal");
+    status->ullAvailPageFile = available + MemInfo("SwapFree");
+    status->ullTotalVirtual = kMaxAddress + 1 - kMinAddress;
+    status->ullAvailVirtual = status->ullTotalVirtual; // not worth a walk of the address space
+    status->ullAvailExtendedVirtual = 0;
+    return TRUE;
+}
+
+BOOL GetLogicalProcessorInformation(PSYSTEM_LOGICAL_PROCESSOR_INFORMATION info, PDWORD length) {
+    struct Cache {
+        BYTE level;
+        PROCESSOR_CACHE_TYPE type;
+        int size, assoc, line;
+    };
+    const Cache caches[] = {
+        {1, CacheInstruction, _SC_LEVEL1_ICACHE_SIZE, _SC_LEVEL1_ICACHE_ASSOC, _SC_LEVEL1_ICACHE_LINESIZE},
+        {1, CacheData, _SC_LEVEL1_DCACHE_SIZE, _SC_LEVEL1_DCACHE_ASSOC, _SC_LEVEL1_DCACHE_LINESIZE},
+        {2, CacheUnified, _SC_LEVEL2_CACHE_SIZE, _SC_LEVEL2_CACHE_ASSOC, _SC_LEVEL2_CACHE_LINESIZE},
+        {3, CacheUnified, _SC_LEVEL3_CACHE_SIZE, _SC_LEVEL3_CACHE_ASSOC, _SC_LEVEL3_CACHE_LINESIZE},
+    };
+    // the caches the C library knows of, one entry each (not one per instance)
+    std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> entries;
+    for(const Cache& cache : caches) {
+        const long size = sysconf(cache.size);
+        if(size <= 0) continue;
+        SYSTEM_LOGICAL_PROCESSOR_INFORMATION entry = {};
+        entry.Relationship = RelationCache;
+        entry.Cache.Level = cache.level;
+        entry.Cache.Type = cache.type;
+        entry.Cache.Size = (DWORD)size;
+        entry.Cache.Associativity = (BYTE)std::max(sysconf(cache.assoc), 0l);
+        entry.Cache.LineSize = (WORD)std::max(sysconf(cache.line), 0l);
+        entries.push_back(entry);
+    }
+    const DWORD needed = (DWORD)(entries.size() * sizeof(*info));
+    if(!info || *length < needed) {
+        *length = needed;
+        return Fail(ERROR_INSUFFICIENT_BUFFER, FALSE);
+    }
+    std::copy(entries.begin(), entries.end(), info);
+    *length = needed;
+    return TRUE;
+}
+
+DWORD GetActiveProcessorCount(WORD group) {
+    (void) group;
+    return (DWORD)std::max(sysconf(_SC_NPROCESSORS_ONLN), 1l);
+}
+
+BOOL GetNumaHighestNodeNumber(PULONG highest) {
+    *highest = 0;
+    return TRUE;
+}
+
+BOOL GetNumaNodeProcessorMask(UCHAR node, PULONGLONG mask) {
+    if(node) return Fail(ERROR_INVALID_PARAMETER, FALSE);
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    *mask = info.dwActiveProcessorMask;
+    return TRUE;
+}
+
+DWORD_PTR SetThreadAffinityMask(HANDLE thread, DWORD_PTR mask) {
+    if(thread != kCurrentThread || !mask) return Fail(ERROR_INVALID_PARAMETER, (DWORD_PTR)0);
+    cpu_set_t cpus;
+    if(sched_getaffinity(0, sizeof(cpus), &cpus)) return Fail(ErrorFromErrno(errno), (DWORD_PTR)0);
+    DWORD_PTR previous = 0;
+    for(unsigned i = 0; i < sizeof(mask) * 8; ++i) {
+        if(CPU_ISSET(i, &cpus)) previous |= (DWORD_PTR)1 << i;
+    }
+    CPU_ZERO(&cpus);
+    for(unsigned i = 0; i < sizeof(mask) * 8; ++i) {
+        if(mask & ((DWORD_PTR)1 << i)) CPU_SET(i, &cpus);
+    }
+    if(sched_setaffinity(0, sizeof(cpus), &cpus)) return Fail(ErrorFromErrno(errno), (DWORD_PTR)0);
+    return previous;
+}
+
+////////////////////
+// Virtual memory //
+////////////////////
+
+LPVOID VirtualAlloc(LPVOID addr, SIZE_T size, DWORD type, DWORD protect) {
+    const size_t page_size = PageSize();
+    if(!size || (uintptr_t)addr + size < (uintptr_t)addr) return Fail(ERROR_INVALID_PARAMETER, nullptr);
+    if(type & (MEM_RESET | MEM_RESET_UNDO)) {
+        // the contents may go; MEM_RESET_UNDO can't tell whether they did, and says they didn't
+        const uintptr_t lower = Ceil((uintptr_t)addr, page_size);
+        const uintptr_t upper = Floor((uintptr_t)addr + size, page_size);
+        if((type & MEM_RESET) && lower < upper && kernel::Advise((void*)lower, upper - lower, MADV_FREE)) {
+            return Fail(ErrorFromErrno(errno), nullptr);
+        }
+        return addr;
+    }
+    if(!(type & (MEM_RESERVE | MEM_COMMIT)) || !ValidProtection(protect)) return Fail(ERROR_INVALID_PARAMETER, nullptr);
+
+    if(type & MEM_RESERVE) {
+        // MEM_LARGE_PAGES and MEM_TOP_DOWN are taken for hints, and not taken
+        const uintptr_t lower = Floor((uintptr_t)addr, kGranularity);
+        const uintptr_t upper = Ceil((uintptr_t)addr + size, page_size);
+        VmLock guard;
+        void* base = Reserve(lower, addr ? upper - lower : upper);
+        if(!base) return Fail((errno == ENOMEM) ? ERROR_NOT_ENOUGH_MEMORY : ERROR_INVALID_ADDRESS, nullptr);
+        const size_t length = addr ? upper - lower : upper;
+        try {
+            Allocation& allocation = _allocations[(uintptr_t)base];
+            allocation.size = length;
+            allocation.type = MEM_PRIVATE;
+            allocation.protect = protect;
+            allocation.pages.assign(length / page_size, 0);
+            if((type & MEM_COMMIT) && !SetProtection(allocation, (uintptr_t)base, (uintptr_t)base, (uintptr_t)base + length, protect)) {
+                _allocations.erase((uintptr_t)base);
+                kernel::Unmap(base, length);
+                return Fail(ERROR_COMMITMENT_LIMIT, nullptr);
+            }
+        } catch(const std::bad_alloc&) {
+            _allocations.erase((uintptr_t)base);
+            kernel::Unmap(base, length);
+            return Fail(ERROR_NOT_ENOUGH_MEMORY, nullptr);
+        }
+        return base;
+    }
+
+    // MEM_COMMIT within a reservation or a view; committed pages keep their protection
+    const uintptr_t lower = Floor((uintptr_t)addr, page_size);
+    const uintptr_t upper = Ceil((uintptr_t)addr + size, page_size);
+    VmLock guard;
+    uintptr_t base;
+    Allocation* allocation = Find(lower, upper, &base);
+    if(!allocation) return Fail(ERROR_INVALID_ADDRESS, nullptr);
+    if(allocation->type == MEM_MAPPED) return (void*)lower; // views are committed whole (see windows.h)
+    for(uintptr_t page = lower; page < upper;) {
+        const size_t index = (page - base) / page_size;
+        size_t run = 1; // pages of the same state
+        while(page + run * page_size < upper && !allocation->pages[index + run] == !allocation->pages[index]) ++run;
+        if(!allocation->pages[index] && !SetProtection(*allocation, base, page, page + run * page_size, protect)) {
+            return Fail(ERROR_COMMITMENT_LIMIT, nullptr);
+        }
+        page += run * page_size;
+    }
+    return (void*)lower;
+}
+
+LPVOID VirtualAllocExNuma(HANDLE process, LPVOID addr, SIZE_T size, DWORD type, DWORD protect, DWORD node) {
+    (void) node; // one node (see windows.h)
+    if(process != kCurrentProcess) return Fail(ERROR_INVALID_HANDLE, nullptr);
+    return VirtualAlloc(addr, size, type, protect);
+}
+
+BOOL VirtualFree(LPVOID addr, SIZE_T size, DWORD type) {
+    const size_t page_size = PageSize();
+    VmLock guard;
+    if(type == MEM_RELEASE) {
+        if(size) return Fail(ERROR_INVALID_PARAMETER, FALSE);
+        auto found = _allocations.find((uintptr_t)addr);
+        if(found == _allocations.end() || found->second.type != MEM_PRIVATE) return Fail(ERROR_INVALID_ADDRESS, FALSE);
+        kernel::Unmap(addr, found->second.size);
+        _allocations.erase(found);
+        return TRUE;
+    }
+    if(type != MEM_DECOMMIT) return Fail(ERROR_INVALID_PARAMETER, FALSE);
+    uintptr_t base;
+    Allocation* allocation = Find((uintptr_t)addr, (uintptr_t)addr + 1, &base);
+    if(!allocation || allocation->type != MEM_PRIVATE) return Fail(ERROR_INVALID_ADDRESS, FALSE);
+    const uintptr_t lower = Floor((uintptr_t)addr, page_size);
+    const uintptr_t upper = size ? Ceil((uintptr_t)addr + size, page_size) : base + allocation->size;
+    if(upper > base + allocation->size) return Fail(ERROR_INVALID_PARAMETER, FALSE);
+    // decommitted pages read as zeros once committed again
+    if(kernel::Advise((void*)lower, upper - lower, MADV_DONTNEED)) return Fail(ErrorFromErrno(errno), FALSE);
+    if(!SetProtection(*allocation, base, lower, upper, 0)) return Fail(ErrorFromErrno(errno), FALSE);
+    return TRUE;
+}
+
+BOOL VirtualProtect(LPVOID addr, SIZE_T size, DWORD protect, PDWORD old_protect) {
+    const size_t page_size = PageSize();
+    if(!ValidProtection(protect) || !old_protect) return Fail(ERROR_INVALID_PARAMETER, FALSE);
+    const uintptr_t lower = Floor((uintptr_t)addr, page_size);
+    const uintptr_t upper = Ceil((uintptr_t)addr + size, page_size);
+    VmLock guard;
+    uintptr_t base;
+    Allocation* allocation = Find(lower, upper, &base);
+    if(!allocation) {
+        // someone else's memory (the image, the C heap): the kernel knows better
+        MEMORY_BASIC_INFORMATION mbi;
+        QueryForeign(lower, &mbi);
+        if(mbi.State != MEM_COMMIT) return Fail(ERROR_INVALID_ADDRESS, FALSE);
+        if(kernel::Protect((void*)lower, upper - lower, ProtFrom(protect))) return Fail(ErrorFromErrno(errno), FALSE);
+        *old_protect = mbi.Protect;
+        return TRUE;
+    }
+    const auto first = allocation->pages.begin() + (lower - base) / page_size;
+    const auto last = allocation->pages.begin() + (upper - base) / page_size;
+    if(std::find(first, last, 0) != last) return Fail(ERROR_INVALID_ADDRESS, FALSE); // not committed
+    const DWORD old = *first;
+    if(!SetProtection(*allocation, base, lower, upper, protect)) return Fail(ErrorFromErrno(errno), FALSE);
+    *old_protect = old;
+    return TRUE;
+}
+
+SIZE_T VirtualQuery(LPCVOID addr, PMEMORY_BASIC_INFORMATION mbi, SIZE_T length) {
+    const size_t page_size = PageSize();
+    const uintptr_t address = (uintptr_t)addr;
+    if(length < sizeof(*mbi) || address > kMaxAddress) return Fail(ERROR_INVALID_PARAMETER, (SIZE_T)0);
+    const uintptr_t page = Floor(address, page_size);
+    VmLock guard;
+    uintptr_t base;
+    Allocation* allocation = Find(page, page + page_size, &base);
+    if(!allocation) {
+        QueryForeign(address, mbi);
+        return sizeof(*mbi);
+    }
+    const size_t first = (page - base) / page_size;
+    const DWORD protect = allocation->pages[first];
+    size_t last = first + 1;
+    while(last < allocation->pages.size() && allocation->pages[last] == protect) ++last;
+    mbi->BaseAddress = (void*)page;
+    mbi->AllocationBase = (void*)base;
+    mbi->AllocationProtect = allocation->protect;
+    mbi->RegionSize = (last - first) * page_size;
+    mbi->State = protect ? MEM_COMMIT : MEM_RESERVE;
+    mbi->Protect = protect;
+    mbi->Type = allocation->type;
+    return sizeof(*mbi);
+}
+
+BOOL VirtualLock(LPVOID addr, SIZE_T size) {
+    if(kernel::Lock(addr, size)) return Fail((errno == ENOMEM) ? ERROR_NOACCESS : ERROR_WORKING_SET_QUOTA, FALSE);
+    return TRUE;
+}
+
+BOOL VirtualUnlock(LPVOID addr, SIZE_T size) {
+    if(kernel::Unlock(addr, size)) return Fail(ERROR_NOACCESS, FALSE);
+    return TRUE;
+}
+
+DWORD DiscardVirtualMemory(PVOID addr, SIZE_T size) {
+    // the pages stay committed, their contents become undefined: MADV_FREE, where it applies
+    if(!kernel::Advise(addr, size, MADV_FREE) || !kernel::Advise(addr, size, MADV_DONTNEED)) return ERROR_SUCCESS;
+    return ErrorFromErrno(errno);
+}
+
+DWORD OfferVirtualMemory(PVOID addr, SIZE_T size, OFFER_PRIORITY priority) {
+    (void) addr; (void) size; (void) priority; // kept (see windows.h)
+    return ERROR_SUCCESS;
+}
+
+DWORD ReclaimVirtualMemory(PVOID addr, SIZE_T size) {
+    (void) addr; (void) size;
+    return ERROR_SUCCESS; // the contents are intact
+}
+
+BOOL PrefetchVirtualMemory(HANDLE process, ULONG_PTR count, PWIN32_MEMORY_RANGE_ENTRY ranges, ULONG flags) {
+    (void) flags;
+    if(process != kCurrentProcess) return Fail(ERROR_INVALID_HANDLE, FALSE);
+    const size_t page_size = PageSize();
+    for(ULONG_PTR i = 0; i < count; ++i) {
+        const uintptr_t lower = Floor((uintptr_t)ranges[i].VirtualAddress, page_size);
+        const uintptr_t upper = (uintptr_t)ranges[i].VirtualAddress + ranges[i].NumberOfBytes;
+        kernel::Advise((void*)lower, upper - lower, MADV_WILLNEED); // a hint, like the original
+    }
+    return TRUE;
+}
+
+BOOL FlushInstructionCache(HANDLE process, LPCVOID addr, SIZE_T size) {
+    if(process != kCurrentProcess) return Fail(ERROR_INVALID_HANDLE, FALSE);
+    __builtin___clear_cache((char*)addr, (char*)addr + size);
+    return TRUE;
+}
+
+BOOL GetProcessWorkingSetSizeEx(HANDLE process, PSIZE_T min, PSIZE_T max, PDWORD flags) {
+    if(process != kCurrentProcess) return Fail(ERROR_INVALID_HANDLE, FALSE);
+    *min = _working_set_min;
+    *max = _working_set_max;
+    *flags = _working_set_flags;
+    return TRUE;
+}
+
+BOOL SetProcessWorkingSetSizeEx(HANDLE process, SIZE_T min, SIZE_T max, DWORD flags) {
+    if(process != kCurrentProcess) return Fail(ERROR_INVALID_HANDLE, FALSE);
+    if(min > max) return Fail(ERROR_INVALID_PARAMETER, FALSE);
+    _working_set_min = min;
+    _working_set_max = max;
+    _working_set_flags = flags;
+    return TRUE; // RLIMIT_MEMLOCK limits `VirtualLock` instead
+}
+
+//////////////
+// Sections //
+//////////////
+
+HANDLE CreateFileMappingW(HANDLE file, LPSECURITY_ATTRIBUTES sa, DWORD protect, DWORD size_high, DWORD size_low, LPCWSTR name) {
+    if(name) return Fail(ERROR_NOT_SUPPORTED, (HANDLE)nullptr);
+    const DWORD page_protect = protect & 0xff;
+    if(!ValidProtection(page_protect)) return Fail(ERROR_INVALID_PARAMETER, (HANDLE)nullptr);
+    const bool writable = (page_protect == PAGE_READWRITE) || (page_protect == PAGE_EXECUTE_READWRITE);
+    const int cloexec = (sa && sa->bInheritHandle) ? 0 : O_CLOEXEC;
+    uint64_t size = ((uint64_t)size_high << 32) | size_low;
+    int fd = -1;
+    if(file == INVALID_HANDLE_VALUE) { // the page file: sized at once, SEC_RESERVE or not
+        if(!size) return Fail(ERROR_INVALID_PARAMETER, (HANDLE)nullptr);
+        fd = kernel::MemfdCreate("memmap", cloexec ? MFD_CLOEXEC : 0);
+        if(fd < 0) return Fail(ErrorFromErrno(errno), (HANDLE)nullptr);
+        if(ftruncate(fd, (off_t)size)) {
+            close(fd);
+            return Fail(ERROR_COMMITMENT_LIMIT, (HANDLE)nullptr);
+        }
+    } else {
+        const int file_fd = FdOf(file);
+        struct stat st;
+        if(file_fd < 0 || fstat(file_fd, &st)) return Fail(ERROR_INVALID_HANDLE, (HANDLE)nullptr);
+        if(!size) size = st.st_size;
+        if(!size) return Fail(ERROR_FILE_INVALID, (HANDLE)nullptr);
+        if(size > (uint64_t)st.st_size) { // extends the file, if the section may write
+            if(!writable) return Fail(ERROR_NOT_ENOUGH_MEMORY, (HANDLE)nullptr);
+            if(ftruncate(file_fd, (off_t)size)) return Fail(ErrorFromErrno(errno), (HANDLE)nullptr);
+        }
+        fd = fcntl(file_fd, cloexec ? F_DUPFD_CLOEXEC : F_DUPFD, 0);
+        if(fd < 0) return Fail(ErrorFromErrno(errno), (HANDLE)nullptr);
+    }
+    Section* section = new(std::nothrow) Section(fd, size, page_protect);
+    if(!section) {
+        close(fd);
+        return Fail(ERROR_NOT_ENOUGH_MEMORY, (HANDLE)nullptr);
+    }
+    return section;
+}
+
+LPVOID MapViewOfFileEx(HANDLE handle, DWORD access, DWORD offset_high, DWORD offset_low, SIZE_T size, LPVOID addr) {
+    const Section* section = As<Section>(handle);
+    if(!section) return Fail(ERROR_INVALID_HANDLE, nullptr);
+    const uint64_t offset = ((uint64_t)offset_high << 32) | offset_low;
+    if(offset % kGranularity) return Fail(ERROR_MAPPED_ALIGNMENT, nullptr);
+    if((uintptr_t)addr % kGranularity) return Fail(ERROR_INVALID_ADDRESS, nullptr);
+    if(offset >= section->size) return Fail(ERROR_INVALID_PARAMETER, nullptr);
+    if(!size) size = (SIZE_T)(section->size - offset);
+    if(size > section->size - offset) return Fail(ERROR_ACCESS_DENIED, nullptr);
+
+    const bool executable = access & FILE_MAP_EXECUTE;
+    const bool copy = (access & FILE_MAP_COPY) && !(access & FILE_MAP_WRITE);
+    const bool writes = access & FILE_MAP_WRITE;
+    const bool section_writable = (section->protect == PAGE_READWRITE) || (section->protect == PAGE_EXECUTE_READWRITE);
+    const bool section_executable = section->protect & (PAGE_EXECUTE | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY);
+    if((writes && !section_writable) || (executable && !section_executable)) return Fail(ERROR_ACCESS_DENIED, nullptr);
+    const DWORD protect = executable
+        ? (copy ? PAGE_EXECUTE_WRITECOPY : writes ? PAGE_EXECUTE_READWRITE : PAGE_EXECUTE_READ)
+        : (copy ? PAGE_WRITECOPY : writes ? PAGE_READWRITE : PAGE_READONLY);
+
+    const size_t page_size = PageSize();
+    const size_t length = Ceil(size, page_size);
+    VmLock guard;
+    void* base = Reserve((uintptr_t)addr, length);
+    if(!base) return Fail((errno == ENOMEM) ? ERROR_NOT_ENOUGH_MEMORY : ERROR_INVALID_ADDRESS, nullptr);
+    if(kernel::Map(base, length, ProtFrom(protect), MAP_FIXED | (copy ? MAP_PRIVATE : MAP_SHARED), section->fd, (off_t)offset) == kernel::kFailed) {
+        const DWORD error = ErrorFromErrno(errno);
+        kernel::Unmap(base, length);
+        return Fail(error, nullptr);
+    }
+    try {
+        Allocation& allocation = _allocations[(uintptr_t)base];
+        allocation.size = length;
+        allocation.type = MEM_MAPPED;
+        allocation.protect = protect;
+        allocation.pages.assign(length / page_size, protect);
+    } catch(const std::bad_alloc&) {
+        _allocations.erase((uintptr_t)base);
+        kernel::Unmap(base, length);
+        return Fail(ERROR_NOT_ENOUGH_MEMORY, nullptr);
+    }
+    return base;
+}
+
+LPVOID MapViewOfFile(HANDLE section, DWORD access, DWORD offset_high, DWORD offset_low, SIZE_T size) {
+    return MapViewOfFileEx(section, access, offset_high, offset_low, size, nullptr);
+}
+
+LPVOID MapViewOfFileExNuma(HANDLE section, DWORD access, DWORD offset_high, DWORD offset_low, SIZE_T size, LPVOID addr, DWORD node) {
+    (void) node;
+    return MapViewOfFileEx(section, access, offset_high, offset_low, size, addr);
+}
+
+BOOL UnmapViewOfFile(LPCVOID addr) {
+    VmLock guard;
+    auto found = _allocations.find((uintptr_t)addr);
+    if(found == _allocations.end() || found->second.type != MEM_MAPPED) return Fail(ERROR_INVALID_ADDRESS, FALSE);
+    kernel::Unmap((void*)addr, found->second.size);
+    _allocations.erase(found);
+    return TRUE;
+}
+
+BOOL FlushViewOfFile(LPCVOID addr, SIZE_T size) {
+    const size_t page_size = PageSize();
+    const uintptr_t lower = Floor((uintptr_t)addr, page_size);
+    uintptr_t upper = (uintptr_t)addr + size;
+    if(!size) { // to the end of the view
+        VmLock guard;
+        uintptr_t base;
+        const Allocation* allocation = Find(lower, lower + page_size, &base);
+        if(!allocation) return Fail(ERROR_INVALID_ADDRESS, FALSE);
+        upper = base + allocation->size;
+    }
+    if(kernel::Sync((void*)lower, upper - lower, MS_ASYNC)) return Fail(ERROR_INVALID_ADDRESS, FALSE);
+    return TRUE;
+}
+
+///////////
+// Files //
+///////////
+
+HANDLE CreateFileA(LPCSTR path, DWORD access, DWORD share, LPSECURITY_ATTRIBUTES sa, DWORD disposition, DWORD flags, HANDLE tmpl) {
+    (void) share; (void) tmpl;
+    return OpenFile(path, access, sa, disposition, flags);
+}
+
+HANDLE CreateFileW(LPCWSTR path, DWORD access, DWORD share, LPSECURITY_ATTRIBUTES sa, DWORD disposition, DWORD flags, HANDLE tmpl) {
+    (void) share; (void) tmpl;
+    const size_t length = wcslen(path);
+    std::vector<char> bytes(Utf8(path, length, nullptr, 0) + 1, 0);
+    Utf8(path, length, bytes.data(), bytes.size());
+    return OpenFile(bytes.data(), access, sa, disposition, flags);
+}
+
+HANDLE ReOpenFile(HANDLE original, DWORD access, DWORD share, DWORD flags) {
+    (void) share;
+    const int fd = FdOf(original);
+    if(fd < 0) return Fail(ERROR_INVALID_HANDLE, INVALID_HANDLE_VALUE);
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd); // the file, even if renamed or unlinked since
+    return OpenFile(path, access, nullptr, OPEN_EXISTING, flags & ~FILE_FLAG_DELETE_ON_CLOSE);
+}
+
+BOOL WriteFile(HANDLE file, LPCVOID data, DWORD size, LPDWORD written, LPOVERLAPPED at) {
+    const int fd = FdOf(file);
+    if(fd < 0) return Fail(ERROR_INVALID_HANDLE, FALSE);
+    off_t position = at ? (off_t)(((uint64_t)at->OffsetHigh << 32) | at->Offset) : lseek(fd, 0, SEEK_CUR);
+    DWORD done = 0;
+    while(done < size) { // files take it all, or fail
+        const ssize_t n = (position >= 0) ? pwrite(fd, (const char*)data + done, size - done, position + done)
+                                          : write(fd, (const char*)data + done, size - done);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) {
+            if(written) *written = done;
+            return Fail((n < 0 && errno != EBADF) ? ErrorFromErrno(errno) : ERROR_ACCESS_DENIED, FALSE);
+        }
+        done += (DWORD)n;
+    }
+    if(position >= 0) lseek(fd, position + done, SEEK_SET); // a synchronous handle moves on either way
+    if(written) *written = done;
+    return TRUE;
+}
+
+BOOL ReadFile(HANDLE file, LPVOID data, DWORD size, LPDWORD read, LPOVERLAPPED at) {
+    const int fd = FdOf(file);
+    if(fd < 0) return Fail(ERROR_INVALID_HANDLE, FALSE);
+    ssize_t n;
+    do {
+        n = at ? pread(fd, data, size, (off_t)(((uint64_t)at->OffsetHigh << 32) | at->Offset)) : ::read(fd, data, size);
+    } while(n < 0 && errno == EINTR);
+    if(n < 0) return Fail((errno == EBADF) ? ERROR_ACCESS_DENIED : ErrorFromErrno(errno), FALSE);
+    if(at) lseek(fd, (off_t)(((uint64_t)at->OffsetHigh << 32) | at->Offset) + n, SEEK_SET);
+    if(read) *read = (DWORD)n;
+    return (at && !n && size) ? Fail(ERROR_HANDLE_EOF, FALSE) : TRUE;
+}
+
+BOOL SetFilePointerEx(HANDLE file, LARGE_INTEGER distance, PLARGE_INTEGER position, DWORD method) {
+    const int fd = FdOf(file);
+    if(fd < 0) return Fail(ERROR_INVALID_HANDLE, FALSE);
+    const int whence = (method == FILE_BEGIN) ? SEEK_SET : (method == FILE_CURRENT) ? SEEK_CUR : SEEK_END;
+    const off_t at = lseek(fd, (off_t)distance.QuadPart, whence);
+    if(at < 0) return Fail(ErrorFromErrno(errno), FALSE);
+    if(position) position->QuadPart = at;
+    return TRUE;
+}
+
+BOOL GetFileSizeEx(HANDLE file, PLARGE_INTEGER size) {
+    struct stat st;
+    const int fd = FdOf(file);
+    if(fd < 0 || fstat(fd, &st)) return Fail(ERROR_INVALID_HANDLE, FALSE);
+    size->QuadPart = st.st_size;
+    return TRUE;
+}
+
+DWORD GetFileType(HANDLE file) {
+    struct stat st;
+    const int fd = FdOf(file);
+    if(fd < 0 || fstat(fd, &st)) return Fail(ERROR_INVALID_HANDLE, (DWORD)FILE_TYPE_UNKNOWN);
+    if(S_ISREG(st.st_mode) || S_ISBLK(st.st_mode) || S_ISDIR(st.st_mode)) return FILE_TYPE_DISK;
+    if(S_ISCHR(st.st_mode)) return FILE_TYPE_CHAR;
+    if(S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode)) return FILE_TYPE_PIPE;
+    return FILE_TYPE_UNKNOWN;
+}
+
+BOOL SetFileInformationByHandle(HANDLE file, FILE_INFO_BY_HANDLE_CLASS info_class, LPVOID info, DWORD size) {
+    if(info_class != FileEndOfFileInfo || size < sizeof(FILE_END_OF_FILE_INFO)) return Fail(ERROR_INVALID_PARAMETER, FALSE);
+    const int fd = FdOf(file);
+    if(fd < 0) return Fail(ERROR_INVALID_HANDLE, FALSE);
+    if(ftruncate(fd, (off_t)((FILE_END_OF_FILE_INFO*)info)->EndOfFile.QuadPart)) {
+        // not open for writing: EBADF or EINVAL
+        return Fail((errno == EBADF || errno == EINVAL) ? ERROR_ACCESS_DENIED : ErrorFromErrno(errno), FALSE);
+    }
+    return TRUE;
+}
+
+BOOL SetEndOfFile(HANDLE file) {
+    const int fd = FdOf(file);
+    if(fd < 0) return Fail(ERROR_INVALID_HANDLE, FALSE);
+    const off_t at = lseek(fd, 0, SEEK_CUR);
+    if(at < 0 || ftruncate(fd, at)) return Closed(errno);
+    return TRUE;
+}
+
+BOOL DeviceIoControl(HANDLE file, DWORD code, LPVOID in, DWORD in_size, LPVOID out, DWORD out_size, LPDWORD returned, LPOVERLAPPED at) {
+    (void) in; (void) in_size; (void) out; (void) out_size; (void) at;
+    if(FdOf(file) < 0) return Fail(ERROR_INVALID_HANDLE, FALSE);
+    if(code != FSCTL_SET_SPARSE) return Fail(ERROR_NOT_SUPPORTED, FALSE);
+    if(returned) *returned = 0;
+    return TRUE; // files with holes are the norm
+}
+
+BOOL DeleteFileA(LPCSTR path) {
+    return unlink(path) ? Closed(errno) : TRUE;
+}
+
+DWORD GetTempPathA(DWORD length, LPSTR path) {
+    const char* dir = getenv("TMPDIR");
+    if(!dir || !*dir) dir = "/tmp";
+    const size_t n = strlen(dir);
+    const bool slash = dir[n - 1] != '/';
+    if(n + slash + 1 > length) return (DWORD)(n + slash + 1);
+    memcpy(path, dir, n);
+    if(slash) path[n] = '/';
+    path[n + slash] = 0;
+    return (DWORD)(n + slash);
+}
+
+BOOL FlushFileBuffers(HANDLE file) {
+    const int fd = FdOf(file);
+    if(fd < 0) return Fail(ERROR_INVALID_HANDLE, FALSE);
+    return fsync(fd) ? Closed(errno) : TRUE;
+}
+
+BOOL DuplicateHandle(HANDLE source_process, HANDLE source, HANDLE target_process, HANDLE* target, DWORD access, BOOL inherit, DWORD options) {
+    (void) access; // DUPLICATE_SAME_ACCESS, in effect
+    if(source_process != kCurrentProcess || target_process != kCurrentProcess) return Fail(ERROR_INVALID_HANDLE, FALSE);
+    const Section* section = As<Section>(source);
+    const int fd = section ? section->fd : FdOf(source);
+    if(fd < 0) return Fail(ERROR_INVALID_HANDLE, FALSE);
+    const int copy = fcntl(fd, inherit ? F_DUPFD : F_DUPFD_CLOEXEC, 0);
+    if(copy < 0) return Closed(errno);
+    Object* duplicate = section ? (Object*)new(std::nothrow) Section(copy, section->size, section->protect)
+                                : (Object*)new(std::nothrow) File(copy);
+    if(!duplicate) {
+        close(copy);
+        return Fail(ERROR_NOT_ENOUGH_MEMORY, FALSE);
+    }
+    if(options & DUPLICATE_CLOSE_SOURCE) CloseHandle(source);
+    *target = duplicate;
+    return TRUE;
+}
+
+BOOL CloseHandle(HANDLE handle) {
+    if(handle == kCurrentProcess || handle == kCurrentThread) return TRUE;
+    if(IsFdHandle(handle)) return close(FdOf(handle)) ? Closed(errno) : TRUE;
+    Object* object = ObjectOf(handle);
+    if(!object) return Fail(ERROR_INVALID_HANDLE, FALSE);
+    delete object;
+    return TRUE;
+}
+
+//////////////////////////////////
+// The CRT side of file handles //
+//////////////////////////////////
+
+intptr_t _get_osfhandle(int fd) {
+    if(fcntl(fd, F_GETFD) < 0) return errno = EBADF, (intptr_t)INVALID_HANDLE_VALUE;
+    pthread_mutex_lock(&_osf_lock);
+    auto found = _osf_handles.find(fd);
+    const HANDLE handle = (found != _osf_handles.end()) ? found->second : FdHandle(fd);
+    pthread_mutex_unlock(&_osf_lock);
+    return (intptr_t)handle;
+}
+
+int _open_osfhandle(intptr_t handle, int flags) {
+    File* file = As<File>((HANDLE)handle);
+    if(!file) return errno = EBADF, -1;
+    const int fd = file->fd;
+    fcntl(fd, F_SETFD, (flags & O_CLOEXEC) ? FD_CLOEXEC : 0);
+    pthread_mutex_lock(&_osf_lock);
+    try {
+        _osf_handles[fd] = (HANDLE)handle;
+    } catch(const std::bad_alloc&) {
+        pthread_mutex_unlock(&_osf_lock);
+        return errno = ENOMEM, -1;
+    }
+    pthread_mutex_unlock(&_osf_lock);
+    return fd;
+}
+
+int _close(int fd) {
+    File* file = nullptr;
+    pthread_mutex_lock(&_osf_lock);
+    auto found = _osf_handles.find(fd);
+    if(found != _osf_handles.end()) {
+        file = As<File>(found->second);
+        _osf_handles.erase(found);
+    }
+    pthread_mutex_unlock(&_osf_lock);
+    if(file) {
+        file->fd = -1; // the descriptor goes below
+        delete file;
+    }
+    return close(fd);
+}
+
+int _commit(int fd) {
+    return fsync(fd);
+}
+
+int _chsize_s(int fd, long long size) {
+    return ftruncate(fd, (off_t)size) ? errno : 0;
+}
+
+////////////////////////////
+// Processes and threads  //
+////////////////////////////
+
+HANDLE GetCurrentProcess(void) {
+    return kCurrentProcess;
+}
+
+HANDLE GetCurrentThread(void) {
+    return kCurrentThread;
+}
+
+DWORD GetCurrentProcessId(void) {
+    return (DWORD)getpid();
+}
+
+DWORD GetCurrentThreadId(void) {
+    static thread_local const DWORD id = (DWORD)syscall(SYS_gettid);
+    return id;
+}
+
+HANDLE CreateThread(LPSECURITY_ATTRIBUTES sa, SIZE_T stack_size, LPTHREAD_START_ROUTINE start, LPVOID arg, DWORD flags, LPDWORD id) {
+    (void) sa; (void) flags; // no CREATE_SUSPENDED
+    Thread* thread = new(std::nothrow) Thread();
+    if(!thread) return Fail(ERROR_NOT_ENOUGH_MEMORY, (HANDLE)nullptr);
+    thread->start = start;
+    thread->arg = arg;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if(stack_size) pthread_attr_setstacksize(&attr, std::max<size_t>(stack_size, PTHREAD_STACK_MIN));
+    const int error = pthread_create(&thread->thread, &attr, &StartThread, thread);
+    pthread_attr_destroy(&attr);
+    if(error) {
+        thread->joined = true; // nothing to detach
+        delete thread;
+        return Fail(ErrorFromErrno(error), (HANDLE)nullptr);
+    }
+    if(id) *id = 0; // known to the thread only (GetCurrentThreadId)
+    return thread;
+}
+
+BOOL SetThreadPriority(HANDLE thread, int priority) {
+    (void) thread; (void) priority; // the scheduler decides
+    return TRUE;
+}
+
+HANDLE CreateEventW(LPSECURITY_ATTRIBUTES sa, BOOL manual_reset, BOOL initial_state, LPCWSTR name) {
+    (void) sa;
+    if(name) return Fail(ERROR_NOT_SUPPORTED, (HANDLE)nullptr);
+    Event* event = new(std::nothrow) Event(manual_reset, initial_state);
+    return event ? (HANDLE)event : Fail(ERROR_NOT_ENOUGH_MEMORY, (HANDLE)nullptr);
+}
+
+BOOL SetEvent(HANDLE handle) {
+    Event* event = As<Event>(handle);
+    if(!event) return Fail(ERROR_INVALID_HANDLE, FALSE);
+    pthread_mutex_lock(&event->mutex);
+    event->signaled = true;
+    if(event->manual_reset) {
+        pthread_cond_broadcast(&event->cond);
+    } else {
+        pthread_cond_signal(&event->cond);
+    }
+    pthread_mutex_unlock(&event->mutex);
+    return TRUE;
+}
+
+BOOL ResetEvent(HANDLE handle) {
+    Event* event = As<Event>(handle);
+    if(!event) return Fail(ERROR_INVALID_HANDLE, FALSE);
+    pthread_mutex_lock(&event->mutex);
+    event->signaled = false;
+    pthread_mutex_unlock(&event->mutex);
+    return TRUE;
+}
+
+DWORD WaitForSingleObject(HANDLE handle, DWORD milliseconds) {
+    if(Thread* thread = As<Thread>(handle)) {
+        if(thread->joined) return WAIT_OBJECT_0;
+        int error;
+        if(milliseconds == INFINITE) {
+            error = pthread_join(thread->thread, nullptr);
+        } else {
+            const timespec deadline = Deadline(CLOCK_REALTIME, milliseconds);
+            error = milliseconds ? pthread_timedjoin_np(thread->thread, nullptr, &deadline)
+                                 : pthread_tryjoin_np(thread->thread, nullptr);
+        }
+        if(error == ETIMEDOUT || error == EBUSY) return WAIT_TIMEOUT;
+        if(error) return Fail(ERROR_INVALID_HANDLE, WAIT_FAILED);
+        thread->joined = true;
+        return WAIT_OBJECT_0;
+    }
+    if(Event* event = As<Event>(handle)) {
+        const timespec deadline = Deadline(CLOCK_MONOTONIC, (milliseconds == INFINITE) ? 0 : milliseconds);
+        DWORD result = WAIT_OBJECT_0;
+        pthread_mutex_lock(&event->mutex);
+        while(!event->signaled) {
+            if(!milliseconds) {
+                result = WAIT_TIMEOUT;
+                break;
+            }
+            const int error = (milliseconds == INFINITE) ? pthread_cond_wait(&event->cond, &event->mutex)
+                                                         : pthread_cond_timedwait(&event->cond, &event->mutex, &deadline);
+            if(error == ETIMEDOUT) {
+                result = WAIT_TIMEOUT;
+                break;
+            }
+        }
+        if(result == WAIT_OBJECT_0 && !event->manual_reset) event->signaled = false;
+        pthread_mutex_unlock(&event->mutex);
+        return result;
+    }
+    return Fail(ERROR_INVALID_HANDLE, WAIT_FAILED);
+}
+
+void Sleep(DWORD milliseconds) {
+    timespec duration = {(time_t)(milliseconds / 1000), (long)(milliseconds % 1000) * 1000000};
+    while(nanosleep(&duration, &duration) && errno == EINTR) {}
+}
+
+//////////
+// Time //
+//////////
+
+ULONGLONG GetTickCount64(void) {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (ULONGLONG)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+BOOL QueryPerformanceCounter(LARGE_INTEGER* count) {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    count->QuadPart = (LONGLONG)now.tv_sec * 1000000000 + now.tv_nsec;
+    return TRUE;
+}
+
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* frequency) {
+    frequency->QuadPart = 1000000000; // nanoseconds
+    return TRUE;
+}
+
+////////////////////////////////
+// Vectored exception handers //
+////////////////////////////////
+
+PVOID AddVectoredExceptionHandler(ULONG first, PVECTORED_EXCEPTION_HANDLER handler) {
+    pthread_mutex_lock(&_veh_lock);
+    unsigned free_slot = kMaxHandlers;
+    for(unsigned i = 0; i < kMaxHandlers; ++i) {
+        if(!_handlers[i]) {
+            free_slot = i;
+            break;
+        }
+    }
+    if(free_slot < kMaxHandlers) {
+        // shift to make room at the front: a handler being called may run once more, or be missed once
+        if(first) {
+            for(unsigned i = free_slot; i > 0; --i) _handlers[i] = _handlers[i - 1];
+            free_slot = 0;
+        }
+        _handlers[free_slot] = handler;
+        if(!_installed) InstallFaultHandler();
+    }
+    pthread_mutex_unlock(&_veh_lock);
+    return (free_slot < kMaxHandlers) ? (PVOID)handler : Fail(ERROR_NOT_ENOUGH_MEMORY, (PVOID)nullptr);
+}
+
+ULONG RemoveVectoredExceptionHandler(PVOID handle) {
+    pthread_mutex_lock(&_veh_lock);
+    ULONG removed = 0;
+    for(unsigned i = 0; i < kMaxHandlers && !removed; ++i) {
+        if((PVOID)_handlers[i] == handle) {
+            for(unsigned j = i; j + 1 < kMaxHandlers; ++j) _handlers[j] = _handlers[j + 1];
+            _handlers[kMaxHandlers - 1] = nullptr;
+            removed = 1;
+        }
+    }
+    pthread_mutex_unlock(&_veh_lock);
+    return removed;
+}
+
+/////////////
+// Modules //
+/////////////
+
+HMODULE GetModuleHandleW(LPCWSTR name) {
+    (void) name;
+    return Fail(ERROR_FILE_NOT_FOUND, (HMODULE)nullptr);
+}
+
+FARPROC GetProcAddress(HMODULE module, LPCSTR name) {
+    (void) module; (void) name;
+    return Fail(kErrorProcNotFound, (FARPROC)nullptr);
+}
+
+HRESULT WerRegisterMemoryBlock(const void* address, DWORD size) {
+    (void) address; (void) size; // no error reporting service to tell
+    return kNotImplemented;
+}
+
+/////////////////////////
+// Names and encodings //
+/////////////////////////
+
+DWORD GetLogicalDrives(void) {
+    return 0; // paths are paths: nothing for `QueryDosDeviceW` to translate
+}
+
+DWORD QueryDosDeviceW(LPCWSTR device, LPWSTR target, DWORD length) {
+    (void) device; (void) target; (void) length;
+    return Fail(ERROR_FILE_NOT_FOUND, (DWORD)0);
+}
+
+int WideCharToMultiByte(UINT code_page, DWORD flags, LPCWSTR wide, int wide_length,
+                        LPSTR bytes, int bytes_length, LPCSTR default_char, PBOOL used_default) {
+    (void) flags;
+    if(code_page != CP_UTF8 || default_char || used_default) return Fail(ERROR_INVALID_PARAMETER, 0);
+    const size_t length = (wide_length < 0) ? wcslen(wide) + 1 : (size_t)wide_length;
+    const size_t needed = Utf8(wide, length, nullptr, 0);
+    if(!bytes_length) return (int)needed;
+    if(needed > (size_t)bytes_length) return Fail(ERROR_INSUFFICIENT_BUFFER, 0);
+    Utf8(wide, length, bytes, bytes_length);
+    return (int)needed;
+}
+
+BOOL QueryWorkingSetEx(HANDLE process, PVOID info, DWORD size) {
+    if(process != kCurrentProcess) return Fail(ERROR_INVALID_PARAMETER, FALSE);
+    const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    PSAPI_WORKING_SET_EX_INFORMATION* pages = (PSAPI_WORKING_SET_EX_INFORMATION*)info;
+    const DWORD count = size / sizeof(*pages);
+    unsigned char resident[256];
+    for(DWORD i = 0, run; i < count; i += run) {
+        // one call per run of consecutive pages; a run with a hole in it goes page by page
+        const uintptr_t first = (uintptr_t)pages[i].VirtualAddress / page_size * page_size;
+        for(run = 1; i + run < count && run < sizeof(resident)
+                && (uintptr_t)pages[i + run].VirtualAddress / page_size * page_size == first + run * page_size; ++run) {}
+        if(kernel::Residency((void*)first, run * page_size, resident)) {
+            run = 1;
+            if(kernel::Residency((void*)first, page_size, resident)) resident[0] = 0; // not mapped
+        }
+        for(DWORD j = 0; j < run; ++j) {
+            pages[i + j].VirtualAttributes.Flags = 0;
+            pages[i + j].VirtualAttributes.Valid = resident[j] & 1;
+        }
+    }
+    return TRUE;
+}
+
+DWORD GetMappedFileNameW(HANDLE process, LPVOID addr, LPWSTR name, DWORD length) {
+    if(process != kCurrentProcess || !length) return Fail(ERROR_INVALID_PARAMETER, (DWORD)0);
+    DWORD written = 0;
+    Mapping mapping;
+    VmLock guard;
+    if(FindMapping((uintptr_t)addr, mapping) && mapping.lower <= (uintptr_t)addr && mapping.path[0] == '/') {
+        written = (DWORD)Utf32(mapping.path, name, length - 1);
+        name[written] = 0;
+    }
+    return written ? written : Fail(ERROR_FILE_INVALID, (DWORD)0);
+}
+
+DWORD GetMappedFileNameA(HANDLE process, LPVOID addr, LPSTR name, DWORD length) {
+    if(process != kCurrentProcess || !length) return Fail(ERROR_INVALID_PARAMETER, (DWORD)0);
+    DWORD written = 0;
+    Mapping mapping;
+    VmLock guard;
+    if(FindMapping((uintptr_t)addr, mapping) && mapping.lower <= (uintptr_t)addr && mapping.path[0] == '/') {
+        written = (DWORD)std::min<size_t>(strlen(mapping.path), length - 1);
+        memcpy(name, mapping.path, written);
+        name[written] = 0;
+    }
+    return written ? written : Fail(ERROR_FILE_INVALID, (DWORD)0);
+}
+
+} // extern "C"
@@ -0,0 +1,482 @@
+#ifndef _MEMMAP_SRC_LINUX_WINDOWS_H_
+#define _MEMMAP_SRC_LINUX_WINDOWS_H_
+
+/**
+ * The native Linux baseline backend (`meson setup -Dplatform=linux`): the subset of
+ * <windows.h> that the library uses, implemented in win32.cpp on top of the Linux
+ * system calls. It exists to measure what the library's own logic costs over the
+ * kernel, not to emulate Windows; the differences that matter are:
+ *
+ *  - reservations and views are kernel mappings (PROT_NONE while reserved) aligned
+ *    to a 64 KiB allocation granularity, tracked in a table that VirtualQuery reads;
+ *    the rest of the address space is read from /proc/self/maps (one allocation per
+ *    line, file-backed lines reported as MEM_IMAGE);
+ *  - sections are file descriptors (a memfd for the page file). SEC_RESERVE sections
+ *    are sized at their maximum, and their views report every page as committed;
+ *  - large pages are regular pages; the working set has no quota; there is one NUMA
+ *    node; memory offered with OfferVirtualMemory is kept;
+ *  - vectored exception handlers run from a SIGSEGV/SIGBUS handler, which emulates
+ *    PAGE_GUARD with PROT_NONE. It runs on the faulting stack: a thread that faults
+ *    on the guard of its own stack needs an alternate signal stack;
+ *  - GetProcAddress finds nothing, so optional Windows 8+ entry points resolved at
+ *    run time stay unavailable.
+ *
+ * The library exports the sys/mman.h functions under their POSIX names, so on Linux
+ * they interpose the C library's; the backend itself calls the kernel directly.
+ */
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <wchar.h>
+
+#define _WIN32_WINNT_WIN7 0x0601
+#define _WIN32_WINNT_WIN8 0x0602
+#define _WIN32_WINNT_WINBLUE 0x0603
+#define _WIN32_WINNT_WIN10 0x0A00
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT _WIN32_WINNT_WIN10
+#endif
+
+#define WINAPI
+#define NTAPI
+#define CALLBACK
+#define WINBASEAPI
+
+/* Types */
+///////////
+
+typedef int BOOL;
+typedef unsigned char BOOLEAN;
+typedef unsigned char BYTE;
+typedef unsigned char UCHAR;
+typedef unsigned short WORD;
+typedef unsigned short USHORT;
+typedef uint32_t DWORD;
+typedef uint32_t ULONG;
+typedef uint32_t UINT;
+typedef int32_t LONG;
+typedef int32_t HRESULT;
+typedef int64_t LONGLONG;
+typedef uint64_t ULONGLONG;
+typedef uint64_t ULONG64;
+typedef uint64_t DWORD64;
+typedef uintptr_t ULONG_PTR;
+typedef uintptr_t DWORD_PTR;
+typedef size_t SIZE_T;
+typedef DWORD ACCESS_MASK;
+
+typedef BOOL* PBOOL;
+typedef DWORD* PDWORD;
+typedef DWORD* LPDWORD;
+typedef ULONG* PULONG;
+typedef ULONGLONG* PULONGLONG;
+typedef SIZE_T* PSIZE_T;
+
+typedef void* PVOID;
+typedef void* LPVOID;
+typedef const void* LPCVOID;
+typedef void* HANDLE;
+typedef HANDLE HMODULE;
+typedef void* FARPROC;
+
+typedef wchar_t WCHAR; /* UTF-32 here: the library only passes WCHAR strings through */
+typedef char* LPSTR;
+typedef const char* LPCSTR;
+typedef WCHAR* LPWSTR;
+typedef const WCHAR* LPCWSTR;
+
+typedef union _LARGE_INTEGER {
+    __extension__ struct {
+        DWORD LowPart;
+        LONG HighPart;
+    };
+    LONGLONG QuadPart;
+} LARGE_INTEGER, *PLARGE_INTEGER;
+
+typedef struct _SECURITY_ATTRIBUTES {
+    DWORD nLength;
+    LPVOID lpSecurityDescriptor;
+    BOOL bInheritHandle;
+} SECURITY_ATTRIBUTES, *PSECURITY_ATTRIBUTES, *LPSECURITY_ATTRIBUTES;
+
+typedef struct _MEMORY_BASIC_INFORMATION {
+    PVOID BaseAddress;
+    PVOID AllocationBase;
+    DWORD AllocationProtect;
+    SIZE_T RegionSize;
+    DWORD State;
+    DWORD Protect;
+    DWORD Type;
+} MEMORY_BASIC_INFORMATION, *PMEMORY_BASIC_INFORMATION;
+
+typedef struct _SYSTEM_INFO {
+    WORD wProcessorArchitecture;
+    WORD wReserved;
+    DWORD dwPageSize;
+    LPVOID lpMinimumApplicationAddress;
+    LPVOID lpMaximumApplicationAddress;
+    DWORD_PTR dwActiveProcessorMask;
+    DWORD dwNumberOfProcessors;
+    DWORD dwProcessorType;
+    DWORD dwAllocationGranularity;
+    WORD wProcessorLevel;
+    WORD wProcessorRevision;
+} SYSTEM_INFO, *LPSYSTEM_INFO;
+
+typedef struct _MEMORYSTATUSEX {
+    DWORD dwLength;
+    DWORD dwMemoryLoad;
+    ULONGLONG ullTotalPhys;
+    ULONGLONG ullAvailPhys;
+    ULONGLONG ullTotalPageFile;
+    ULONGLONG ullAvailPageFile;
+    ULONGLONG ullTotalVirtual;
+    ULONGLONG ullAvailVirtual;
+    ULONGLONG ullAvailExtendedVirtual;
+} MEMORYSTATUSEX, *LPMEMORYSTATUSEX;
+
+typedef enum _PROCESSOR_CACHE_TYPE {
+    CacheUnified,
+    CacheInstruction,
+    CacheData,
+    CacheTrace
+} PROCESSOR_CACHE_TYPE;
+
+typedef struct _CACHE_DESCRIPTOR {
+    BYTE Level;
+    BYTE Associativity;
+    WORD LineSize;
+    DWORD Size;
+    PROCESSOR_CACHE_TYPE Type;
+} CACHE_DESCRIPTOR;
+
+typedef enum _LOGICAL_PROCESSOR_RELATIONSHIP {
+    RelationProcessorCore,
+    RelationNumaNode,
+    RelationCache,
+    RelationProcessorPackage
+} LOGICAL_PROCESSOR_RELATIONSHIP;
+
+typedef struct _SYSTEM_LOGICAL_PROCESSOR_INFORMATION {
+    ULONG_PTR ProcessorMask;
+    LOGICAL_PROCESSOR_RELATIONSHIP Relationship;
+    union {
+        struct {
+            BYTE Flags;
+        } ProcessorCore;
+        struct {
+            DWORD NodeNumber;
+        } NumaNode;
+        CACHE_DESCRIPTOR Cache;
+        ULONGLONG Reserved[2];
+    };
+} SYSTEM_LOGICAL_PROCESSOR_INFORMATION, *PSYSTEM_LOGICAL_PROCESSOR_INFORMATION;
+
+typedef struct _EXCEPTION_RECORD {
+    DWORD ExceptionCode;
+    DWORD ExceptionFlags;
+    struct _EXCEPTION_RECORD* ExceptionRecord;
+    PVOID ExceptionAddress;
+    DWORD NumberParameters;
+    ULONG_PTR ExceptionInformation[15];
+} EXCEPTION_RECORD, *PEXCEPTION_RECORD;
+
+typedef struct _CONTEXT {
+    void* ucontext; /* the ucontext_t of the signal */
+} CONTEXT, *PCONTEXT;
+
+typedef struct _EXCEPTION_POINTERS {
+    PEXCEPTION_RECORD ExceptionRecord;
+    PCONTEXT ContextRecord;
+} EXCEPTION_POINTERS, *PEXCEPTION_POINTERS;
+
+typedef LONG (NTAPI *PVECTORED_EXCEPTION_HANDLER)(PEXCEPTION_POINTERS);
+typedef DWORD (WINAPI *LPTHREAD_START_ROUTINE)(LPVOID);
+
+typedef struct _OVERLAPPED {
+    ULONG_PTR Internal;
+    ULONG_PTR InternalHigh;
+    DWORD Offset;
+    DWORD OffsetHigh;
+    HANDLE hEvent;
+} OVERLAPPED, *LPOVERLAPPED;
+
+typedef enum _FILE_INFO_BY_HANDLE_CLASS {
+    FileEndOfFileInfo = 6
+} FILE_INFO_BY_HANDLE_CLASS;
+
+typedef struct _FILE_END_OF_FILE_INFO {
+    LARGE_INTEGER EndOfFile;
+} FILE_END_OF_FILE_INFO;
+
+typedef struct _WIN32_MEMORY_RANGE_ENTRY {
+    PVOID VirtualAddress;
+    SIZE_T NumberOfBytes;
+} WIN32_MEMORY_RANGE_ENTRY, *PWIN32_MEMORY_RANGE_ENTRY;
+
+typedef enum OFFER_PRIORITY {
+    VmOfferPriorityVeryLow = 1,
+    VmOfferPriorityLow,
+    VmOfferPriorityBelowNormal,
+    VmOfferPriorityNormal
+} OFFER_PRIORITY;
+
+/* Slim reader/writer locks are pthread rwlocks (larger than a pointer, which nothing relies on) */
+typedef struct _RTL_SRWLOCK {
+    pthread_rwlock_t rwlock;
+} SRWLOCK, *PSRWLOCK;
+#define SRWLOCK_INIT {PTHREAD_RWLOCK_INITIALIZER}
+
+/* Constants */
+///////////////
+
+#define TRUE 1
+#define FALSE 0
+#define MAX_PATH 260
+#define INFINITE 0xFFFFFFFF
+#define INVALID_HANDLE_VALUE ((HANDLE)(intptr_t)-1)
+#define INVALID_FILE_SIZE ((DWORD)0xFFFFFFFF)
+#define S_OK 0
+#define CP_UTF8 65001
+#define ALL_PROCESSOR_GROUPS 0xffff
+#define NUMA_NO_PREFERRED_NODE ((DWORD)-1)
+
+#define PAGE_NOACCESS 0x01
+#define PAGE_READONLY 0x02
+#define PAGE_READWRITE 0x04
+#define PAGE_WRITECOPY 0x08
+#define PAGE_EXECUTE 0x10
+#define PAGE_EXECUTE_READ 0x20
+#define PAGE_EXECUTE_READWRITE 0x40
+#define PAGE_EXECUTE_WRITECOPY 0x80
+#define PAGE_GUARD 0x100
+#define PAGE_NOCACHE 0x200
+#define PAGE_WRITECOMBINE 0x400
+
+#define MEM_COMMIT 0x1000
+#define MEM_RESERVE 0x2000
+#define MEM_DECOMMIT 0x4000
+#define MEM_RELEASE 0x8000
+#define MEM_FREE 0x10000
+#define MEM_PRIVATE 0x20000
+#define MEM_MAPPED 0x40000
+#define MEM_RESET 0x80000
+#define MEM_TOP_DOWN 0x100000
+#define MEM_RESET_UNDO 0x1000000
+#define MEM_IMAGE 0x1000000
+#define MEM_LARGE_PAGES 0x20000000
+
+#define SEC_IMAGE 0x1000000
+#define SEC_RESERVE 0x4000000
+#define SEC_COMMIT 0x8000000
+#define SEC_LARGE_PAGES 0x80000000
+
+#define FILE_MAP_COPY 0x1
+#define FILE_MAP_WRITE 0x2
+#define FILE_MAP_READ 0x4
+#define FILE_MAP_EXECUTE 0x20
+#define FILE_MAP_ALL_ACCESS 0xf001f
+
+#define GENERIC_READ 0x80000000
+#define GENERIC_WRITE 0x40000000
+#define GENERIC_EXECUTE 0x20000000
+#define FILE_READ_DATA 0x1
+#define FILE_WRITE_DATA 0x2
+#define FILE_EXECUTE 0x20
+#define FILE_SHARE_READ 0x1
+#define FILE_SHARE_WRITE 0x2
+#define FILE_SHARE_DELETE 0x4
+#define CREATE_NEW 1
+#define CREATE_ALWAYS 2
+#define OPEN_EXISTING 3
+#define OPEN_ALWAYS 4
+#define TRUNCATE_EXISTING 5
+#define FILE_ATTRIBUTE_NORMAL 0x80
+#define FILE_ATTRIBUTE_TEMPORARY 0x100
+#define FILE_FLAG_DELETE_ON_CLOSE 0x04000000
+#define FILE_FLAG_SEQUENTIAL_SCAN 0x08000000
+#define FILE_FLAG_NO_BUFFERING 0x20000000
+#define FILE_FLAG_WRITE_THROUGH 0x80000000
+#define FILE_BEGIN 0
+#define FILE_CURRENT 1
+#define FILE_END 2
+#define FILE_TYPE_UNKNOWN 0
+#define FILE_TYPE_DISK 1
+#define FILE_TYPE_CHAR 2
+#define FILE_TYPE_PIPE 3
+#define FSCTL_SET_SPARSE 0x900c4
+#define DUPLICATE_CLOSE_SOURCE 0x1
+#define DUPLICATE_SAME_ACCESS 0x2
+
+#define WAIT_OBJECT_0 0
+#define WAIT_TIMEOUT 258
+#define WAIT_FAILED ((DWORD)0xFFFFFFFF)
+#define THREAD_PRIORITY_LOWEST (-2)
+#define THREAD_PRIORITY_BELOW_NORMAL (-1)
+#define THREAD_PRIORITY_NORMAL 0
+#define THREAD_PRIORITY_ABOVE_NORMAL 1
+#define QUOTA_LIMITS_HARDWS_MIN_ENABLE 0x1
+#define QUOTA_LIMITS_HARDWS_MIN_DISABLE 0x2
+#define QUOTA_LIMITS_HARDWS_MAX_ENABLE 0x4
+#define QUOTA_LIMITS_HARDWS_MAX_DISABLE 0x8
+
+#define ERROR_SUCCESS 0
+#define ERROR_FILE_NOT_FOUND 2
+#define ERROR_PATH_NOT_FOUND 3
+#define ERROR_TOO_MANY_OPEN_FILES 4
+#define ERROR_ACCESS_DENIED 5
+#define ERROR_INVALID_HANDLE 6
+#define ERROR_NOT_ENOUGH_MEMORY 8
+#define ERROR_HANDLE_EOF 38
+#define ERROR_HANDLE_DISK_FULL 39
+#define ERROR_NOT_SUPPORTED 50
+#define ERROR_FILE_EXISTS 80
+#define ERROR_INVALID_PARAMETER 87
+#define ERROR_DISK_FULL 112
+#define ERROR_INSUFFICIENT_BUFFER 122
+#define ERROR_BUSY 170
+#define ERROR_ALREADY_EXISTS 183
+#define ERROR_FILE_INVALID 1006
+#define ERROR_MAPPED_ALIGNMENT 1132
+#define ERROR_INVALID_ADDRESS 487
+#define ERROR_IO_PENDING 997
+#define ERROR_NOACCESS 998
+#define ERROR_WORKING_SET_QUOTA 1453
+#define ERROR_COMMITMENT_LIMIT 1455
+
+#define EXCEPTION_ACCESS_VIOLATION 0xC0000005
+#define EXCEPTION_IN_PAGE_ERROR 0xC0000006
+#define STATUS_GUARD_PAGE_VIOLATION 0x80000001
+#define EXCEPTION_CONTINUE_EXECUTION (-1)
+#define EXCEPTION_CONTINUE_SEARCH 0
+
+/* Functions */
+///////////////
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+DWORD GetLastError(void);
+void SetLastError(DWORD error);
+
+void GetSystemInfo(LPSYSTEM_INFO info);
+SIZE_T GetLargePageMinimum(void);
+BOOL GlobalMemoryStatusEx(LPMEMORYSTATUSEX status);
+BOOL GetLogicalProcessorInformation(PSYSTEM_LOGICAL_PROCESSOR_INFORMATION info, PDWORD length);
+DWORD GetActiveProcessorCount(WORD group);
+BOOL GetNumaHighestNodeNumber(PULONG highest);
+BOOL GetNumaNodeProcessorMask(UCHAR node, PULONGLONG mask);
+DWORD_PTR SetThreadAffinityMask(HANDLE thread, DWORD_PTR mask);
+
+LPVOID VirtualAlloc(LPVOID addr, SIZE_T size, DWORD type, DWORD protect);
+LPVOID VirtualAllocExNuma(HANDLE process, LPVOID addr, SIZE_T size, DWORD type, DWORD protect, DWORD node);
+BOOL VirtualFree(LPVOID addr, SIZE_T size, DWORD type);
+BOOL VirtualProtect(LPVOID addr, SIZE_T size, DWORD protect, PDWORD old_protect);
+SIZE_T VirtualQuery(LPCVOID addr, PMEMORY_BASIC_INFORMATION mbi, SIZE_T length);
+BOOL VirtualLock(LPVOID addr, SIZE_T size);
+BOOL VirtualUnlock(LPVOID addr, SIZE_T size);
+/* Windows 8+: weak, as the library declares them for older SDKs and checks for them */
+DWORD DiscardVirtualMemory(PVOID addr, SIZE_T size) __attribute((weak));
+DWORD OfferVirtualMemory(PVOID addr, SIZE_T size, OFFER_PRIORITY priority) __attribute((weak));
+DWORD ReclaimVirtualMemory(PVOID addr, SIZE_T size) __attribute((weak));
+BOOL PrefetchVirtualMemory(HANDLE process, ULONG_PTR count, PWIN32_MEMORY_RANGE_ENTRY ranges, ULONG flags) __attribute((weak));
+BOOL FlushInstructionCache(HANDLE process, LPCVOID addr, SIZE_T size);
+BOOL GetProcessWorkingSetSizeEx(HANDLE process, PSIZE_T min, PSIZE_T max, PDWORD flags);
+BOOL SetProcessWorkingSetSizeEx(HANDLE process, SIZE_T min, SIZE_T max, DWORD flags);
+
+HANDLE CreateFileMappingW(HANDLE file, LPSECURITY_ATTRIBUTES sa, DWORD protect, DWORD size_high, DWORD size_low, LPCWSTR name);
+LPVOID MapViewOfFile(HANDLE section, DWORD access, DWORD offset_high, DWORD offset_low, SIZE_T size);
+LPVOID MapViewOfFileEx(HANDLE section, DWORD access, DWORD offset_high, DWORD offset_low, SIZE_T size, LPVOID addr);
+LPVOID MapViewOfFileExNuma(HANDLE section, DWORD access, DWORD offset_high, DWORD offset_low, SIZE_T size, LPVOID addr, DWORD node);
+BOOL UnmapViewOfFile(LPCVOID addr);
+BOOL FlushViewOfFile(LPCVOID addr, SIZE_T size);
+
+HANDLE CreateFileA(LPCSTR path, DWORD access, DWORD share, LPSECURITY_ATTRIBUTES sa, DWORD disposition, DWORD flags, HANDLE tmpl);
+HANDLE CreateFileW(LPCWSTR path, DWORD access, DWORD share, LPSECURITY_ATTRIBUTES sa, DWORD disposition, DWORD flags, HANDLE tmpl);
+HANDLE ReOpenFile(HANDLE original, DWORD access, DWORD share, DWORD flags);
+BOOL WriteFile(HANDLE file, LPCVOID data, DWORD size, LPDWORD written, LPOVERLAPPED at);
+BOOL ReadFile(HANDLE file, LPVOID data, DWORD size, LPDWORD read, LPOVERLAPPED at);
+BOOL SetFilePointerEx(HANDLE file, LARGE_INTEGER distance, PLARGE_INTEGER position, DWORD method);
+BOOL GetFileSizeEx(HANDLE file, PLARGE_INTEGER size);
+DWORD GetFileType(HANDLE file);
+BOOL SetFileInformationByHandle(HANDLE file, FILE_INFO_BY_HANDLE_CLASS info_class, LPVOID info, DWORD size);
+BOOL SetEndOfFile(HANDLE file);
+BOOL FlushFileBuffers(HANDLE file);
+BOOL DeviceIoControl(HANDLE file, DWORD code, LPVOID in, DWORD in_size, LPVOID out, DWORD out_size, LPDWORD returned, LPOVERLAPPED at);
+BOOL DeleteFileA(LPCSTR path);
+DWORD GetTempPathA(DWORD length, LPSTR path);
+BOOL DuplicateHandle(HANDLE source_process, HANDLE source, HANDLE target_process, HANDLE* target, DWORD access, BOOL inherit, DWORD options);
+BOOL CloseHandle(HANDLE handle);
+
+HANDLE GetCurrentProcess(void);
+HANDLE GetCurrentThread(void);
+DWORD GetCurrentProcessId(void);
+DWORD GetCurrentThreadId(void);
+HANDLE CreateThread(LPSECURITY_ATTRIBUTES sa, SIZE_T stack_size, LPTHREAD_START_ROUTINE start, LPVOID arg, DWORD flags, LPDWORD id);
+BOOL SetThreadPriority(HANDLE thread, int priority);
+HANDLE CreateEventW(LPSECURITY_ATTRIBUTES sa, BOOL manual_reset, BOOL initial_state, LPCWSTR name);
+BOOL SetEvent(HANDLE event);
+BOOL ResetEvent(HANDLE event);
+DWORD WaitForSingleObject(HANDLE handle, DWORD milliseconds);
+void Sleep(DWORD milliseconds);
+
+ULONGLONG GetTickCount64(void);
+BOOL QueryPerformanceCounter(LARGE_INTEGER* count);
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* frequency);
+
+PVOID AddVectoredExceptionHandler(ULONG first, PVECTORED_EXCEPTION_HANDLER handler);
+ULONG RemoveVectoredExceptionHandler(PVOID handle);
+
+HMODULE GetModuleHandleW(LPCWSTR name);
+FARPROC GetProcAddress(HMODULE module, LPCSTR name);
+
+DWORD GetLogicalDrives(void);
+DWORD QueryDosDeviceW(LPCWSTR device, LPWSTR target, DWORD length);
+int WideCharToMultiByte(UINT code_page, DWORD flags, LPCWSTR wide, int wide_length,
+                        LPSTR bytes, int bytes_length, LPCSTR default_char, PBOOL used_default);
+
+#ifdef __cplusplus
+}
+#endif
+
+static inline LONG InterlockedCompareExchange(volatile LONG* target, LONG exchange, LONG comparand) {
+    return __sync_val_compare_and_swap(target, comparand, exchange);
+}
+
+static inline LONG InterlockedExchange(volatile LONG* target, LONG value) {
+    return __atomic_exchange_n(target, value, __ATOMIC_SEQ_CST);
+}
+
+static inline LONG InterlockedIncrement(volatile LONG* target) {
+    return __atomic_add_fetch(target, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline LONG InterlockedDecrement(volatile LONG* target) {
+    return __atomic_sub_fetch(target, 1, __ATOMIC_SEQ_CST);
+}
+
+#define MemoryBarrier() __sync_synchronize()
+
+static inline void InitializeSRWLock(PSRWLOCK lock) {
+    pthread_rwlock_init(&lock->rwlock, NULL);
+}
+
+static inline void AcquireSRWLockExclusive(PSRWLOCK lock) {
+    pthread_rwlock_wrlock(&lock->rwlock);
+}
+
+static inline void ReleaseSRWLockExclusive(PSRWLOCK lock) {
+    pthread_rwlock_unlock(&lock->rwlock);
+}
+
+static inline void AcquireSRWLockShared(PSRWLOCK lock) {
+    pthread_rwlock_rdlock(&lock->rwlock);
+}
+
+static inline void ReleaseSRWLockShared(PSRWLOCK lock) {
+    pthread_rwlock_unlock(&lock->rwlock);
+}
+
+#endif /* _MEMMAP_SRC_LINUX_WINDOWS_H_ */
@@ -0,0 +1,226 @@
+#include "memmap/proc.h"
+#include "memmap/iter.h"
+
+#include "lock.h"
+#include "sync.h"
+#include "dbg.h" // tracing
+
+#include <windows.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <vector>
+
+namespace {
+
+/**
+ * MSDN: "the maximum number of pages that a process can lock is equal to the number of
+ * pages in its minimum working set minus a small overhead". The default minimum is a
+ * few hundred pages. We keep track of what we locked and raise the minimum (and, if
+ * needed, the maximum) ahead of VirtualLock, geometrically, so that a process locking
+ * many small ranges does not pay for SetProcessWorkingSetSizeEx every time.
+ */
+constexpr size_t kWorkingSetSlack = 4 << 20; // pages the process touches without locking them
+
+SRWLOCK _lock_lock = SRWLOCK_INIT;
+std::map<uintptr_t, uintptr_t> _locked; // lower -> upper; disjoint, page aligned
+size_t _locked_bytes = 0;
+std::atomic<size_t> _locked_count{0}; // of `_locked`, for `Unmapped` to skip the lock
+volatile bool _lock_future = false;
+
+uintptr_t _lock_page_size = getpagesize();
+
+bool GrowWorkingSet(size_t extra) {
+    HANDLE self = GetCurrentProcess();
+    SIZE_T min_ws = 0, max_ws = 0;
+    DWORD flags = 0;
+    if(!GetProcessWorkingSetSizeEx(self, &min_ws, &max_ws, &flags)) return false;
+    const size_t needed = _locked_bytes + extra + kWorkingSetSlack;
+    if(min_ws >= needed) return true;
+    const size_t new_min = std::max<size_t>(needed, min_ws + min_ws / 2);
+    const size_t new_max = std::max<size_t>(max_ws, new_min + kWorkingSetSlack);
+    _MEMMAP_LOG("SetProcessWorkingSetSizeEx(%lx, %lx, %lx)", (DWORD)new_min, (DWORD)new_max, flags);
+    return SetProcessWorkingSetSizeEx(self, new_min, new_max, flags);
+}
+
+/* Insert [lower, upper) into `_locked`, merging with overlapping and adjacent ranges. */
+void Remember(uintptr_t lower, uintptr_t upper) {
+    auto it = _locked.upper_bound(lower);
+    if(it != _locked.begin() && std::prev(it)->second >= lower) --it;
+    while(it != _locked.end() && it->first <= upper) {
+        lower = std::min(lower, it->first);
+        upper = std::max(upper, it->second);
+        _locked_bytes -= it->second - it->first;
+        it = _locked.erase(it);
+    }
+    _locked.emplace(lower, upper);
+    _locked_bytes += upper - lower;
+    _locked_count = _locked.size();
+}
+
+/* Remove [lower, upper) from `_locked`, splitting ranges that straddle the bounds. */
+void Forget(uintptr_t lower, uintptr_t upper) {
+    auto it = _locked.upper_bound(lower);
+    if(it != _locked.begin() && std::prev(it)->second > lower) --it;
+    while(it != _locked.end() && it->first < upper) {
+        const uintptr_t l = it->first, u = it->second;
+        _locked_bytes -= u - l;
+        it = _locked.erase(it);
+        if(l < lower) {
+            _locked.emplace(l, lower);
+            _locked_bytes += lower - l;
+        }
+        if(u > upper) {
+            it = _locked.emplace(upper, u).first;
+            _locked_bytes += u - upper;
+            ++it;
+        }
+    }
+    _locked_count = _locked.size();
+}
+
+bool Lockable(const MEMORY_BASIC_INFORMATION& mbi) {
+    return mem::Committed(mbi) && mbi.Protect && !(mbi.Protect & (PAGE_NOACCESS | PAGE_GUARD));
+}
+
+bool LockPages(uintptr_t lower, uintptr_t upper) {
+    if(!GrowWorkingSet(upper - lower)) return false;
+    _MEMMAP_LOG("VirtualLock(%p, %lx)", (void*)lower, (DWORD)(upper - lower));
+    bool locked = VirtualLock((void*)lower, upper - lower);
+    if(!locked && GetLastError() == ERROR_WORKING_SET_QUOTA) {
+        // pages locked behind our back (or a foreign working set change): make room and retry once
+        locked = GrowWorkingSet(2 * (upper - lower)) && VirtualLock((void*)lower, upper - lower);
+    }
+    if(locked) Remember(lower, upper);
+    return locked;
+}
+
+/**
+ * VirtualUnlock of [lower, upper), one allocation at a time: `_locked` merges adjacent
+ * ranges, and VirtualUnlock fails on a range that spans two allocations.
+ */
+bool UnlockPages(uintptr_t lower, uintptr_t upper) {
+    bool all_unlocked = true;
+    void* base = nullptr;
+    uintptr_t run_lower = 0, run_upper = 0;
+    auto unlock = [&] {
+        if(run_lower == run_upper) return;
+        _MEMMAP_LOG("VirtualUnlock(%p, %lx)", (void*)run_lower, (DWORD)(run_upper - run_lower));
+        all_unlocked &= !!VirtualUnlock((void*)run_lower, run_upper - run_lower);
+    };
+    const MEMMAP_RANGE range = {(void*)lower, (void*)upper};
+    mem::TraverseInPlace(range, [&](const MEMORY_BASIC_INFORMATION& mbi, const MEMMAP_RANGE& region) {
+        if(mbi.AllocationBase != base || run_upper != (uintptr_t)region.lower) {
+            unlock();
+            base = mbi.AllocationBase;
+            run_lower = (uintptr_t)region.lower;
+        }
+        run_upper = (uintptr_t)region.upper;
+    }, &mem::Committed);
+    unlock();
+    return all_unlocked;
+}
+
+} // anonymous
+
+namespace mem {
+namespace lock {
+
+bool Lock(const void* addr, size_t length) {
+    const uintptr_t lower = (uintptr_t)addr - (uintptr_t)addr % _lock_page_size;
+    const uintptr_t upper = (uintptr_t)addr + length + _lock_page_size - 1;
+    ExclusiveLock guard(_lock_lock);
+    return LockPages(lower, upper - upper % _lock_page_size);
+}
+
+bool LockNew(const void* addr, size_t length) {
+    const uintptr_t lower = (uintptr_t)addr - (uintptr_t)addr % _lock_page_size;
+    const uintptr_t upper = (uintptr_t)addr + length + _lock_page_size - 1;
+    const MEMMAP_RANGE range = {(void*)lower, (void*)(upper - upper % _lock_page_size)};
+    ExclusiveLock guard(_lock_lock);
+    bool all_locked = true;
+    uintptr_t run_lower = 0, run_upper = 0; // lockable regions are coalesced, as in `LockCurrent`
+    TraverseInPlace(range, [&](const MEMORY_BASIC_INFORMATION&, const MEMMAP_RANGE& region) {
+        if(run_upper != (uintptr_t)region.lower) {
+            if(run_lower < run_upper) all_locked &= LockPages(run_lower, run_upper);
+            run_lower = (uintptr_t)region.lower;
+        }
+        run_upper = (uintptr_t)region.upper;
+    }, &Lockable);
+    if(run_lower < run_upper) all_locked &= LockPages(run_lower, run_upper);
+    return all_locked;
+}
+
+void Unmapped(const void* addr, size_t length) {
+    if(!_locked_count) return;
+    const uintptr_t lower = (uintptr_t)addr - (uintptr_t)addr % _lock_page_size;
+    uintptr_t upper = (uintptr_t)addr + length + _lock_page_size - 1;
+    upper -= upper % _lock_page_size;
+    ExclusiveLock guard(_lock_lock);
+    // unlocked before they go: recycled pages would stay locked otherwise
+    auto it = _locked.upper_bound(lower);
+    if(it != _locked.begin() && std::prev(it)->second > lower) --it;
+    for(; it != _locked.end() && it->first < upper; ++it) {
+        UnlockPages(std::max(lower, it->first), std::min(upper, it->second));
+    }
+    Forget(lower, upper);
+}
+
+bool Unlock(const void* addr, size_t length) {
+    const uintptr_t lower = (uintptr_t)addr - (uintptr_t)addr % _lock_page_size;
+    const uintptr_t upper = (uintptr_t)addr + length + _lock_page_size - 1;
+    ExclusiveLock guard(_lock_lock);
+    Forget(lower, upper - upper % _lock_page_size);
+    return UnlockPages(lower, upper - upper % _lock_page_size);
+}
+
+bool LockCurrent() {
+    // coalesce first, so that the working set grows once and VirtualLock runs once per run
+    std::vector<MEMMAP_RANGE> runs;
+    TraverseAllProcessMemory([&](const MEMORY_BASIC_INFORMATION&, const MEMMAP_RANGE& range) {
+        if(!runs.empty() && runs.back().upper == range.lower) {
+            runs.back().upper = range.upper;
+        } else {
+            runs.push_back(range);
+        }
+    }, &Lockable);
+
+    size_t total = 0;
+    for(const MEMMAP_RANGE& run : runs) total += MEMMAP_RANGE_SIZE(run);
+
+    ExclusiveLock guard(_lock_lock);
+    bool all_locked = GrowWorkingSet(total);
+    for(const MEMMAP_RANGE& run : runs) {
+        if(LockPages((uintptr_t)run.lower, (uintptr_t)run.upper)) continue;
+        // some region of the run changed state meanwhile: lock what is still lockable, one by one
+        Traverse(run, [&](const MEMORY_BASIC_INFORMATION&, const MEMMAP_RANGE& range) {
+            all_locked &= LockPages((uintptr_t)range.lower, (uintptr_t)range.upper);
+        }, &Lockable);
+    }
+    return all_locked;
+}
+
+bool UnlockAll() {
+    std::map<uintptr_t, uintptr_t> locked;
+    {
+        ExclusiveLock guard(_lock_lock);
+        locked.swap(_locked);
+        _locked_bytes = 0;
+        _locked_count = 0;
+    }
+    bool all_unlocked = true;
+    for(const auto& range : locked) all_unlocked &= UnlockPages(range.first, range.second);
+    return all_unlocked;
+}
+
+void SetFuture(bool future) {
+    _lock_future = future;
+}
+
+bool Future() {
+    return _lock_future;
+}
+
+} // namespace lock
+} // namespace mem
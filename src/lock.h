@@ -0,0 +1,43 @@
+#ifndef _MEMMAP_SRC_LOCK_H_
+#define _MEMMAP_SRC_LOCK_H_
+
+#include <stddef.h>
+
+/* Page locking bookkeeping behind the `mlock` family */
+
+namespace mem {
+namespace lock {
+
+/**
+ * VirtualLock [addr, addr+length), growing the process working set limits first if
+ * the locked total would not fit (VirtualLock fails with ERROR_WORKING_SET_QUOTA
+ * after a few hundred pages otherwise). Successfully locked ranges are remembered.
+ */
+bool Lock(const void* addr, size_t length);
+
+/**
+ * MCL_FUTURE: locks the accessible pages of a new mapping. PROT_NONE and reserved pages
+ * are skipped, as `LockCurrent` skips them (guard and reservation mappings stay legal).
+ */
+bool LockNew(const void* addr, size_t length);
+
+/* `munmap`: unlocks and forgets the locked pages of [addr, addr+length). Cheap while nothing is locked. */
+void Unmapped(const void* addr, size_t length);
+
+/* VirtualUnlock and forget [addr, addr+length). */
+bool Unlock(const void* addr, size_t length);
+
+/* Locks all committed accessible memory, coalescing adjacent regions into single calls. */
+bool LockCurrent();
+
+/* Unlocks exactly the ranges remembered by `Lock`. */
+bool UnlockAll();
+
+/* MCL_FUTURE: `mmap` locks new mappings while this is set. */
+void SetFuture(bool future);
+bool Future();
+
+} // namespace lock
+} // namespace mem
+
+#endif /* _MEMMAP_SRC_LOCK_H_ */
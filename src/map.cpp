@@ -2,8 +2,21 @@
 #include "memmap/conf.h"
 #include "memmap/proc.h"
 #include "memmap/iter.h"
+#include "memmap/dump.h"
 
 #include "dbg.h" // tracing
+#include "pack.h"
+#include "recycle.h"
+#include "numa.h"
+#include "lock.h"
+#include "view.h"
+#include "stack.h"
+#include "memfd.h"
+#include "fit.h"
+#include "access.h"
+#include "huge.h"
+#include "tags.h"
+#include "offer.h"
 
 // implementation
 #include <windows.h>
@@ -12,27 +25,6 @@
 #include <io.h> // _get_osfhandle
 #include <assert.h>
 
-extern "C" {
-
-////////////////////////
-// Advice (`madvise`) //
-////////////////////////
-
-#if _WIN32_WINNT < _WIN32_WINNT_WINBLUE
-  typedef enum _OFFER_PRIORITY {
-    VmOfferPriorityVeryLow = 1,
-    VmOfferPriorityLow,
-    VmOfferPriorityBelowNormal,
-    VmOfferPriorityNormal
-  } OFFER_PRIORITY;
-
-  /* WINBASEAPI */ DWORD WINAPI DiscardVirtualMemory (PVOID VirtualAddress, SIZE_T Size) __attribute((weak));
-  /* WINBASEAPI */ DWORD WINAPI OfferVirtualMemory (PVOID VirtualAddress, SIZE_T Size, OFFER_PRIORITY Priority) __attribute((weak));
-  /* WINBASEAPI */ DWORD WINAPI ReclaimVirtualMemory (PVOID VirtualAddress, SIZE_T Size) __attribute((weak));
-#endif
-
-} // extern "C"
-
 namespace
 {
 using namespace mem;
@@ -63,9 +55,6 @@ enum class ModusVivendi {
     EMERGENCY = 0,
 } _modus_vivendi = ModusVivendi::NORMAL;
 
-enum fd_access_inference_policy _exec_policy = fd_access_inference_policy__probe;
-enum fd_access_inference_policy _write_policy = fd_access_inference_policy__probe;
-
 bool _mmap_strict_policy = false;
 bool _mmap_apply_executable_image_sections = false;
 
@@ -88,6 +77,11 @@ int RoundDownFailFast(void* &addr, size_t &length) {
         ? (errno = EINVAL, -1) : 0;
 }
 
+size_t PageCeil(size_t length) {
+    length += _page_size - 1;
+    return length - length % _page_size;
+}
+
 int RoundUpFailFast(size_t &length) {
     const auto oldlen = length;
     length += _page_size - 1;
@@ -100,6 +94,25 @@ int FailIfStrict(int errcode = EINVAL) {
     return _mmap_strict_policy ? (errno = errcode, -1) : 0;
 }
 
+/**
+ * A file view can only be unmapped as a whole. `mmap` may have shifted the start address
+ * by up to one allocation granule (file offset padding), so the view is released iff the
+ * range [addr, addr+length) reaches from within the first granule to the end of the view.
+ * A partial `munmap` leaves the view in place (its changes have been `msync`ed already).
+ */
+bool UnmapViewIfCovered(void* addr, size_t length, const MEMORY_BASIC_INFORMATION& mbi) {
+    const uintptr_t view = (uintptr_t)mbi.AllocationBase;
+    if((uintptr_t)addr - view >= (uintptr_t)get_allocation_granularity()) return true;
+    uintptr_t view_end = (uintptr_t)mbi.BaseAddress + mbi.RegionSize;
+    MEMORY_BASIC_INFORMATION next;
+    while(VirtualQuery((void*)view_end, &next, sizeof(next)) && (uintptr_t)next.AllocationBase == view) {
+        view_end += next.RegionSize;
+    }
+    if((uintptr_t)addr + length + _page_size - 1 < view_end) return true;
+    _MEMMAP_LOG("UnmapViewOfFile(%p)", mbi.AllocationBase);
+    return UnmapViewOfFile(mbi.AllocationBase);
+}
+
 } // anonymouys / nonreusable
 
 namespace mem {
@@ -114,6 +127,95 @@ Fd2HANDLE DefFd2Handle() {
 }
 
 } // namespace map
+
+namespace view {
+
+HANDLE FileHandle(int fd) {
+    return _curFd2HandleImpl(fd);
+}
+
+DWORD Protection(int prot, int flags) {
+    const DWORD protection = kProtectionTranslationLUT[prot & PROT_MASK];
+    const bool copy_on_write = (flags & MAP_PRIVATE) && (prot & PROT_WRITE);
+    return copy_on_write ? protection << 1 : protection; // *_READWRITE becomes *_WRITECOPY
+}
+
+HANDLE Section(HANDLE hfile, DWORD protection, int prot, uint64_t max_size) {
+    if(HANDLE section = memfd::Section(hfile)) return section; // already a section; views of it narrow its access
+    if(_modus_vivendi == ModusVivendi::NORMAL) { // the handle cache allocates: in emergency mode the section decides
+        hfile = access::ForSection(hfile, protection); // reopened if the fd lacks the access and the policies allow
+        if(!hfile) return nullptr;
+    }
+    SECURITY_ATTRIBUTES sa;
+    sa.nLength = sizeof(sa);
+    sa.lpSecurityDescriptor = nullptr;
+    sa.bInheritHandle = true; // TODO review handle inheritance throughout the API
+    DWORD file_prot = protection;
+    // if(large_pages) fileprot |= SEC_LARGE_PAGES; // only for the swap file
+    if((prot & PROT_EXEC) && _mmap_apply_executable_image_sections) {
+        // SEC_IMAGE is not a prerequisite for mapping an executable file.
+        // Instead it tells the OS that memory protection values must follow
+        // the binary ("objdump -h") layout of the file being mapped.
+        // There is no equivalent flag in POSIX API; we enable it by a policy.
+        file_prot |= SEC_IMAGE;
+    }
+    // a maximum size beyond the end of the file extends the file (sparsely, if it is sparse)
+    const DWORD max_size_high = (DWORD)(max_size >> 32);
+    const DWORD max_size_low = (DWORD)max_size;
+    _MEMMAP_LOG("CreateFileMappingW(%p, %cinh, 0x%lx, %lx:%lx, no name)",
+                 hfile, sa.bInheritHandle?'+':'-', file_prot, max_size_high, max_size_low);
+    HANDLE h_map = CreateFileMappingW(hfile, &sa, file_prot, max_size_high, max_size_low, nullptr /*name*/);
+    // the name won't be null for shm_open
+
+    if(!h_map) { // NULL, unlike CreateFile, which returns INVALID_HANDLE_VALUE
+        /* FIXME parse GetLastError() and translate to relevant BSD/Linux errno! */
+        _MEMMAP_LOG("invalid h_map GetLastError()=%lx", GetLastError());
+        errno = EACCES;
+    }
+    return h_map;
+}
+
+DWORD Access(int prot, int flags) {
+    // NOTE: https://stackoverflow.com/questions/55018806/copy-on-write-file-mapping-on-windows
+    // also: in MinGW FILE_MAP_ALL_ACCESS includes FILE_MAP_EXECUTE, which is contrary to MSDN.
+    const bool copy_on_write = (flags & MAP_PRIVATE) && (prot & PROT_WRITE);
+    const bool share_changes = (flags & MAP_SHARED) && (prot & PROT_WRITE);
+    DWORD fv_access = copy_on_write ? FILE_MAP_COPY :
+                      share_changes ? FILE_MAP_WRITE|FILE_MAP_READ : FILE_MAP_READ;
+    if(prot & PROT_EXEC) {
+        fv_access |= FILE_MAP_EXECUTE;
+    }
+    return fv_access;
+}
+
+size_t Padding(uint64_t offset) {
+    const uint64_t allocgran = get_allocation_granularity();
+    return offset % allocgran;
+}
+
+void* Map(HANDLE section, uint64_t offset, size_t length, DWORD access, int flags) {
+    const size_t fvpadding = Padding(offset);
+    const uint64_t fv_offset = offset - fvpadding;
+    const size_t fv_length = length + fvpadding;
+    const DWORD fv_offset_high = (DWORD)(fv_offset >> 32);
+    const DWORD fv_offset_low = (DWORD)fv_offset;
+
+    _MEMMAP_LOG("MapViewOfFile(%p, %lx, %lx:%lx, %lx)", section, access, fv_offset_high, fv_offset_low, (DWORD)fv_length);
+    void* fv = numa::Placed(flags)
+        ? MapViewOfFileExNuma(section, access, fv_offset_high, fv_offset_low, fv_length, nullptr, numa::NodeFor(flags))
+        : (fit::Enabled() && _modus_vivendi == ModusVivendi::NORMAL)
+        ? fit::Place(fv_length, [&](void* at) {
+              return MapViewOfFileEx(section, access, fv_offset_high, fv_offset_low, fv_length, at);
+          })
+        : MapViewOfFile(section, access, fv_offset_high, fv_offset_low, fv_length);
+    if(!fv) {
+        _MEMMAP_LOG("invalid mview GetLastError()=%lx", GetLastError());
+        return errno = ENOMEM, nullptr; /* FIXME GetLastError() etc. */
+    }
+    return (char*)fv + fvpadding;
+}
+
+} // namespace view
 } // namespace mem
 
 extern "C" {
@@ -142,14 +244,6 @@ void emergency_mode_assume_unreliable_heap() {
     _modus_vivendi = ModusVivendi::EMERGENCY;
 }
 
-void set_exec_bit_inference_policy(enum fd_access_inference_policy policy) {
-    _exec_policy = policy;
-}
-
-void set_write_bit_inference_policy(enum fd_access_inference_policy policy) {
-    _write_policy = policy;
-}
-
 void set_mmap_strict_policy(int strict) {
     _mmap_strict_policy = strict;
 }
@@ -186,7 +280,15 @@ static bool WerExcludeMemoryBlock(const void *address, DWORD size) {
 // POSIX interface //
 /////////////////////
 
-void* mmap(void* addr, size_t length, int prot, int flags, int fd, off_t off) {
+// The 32-bit `off_t` entry point; <sys/mman.h> may have aliased the name to `mmap64`.
+#undef mmap
+void* mmap(void* addr, size_t length, int prot, int flags, int fd, _off_t off) __MEMMAP_NAME(mmap);
+
+void* mmap(void* addr, size_t length, int prot, int flags, int fd, _off_t off) {
+    return mmap64(addr, length, prot, flags, fd, off);
+}
+
+void* mmap64(void* addr, size_t length, int prot, int flags, int fd, off64_t off) {
     // *** IMPLEMENTATION NOTES (code generation) ***
     // MSDN: "To execute dynamically generated code, use VirtualAlloc to allocate
     //      memory and the VirtualProtect function to grant PAGE_EXECUTE access."
@@ -208,7 +310,7 @@ void* mmap(void* addr, size_t length, int prot, int flags, int fd, off_t off) {
     // NOTE: https://learn.microsoft.com/en-us/windows/win32/memory/large-page-support
     //       (particularly, see the part about AdjustTokenPrivileges)
 
-    if(((off * _mmap_strict_policy) | (uintptr_t)addr) % page_size) {
+    if(((off * _mmap_strict_policy) | (uintptr_t)addr) % page_size || off < 0) {
         return errno = EINVAL, MAP_FAILED; // enforce page boundary
     }
     // length will be rounded up later -- there is a file view padding to incorporate
@@ -224,7 +326,7 @@ void* mmap(void* addr, size_t length, int prot, int flags, int fd, off_t off) {
 
         // ... handtracking here (unless emergency mode is on)
 
-        HANDLE hfile = _curFd2HandleImpl(fd);
+        HANDLE hfile = view::FileHandle(fd);
         // The handle CAN be INVALID_HANDLE_VALUE. In this case, Windows creates
         // a mapping backed by the system page file. However, this behavior is
         // not expected in POSIX API and we simply report an error and quit.
@@ -232,52 +334,14 @@ void* mmap(void* addr, size_t length, int prot, int flags, int fd, off_t off) {
             _MEMMAP_LOG("invalid hfile GetLastError()=%lx", GetLastError());
             return errno = EBADF, MAP_FAILED;
         }
-        SECURITY_ATTRIBUTES sa;
-        sa.lpSecurityDescriptor = nullptr;
-        sa.bInheritHandle = true; // TODO review handle inheritance throughout the API
-        DWORD file_prot = protection;
-        // if(large_pages) fileprot |= SEC_LARGE_PAGES; // only for the swap file
-        if((prot & PROT_EXEC) && _mmap_apply_executable_image_sections) {
-            // SEC_IMAGE is not a prerequisite for mapping an executable file.
-            // Instead it tells the OS that memory protection values must follow
-            // the binary ("objdump -h") layout of the file being mapped.
-            // There is no equivalent flag in POSIX API; we enable it by a policy.
-            file_prot |= SEC_IMAGE;
-        }
-        _MEMMAP_LOG("CreateFileMappingW(%p, %cinh, 0x%lx, whole file, no name)",
-                     hfile, sa.bInheritHandle?'+':'-', file_prot);
-        HANDLE h_map = CreateFileMappingW(hfile, &sa, file_prot, 0, 0, nullptr /*name*/);
-        // the name won't be null for shm_open
-
-        if(h_map == INVALID_HANDLE_VALUE) {
-            /* FIXME parse GetLastError() and translate to relevant BSD/Linux errno! */
-            _MEMMAP_LOG("invalid h_map GetLastError()=%lx", GetLastError());
-            return errno = EACCES, MAP_FAILED;
-        }
-
-        const bool existing_mapping = GetLastError() == ERROR_ALREADY_EXISTS; // atomic
-
-        off_t allocgran = get_allocation_granularity();
-        off_t fvpadding = (off % allocgran);
-        off_t fv_offset = off - fvpadding;
-        off_t fv_length = length + fvpadding;
-
-        // NOTE: https://stackoverflow.com/questions/55018806/copy-on-write-file-mapping-on-windows
-        // also: in MinGW FILE_MAP_ALL_ACCESS includes FILE_MAP_EXECUTE, which is contrary to MSDN.
-        const bool share_changes = (flags & MAP_SHARED) && (prot & PROT_WRITE);
-        DWORD fv_access = copy_on_write ? FILE_MAP_COPY :
-                          share_changes ? FILE_MAP_WRITE|FILE_MAP_READ : FILE_MAP_READ;
-        if(prot & PROT_EXEC) {
-            fv_access |= FILE_MAP_EXECUTE;
-        }
-        _MEMMAP_LOG("MapViewOfFile(%p, %lx, 0:%lx, %lx)", h_map, fv_access, (DWORD)fv_offset, (DWORD)fv_length);
-        addr = MapViewOfFile(h_map, fv_access, 0, fv_offset, fv_length);
-        if(!addr) {
-            _MEMMAP_LOG("invalid mview GetLastError()=%lx", GetLastError());
-            return errno = ENOMEM, MAP_FAILED; /* FIXME GetLastError() etc. */
-        }
+        HANDLE h_map = view::Section(hfile, protection, prot);
+        if(!h_map) return MAP_FAILED;
 
-        addr = (void*)((uintptr_t)addr + fvpadding);
+        addr = view::Map(h_map, off, length, view::Access(prot, flags), flags);
+        // MSDN: "mapped views of a file mapping object maintain internal references to the object"
+        // -- the view keeps the mapping alive, and we don't need the handle anymore.
+        CloseHandle(h_map);
+        if(!addr) return MAP_FAILED;
 
         // TODO further decorate for synchronization, execution etc. RESPECTING PAGE BOUNDARIES
         // TODO add handtracking for further `munmap` and `madvise` purposes
@@ -290,12 +354,30 @@ void* mmap(void* addr, size_t length, int prot, int flags, int fd, off_t off) {
         // length is not checked, but silently rounded up:
         length += page_size - 1; length -= length % page_size;
 
-        _MEMMAP_LOG("VirtualAlloc(%p, %lx, %lx, %lx)", addr, (DWORD)length, vm_request, protection);
-        addr = VirtualAlloc(addr, length, vm_request, protection);
+        const bool reusable = !addr && !large_pages && TrustTheHeap() && !numa::Placed(flags) && !(flags & MAP_GROWSDOWN);
+        void* reused = reusable ? recycle::Take(length, protection, flags & MAP_UNINITIALIZED) : nullptr;
+        void* packed = (reusable && !reused) ? pack::Map(length, protection) : nullptr;
+        if(reused || packed) {
+            addr = reused ? reused : packed;
+        } else if((flags & MAP_GROWSDOWN) && !large_pages && TrustTheHeap()) {
+            addr = stack::Map(addr, length, protection); // reserved whole, committed from the top down
+            if(!addr) return MAP_FAILED;
+        } else if(numa::Placed(flags)) {
+            addr = numa::Alloc(addr, length, vm_request, protection, flags);
+        } else if(!addr && !large_pages && fit::Enabled() && TrustTheHeap()) {
+            addr = fit::Place(length, [&](void* at) {
+                return huge::Map(at, length, vm_request, protection);
+            });
+        } else {
+            addr = huge::Map(addr, length, vm_request, protection); // VirtualAlloc, in a way MADV_HUGEPAGE can swap
+        }
         if(!addr) {
             errno = (GetLastError() == ERROR_INVALID_ADDRESS) ? EINVAL : ENOMEM;
             return MAP_FAILED;
         }
+        if((large_pages || numa::Placed(flags)) && TrustTheHeap()) {
+            recycle::Exclude(addr); // not the pages a plain `mmap` of the same length expects
+        }
     }
 
     assert(addr); // we quit earlier in all error cases
@@ -303,9 +385,17 @@ void* mmap(void* addr, size_t length, int prot, int flags, int fd, off_t off) {
     // now adorn the newlywed memory in special modes independent of file mapping
 
     if(flags & MAP_CONCEAL) {
+        memmap_dump_exclude(addr, length);
         WerExcludeMemoryBlock(addr, length);
     }
 
+    if(lock::Future() && !(flags & MAP_GROWSDOWN) && !lock::LockNew(addr, length)) { // stacks: only reserved
+        munmap(addr, length); // Linux: "mlockall(MCL_FUTURE) ... may fail with EAGAIN"
+        return errno = EAGAIN, MAP_FAILED;
+    }
+
+    if(!is_file_backed) tags::Created(addr, length); // see memmap_tag_thread
+
     return addr;
 }
 
@@ -323,14 +413,29 @@ int munmap(void* addr, size_t length) {
     // Side effects of a partial munmap() on a file view are replicated w/`msync`
     // We stop tracking status of "logically unmapped" regions in emergency mode.
 
-    // For anonymous regions, we do VirtualFree().
+    // For anonymous regions, we do VirtualFree() -- unless they share a packed reservation.
+
+    tags::Unmapped(addr, length, TrustTheHeap()); // the pages lose their names whatever becomes of them
+    memmap_dump_include(addr, length); // ...and their exclusions from dumps (MAP_CONCEAL)
+    if(TrustTheHeap()) lock::Unmapped(addr, length); // ...and their locks (the bookkeeping allocates)
+
+    if(pack::Unmap(addr, length, TrustTheHeap()) || stack::Unmap(addr, length) || huge::Unmap(addr, length)) return 0;
 
     msync(addr, length, MS_ASYNC); // flush writable file mapping
     MEMORY_BASIC_INFORMATION mbi;
     VirtualQuery(addr, &mbi, sizeof(mbi));
+    if(mbi.Type == MEM_MAPPED) {
+        if(!UnmapViewIfCovered(addr, length, mbi)) return errno = EINVAL, -1;
+        if(TrustTheHeap()) fit::Released(mbi.AllocationBase);
+        return 0;
+    }
+    if(TrustTheHeap() && recycle::Keep(addr, PageCeil(length), mbi)) {
+        return 0;
+    }
     const DWORD free_flags = (addr == mbi.AllocationBase && length == mbi.RegionSize)
         ? MEM_RELEASE : MEM_DECOMMIT; // MEM_RELEASE frees the entire original allocation
-    VirtualFree(addr, length, free_flags);
+    VirtualFree(addr, (free_flags == MEM_RELEASE) ? 0 : length, free_flags); // MSDN: MEM_RELEASE takes no size
+    if(free_flags == MEM_RELEASE && TrustTheHeap()) fit::Released(addr);
     return 0; // any good reason to fail here? TODO: consider smarter logic regarding file views
 }
 
@@ -372,21 +477,25 @@ int madvise(void* addr, size_t length, int advice) {
     switch(advice){
         case MADV_DONTNEED:
             if(_offer_decommit) {
-                return &OfferVirtualMemory && OfferVirtualMemory(addr, length, _offer_prio) == ERROR_SUCCESS
-                    || FailIfStrict(ENOMEM);
+                return (&OfferVirtualMemory && OfferVirtualMemory(addr, length, _offer_prio) == ERROR_SUCCESS)
+                    ? 0 : FailIfStrict(ENOMEM);
             } else {
-                return &DiscardVirtualMemory && DiscardVirtualMemory(addr, length) == ERROR_SUCCESS 
-                    || FailIfStrict(ENOMEM);
+                return (&DiscardVirtualMemory && DiscardVirtualMemory(addr, length) == ERROR_SUCCESS)
+                    ? 0 : FailIfStrict(ENOMEM);
             }
         case MADV_WILLNEED:
-            return &ReclaimVirtualMemory && ReclaimVirtualMemory(addr, length) == ERROR_SUCCESS
-                || FailIfStrict(ENOMEM);
-        case MADV_DONTDUMP:
-            return WerExcludeMemoryBlock(addr, length)
-                || FailIfStrict(EAGAIN);
+            return (&ReclaimVirtualMemory && ReclaimVirtualMemory(addr, length) == ERROR_SUCCESS)
+                ? 0 : FailIfStrict(ENOMEM); // see memmap/purge.h to learn whether the contents survived
+        case MADV_HUGEPAGE: // advice: anything left on small pages is counted (memmap/huge.h), not failed
+            return huge::Promote(addr, length);
+        case MADV_NOHUGEPAGE:
+            return 0;
+        case MADV_DONTDUMP: // our own dump writer (memmap/dump.h) first, WER if available
+            return (!memmap_dump_exclude(addr, length) | WerExcludeMemoryBlock(addr, length))
+                ? 0 : FailIfStrict(EAGAIN);
         case MADV_DODUMP:
-            return WerRegisterMemoryBlock(addr, length) == S_OK
-                || FailIfStrict(EAGAIN);
+            return (!memmap_dump_include(addr, length) | (WerRegisterMemoryBlock(addr, length) == S_OK))
+                ? 0 : FailIfStrict(EAGAIN);
         default:
             return FailIfStrict(); // EINVAL
     }
@@ -394,38 +503,34 @@ int madvise(void* addr, size_t length, int advice) {
 
 int mlock(const void* addr, size_t length) {
     // screw the strict mode and page size alignment; Windows is more liberal
-    return VirtualLock(const_cast<void*>(addr), length) ? 0 : (errno = EAGAIN, -1);
+    return lock::Lock(addr, length) ? 0 : (errno = EAGAIN, -1);
 }
 
 int mlock2(const void* addr, size_t length, int flags) {
-    (!(flags & MCL_CURRENT) ^ !(flags & MCL_FUTURE)) || FailIfStrict();
+    if((flags & ~MLOCK_ONFAULT) && FailIfStrict()) return -1; // MLOCK_ONFAULT: locked right away
     return mlock(addr, length);
 }
 
 int munlock(const void* addr, size_t length) {
     // ditto
-    return (VirtualUnlock(const_cast<void*>(addr), length) || !_mmap_strict_policy) ? 0 : (errno = EAGAIN, -1);
+    return (lock::Unlock(addr, length) || !_mmap_strict_policy) ? 0 : (errno = EAGAIN, -1);
 }
 
-int mlockall(int) {
+int mlockall(int flags) {
     // *all: no such shortcuts on Windows. The process will have to iterate through
-    //       its entire memory map and lock/unlock all committed pages it encounters.
-    int retval = 0;
-    TraverseAllProcessMemory([&](const _MEMORY_BASIC_INFORMATION& mbi, const MEMMAP_RANGE& range) {
-        if(mbi.Protect != PAGE_NOACCESS) { // inaccessible memory cannot be locked
-            retval |= mlock(range.lower, MEMMAP_RANGE_SIZE(range)); // also sets errno
-        }
-    });
-    return retval;
+    //       its entire memory map and lock all committed pages it encounters.
+    //       MCL_FUTURE is emulated by `mmap`; MCL_ONFAULT is implied (VirtualLock faults pages in).
+    if(!(flags & (MCL_CURRENT | MCL_FUTURE)) || (flags & ~(MCL_CURRENT | MCL_FUTURE | MCL_ONFAULT))) {
+        return errno = EINVAL, -1;
+    }
+    lock::SetFuture(flags & MCL_FUTURE);
+    return ((flags & MCL_CURRENT) && !lock::LockCurrent()) ? (errno = EAGAIN, -1) : 0;
 }
 
 int munlockall() {
-    // ditto (see `mlockall`)
-    int retval = 0;
-    TraverseAllProcessMemory([&](const _MEMORY_BASIC_INFORMATION&, const MEMMAP_RANGE& range) {
-        retval |= munlock(range.lower, MEMMAP_RANGE_SIZE(range)); // also sets errno
-    });
-    return retval;
+    // only ranges locked through this library are unlocked, rather than every region in sight
+    lock::SetFuture(false);
+    return (lock::UnlockAll() || !_mmap_strict_policy) ? 0 : (errno = EAGAIN, -1);
 }
 
 // `mincore` is defined in mem.cpp
@@ -0,0 +1,284 @@
+#include "sys/mman.h"
+#include "memmap/proc.h"
+#include "memmap/iter.h"
+#include "memmap/tags.h"
+#include "memmap/maps.h"
+
+#include "tags.h"
+
+#include <windows.h>
+#include <psapi.h> /* GetMappedFileNameW */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <wchar.h>
+#include <algorithm>
+
+namespace {
+
+/**
+ * Everything below lives on the stack of the caller: the exporter is meant for
+ * tools and sanitizers that may run it at awkward moments (and it would perturb
+ * the very address space it describes if it allocated).
+ */
+constexpr unsigned kDrives = 26;
+constexpr unsigned kDeviceChars = 64;
+constexpr unsigned kNameChars = 1024;                   // WCHARs of a mapped file name
+constexpr unsigned kNameBytes = 3 * kNameChars;         // the same in UTF-8
+constexpr unsigned kLineBytes = 128 + kNameBytes;
+constexpr unsigned kNameColumn = 25 + 6 * sizeof(void*); // where Linux pads the path to
+
+/* NT device names of the drive letters (\Device\HarddiskVolume3 for C:), queried once per export. */
+class Drives {
+public:
+    Drives() {
+        const DWORD present = GetLogicalDrives();
+        for(unsigned i = 0; i < kDrives; ++i) {
+            _length[i] = 0;
+            const WCHAR drive[] = {WCHAR(L'A' + i), L':', 0};
+            if((present & (1u << i)) && QueryDosDeviceW(drive, _device[i], kDeviceChars)) {
+                _length[i] = wcslen(_device[i]);
+            }
+        }
+    }
+
+    /* Rewrites an NT path as a DOS path in place; returns the new length. */
+    size_t Translate(WCHAR* path, size_t length) const {
+        for(unsigned i = 0; i < kDrives; ++i) {
+            const size_t n = _length[i];
+            if(n && n < length && path[n] == L'\\' && !wcsncmp(path, _device[i], n)) {
+                path[0] = WCHAR(L'A' + i);
+                path[1] = L':';
+                memmove(path + 2, path + n, (length - n + 1) * sizeof(WCHAR));
+                return length - n + 2;
+            }
+        }
+        return length;
+    }
+
+private:
+    WCHAR _device[kDrives][kDeviceChars];
+    size_t _length[kDrives];
+};
+
+/**
+ * File names by allocation base. The traversal is in address order and all regions
+ * of an allocation are contiguous, so remembering the last allocation base is enough
+ * to look every name up exactly once. Anonymous memory goes by its tag, if any.
+ */
+class Names {
+public:
+    const char* Lookup(void* allocation, DWORD type, const char* tag, size_t& length) {
+        if(type != MEM_PRIVATE) {
+            length = File(allocation);
+            if(length || !tag) return _name;
+        }
+        if(!tag) {
+            length = 0;
+            return "";
+        }
+        const int bytes = snprintf(_tagged, sizeof(_tagged), "[%s:%s]", (type == MEM_PRIVATE) ? "anon" : "anon_shmem", tag);
+        length = (bytes > 0) ? bytes : 0;
+        return _tagged;
+    }
+
+private:
+    size_t File(void* allocation) {
+        if(!_valid || allocation != _allocation) {
+            WCHAR wide[kNameChars];
+            size_t wide_length = GetMappedFileNameW(GetCurrentProcess(), allocation, wide, kNameChars);
+            wide_length = _drives.Translate(wide, wide_length);
+            const int bytes = WideCharToMultiByte(CP_UTF8, 0, wide, (int)wide_length, _name, kNameBytes, nullptr, nullptr);
+            _length = bytes > 0 ? bytes : 0;
+            _name[_length] = '\0';
+            _allocation = allocation;
+            _valid = true;
+        }
+        return _length;
+    }
+
+    Drives _drives;
+    void* _allocation = nullptr;
+    bool _valid = false;
+    char _name[kNameBytes + 1];
+    size_t _length = 0;
+    char _tagged[sizeof("[anon_shmem:]") + MEMMAP_TAG_MAX];
+};
+
+struct Mapping {
+    uintptr_t lower;
+    uintptr_t upper;
+    uintptr_t offset;
+    void* allocation;
+    DWORD type;
+    unsigned prot;
+    unsigned flags;
+    const char* tag; // see memmap/tags.h
+};
+
+unsigned ProtFrom(DWORD protect) {
+    if(protect & (PAGE_GUARD | PAGE_NOACCESS)) return PROT_NONE;
+    switch(protect & 0xff) {
+        case PAGE_READONLY:             return PROT_READ;
+        case PAGE_READWRITE:
+        case PAGE_WRITECOPY:            return PROT_DATA;
+        case PAGE_EXECUTE:              return PROT_EXEC;
+        case PAGE_EXECUTE_READ:         return PROT_CODE;
+        case PAGE_EXECUTE_READWRITE:
+        case PAGE_EXECUTE_WRITECOPY:    return PROT_JITC;
+        default:                        return PROT_NONE; // reserved: Protect is 0
+    }
+}
+
+Mapping MappingFrom(const MEMORY_BASIC_INFORMATION& mbi, const MEMMAP_RANGE& range) {
+    Mapping m;
+    m.lower = (uintptr_t)range.lower;
+    m.upper = (uintptr_t)range.upper;
+    m.allocation = mbi.AllocationBase;
+    m.type = mbi.Type;
+    m.offset = (mbi.Type == MEM_PRIVATE) ? 0 : m.lower - (uintptr_t)mbi.AllocationBase;
+    m.prot = (mbi.State == MEM_COMMIT) ? ProtFrom(mbi.Protect) : PROT_NONE;
+    const bool copy_on_write = (mbi.Protect & 0xff) == PAGE_WRITECOPY || (mbi.Protect & 0xff) == PAGE_EXECUTE_WRITECOPY;
+    m.flags = (mbi.Type == MEM_MAPPED && !copy_on_write) ? MAP_SHARED : MAP_PRIVATE;
+    m.tag = nullptr;
+    return m;
+}
+
+/* Walks the reserved address space, merging regions, and calls `emit(mapping, name, name_length)`. */
+template<typename Emit>
+void Walk(Emit&& emit) {
+    Names names;
+    Mapping pending;
+    bool have_pending = false;
+    auto flush = [&]() {
+        size_t name_length;
+        const char* name = names.Lookup(pending.allocation, pending.type, pending.tag, name_length);
+        emit(pending, name, name_length);
+    };
+    mem::TraverseInPlace(mem::ProcessRange(), [&](const MEMORY_BASIC_INFORMATION& mbi, const MEMMAP_RANGE& range) {
+        const Mapping region = MappingFrom(mbi, range);
+        uintptr_t until;
+        for(Mapping m = region; m.lower < region.upper; m.lower = m.upper) { // split where the tags change
+            m.tag = mem::tags::At(m.lower, until);
+            m.upper = std::min(region.upper, until);
+            if(m.type != MEM_PRIVATE) m.offset = m.lower - (uintptr_t)m.allocation;
+            if(have_pending && m.lower == pending.upper && m.allocation == pending.allocation && m.tag == pending.tag
+                    && m.type == pending.type && m.prot == pending.prot && m.flags == pending.flags) {
+                pending.upper = m.upper;
+                continue;
+            }
+            if(have_pending) flush();
+            pending = m;
+            have_pending = true;
+        }
+    }, &mem::Reserved);
+    if(have_pending) flush();
+}
+
+/* Appends whole pieces while they fit; counts everything. */
+class Output {
+public:
+    Output(char* buffer, size_t capacity) : _buffer(buffer), _capacity(capacity) {}
+
+    void Put(const char* data, size_t size) {
+        if(!_full && _total + size <= _capacity) {
+            memcpy(_buffer + _total, data, size);
+            _written = _total + size;
+        } else {
+            _full = true; // keep the output a prefix of the complete data
+        }
+        _total += size;
+    }
+
+    size_t Written() const { return _written; }
+    size_t Total() const { return _total; }
+
+private:
+    char* _buffer;
+    size_t _capacity;
+    size_t _written = 0;
+    size_t _total = 0;
+    bool _full = false;
+};
+
+char* Hex(char* out, uint64_t value, unsigned min_digits) {
+    char digits[16];
+    unsigned count = 0;
+    do {
+        digits[count++] = "0123456789abcdef"[value & 0xf];
+        value >>= 4;
+    } while(value);
+    while(count < min_digits--) *out++ = '0';
+    while(count) *out++ = digits[--count];
+    return out;
+}
+
+} // anonymous
+
+namespace mem {
+
+std::string ProcessMaps() {
+    std::string text;
+    size_t length = memmap_maps_text(nullptr, 0);
+    for(;;) {
+        text.resize(length + length / 8 + 1);
+        length = memmap_maps_text(&text[0], text.size());
+        if(length < text.size()) break;
+    }
+    text.resize(length);
+    return text;
+}
+
+} // namespace mem
+
+extern "C" {
+
+size_t memmap_maps_text(char* buffer, size_t size) {
+    Output out(buffer, size ? size - 1 : 0);
+    Walk([&](const Mapping& m, const char* name, size_t name_length) {
+        char line[kLineBytes];
+        char* end = Hex(line, m.lower, 8);
+        *end++ = '-';
+        end = Hex(end, m.upper, 8);
+        *end++ = ' ';
+        *end++ = (m.prot & PROT_READ) ? 'r' : '-';
+        *end++ = (m.prot & PROT_WRITE) ? 'w' : '-';
+        *end++ = (m.prot & PROT_EXEC) ? 'x' : '-';
+        *end++ = (m.flags & MAP_SHARED) ? 's' : 'p';
+        *end++ = ' ';
+        end = Hex(end, m.offset, 8);
+        memcpy(end, " 00:00 0", 8);
+        end += 8;
+        if(name_length) {
+            while(end < line + kNameColumn - 1) *end++ = ' ';
+            *end++ = ' ';
+            memcpy(end, name, name_length);
+            end += name_length;
+        }
+        *end++ = '\n';
+        out.Put(line, end - line);
+    });
+    if(size) buffer[out.Written()] = '\0';
+    return out.Total();
+}
+
+size_t memmap_maps_binary(void* buffer, size_t size) {
+    Output out((char*)buffer, size);
+    Walk([&](const Mapping& m, const char* name, size_t name_length) {
+        alignas(8) char record[sizeof(memmap_maps_record) + kNameBytes + 8];
+        memmap_maps_record& r = *(memmap_maps_record*)record;
+        r.lower = m.lower;
+        r.upper = m.upper;
+        r.offset = m.offset;
+        r.prot = m.prot;
+        r.flags = (uint16_t)m.flags;
+        r.name_length = (uint16_t)name_length;
+        const size_t record_size = MEMMAP_MAPS_RECORD_SIZE(&r);
+        memset(record + sizeof(r), 0, record_size - sizeof(r));
+        memcpy(record + sizeof(r), name, name_length);
+        out.Put(record, record_size);
+    });
+    return out.Total();
+}
+
+} // extern "C"
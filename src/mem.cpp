@@ -1,3 +1,4 @@
+#include "sys/mman.h"
 #include "memmap/conf.h"
 #include "memmap/iter.h"
 #include "memmap/proc.h"
@@ -5,23 +6,27 @@
 #include <windows.h>
 #include <errno.h>
 #include <assert.h>
+#include <limits.h>
 #include <algorithm>
 
 namespace {
 
 bool _mincore_strict_policy = false;
 
-mem::RangeVisitor CPPize(memmap_range_visitor purefunc_visitor) {
-    return [=](const MEMORY_BASIC_INFORMATION& mbi, const MEMMAP_RANGE& range) {
-        (*purefunc_visitor)(&mbi, &range);
-    };
-}
+/* Adapters from C function pointers to `TraverseInPlace` callables (trivially copyable, heap-free). */
+struct Visit {
+    memmap_range_visitor visitor;
+    void operator()(const MEMORY_BASIC_INFORMATION& mbi, const MEMMAP_RANGE& range) const {
+        (*visitor)(&mbi, &range);
+    }
+};
 
-mem::RangePredicate CPPize(memmap_range_predicate purefunc_predicate) {
-    return [=](const MEMORY_BASIC_INFORMATION& mbi) {
-        return (*purefunc_predicate)(&mbi);
-    };
-}
+struct Test {
+    memmap_range_predicate predicate;
+    bool operator()(const MEMORY_BASIC_INFORMATION& mbi) const {
+        return (*predicate)(&mbi);
+    }
+};
 
 } // anonymous
 
@@ -33,29 +38,16 @@ MEMMAP_RANGE Range(void* base, std::size_t size) {
 }
 
 void Traverse(const MEMMAP_RANGE& range, RangeVisitor visitor, RangePredicate predicate) {
-    MEMMAP_RANGE subrange = range;
-    MEMORY_BASIC_INFORMATION mbi;
-    while((uintptr_t)subrange.lower < (uintptr_t)range.upper) {
-        VirtualQuery(subrange.lower, &mbi, sizeof(mbi));
-        assert(mbi.BaseAddress == subrange.lower);
-        void* homog_until = (void*)((uintptr_t)subrange.lower + mbi.RegionSize);
-
-        if(predicate(mbi)) {
-            subrange.upper = (void*)(std::min((uintptr_t)homog_until, (uintptr_t)range.upper));
-            visitor(mbi, subrange);
-        }
+    TraverseInPlace(range, visitor, predicate);
+}
 
-        subrange.lower = homog_until;
-    }
+MEMMAP_RANGE ProcessRange() {
+    const memmap_topology* t = memmap_topology_get();
+    return {t->min_address, t->max_address};
 }
 
 void TraverseAllProcessMemory(RangeVisitor visitor, RangePredicate predicate) {
-    SYSTEM_INFO si;
-    GetSystemInfo(&si);
-
-    void* lower = si.lpMinimumApplicationAddress;
-    void* upper = si.lpMaximumApplicationAddress;
-    Traverse({lower, upper}, visitor, predicate);
+    Traverse(ProcessRange(), visitor, predicate);
 }
 
 } // namespace mem
@@ -68,57 +60,92 @@ void set_mincore_strict_policy(int strict) {
 
 extern long sysconf(int name) __attribute((weak));
 
+} // extern "C"
+
+namespace {
+
+/* Changes all the time, so it is the one figure that is never cached. */
+long AvailablePhysPages(size_t page_size) {
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if(!GlobalMemoryStatusEx(&status)) return errno = EINVAL, -1;
+    return (long)std::min<uint64_t>(status.ullAvailPhys / page_size, LONG_MAX);
+}
+
+} // anonymous
+
+extern "C" {
+
 int getpagesize() {
-    SYSTEM_INFO si;
-    GetSystemInfo(&si);
-    return si.dwPageSize;
+    return memmap_topology_get()->page_size;
 }
 
 int gethugepagesize() {
-    return (int) GetLargePageMinimum();
+    return memmap_topology_get()->large_page_size;
 }
 
 int get_allocation_granularity() {
-    SYSTEM_INFO si;
-    GetSystemInfo(&si);
-    return si.dwAllocationGranularity;
+    return memmap_topology_get()->allocation_granularity;
 }
 
 long memmap_sysconf(int name) {
-    if((name == _SC_PAGESIZE) || (name == _SC_PAGE_SIZE)) {
-        return getpagesize();
-    } else if(&sysconf) {
+    const memmap_topology* t = memmap_topology_get();
+    if(name == _SC_PAGE_SIZE) name = _SC_PAGESIZE; // the same on most runtimes, but not necessarily
+    switch(name) {
+        case _SC_PAGESIZE:                  return t->page_size;
+        case _SC_NUMA_NODES:                return t->numa_nodes;
+        case _SC_NPROCESSORS_CONF:
+        case _SC_NPROCESSORS_ONLN:          return t->processors;
+        case _SC_PHYS_PAGES:                return (long)std::min<uint64_t>(t->phys_pages, LONG_MAX);
+        case _SC_AVPHYS_PAGES:              return AvailablePhysPages(t->page_size);
+        case _SC_LEVEL1_ICACHE_SIZE:        return t->l1i.size;
+        case _SC_LEVEL1_ICACHE_ASSOC:       return t->l1i.associativity;
+        case _SC_LEVEL1_ICACHE_LINESIZE:    return t->l1i.line_size;
+        case _SC_LEVEL1_DCACHE_SIZE:        return t->l1d.size;
+        case _SC_LEVEL1_DCACHE_ASSOC:       return t->l1d.associativity;
+        case _SC_LEVEL1_DCACHE_LINESIZE:    return t->l1d.line_size;
+        case _SC_LEVEL2_CACHE_SIZE:         return t->l2.size;
+        case _SC_LEVEL2_CACHE_ASSOC:        return t->l2.associativity;
+        case _SC_LEVEL2_CACHE_LINESIZE:     return t->l2.line_size;
+        case _SC_LEVEL3_CACHE_SIZE:         return t->l3.size;
+        case _SC_LEVEL3_CACHE_ASSOC:        return t->l3.associativity;
+        case _SC_LEVEL3_CACHE_LINESIZE:     return t->l3.line_size;
+        case _SC_ALLOCATION_GRANULARITY:    return t->allocation_granularity;
+        case _SC_LARGE_PAGESIZE:            return t->large_page_size;
+    }
+    if(&sysconf) {
         return sysconf(name);
     }
     errno = EINVAL;
     return -1;
 }
 
+// The C entry points go straight to `TraverseInPlace`: no std::function, no heap.
+
 void memmap_traverse_addresses_from_to(void* lower, void* upper, memmap_range_visitor visitor, memmap_range_predicate predicate) {
-    mem::Traverse({lower, upper}, CPPize(visitor), CPPize(predicate));
+    mem::TraverseInPlace({lower, upper}, Visit{visitor}, Test{predicate});
 }
 
 void memmap_traverse_addresses_from_for(void* base, size_t size, memmap_range_visitor visitor, memmap_range_predicate predicate) {
-    mem::Traverse(mem::Range(base, size), CPPize(visitor), CPPize(predicate));
+    mem::TraverseInPlace(mem::Range(base, size), Visit{visitor}, Test{predicate});
 }
 
 void memmap_traverse_committed_from_to(void* lower, void* upper, memmap_range_visitor visitor) {
-    mem::Traverse({lower, upper}, CPPize(visitor));
+    mem::TraverseInPlace({lower, upper}, Visit{visitor}, &mem::Committed);
 }
 
 void memmap_traverse_committed_from_for(void* base, size_t size, memmap_range_visitor visitor) {
-    mem::Traverse(mem::Range(base, size), CPPize(visitor));
+    mem::TraverseInPlace(mem::Range(base, size), Visit{visitor}, &mem::Committed);
 }
 
 void memmap_traverse_all_process_memory(memmap_range_visitor visitor, memmap_range_predicate predicate) {
-    mem::TraverseAllProcessMemory(CPPize(visitor), CPPize(predicate));
+    mem::TraverseInPlace(mem::ProcessRange(), Visit{visitor}, Test{predicate});
 }
 
 int mincore(void* start, size_t length, unsigned char* status) {
     int retval = 0;
-    SYSTEM_INFO si;
-    GetSystemInfo(&si);
-    long page_size = si.dwPageSize;
+    const memmap_topology* t = memmap_topology_get();
+    long page_size = t->page_size;
 
     uintptr_t start_address = (uintptr_t) start;
     uintptr_t last_address = start_address + length;
@@ -131,7 +158,7 @@ int mincore(void* start, size_t length, unsigned char* status) {
         }
     }
 
-    if(_mincore_strict_policy && (last_address > (uintptr_t)si.lpMaximumApplicationAddress)) {
+    if(_mincore_strict_policy && (last_address > (uintptr_t)t->max_address)) {
         errno = ENOMEM;
         retval = -1;
     }
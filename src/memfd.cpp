@@ -0,0 +1,230 @@
+#include "sys/mman.h"
+#include "memmap/memfd.h"
+
+#include "memfd.h"
+#include "handles.h"
+#include "view.h"
+#include "sync.h"
+#include "dbg.h" // tracing
+
+#include <windows.h>
+#include <io.h> // _open_osfhandle
+#include <fcntl.h> // _O_NOINHERIT
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+
+namespace {
+
+constexpr uint64_t kDefaultMaxSize = (sizeof(void*) > 4) ? (uint64_t)1 << 30 : (uint64_t)256 << 20;
+constexpr size_t kMaxName = 249; // Linux: NAME_MAX less the "memfd:" prefix
+constexpr ULONG kSecFile = 0x800000; // SEC_FILE: the section maps a file, not the page file
+
+/* Resolved from ntdll.dll: there is no import library for it. */
+struct SectionBasicInformation {
+    PVOID base;
+    ULONG attributes; // SEC_*
+    LARGE_INTEGER size;
+};
+
+typedef LONG (NTAPI *NtQuerySectionFunc)(HANDLE section, int info_class, PVOID info, SIZE_T length, PSIZE_T result);
+
+struct Functions {
+    NtQuerySectionFunc nt_query_section = nullptr;
+
+    Functions() {
+        if(HMODULE ntdll = GetModuleHandleW(L"ntdll.dll")) {
+            nt_query_section = (NtQuerySectionFunc)(void*)GetProcAddress(ntdll, "NtQuerySection");
+        }
+    }
+};
+
+const Functions& Api() {
+    static const Functions api;
+    return api;
+}
+
+struct Memfd {
+    HANDLE duplicate;   // ours, of the placeholder behind the fd: it tells when the fd is closed
+    HANDLE section;
+    uint64_t max_size;
+    uint64_t size;      // bytes committed by `memmap_ftruncate`, or `max_size` if unknown
+};
+
+/* The maximum size of a page file section, or 0 if `section` is something else. */
+uint64_t MaxSize(HANDLE section) {
+    if(!Api().nt_query_section) return 0;
+    SectionBasicInformation info;
+    if(Api().nt_query_section(section, 0 /*SectionBasicInformation*/, &info, sizeof(info), nullptr) < 0) return 0;
+    return (info.attributes & kSecFile) ? 0 : info.size.QuadPart;
+}
+
+void Release(const Memfd& memfd) {
+    _MEMMAP_LOG("memfd: releasing %p", memfd.section);
+    CloseHandle(memfd.duplicate);
+    CloseHandle(memfd.section); // views keep it alive
+}
+
+/* By the placeholder behind the fd (see handles.h). */
+SRWLOCK _memfds_lock = SRWLOCK_INIT;
+mem::handles::Registry<Memfd, &Release> _memfds;
+
+/* Wraps `section` (which the new memfd takes over) in an fd. Returns the fd, or -1 and `errno`. */
+int Register(HANDLE section, uint64_t max_size, uint64_t size, unsigned flags) {
+    SECURITY_ATTRIBUTES sa;
+    sa.nLength = sizeof(sa);
+    sa.lpSecurityDescriptor = nullptr;
+    sa.bInheritHandle = !(flags & MFD_CLOEXEC);
+    // no access: reads and writes fail rather than going to the NUL device
+    HANDLE placeholder = CreateFileW(L"NUL", 0, FILE_SHARE_READ | FILE_SHARE_WRITE, &sa, OPEN_EXISTING, 0, nullptr);
+    if(placeholder == INVALID_HANDLE_VALUE) {
+        CloseHandle(section);
+        return errno = EMFILE, -1;
+    }
+    Memfd memfd = {nullptr, section, max_size, size};
+    if(!DuplicateHandle(GetCurrentProcess(), placeholder, GetCurrentProcess(), &memfd.duplicate, 0, FALSE, DUPLICATE_SAME_ACCESS)) {
+        CloseHandle(placeholder);
+        CloseHandle(section);
+        return errno = EMFILE, -1;
+    }
+
+    mem::ExclusiveLock guard(_memfds_lock);
+    _memfds.Sweep(); // closed memfds are noticed here (and by `memmap_ftruncate`)
+    const int fd = _open_osfhandle((intptr_t)placeholder, (flags & MFD_CLOEXEC) ? _O_NOINHERIT : 0);
+    if(fd < 0) {
+        CloseHandle(placeholder);
+        Release(memfd);
+        return errno = EMFILE, -1;
+    }
+    if(!_memfds.Insert(placeholder, memfd)) {
+        _close(fd);
+        Release(memfd);
+        return errno = ENOMEM, -1;
+    }
+    _MEMMAP_LOG("memfd: fd %d, section %p (max %llx)", fd, section, (unsigned long long)max_size);
+    return fd;
+}
+
+/* Zeroes the committed pages of [from, to); the memory cannot be decommitted through a view. */
+void Zero(HANDLE section, uint64_t from, uint64_t to) {
+    const size_t padding = mem::view::Padding(from);
+    char* data = (char*)mem::view::Map(section, from, (size_t)(to - from), FILE_MAP_WRITE, 0);
+    if(!data) return;
+    char* const end = data + (to - from);
+    for(char* at = data; at < end;) {
+        MEMORY_BASIC_INFORMATION mbi;
+        if(!VirtualQuery(at, &mbi, sizeof(mbi))) break;
+        char* const next = std::min(end, (char*)mbi.BaseAddress + mbi.RegionSize);
+        if(mbi.State == MEM_COMMIT) memset(at, 0, next - at);
+        at = next;
+    }
+    UnmapViewOfFile(data - padding);
+}
+
+int Resize(Memfd& memfd, uint64_t length) {
+    if(length > memfd.max_size) return errno = EFBIG, -1;
+    if(length) {
+        // committing the pages of a view commits them in the section; the committed ones stay as they are
+        char* data = (char*)MapViewOfFile(memfd.section, FILE_MAP_WRITE, 0, 0, (SIZE_T)length);
+        const bool committed = data && VirtualAlloc(data, (SIZE_T)length, MEM_COMMIT, PAGE_READWRITE);
+        if(data) UnmapViewOfFile(data);
+        if(!committed) return errno = ENOMEM, -1;
+    }
+    if(length < memfd.size) Zero(memfd.section, length, memfd.size);
+    _MEMMAP_LOG("memfd: %p resized from %llx to %llx", memfd.section,
+                (unsigned long long)memfd.size, (unsigned long long)length);
+    memfd.size = length;
+    return 0;
+}
+
+int TruncateFile(HANDLE file, uint64_t length) {
+    FILE_END_OF_FILE_INFO eof;
+    eof.EndOfFile.QuadPart = length;
+    if(SetFileInformationByHandle(file, FileEndOfFileInfo, &eof, sizeof(eof))) return 0;
+    switch(GetLastError()) {
+    case ERROR_ACCESS_DENIED:
+    case ERROR_INVALID_HANDLE:
+        return errno = EBADF, -1;
+    case ERROR_DISK_FULL:
+    case ERROR_HANDLE_DISK_FULL:
+        return errno = ENOSPC, -1;
+    default:
+        return errno = EIO, -1;
+    }
+}
+
+} // anonymous
+
+namespace mem {
+namespace memfd {
+
+HANDLE Section(HANDLE hfile) {
+    mem::SharedLock guard(_memfds_lock);
+    if(_memfds.Empty()) return nullptr;
+    const Memfd* memfd = _memfds.Find(hfile);
+    HANDLE section = nullptr;
+    if(memfd) {
+        DuplicateHandle(GetCurrentProcess(), memfd->section, GetCurrentProcess(), &section, 0, FALSE, DUPLICATE_SAME_ACCESS);
+    }
+    return section;
+}
+
+} // namespace memfd
+} // namespace mem
+
+extern "C" {
+
+int memfd_create(const char* name, unsigned flags) {
+    return memmap_memfd_create(name, flags, 0);
+}
+
+int memmap_memfd_create(const char* name, unsigned flags, uint64_t max_size) {
+    if(!name) return errno = EFAULT, -1;
+    if(strlen(name) > kMaxName || (flags & ~MFD_CLOEXEC)) return errno = EINVAL, -1; // no sealing, no huge pages
+    if(!max_size) max_size = kDefaultMaxSize;
+
+    SECURITY_ATTRIBUTES sa;
+    sa.nLength = sizeof(sa);
+    sa.lpSecurityDescriptor = nullptr;
+    sa.bInheritHandle = !(flags & MFD_CLOEXEC);
+    // executable, so that views may be too (FILE_MAP_EXECUTE needs it); the pages are committed PAGE_READWRITE
+    const DWORD protection = PAGE_EXECUTE_READWRITE | SEC_RESERVE;
+    _MEMMAP_LOG("memfd: \"%s\", CreateFileMappingW(page file, 0x%lx, %llx)", name, protection, (unsigned long long)max_size);
+    HANDLE section = CreateFileMappingW(INVALID_HANDLE_VALUE, &sa, protection,
+                                        (DWORD)(max_size >> 32), (DWORD)max_size, nullptr /*unnamed*/);
+    if(!section) return errno = ENOMEM, -1;
+    return Register(section, max_size, 0, flags);
+}
+
+int memmap_ftruncate(int fd, off64_t length) {
+    if(length < 0) return errno = EINVAL, -1;
+    HANDLE hfile = mem::view::FileHandle(fd);
+    if(hfile == INVALID_HANDLE_VALUE) return errno = EBADF, -1;
+    {
+        mem::ExclusiveLock guard(_memfds_lock);
+        _memfds.Sweep();
+        if(Memfd* memfd = _memfds.Find(hfile)) return Resize(*memfd, length);
+    }
+    return TruncateFile(hfile, length);
+}
+
+HANDLE memmap_memfd_section(int fd) {
+    HANDLE hfile = mem::view::FileHandle(fd);
+    mem::SharedLock guard(_memfds_lock);
+    const Memfd* memfd = (hfile != INVALID_HANDLE_VALUE) ? _memfds.Find(hfile) : nullptr;
+    return memfd ? memfd->section : (errno = EBADF, nullptr);
+}
+
+int memmap_memfd_open(HANDLE section, unsigned flags) {
+    if(flags & ~MFD_CLOEXEC) return errno = EINVAL, -1;
+    const uint64_t max_size = MaxSize(section);
+    if(!max_size) return errno = EINVAL, -1;
+    HANDLE own;
+    if(!DuplicateHandle(GetCurrentProcess(), section, GetCurrentProcess(), &own, 0, !(flags & MFD_CLOEXEC), DUPLICATE_SAME_ACCESS)) {
+        return errno = EBADF, -1;
+    }
+    return Register(own, max_size, max_size, flags); // the other side's size is unknown here
+}
+
+} // extern "C"
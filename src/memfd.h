@@ -0,0 +1,20 @@
+#ifndef _MEMMAP_SRC_MEMFD_H_
+#define _MEMMAP_SRC_MEMFD_H_
+
+#include <windows.h>
+
+/* The memfd registry, consulted by the file-view path of `mmap` (see memmap/memfd.h) */
+
+namespace mem {
+namespace memfd {
+
+/**
+ * A new handle to the section of the memfd whose placeholder is `hfile`, to be
+ * closed by the caller; nullptr if `hfile` is not a memfd placeholder.
+ */
+HANDLE Section(HANDLE hfile);
+
+} // namespace memfd
+} // namespace mem
+
+#endif /* _MEMMAP_SRC_MEMFD_H_ */
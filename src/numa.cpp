@@ -0,0 +1,260 @@
+#include "sys/mman.h"
+#include "numaif.h"
+#include "memmap/conf.h"
+#include "memmap/proc.h"
+#include "memmap/iter.h"
+
+#include "numa.h"
+#include "recycle.h"
+#include "dbg.h" // tracing
+
+#include <windows.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+/**
+ * Process policy. Like the rest of the configuration, it is expected to be set at
+ * startup; only the interleave cursor is touched concurrently.
+ */
+int _numa_mode = MPOL_DEFAULT;
+DWORD _numa_preferred = NUMA_NO_PREFERRED_NODE;
+uint64_t _numa_interleave = 0; // node mask
+std::atomic<unsigned> _numa_cursor{0};
+
+constexpr unsigned kMaxNodes = 64;
+constexpr unsigned kBitsPerWord = 8 * sizeof(unsigned long);
+
+constexpr size_t kMigrationChunk = 1 << 20;
+
+uint64_t AllNodes() {
+    const unsigned count = mem::numa::NodeCount();
+    return count >= kMaxNodes ? ~uint64_t(0) : (uint64_t(1) << count) - 1;
+}
+
+/* Linux nodemasks are arrays of `unsigned long` with `maxnode` significant bits. */
+uint64_t ParseNodemask(const unsigned long* nodemask, unsigned long maxnode) {
+    uint64_t mask = 0;
+    for(unsigned long node = 0; nodemask && node < std::min<unsigned long>(maxnode, kMaxNodes); ++node) {
+        if(nodemask[node / kBitsPerWord] & (1ul << (node % kBitsPerWord))) {
+            mask |= uint64_t(1) << node;
+        }
+    }
+    return mask & AllNodes();
+}
+
+DWORD LowestNode(uint64_t mask) {
+    for(DWORD node = 0; node < kMaxNodes; ++node) {
+        if(mask & (uint64_t(1) << node)) return node;
+    }
+    return NUMA_NO_PREFERRED_NODE;
+}
+
+/* The n-th set bit of a nonempty mask, wrapping around. */
+DWORD NthNode(uint64_t mask, unsigned n) {
+    unsigned bits = 0;
+    for(uint64_t m = mask; m; m &= m - 1) ++bits;
+    n %= bits;
+    for(DWORD node = 0;; ++node) {
+        if((mask & (uint64_t(1) << node)) && !n--) return node;
+    }
+}
+
+enum class Migration { MOVED, STAYED, LOST };
+
+/**
+ * Copies committed private pages out, recommits them on `node` (or anywhere, if the node refuses) and copies them back.
+ * Windows cannot commit new pages at the address of live ones: if nothing can be committed in between
+ * (out of commit charge), the contents are LOST and the pages left decommitted.
+ */
+Migration Migrate(char* lower, size_t size, DWORD protection, DWORD node, void* bounce) {
+    HANDLE self = GetCurrentProcess();
+    DWORD ignored;
+    if(!(protection & (PAGE_READONLY | PAGE_READWRITE | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE))) {
+        return Migration::STAYED; // unreadable (or copy-on-write view) pages stay where they are
+    }
+    memcpy(bounce, lower, size);
+    _MEMMAP_LOG("VirtualAllocExNuma(%p, %lx, MEM_COMMIT, %lx, %lu) [migrate]", lower, (DWORD)size, protection, node);
+    if(!VirtualFree(lower, size, MEM_DECOMMIT)) return Migration::STAYED; // nothing happened
+    const bool moved = VirtualAllocExNuma(self, lower, size, MEM_COMMIT, PAGE_READWRITE, node);
+    if(!moved && !VirtualAlloc(lower, size, MEM_COMMIT, PAGE_READWRITE)) {
+        _MEMMAP_LOG("%p..%p lost in migration", lower, lower + size); // nothing to copy into
+        return Migration::LOST;
+    }
+    memcpy(lower, bounce, size); // on the node, or back wherever the system puts it
+    const bool restored = protection == PAGE_READWRITE || VirtualProtect(lower, size, protection, &ignored);
+    return (restored && moved) ? Migration::MOVED : Migration::STAYED;
+}
+
+} // anonymous
+
+namespace mem {
+namespace numa {
+
+unsigned NodeCount() {
+    return memmap_topology_get()->numa_nodes;
+}
+
+bool Placed(int flags) {
+    return (flags & __MAP_NUMA_MASK) || _numa_mode != MPOL_DEFAULT;
+}
+
+DWORD NodeFor(int flags) {
+    if(flags & __MAP_NUMA_MASK) {
+        const DWORD node = ((flags & __MAP_NUMA_MASK) >> __MAP_NUMA_SHIFT) - 1;
+        return (node < NodeCount()) ? node : NUMA_NO_PREFERRED_NODE; // a hint, as with set_mmap_numa_policy
+    }
+    switch(_numa_mode) {
+        case MPOL_PREFERRED:
+        case MPOL_BIND:
+            return _numa_preferred;
+        case MPOL_INTERLEAVE:
+            return NthNode(_numa_interleave, _numa_cursor++);
+        default:
+            return NUMA_NO_PREFERRED_NODE;
+    }
+}
+
+void* Alloc(void* addr, size_t length, DWORD vm_request, DWORD protection, int flags) {
+    HANDLE self = GetCurrentProcess();
+    const size_t granule = get_allocation_granularity();
+    const bool interleave = !(flags & __MAP_NUMA_MASK) && _numa_mode == MPOL_INTERLEAVE
+        && !(vm_request & MEM_LARGE_PAGES) && length > granule;
+    if(!interleave) {
+        const DWORD node = NodeFor(flags);
+        _MEMMAP_LOG("VirtualAllocExNuma(%p, %lx, %lx, %lx, %lu)", addr, (DWORD)length, vm_request, protection, node);
+        return VirtualAllocExNuma(self, addr, length, vm_request, protection, node);
+    }
+
+    char* base = (char*)VirtualAlloc(addr, length, MEM_RESERVE, protection);
+    if(!base) return nullptr;
+    const unsigned first = _numa_cursor++;
+    for(size_t offset = 0, chunk = 0; offset < length; offset += granule, ++chunk) {
+        const size_t size = std::min(granule, length - offset);
+        const DWORD node = NthNode(_numa_interleave, first + chunk);
+        if(!VirtualAllocExNuma(self, base + offset, size, MEM_COMMIT, protection, node)) {
+            VirtualFree(base, 0, MEM_RELEASE);
+            return nullptr;
+        }
+    }
+    _MEMMAP_LOG("interleaved %p (%lx bytes) from node #%u", base, (DWORD)length, first);
+    return base;
+}
+
+} // namespace numa
+} // namespace mem
+
+extern "C" {
+
+void set_mmap_numa_policy(enum mmap_numa_policy policy, int node) {
+    switch(policy) {
+        case mmap_numa_policy__preferred:
+            _numa_preferred = (node >= 0 && (unsigned)node < mem::numa::NodeCount()) ? node : NUMA_NO_PREFERRED_NODE;
+            _numa_mode = (_numa_preferred == NUMA_NO_PREFERRED_NODE) ? MPOL_DEFAULT : MPOL_PREFERRED;
+            break;
+        case mmap_numa_policy__interleave:
+            _numa_interleave = AllNodes();
+            _numa_mode = MPOL_INTERLEAVE;
+            break;
+        default:
+            _numa_mode = MPOL_DEFAULT;
+    }
+}
+
+long set_mempolicy(int mode, const unsigned long* nodemask, unsigned long maxnode) {
+    const uint64_t mask = ParseNodemask(nodemask, maxnode);
+    switch(mode) {
+        case MPOL_DEFAULT:
+        case MPOL_LOCAL:
+            _numa_mode = MPOL_DEFAULT;
+            return 0;
+        case MPOL_PREFERRED:
+        case MPOL_BIND:
+            if(!mask) { // Linux: an empty MPOL_PREFERRED mask means "local"
+                _numa_mode = MPOL_DEFAULT;
+                return mode == MPOL_PREFERRED ? 0 : (errno = EINVAL, -1);
+            }
+            _numa_preferred = LowestNode(mask);
+            _numa_mode = mode;
+            return 0;
+        case MPOL_INTERLEAVE:
+            if(!mask) return errno = EINVAL, -1;
+            _numa_interleave = mask;
+            _numa_mode = mode;
+            return 0;
+        default:
+            return errno = EINVAL, -1;
+    }
+}
+
+long get_mempolicy(int* mode, unsigned long* nodemask, unsigned long maxnode, void* addr, unsigned long flags) {
+    if(addr || flags) return errno = EINVAL, -1;
+    if(mode) *mode = _numa_mode;
+    if(nodemask) {
+        const uint64_t mask = (_numa_mode == MPOL_INTERLEAVE) ? _numa_interleave
+                            : (_numa_mode == MPOL_DEFAULT) ? 0 : uint64_t(1) << _numa_preferred;
+        memset(nodemask, 0, (maxnode + kBitsPerWord - 1) / kBitsPerWord * sizeof(unsigned long));
+        for(unsigned long node = 0; node < std::min<unsigned long>(maxnode, kMaxNodes); ++node) {
+            if(mask & (uint64_t(1) << node)) nodemask[node / kBitsPerWord] |= 1ul << (node % kBitsPerWord);
+        }
+    }
+    return 0;
+}
+
+long mbind(void* addr, unsigned long len, int mode, const unsigned long* nodemask, unsigned long maxnode, unsigned flags) {
+    const uintptr_t page_size = getpagesize();
+    if((uintptr_t)addr % page_size || (flags & ~(MPOL_MF_STRICT | MPOL_MF_MOVE | MPOL_MF_MOVE_ALL))) {
+        return errno = EINVAL, -1;
+    }
+    uint64_t mask = ParseNodemask(nodemask, maxnode);
+    switch(mode) {
+        case MPOL_DEFAULT:
+        case MPOL_LOCAL:
+            return 0; // nothing to undo: Windows keeps no per-range policy
+        case MPOL_PREFERRED:
+        case MPOL_BIND:
+            if(mask) mask = uint64_t(1) << LowestNode(mask);
+            // fallthrough
+        case MPOL_INTERLEAVE:
+            if(!mask) return errno = EINVAL, -1;
+            break;
+        default:
+            return errno = EINVAL, -1;
+    }
+    if(!(flags & (MPOL_MF_MOVE | MPOL_MF_MOVE_ALL))) return 0;
+
+    void* bounce = VirtualAlloc(nullptr, kMigrationChunk, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if(!bounce) return errno = ENOMEM, -1;
+
+    const size_t granule = get_allocation_granularity();
+    bool misplaced = false, lost = false;
+    unsigned chunk = 0;
+    mem::Traverse(mem::Range(addr, len), [&](const MEMORY_BASIC_INFORMATION& mbi, const MEMMAP_RANGE& range) {
+        if(lost || mbi.State != MEM_COMMIT) return; // reserved pages have nothing to place yet
+        if(mbi.Type != MEM_PRIVATE || (mbi.Protect & PAGE_GUARD)) {
+            misplaced = true;
+            return;
+        }
+        bool moved = false;
+        for(char* lower = (char*)range.lower; lower < (char*)range.upper && !lost;) {
+            // interleaving granule by granule; single nodes in bounce-buffer-sized steps
+            const size_t step = (mode == MPOL_INTERLEAVE) ? granule - (uintptr_t)lower % granule : kMigrationChunk;
+            const size_t size = std::min<size_t>(step, (char*)range.upper - lower);
+            const Migration outcome = Migrate(lower, size, mbi.Protect, NthNode(mask, chunk++), bounce);
+            misplaced |= outcome != Migration::MOVED;
+            moved |= outcome == Migration::MOVED;
+            lost = outcome == Migration::LOST; // out of commit charge: stop before losing more
+            lower += size;
+        }
+        if(moved) mem::recycle::Exclude(mbi.AllocationBase); // placed now: not for a plain `mmap`
+    });
+    VirtualFree(bounce, 0, MEM_RELEASE);
+    if(lost) return errno = ENOMEM, -1; // whatever the flags: the caller must know
+    return (misplaced && (flags & MPOL_MF_STRICT)) ? (errno = EIO, -1) : 0;
+}
+
+} // extern "C"
@@ -0,0 +1,30 @@
+#ifndef _MEMMAP_SRC_NUMA_H_
+#define _MEMMAP_SRC_NUMA_H_
+
+#include <windows.h>
+#include <stddef.h>
+
+/* NUMA placement of new mappings (see numaif.h and `set_mmap_numa_policy`) */
+
+namespace mem {
+namespace numa {
+
+/* Highest node number + 1; 1 on non-NUMA systems. */
+unsigned NodeCount();
+
+/* Whether a new mapping with these `mmap` flags needs NUMA-aware placement at all. */
+bool Placed(int flags);
+
+/* The node for a single-node allocation: MAP_NUMA_NODE (if the system has it), or the process policy. */
+DWORD NodeFor(int flags);
+
+/**
+ * VirtualAlloc honoring `flags` and the process policy. Interleaved allocations are
+ * reserved at once and committed granule by granule on alternating nodes.
+ */
+void* Alloc(void* addr, size_t length, DWORD vm_request, DWORD protection, int flags);
+
+} // namespace numa
+} // namespace mem
+
+#endif /* _MEMMAP_SRC_NUMA_H_ */
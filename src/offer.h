@@ -0,0 +1,25 @@
+#ifndef _MEMMAP_SRC_OFFER_H_
+#define _MEMMAP_SRC_OFFER_H_
+
+#include <windows.h>
+
+/* Memory offer and discard API (Windows 8.1+), weakly linked for older SDKs and systems. */
+
+extern "C" {
+
+#if _WIN32_WINNT < _WIN32_WINNT_WINBLUE
+  typedef enum _OFFER_PRIORITY {
+    VmOfferPriorityVeryLow = 1,
+    VmOfferPriorityLow,
+    VmOfferPriorityBelowNormal,
+    VmOfferPriorityNormal
+  } OFFER_PRIORITY;
+
+  /* WINBASEAPI */ DWORD WINAPI DiscardVirtualMemory (PVOID VirtualAddress, SIZE_T Size) __attribute((weak));
+  /* WINBASEAPI */ DWORD WINAPI OfferVirtualMemory (PVOID VirtualAddress, SIZE_T Size, OFFER_PRIORITY Priority) __attribute((weak));
+  /* WINBASEAPI */ DWORD WINAPI ReclaimVirtualMemory (PVOID VirtualAddress, SIZE_T Size) __attribute((weak));
+#endif
+
+} // extern "C"
+
+#endif /* _MEMMAP_SRC_OFFER_H_ */
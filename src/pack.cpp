@@ -0,0 +1,148 @@
+#include "sys/mman.h"
+#include "memmap/conf.h"
+#include "memmap/proc.h"
+
+#include "pack.h"
+#include "sync.h"
+#include "dbg.h" // tracing
+
+#include <windows.h>
+#include <stdint.h>
+#include <algorithm>
+#include <map>
+#include <set>
+
+namespace {
+
+/**
+ * VirtualAlloc reserves address space in allocation granularity units (64 KiB),
+ * so a one-page anonymous mapping wastes 15/16 of its reservation. The packer
+ * reserves whole granules ("arenas") and commits individual runs of pages in them.
+ * A 64-bit mask tracks the committed pages of an arena, which limits the packer to
+ * granularity/page size <= 64; that holds for every Windows platform we know of.
+ */
+struct Arena {
+    uint64_t used = 0; // bit N => page N is handed out
+};
+
+SRWLOCK _pack_lock = SRWLOCK_INIT;
+std::map<uintptr_t, Arena> _arenas; // by base address
+std::set<uintptr_t> _partial; // arenas with at least one free page, lowest address first
+volatile bool _pack_touched = false; // cheap bypass for `munmap` if the packer was never used
+
+size_t _pack_max_length = 0; // 0 => disabled
+size_t _pack_page_size = 0;
+size_t _pack_arena_size = 0;
+unsigned _pack_arena_pages = 0;
+
+uint64_t RunMask(unsigned first, unsigned count) {
+    return (count >= 64 ? ~uint64_t(0) : ((uint64_t(1) << count) - 1)) << first;
+}
+
+uint64_t FullMask() {
+    return RunMask(0, _pack_arena_pages);
+}
+
+/* First fit of `count` free pages; returns _pack_arena_pages if there is no room. */
+unsigned FindRun(uint64_t used, unsigned count) {
+    for(unsigned first = 0; first + count <= _pack_arena_pages; ++first) {
+        const uint64_t mask = RunMask(first, count);
+        if(!(used & mask)) return first;
+    }
+    return _pack_arena_pages;
+}
+
+} // anonymous
+
+namespace mem {
+namespace pack {
+
+void* Map(size_t length, DWORD protection) {
+    if(!length || length > _pack_max_length) return nullptr;
+    const unsigned count = (unsigned)(length / _pack_page_size);
+
+    ExclusiveLock guard(_pack_lock);
+    uintptr_t base = 0;
+    unsigned first = _pack_arena_pages;
+    for(uintptr_t candidate : _partial) {
+        first = FindRun(_arenas.find(candidate)->second.used, count);
+        if(first < _pack_arena_pages) {
+            base = candidate;
+            break;
+        }
+    }
+
+    const bool fresh = !base;
+    if(fresh) {
+        base = (uintptr_t)VirtualAlloc(nullptr, _pack_arena_size, MEM_RESERVE, PAGE_NOACCESS);
+        if(!base) return nullptr;
+        first = 0;
+    }
+
+    void* addr = (void*)(base + first * _pack_page_size);
+    _MEMMAP_LOG("VirtualAlloc(%p, %lx, MEM_COMMIT, %lx) [packed]", addr, (DWORD)length, protection);
+    if(!VirtualAlloc(addr, length, MEM_COMMIT, protection)) {
+        if(fresh) VirtualFree((void*)base, 0, MEM_RELEASE);
+        return nullptr;
+    }
+
+    Arena& arena = _arenas[base];
+    arena.used |= RunMask(first, count);
+    if(arena.used == FullMask()) {
+        _partial.erase(base);
+    } else {
+        _partial.insert(base);
+    }
+    _pack_touched = true;
+    return addr;
+}
+
+bool Unmap(void* addr, size_t length, bool trusted) {
+    if(!_pack_touched) return false;
+
+    const uintptr_t base = (uintptr_t)addr - (uintptr_t)addr % _pack_arena_size;
+    ExclusiveLock guard(_pack_lock);
+    auto found = _arenas.find(base);
+    if(found == _arenas.end()) return false;
+
+    const uintptr_t lower = (uintptr_t)addr - (uintptr_t)addr % _pack_page_size;
+    const uintptr_t limit = base + _pack_arena_size;
+    const uintptr_t upper = std::min(limit, (uintptr_t)addr + length + _pack_page_size - 1);
+    const unsigned first = (unsigned)((lower - base) / _pack_page_size);
+    const unsigned count = (unsigned)((upper - lower) / _pack_page_size);
+    if(!count) return true;
+
+    Arena& arena = found->second;
+    arena.used &= ~RunMask(first, count);
+    if(!trusted) {
+        // `_partial` and `_arenas` allocate: the free pages wait for the next `Unmap` of a neighbour
+        VirtualFree((void*)lower, count * _pack_page_size, MEM_DECOMMIT);
+    } else if(arena.used) {
+        VirtualFree((void*)lower, count * _pack_page_size, MEM_DECOMMIT);
+        _partial.insert(base);
+    } else {
+        _MEMMAP_LOG("VirtualFree(%p, 0, MEM_RELEASE) [packed arena]", (void*)base);
+        VirtualFree((void*)base, 0, MEM_RELEASE);
+        _partial.erase(base);
+        _arenas.erase(found);
+    }
+    return true;
+}
+
+} // namespace pack
+} // namespace mem
+
+extern "C" {
+
+void set_mmap_pack_small_anonymous(size_t max_length) {
+    _pack_page_size = getpagesize();
+    _pack_arena_size = get_allocation_granularity();
+    _pack_arena_pages = (unsigned)(_pack_arena_size / _pack_page_size);
+    if(_pack_arena_pages > 64 || _pack_arena_pages < 2) {
+        max_length = 0; // see `Arena`
+    }
+    const size_t cap = _pack_arena_size - _pack_page_size; // a full granule gains nothing
+    _pack_max_length = std::min(max_length, cap);
+}
+
+} // extern "C"
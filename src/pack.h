@@ -0,0 +1,30 @@
+#ifndef _MEMMAP_SRC_PACK_H_
+#define _MEMMAP_SRC_PACK_H_
+
+#include <windows.h>
+#include <stddef.h>
+
+/* Sub-granularity packing of small anonymous mappings (see `set_mmap_pack_small_anonymous`) */
+
+namespace mem {
+namespace pack {
+
+/**
+ * Commits `length` bytes (a multiple of the page size) in a shared reservation.
+ * Returns nullptr if packing is disabled, the request is too large or the system
+ * is out of memory; the caller is expected to fall back to a plain VirtualAlloc.
+ */
+void* Map(size_t length, DWORD protection);
+
+/**
+ * Decommits the pages of [addr, addr+length) if they belong to a packed reservation,
+ * and releases the reservation once its last page is gone. Returns false (and does
+ * nothing) for memory not managed by the packer. With `trusted` false (emergency mode)
+ * the bookkeeping is left as it is, since it allocates: the pages are only decommitted.
+ */
+bool Unmap(void* addr, size_t length, bool trusted);
+
+} // namespace pack
+} // namespace mem
+
+#endif /* _MEMMAP_SRC_PACK_H_ */
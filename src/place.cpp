@@ -0,0 +1,112 @@
+#include "sys/mman.h"
+#include "memmap/proc.h"
+
+#include "place.h"
+#include "view.h"
+#include "dbg.h" // tracing
+
+#include <windows.h>
+#include <errno.h>
+
+#ifndef MEM_RESERVE_PLACEHOLDER
+#define MEM_RESERVE_PLACEHOLDER 0x00040000
+#endif
+#ifndef MEM_REPLACE_PLACEHOLDER
+#define MEM_REPLACE_PLACEHOLDER 0x00004000
+#endif
+#ifndef MEM_PRESERVE_PLACEHOLDER
+#define MEM_PRESERVE_PLACEHOLDER 0x00000002
+#endif
+
+namespace {
+
+/**
+ * Resolved from kernelbase.dll rather than linked: MinGW import libraries predate
+ * these functions, and our baseline target does not have them at all.
+ * The extended parameters (MEM_EXTENDED_PARAMETER) are never used.
+ */
+typedef PVOID (WINAPI *VirtualAlloc2Func)(HANDLE process, PVOID base, SIZE_T size, ULONG type,
+                                         ULONG protection, void* params, ULONG param_count);
+typedef PVOID (WINAPI *MapViewOfFile3Func)(HANDLE section, HANDLE process, PVOID base, ULONG64 offset,
+                                          SIZE_T size, ULONG type, ULONG protection, void* params, ULONG param_count);
+
+struct Functions {
+    VirtualAlloc2Func virtual_alloc2 = nullptr;
+    MapViewOfFile3Func map_view_of_file3 = nullptr;
+
+    Functions() {
+        HMODULE kernelbase = GetModuleHandleW(L"kernelbase.dll");
+        if(!kernelbase) return;
+        virtual_alloc2 = (VirtualAlloc2Func)(void*)GetProcAddress(kernelbase, "VirtualAlloc2");
+        map_view_of_file3 = (MapViewOfFile3Func)(void*)GetProcAddress(kernelbase, "MapViewOfFile3");
+    }
+};
+
+const Functions& Api() {
+    static const Functions api;
+    return api;
+}
+
+} // anonymous
+
+namespace mem {
+namespace place {
+
+bool Carve(char* at, size_t size) {
+    MEMORY_BASIC_INFORMATION mbi;
+    if(!VirtualQuery(at, &mbi, sizeof(mbi)) || mbi.State != MEM_RESERVE) return false;
+    char* lower = (char*)mbi.BaseAddress;
+    char* upper = lower + mbi.RegionSize;
+    if(at + size > upper) return false;
+    if(lower < at && !VirtualFree(lower, at - lower, MEM_RELEASE | MEM_PRESERVE_PLACEHOLDER)) return false;
+    if(at + size < upper && !VirtualFree(at, size, MEM_RELEASE | MEM_PRESERVE_PLACEHOLDER)) return false;
+    return true;
+}
+
+bool Supported() {
+    return Api().virtual_alloc2 && Api().map_view_of_file3;
+}
+
+void* Reserve(size_t size) {
+    void* base = nullptr;
+    if(Supported()) {
+        _MEMMAP_LOG("VirtualAlloc2(%lx, MEM_RESERVE_PLACEHOLDER)", (DWORD)size);
+        base = Api().virtual_alloc2(nullptr, nullptr, size, MEM_RESERVE | MEM_RESERVE_PLACEHOLDER,
+                                    PAGE_NOACCESS, nullptr, 0);
+    } else if((base = VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS))) {
+        VirtualFree(base, 0, MEM_RELEASE); // remember the hole, leave it free
+    }
+    return base ? base : (errno = ENOMEM, nullptr);
+}
+
+void* Map(HANDLE section, uint64_t offset, size_t size, int prot, int flags, void* at) {
+    void* view = nullptr;
+    if(Supported()) {
+        const size_t page_size = getpagesize();
+        const size_t slot = (size + page_size - 1) / page_size * page_size; // a placeholder is whole pages
+        if(!Carve((char*)at, slot)) return errno = ENOMEM, nullptr;
+        _MEMMAP_LOG("MapViewOfFile3(%p, %llx, %lx, %p)", section, (unsigned long long)offset, (DWORD)size, at);
+        view = Api().map_view_of_file3(section, GetCurrentProcess(), at, offset, size, MEM_REPLACE_PLACEHOLDER,
+                                       view::Protection(prot, flags), nullptr, 0);
+    } else {
+        _MEMMAP_LOG("MapViewOfFileEx(%p, %llx, %lx, %p)", section, (unsigned long long)offset, (DWORD)size, at);
+        view = MapViewOfFileEx(section, view::Access(prot, flags), (DWORD)(offset >> 32), (DWORD)offset, size, at);
+    }
+    if(!view) {
+        _MEMMAP_LOG("placed view GetLastError()=%lx", GetLastError());
+        return errno = ENOMEM, nullptr;
+    }
+    return view;
+}
+
+void Release(void* at, size_t size) {
+    if(!Supported()) return; // nothing is held
+    MEMORY_BASIC_INFORMATION mbi;
+    for(char* lower = (char*)at; lower < (char*)at + size; lower = (char*)mbi.BaseAddress + mbi.RegionSize) {
+        if(!VirtualQuery(lower, &mbi, sizeof(mbi))) break;
+        if(mbi.State == MEM_RESERVE) VirtualFree(mbi.BaseAddress, 0, MEM_RELEASE);
+    }
+}
+
+} // namespace place
+} // namespace mem
@@ -0,0 +1,43 @@
+#ifndef _MEMMAP_SRC_PLACE_H_
+#define _MEMMAP_SRC_PLACE_H_
+
+#include <windows.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Placeholder reservations: address ranges that file views can later be mapped into,
+ * piece by piece, without anybody else taking the addresses meanwhile. Built on
+ * VirtualAlloc2 and MapViewOfFile3 (Windows 10 1803+), looked up at run time.
+ * Older systems get a best-effort emulation: a free range is found but not held,
+ * and views are mapped at fixed addresses in it as long as they are still free.
+ */
+
+namespace mem {
+namespace place {
+
+/* Whether VirtualAlloc2 and MapViewOfFile3 are available. */
+bool Supported();
+
+/* Reserves `size` bytes (a multiple of the allocation granularity). nullptr and `errno` on failure. */
+void* Reserve(size_t size);
+
+/**
+ * Maps [offset, offset+size) of `section` at `at` (all three granularity aligned,
+ * but `size` may end mid-page for the last view), carving [at, at+size) rounded up
+ * to whole pages out of the placeholder that contains it. `prot` and `flags`
+ * are those of `mmap`. Returns nullptr and sets `errno` on failure; the placeholder
+ * is left split but intact.
+ */
+void* Map(HANDLE section, uint64_t offset, size_t size, int prot, int flags, void* at);
+
+/* Splits the placeholder containing [at, at+size) so that the range is a placeholder of its own. */
+bool Carve(char* at, size_t size);
+
+/* Releases what is left of a reservation: the placeholders within [at, at+size). */
+void Release(void* at, size_t size);
+
+} // namespace place
+} // namespace mem
+
+#endif /* _MEMMAP_SRC_PLACE_H_ */
@@ -0,0 +1,165 @@
+#include "sys/mman.h"
+#include "memmap/pressure.h"
+
+#include "sync.h"
+#include "dbg.h" // tracing
+
+#include <windows.h>
+#include <errno.h>
+#include <algorithm>
+#include <new>
+#include <vector>
+
+namespace {
+
+/**
+ * The notifications are level-triggered: each stays signaled as long as its condition
+ * holds. The watcher therefore waits only for the levels it is not at; the way back
+ * to normal signals nothing and is polled for.
+ */
+constexpr DWORD kPollMs = 1000;
+
+struct Subscriber {
+    int id;
+    memmap_pressure_callback callback;
+    void* ctx;
+};
+
+struct Region {
+    void* addr;
+    size_t length;
+};
+
+SRWLOCK _lock = SRWLOCK_INIT;     // guards the lists below
+SRWLOCK _dispatch = SRWLOCK_INIT; // held by the watcher while it acts on a transition
+std::vector<Subscriber> _subscribers;
+std::vector<Region> _regions;
+int _last_id = 0;
+
+HANDLE _low = nullptr;
+HANDLE _high = nullptr;
+HANDLE _watcher = nullptr;
+DWORD _watcher_id = 0;
+
+memmap_pressure_level Query() {
+    BOOL state = FALSE;
+    if(_low && QueryMemoryResourceNotification(_low, &state) && state) return memmap_pressure__low;
+    if(_high && QueryMemoryResourceNotification(_high, &state) && state) return memmap_pressure__high;
+    return memmap_pressure__normal;
+}
+
+/* Acts on a transition: releases offered regions (on low), then tells the subscribers. */
+void Dispatch(memmap_pressure_level level) {
+    mem::ExclusiveLock dispatching(_dispatch);
+    std::vector<Subscriber> subscribers;
+    std::vector<Region> regions;
+    {
+        mem::SharedLock guard(_lock);
+        subscribers = _subscribers;
+        if(level == memmap_pressure__low) regions = _regions;
+    }
+    for(const Region& region : regions) {
+        _MEMMAP_LOG("pressure: releasing %p (%lx bytes)", region.addr, (DWORD)region.length);
+        madvise(region.addr, region.length, MADV_DONTNEED);
+    }
+    for(const Subscriber& subscriber : subscribers) {
+        subscriber.callback(level, subscriber.ctx);
+    }
+}
+
+DWORD WINAPI Watcher(LPVOID) {
+    memmap_pressure_level level = memmap_pressure__normal; // so that a level other than normal is reported at once
+    for(;;) {
+        HANDLE handles[2];
+        DWORD count = 0;
+        if(level != memmap_pressure__low) handles[count++] = _low;
+        if(level != memmap_pressure__high) handles[count++] = _high;
+        WaitForMultipleObjects(count, handles, FALSE, level == memmap_pressure__normal ? INFINITE : kPollMs);
+        const memmap_pressure_level now = Query();
+        if(now == level) continue;
+        _MEMMAP_LOG("pressure: level %d -> %d", (int)level, (int)now);
+        level = now;
+        Dispatch(level);
+    }
+    return 0;
+}
+
+/* Starts the watcher on first use. Call with `_lock` held exclusively. */
+bool Start() {
+    if(_watcher) return true;
+    if(!_low) _low = CreateMemoryResourceNotification(LowMemoryResourceNotification);
+    if(!_high) _high = CreateMemoryResourceNotification(HighMemoryResourceNotification);
+    if(!_low || !_high) return false;
+    _watcher = CreateThread(nullptr, 0, &Watcher, nullptr, 0, &_watcher_id);
+    if(_watcher) SetThreadPriority(_watcher, THREAD_PRIORITY_ABOVE_NORMAL); // shrinking is urgent
+    return _watcher;
+}
+
+/* Waits for an in-flight transition to be handled, unless called from its handler. */
+void Settle() {
+    if(GetCurrentThreadId() == _watcher_id) return;
+    mem::ExclusiveLock settled(_dispatch);
+}
+
+} // anonymous
+
+extern "C" {
+
+int memmap_on_pressure(memmap_pressure_callback callback, void* ctx) {
+    if(!callback) return errno = EINVAL, -1;
+    mem::ExclusiveLock guard(_lock);
+    if(!Start()) return errno = EAGAIN, -1;
+    try {
+        _subscribers.push_back({++_last_id, callback, ctx});
+    } catch(const std::bad_alloc&) {
+        return errno = ENOMEM, -1;
+    }
+    return _last_id;
+}
+
+int memmap_pressure_unsubscribe(int id) {
+    {
+        mem::ExclusiveLock guard(_lock);
+        auto found = std::find_if(_subscribers.begin(), _subscribers.end(),
+                                  [id](const Subscriber& s) { return s.id == id; });
+        if(found == _subscribers.end()) return errno = EINVAL, -1;
+        _subscribers.erase(found);
+    }
+    Settle();
+    return 0;
+}
+
+enum memmap_pressure_level memmap_pressure_current(void) {
+    {
+        mem::ExclusiveLock guard(_lock);
+        if(!_low) _low = CreateMemoryResourceNotification(LowMemoryResourceNotification);
+        if(!_high) _high = CreateMemoryResourceNotification(HighMemoryResourceNotification);
+    }
+    return Query();
+}
+
+int memmap_pressure_offer(void* addr, size_t length) {
+    if(!addr || !length) return errno = EINVAL, -1;
+    mem::ExclusiveLock guard(_lock);
+    if(!Start()) return errno = EAGAIN, -1;
+    try {
+        _regions.push_back({addr, length});
+    } catch(const std::bad_alloc&) {
+        return errno = ENOMEM, -1;
+    }
+    return 0;
+}
+
+int memmap_pressure_withdraw(void* addr) {
+    {
+        mem::ExclusiveLock guard(_lock);
+        auto found = std::find_if(_regions.begin(), _regions.end(),
+                                  [addr](const Region& r) { return r.addr == addr; });
+        if(found == _regions.end()) return errno = EINVAL, -1;
+        _regions.erase(found);
+    }
+    Settle(); // the region may be unmapped as soon as this returns
+    return 0;
+}
+
+} // extern "C"
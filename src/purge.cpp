@@ -0,0 +1,81 @@
+#include "sys/mman.h"
+#include "memmap/purge.h"
+#include "memmap/proc.h"
+
+#include "offer.h"
+#include "dbg.h" // tracing
+
+#include <windows.h>
+#include <errno.h>
+#include <stdint.h>
+#include <atomic>
+
+namespace {
+
+constexpr int kMaxResoluteness = VmOfferPriorityNormal - VmOfferPriorityVeryLow;
+
+std::atomic<size_t> _offers{0};
+std::atomic<size_t> _offered_bytes{0};
+std::atomic<size_t> _reclaims{0};
+std::atomic<size_t> _purges{0};
+std::atomic<size_t> _purged_bytes{0};
+
+/* Validates the start address and rounds the length up to whole pages. */
+bool Pages(void* addr, size_t& length) {
+    const size_t page_size = getpagesize();
+    if(!addr || !length || (uintptr_t)addr % page_size) return false;
+    length += page_size - 1;
+    length -= length % page_size;
+    return true;
+}
+
+} // anonymous
+
+extern "C" {
+
+int memmap_purge_offer(void* addr, size_t length, int resoluteness) {
+    if(!Pages(addr, length)) return errno = EINVAL, -1;
+    if(resoluteness < 0) resoluteness = 0;
+    if(resoluteness > kMaxResoluteness) resoluteness = kMaxResoluteness;
+    if(&OfferVirtualMemory) {
+        const OFFER_PRIORITY priority = (OFFER_PRIORITY)(VmOfferPriorityNormal - resoluteness);
+        _MEMMAP_LOG("OfferVirtualMemory(%p, %lx, %d)", addr, (DWORD)length, (int)priority);
+        if(OfferVirtualMemory(addr, length, priority) != ERROR_SUCCESS) return errno = ENOMEM, -1;
+    }
+    ++_offers;
+    _offered_bytes += length;
+    return 0;
+}
+
+int memmap_purge_reclaim(void* addr, size_t length) {
+    if(!Pages(addr, length)) return errno = EINVAL, -1;
+    int result = MEMMAP_PURGE_INTACT;
+    if(&ReclaimVirtualMemory) {
+        _MEMMAP_LOG("ReclaimVirtualMemory(%p, %lx)", addr, (DWORD)length);
+        switch(ReclaimVirtualMemory(addr, length)) {
+            case ERROR_SUCCESS:
+                break;
+            case ERROR_BUSY: // reclaimed, but discarded in the meantime
+                result = MEMMAP_PURGE_LOST;
+                break;
+            default:
+                return errno = EINVAL, -1;
+        }
+    }
+    ++_reclaims;
+    if(result == MEMMAP_PURGE_LOST) {
+        ++_purges;
+        _purged_bytes += length;
+    }
+    return result;
+}
+
+void memmap_purge_get_stats(memmap_purge_stats* stats) {
+    stats->offers = _offers;
+    stats->offered_bytes = _offered_bytes;
+    stats->reclaims = _reclaims;
+    stats->purges = _purges;
+    stats->purged_bytes = _purged_bytes;
+}
+
+} // extern "C"
@@ -0,0 +1,239 @@
+#include "sys/mman.h"
+#include "memmap/conf.h"
+#include "memmap/proc.h"
+
+#include "recycle.h"
+#include "sync.h"
+#include "dbg.h" // tracing
+
+#include <windows.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+/**
+ * Regions released by `munmap` are parked here, still committed ("hot"), and handed
+ * out again by `mmap` requests of the same length. The trimmer thread decommits hot
+ * entries that idle for longer than the configured age or exceed the byte budget;
+ * decommitted ("cold") entries keep their reservation, and a later hit recommits
+ * them (which is cheaper than a fresh reservation and zero-fills for free). Cold
+ * entries idle for yet another period are released.
+ *
+ * The cache is sharded by thread ID rather than truly thread-local, so that the
+ * trimmer can reach every entry; a thread falls back to other shards on a miss.
+ */
+struct Entry {
+    void* addr;
+    size_t length;
+    DWORD protection;
+    ULONGLONG parked; // GetTickCount64() at `Keep` or at decommit
+    bool committed;
+};
+
+constexpr unsigned kShards = 8;
+
+struct Shard {
+    SRWLOCK lock = SRWLOCK_INIT;
+    std::unordered_map<size_t, std::vector<Entry>> classes; // by exact length; oldest first
+};
+
+Shard _shards[kShards];
+
+std::atomic<size_t> _hot_bytes{0};
+std::atomic<size_t> _cold_bytes{0};
+std::atomic<size_t> _entries{0};
+
+size_t _recycle_budget = 0; // 0 => disabled
+size_t _recycle_max_length = 0;
+DWORD _recycle_max_idle_ms = 0;
+
+SRWLOCK _excluded_lock = SRWLOCK_INIT;
+std::unordered_set<uintptr_t> _excluded; // allocation bases, until their `munmap`
+std::atomic<size_t> _excluded_count{0};  // of `_excluded`, for `Keep` to skip the lock
+
+HANDLE _trimmer = nullptr;
+HANDLE _trimmer_wake = nullptr;
+
+Shard& Local() {
+    return _shards[(GetCurrentThreadId() >> 2) % kShards]; // thread IDs are multiples of 4
+}
+
+void Release(const Entry& entry) {
+    _MEMMAP_LOG("VirtualFree(%p, 0, MEM_RELEASE) [recycled]", entry.addr);
+    VirtualFree(entry.addr, 0, MEM_RELEASE);
+}
+
+bool TakeFrom(Shard& shard, size_t length, Entry& taken) {
+    mem::ExclusiveLock guard(shard.lock);
+    auto found = shard.classes.find(length);
+    if(found == shard.classes.end() || found->second.empty()) return false;
+    std::vector<Entry>& entries = found->second;
+    // the most recently parked hot entry is the most likely to be cache-warm
+    auto pick = std::find_if(entries.rbegin(), entries.rend(), [](const Entry& e) { return e.committed; });
+    auto it = (pick == entries.rend()) ? entries.end() - 1 : (pick + 1).base();
+    taken = *it;
+    entries.erase(it);
+    return true;
+}
+
+/* Whether the allocation at `base` was excluded from the cache; forgets it either way. */
+bool Excluded(void* base) {
+    if(!_excluded_count.load(std::memory_order_relaxed)) return false;
+    mem::ExclusiveLock guard(_excluded_lock);
+    const bool excluded = _excluded.erase((uintptr_t)base);
+    _excluded_count = _excluded.size();
+    return excluded;
+}
+
+/* Decommits idle or over-budget hot entries and releases idle cold ones. */
+void Trim(ULONGLONG now, bool budget_only) {
+    for(Shard& shard : _shards) {
+        std::vector<Entry> doomed;
+        {
+            mem::ExclusiveLock guard(shard.lock);
+            for(auto& cls : shard.classes) {
+                std::vector<Entry>& entries = cls.second;
+                for(auto it = entries.begin(); it != entries.end();) {
+                    const bool idle = now - it->parked >= _recycle_max_idle_ms;
+                    if(it->committed && (_hot_bytes > _recycle_budget || (idle && !budget_only))) {
+                        VirtualFree(it->addr, it->length, MEM_DECOMMIT);
+                        it->committed = false;
+                        it->parked = now;
+                        _hot_bytes -= it->length;
+                        _cold_bytes += it->length;
+                        ++it;
+                    } else if(!it->committed && (_cold_bytes > _recycle_budget || (idle && !budget_only))) {
+                        doomed.push_back(*it);
+                        _cold_bytes -= it->length;
+                        --_entries;
+                        it = entries.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+            }
+        }
+        for(const Entry& entry : doomed) Release(entry);
+    }
+}
+
+DWORD WINAPI Trimmer(LPVOID) {
+    for(;;) {
+        const DWORD period = std::max<DWORD>(10, _recycle_max_idle_ms / 2);
+        const bool woken = WaitForSingleObject(_trimmer_wake, period) == WAIT_OBJECT_0;
+        if(_entries) Trim(GetTickCount64(), woken);
+    }
+    return 0;
+}
+
+} // anonymous
+
+namespace mem {
+namespace recycle {
+
+void* Take(size_t length, DWORD protection, bool uninitialized) {
+    if(!_entries || length > _recycle_max_length) return nullptr;
+
+    Entry entry;
+    Shard& local = Local();
+    bool hit = TakeFrom(local, length, entry);
+    for(unsigned i = 0; !hit && i < kShards; ++i) {
+        hit = (&_shards[i] != &local) && TakeFrom(_shards[i], length, entry);
+    }
+    if(!hit) return nullptr;
+    --_entries;
+
+    const bool hot = entry.committed;
+    if(hot) {
+        _hot_bytes -= length;
+    } else {
+        _cold_bytes -= length;
+    }
+    const bool writable = entry.protection == PAGE_READWRITE || entry.protection == PAGE_EXECUTE_READWRITE;
+    if(hot && !uninitialized && !writable) {
+        // MAP_ANONYMOUS promises zeroes, and these pages cannot take them: recommitting zero-fills
+        VirtualFree(entry.addr, length, MEM_DECOMMIT);
+        entry.committed = false;
+    }
+    if(entry.committed) {
+        if(!uninitialized) {
+            memset(entry.addr, 0, length); // while still writable
+        }
+        DWORD ignored;
+        if(entry.protection != protection && !VirtualProtect(entry.addr, length, protection, &ignored)) {
+            Release(entry);
+            return nullptr;
+        }
+    } else {
+        if(!VirtualAlloc(entry.addr, length, MEM_COMMIT, protection)) {
+            Release(entry);
+            return nullptr;
+        }
+    }
+    _MEMMAP_LOG("recycled %p (%lx bytes, %s)", entry.addr, (DWORD)length, hot ? "hot" : "cold");
+    return entry.addr;
+}
+
+bool Keep(void* addr, size_t length, const MEMORY_BASIC_INFORMATION& mbi) {
+    if(addr == mbi.AllocationBase && Excluded(addr)) return false; // first: the entry must go with the allocation
+    if(!_recycle_budget || length > _recycle_max_length) return false;
+    // a single homogeneous region spanning the whole allocation, i.e. an unmodified `mmap` result
+    const bool whole = addr == mbi.AllocationBase && addr == mbi.BaseAddress && length == mbi.RegionSize;
+    const bool plain = mbi.Type == MEM_PRIVATE && mbi.State == MEM_COMMIT && !(mbi.Protect & PAGE_GUARD);
+    if(!whole || !plain) return false;
+    MEMORY_BASIC_INFORMATION next;
+    if(VirtualQuery((char*)addr + length, &next, sizeof(next)) && next.AllocationBase == addr) {
+        return false; // the allocation continues with reserved or differently protected pages
+    }
+
+    Shard& shard = Local();
+    {
+        ExclusiveLock guard(shard.lock);
+        shard.classes[length].push_back({addr, length, mbi.Protect, GetTickCount64(), true});
+    }
+    ++_entries;
+    if((_hot_bytes += length) > _recycle_budget) {
+        SetEvent(_trimmer_wake); // enforce the budget without waiting for the next period
+    }
+    return true;
+}
+
+void Exclude(void* base) {
+    mem::ExclusiveLock guard(_excluded_lock);
+    try {
+        _excluded.insert((uintptr_t)base);
+    } catch(const std::bad_alloc&) {
+        _MEMMAP_LOG("recycle: %p may be cached for lack of memory", base);
+    }
+    _excluded_count = _excluded.size();
+}
+
+} // namespace recycle
+} // namespace mem
+
+extern "C" {
+
+void set_mmap_recycle_policy(size_t budget, size_t max_length, unsigned max_idle_ms) {
+    const long page_size = getpagesize();
+    _recycle_max_length = std::min(max_length, budget);
+    _recycle_max_length -= _recycle_max_length % page_size;
+    _recycle_max_idle_ms = max_idle_ms;
+    if(budget && !_trimmer) {
+        _trimmer_wake = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+        _trimmer = CreateThread(nullptr, 0, &Trimmer, nullptr, 0, nullptr);
+        if(_trimmer) SetThreadPriority(_trimmer, THREAD_PRIORITY_BELOW_NORMAL);
+    }
+    _recycle_budget = _trimmer ? budget : 0;
+    if(_trimmer) {
+        SetEvent(_trimmer_wake); // apply a reduced budget (0 => drain on the next period)
+    }
+}
+
+} // extern "C"
@@ -0,0 +1,34 @@
+#ifndef _MEMMAP_SRC_RECYCLE_H_
+#define _MEMMAP_SRC_RECYCLE_H_
+
+#include <windows.h>
+#include <stddef.h>
+
+/* Recycling cache of unmapped anonymous regions (see `set_mmap_recycle_policy`) */
+
+namespace mem {
+namespace recycle {
+
+/**
+ * Returns a cached region of exactly `length` bytes with `protection` applied,
+ * zero-filled unless `uninitialized`; nullptr if the cache is disabled or has none.
+ */
+void* Take(size_t length, DWORD protection, bool uninitialized);
+
+/**
+ * Takes ownership of the anonymous allocation described by `mbi` if it is cacheable:
+ * [addr, addr+length) must be a whole, uniformly committed VirtualAlloc allocation,
+ * not excluded by `Exclude`. Returns false if the caller should free the region itself.
+ */
+bool Keep(void* addr, size_t length, const MEMORY_BASIC_INFORMATION& mbi);
+
+/**
+ * Keeps the allocation at `base` out of the cache when it is unmapped: its pages are
+ * not what `Take` hands out (large pages, or placed on a NUMA node). Allocates.
+ */
+void Exclude(void* base);
+
+} // namespace recycle
+} // namespace mem
+
+#endif /* _MEMMAP_SRC_RECYCLE_H_ */
@@ -0,0 +1,251 @@
+#include "sys/mman.h"
+#include "memmap/proc.h"
+#include "memmap/stack.h"
+
+#include "stack.h"
+#include "sync.h"
+#include "dbg.h" // tracing
+
+#include <windows.h>
+#include <errno.h>
+#include <stdint.h>
+#include <map>
+#include <new>
+#include <vector>
+
+namespace {
+
+/**
+ * Layout of a growable stack, from the top (highest address) down:
+ *
+ *     [ committed, in use ... | guard | slack ] [ reserved ... ] [ floor ]
+ *                                               ^ low            ^ base
+ *
+ * Touching the guard page raises STATUS_GUARD_PAGE_VIOLATION (the system clears the
+ * guard bit and the access goes through on return), and the handler commits another
+ * step below `low` with a new guard page. The handler and the exception dispatcher
+ * run on the faulting stack: the committed slack below the guard gives them room.
+ * Threads whose TEB points at the stack (fibers) are grown by the system itself,
+ * which works the same way. The floor page is never committed: running past the
+ * full length faults like a stack overflow would, and so does running into pages
+ * that a partial `munmap` of the bottom has taken away (the floor rises over them).
+ */
+constexpr size_t kStepPages = 4;  // committed at a time, including the guard and the slack
+constexpr size_t kSlackPages = 2; // committed below the guard page
+constexpr size_t kMinStackPages = kStepPages + 2; // the step, one reserved page and the floor
+constexpr size_t kDefaultStack = 1 << 20;
+
+struct Stack {
+    size_t length;
+    DWORD protection;
+    size_t floor; // from the base: the floor page, or the top of a partial munmap of the bottom
+};
+
+SRWLOCK _stacks_lock = SRWLOCK_INIT;
+std::map<uintptr_t, Stack> _stacks; // by base address
+PVOID _grow_handler = nullptr;
+
+/* Commits the next step below `low` (or down to `floor`) and arms a guard page in it. */
+bool Extend(char* floor, char* low, DWORD protection) {
+    const size_t page_size = getpagesize();
+    if(low <= floor) return false;
+    char* const step = (size_t)(low - floor) > kStepPages * page_size ? low - kStepPages * page_size : floor;
+    _MEMMAP_LOG("stack: committing %p..%p", step, low);
+    if(!VirtualAlloc(step, low - step, MEM_COMMIT, protection)) return false;
+    char* const guard = step + kSlackPages * page_size;
+    DWORD ignored;
+    if(guard < low) VirtualProtect(guard, page_size, protection | PAGE_GUARD, &ignored);
+    return true;
+}
+
+/* The lowest committed address of a growable stack (its reserved part ends there). */
+char* Low(char* base) {
+    const size_t page_size = getpagesize();
+    MEMORY_BASIC_INFORMATION mbi;
+    if(!VirtualQuery(base + page_size, &mbi, sizeof(mbi))) return base + page_size;
+    return mbi.State == MEM_RESERVE ? (char*)mbi.BaseAddress + mbi.RegionSize : base + page_size;
+}
+
+LONG CALLBACK Grow(PEXCEPTION_POINTERS info) {
+    const EXCEPTION_RECORD* record = info->ExceptionRecord;
+    if(record->ExceptionCode != STATUS_GUARD_PAGE_VIOLATION || record->NumberParameters < 2) {
+        return EXCEPTION_CONTINUE_SEARCH;
+    }
+    MEMORY_BASIC_INFORMATION mbi;
+    if(!VirtualQuery((void*)record->ExceptionInformation[1], &mbi, sizeof(mbi))) return EXCEPTION_CONTINUE_SEARCH;
+    char* const base = (char*)mbi.AllocationBase;
+    Stack stack;
+    {
+        mem::SharedLock guard(_stacks_lock);
+        auto found = _stacks.find((uintptr_t)base);
+        if(found == _stacks.end()) return EXCEPTION_CONTINUE_SEARCH; // someone else's guard page
+        stack = found->second;
+    }
+    Extend(base + stack.floor, Low(base), stack.protection); // at the floor, the access simply proceeds
+    return EXCEPTION_CONTINUE_EXECUTION;
+}
+
+} // anonymous
+
+namespace mem {
+namespace stack {
+
+void* Map(void* addr, size_t length, DWORD protection) {
+    const size_t page_size = getpagesize();
+    const DWORD vm_request = (length < kMinStackPages * page_size) ? MEM_RESERVE | MEM_COMMIT : MEM_RESERVE;
+    _MEMMAP_LOG("VirtualAlloc(%p, %lx, %lx, %lx) [stack]", addr, (DWORD)length, vm_request, protection);
+    char* base = (char*)VirtualAlloc(addr, length, vm_request, protection);
+    if(!base) {
+        errno = (GetLastError() == ERROR_INVALID_ADDRESS) ? EINVAL : ENOMEM;
+        return nullptr;
+    }
+    if(vm_request & MEM_COMMIT) return base; // too small to grow; an ordinary mapping
+
+    try {
+        ExclusiveLock guard(_stacks_lock);
+        if(!_grow_handler) _grow_handler = AddVectoredExceptionHandler(1, &Grow);
+        if(_grow_handler) _stacks[(uintptr_t)base] = {length, protection, page_size};
+    } catch(const std::bad_alloc&) {
+        VirtualFree(base, 0, MEM_RELEASE);
+        return errno = ENOMEM, nullptr;
+    }
+    if(!_grow_handler || !Extend(base + page_size, base + length, protection)) {
+        if(!Unmap(base, length)) VirtualFree(base, 0, MEM_RELEASE);
+        return errno = ENOMEM, nullptr;
+    }
+    return base;
+}
+
+bool Unmap(void* addr, size_t length) {
+    const size_t page_size = getpagesize();
+    length = (length + page_size - 1) / page_size * page_size;
+    {
+        ExclusiveLock guard(_stacks_lock);
+        auto found = _stacks.find((uintptr_t)addr);
+        if(found == _stacks.end()) return false;
+        if(length >= found->second.length) {
+            _stacks.erase(found);
+        } else { // the bottom of the stack: the reservation stays, the floor rises
+            if(length > found->second.floor) found->second.floor = length;
+            _MEMMAP_LOG("VirtualFree(%p, %lx, MEM_DECOMMIT) [stack]", addr, (DWORD)length);
+            VirtualFree(addr, length, MEM_DECOMMIT);
+            return true;
+        }
+    }
+    _MEMMAP_LOG("VirtualFree(%p, 0, MEM_RELEASE) [stack]", addr);
+    VirtualFree(addr, 0, MEM_RELEASE);
+    return true;
+}
+
+bool Trim(void* addr) {
+    Stack stack;
+    {
+        SharedLock guard(_stacks_lock);
+        auto found = _stacks.find((uintptr_t)addr);
+        if(found == _stacks.end()) return false;
+        stack = found->second;
+    }
+    const size_t page_size = getpagesize();
+    char* const base = (char*)addr;
+    char* const top_step = base + stack.length - kStepPages * page_size;
+    char* const low = Low(base);
+    if(low < top_step) {
+        _MEMMAP_LOG("stack %p: decommitting %p..%p", base, low, top_step);
+        VirtualFree(low, top_step - low, MEM_DECOMMIT);
+    }
+    // the top step was committed first and is never decommitted; only its guard may be gone
+    DWORD ignored;
+    return VirtualProtect(top_step + kSlackPages * page_size, page_size, stack.protection | PAGE_GUARD, &ignored);
+}
+
+size_t Committed(void* addr) {
+    Stack stack;
+    {
+        SharedLock guard(_stacks_lock);
+        auto found = _stacks.find((uintptr_t)addr);
+        if(found == _stacks.end()) return 0;
+        stack = found->second;
+    }
+    return (char*)addr + stack.length - Low((char*)addr);
+}
+
+} // namespace stack
+} // namespace mem
+
+struct memmap_stack_pool {
+    size_t stack_size;
+    size_t max_idle;
+    SRWLOCK lock;
+    std::vector<void*> idle; // most recently released last
+    memmap_stack_stats stats;
+};
+
+extern "C" {
+
+memmap_stack_pool* memmap_stack_pool_create(size_t stack_size, size_t max_idle) {
+    const size_t page_size = getpagesize();
+    if(!stack_size) stack_size = kDefaultStack;
+    stack_size += page_size - 1;
+    stack_size -= stack_size % page_size;
+    if(stack_size < kMinStackPages * page_size) stack_size = kMinStackPages * page_size; // room to grow
+    memmap_stack_pool* pool = new(std::nothrow) memmap_stack_pool();
+    if(!pool) return errno = ENOMEM, nullptr;
+    pool->stack_size = stack_size;
+    pool->max_idle = max_idle;
+    return pool;
+}
+
+void memmap_stack_pool_destroy(memmap_stack_pool* pool) {
+    if(!pool) return;
+    for(void* stack : pool->idle) munmap(stack, pool->stack_size);
+    delete pool;
+}
+
+void* memmap_stack_acquire(memmap_stack_pool* pool) {
+    {
+        mem::ExclusiveLock guard(pool->lock);
+        if(!pool->idle.empty()) {
+            void* stack = pool->idle.back(); // the warmest one
+            pool->idle.pop_back();
+            ++pool->stats.reused;
+            return stack;
+        }
+    }
+    void* stack = mmap(nullptr, pool->stack_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_GROWSDOWN, -1, 0);
+    if(stack == MAP_FAILED) return nullptr;
+    mem::ExclusiveLock guard(pool->lock);
+    ++pool->stats.created;
+    return stack;
+}
+
+void memmap_stack_release(memmap_stack_pool* pool, void* stack) {
+    if(!stack) return;
+    const size_t committed = mem::stack::Committed(stack);
+    if(mem::stack::Trim(stack)) {
+        mem::ExclusiveLock guard(pool->lock);
+        pool->stats.trimmed += committed - mem::stack::Committed(stack);
+        if(pool->idle.size() < pool->max_idle) {
+            try {
+                pool->idle.push_back(stack);
+                return;
+            } catch(const std::bad_alloc&) {}
+        }
+    }
+    munmap(stack, pool->stack_size);
+}
+
+size_t memmap_stack_size(const memmap_stack_pool* pool) {
+    return pool->stack_size;
+}
+
+size_t memmap_stack_committed(void* stack) {
+    return mem::stack::Committed(stack);
+}
+
+void memmap_stack_pool_stats(memmap_stack_pool* pool, memmap_stack_stats* stats) {
+    mem::ExclusiveLock guard(pool->lock);
+    *stats = pool->stats;
+    stats->idle = pool->idle.size();
+}
+
+} // extern "C"
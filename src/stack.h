@@ -0,0 +1,36 @@
+#ifndef _MEMMAP_SRC_STACK_H_
+#define _MEMMAP_SRC_STACK_H_
+
+#include <windows.h>
+#include <stddef.h>
+
+/* Stacks that grow on demand (MAP_GROWSDOWN; see memmap/stack.h for the pool) */
+
+namespace mem {
+namespace stack {
+
+/**
+ * Reserves `length` bytes (a multiple of the page size) and commits only the top,
+ * with a guard page below it that commits more on first touch. Returns nullptr and
+ * sets `errno` on failure. Regions too small for the guard scheme are committed whole
+ * and not tracked.
+ */
+void* Map(void* addr, size_t length, DWORD protection);
+
+/**
+ * Releases the reservation if `addr` is the base of a growable stack and `length`
+ * covers it; a shorter `length` decommits the bottom pages and raises the floor over
+ * them, so they fault from then on. Returns false (and does nothing) for any other memory.
+ */
+bool Unmap(void* addr, size_t length);
+
+/* Decommits all but the initially committed top of a growable stack and re-arms its guard page. */
+bool Trim(void* addr);
+
+/* Bytes committed by a growable stack so far (0 if `addr` is not one). */
+size_t Committed(void* addr);
+
+} // namespace stack
+} // namespace mem
+
+#endif /* _MEMMAP_SRC_STACK_H_ */
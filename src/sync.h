@@ -0,0 +1,32 @@
+#ifndef _MEMMAP_SRC_SYNC_H_
+#define _MEMMAP_SRC_SYNC_H_
+
+#include <windows.h>
+
+/* Scoped SRW lock holders for the (few) internal structures that need thread safety. */
+
+namespace mem {
+
+class ExclusiveLock {
+public:
+    explicit ExclusiveLock(SRWLOCK& lock) : _lock(lock) { AcquireSRWLockExclusive(&_lock); }
+    ~ExclusiveLock() { ReleaseSRWLockExclusive(&_lock); }
+    ExclusiveLock(const ExclusiveLock&) = delete;
+    ExclusiveLock& operator=(const ExclusiveLock&) = delete;
+private:
+    SRWLOCK& _lock;
+};
+
+class SharedLock {
+public:
+    explicit SharedLock(SRWLOCK& lock) : _lock(lock) { AcquireSRWLockShared(&_lock); }
+    ~SharedLock() { ReleaseSRWLockShared(&_lock); }
+    SharedLock(const SharedLock&) = delete;
+    SharedLock& operator=(const SharedLock&) = delete;
+private:
+    SRWLOCK& _lock;
+};
+
+} // namespace mem
+
+#endif /* _MEMMAP_SRC_SYNC_H_ */
@@ -0,0 +1,268 @@
+#include "sys/mman.h"
+#include "memmap/tags.h"
+#include "memmap/proc.h"
+#include "memmap/iter.h"
+
+#include "tags.h"
+#include "sync.h"
+#include "dbg.h" // tracing
+
+#include <windows.h>
+#include <psapi.h> /* QueryWorkingSetEx */
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <iterator>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr uint16_t kUntagged = 0;
+constexpr size_t kMaxTags = UINT16_MAX;
+constexpr size_t kBatch = 256; // pages per QueryWorkingSetEx call
+
+/* A tagged range [lower, upper): the lower bound is the key. */
+struct Tagged {
+    uintptr_t upper;
+    uint16_t tag;
+};
+
+SRWLOCK _tags_lock = SRWLOCK_INIT;
+std::deque<std::string> _names;      // by tag - 1; never removed, so the pointers handed out stay valid
+std::map<uintptr_t, Tagged> _ranges; // disjoint; adjacent ranges of one tag are merged
+std::atomic<size_t> _count{0};       // of `_ranges`, for `Unmapped` to skip the lock
+thread_local uint16_t _thread_tag = kUntagged;
+
+/* The length of `name` if it may be a tag (0 for none), or -1. As Linux checks `PR_SET_VMA_ANON_NAME`. */
+long Check(const char* name) {
+    if(!name) return 0;
+    size_t length = 0;
+    for(; name[length]; ++length) {
+        const char c = name[length];
+        if(length == MEMMAP_TAG_MAX || c < ' ' || c > '~' || strchr("[]\\$`", c)) return errno = EINVAL, -1;
+    }
+    return (long)length;
+}
+
+/* The tag of `name`, interned on first use; kUntagged on failure. Call with the lock held. */
+uint16_t Intern(const char* name, size_t length) {
+    for(size_t i = 0; i < _names.size(); ++i) {
+        if(_names[i].size() == length && !memcmp(_names[i].data(), name, length)) return uint16_t(i + 1);
+    }
+    if(_names.size() == kMaxTags) return errno = ENOMEM, kUntagged;
+    try {
+        _names.emplace_back(name, length);
+    } catch(const std::bad_alloc&) {
+        return errno = ENOMEM, kUntagged;
+    }
+    _MEMMAP_LOG("tags: '%s' is tag %u", _names.back().c_str(), (unsigned)_names.size());
+    return uint16_t(_names.size());
+}
+
+/**
+ * Removes [lower, upper) from the index. Splitting a range around it is the one step
+ * that allocates; if that fails, or with `split` false (emergency mode), the far piece
+ * loses its tag too. Call with the lock held.
+ */
+void Cut(uintptr_t lower, uintptr_t upper, bool split = true) {
+    auto it = _ranges.upper_bound(lower);
+    if(it != _ranges.begin()) {
+        auto before = std::prev(it);
+        if(before->second.upper > lower) {
+            if(before->second.upper > upper && !split) {
+                _MEMMAP_LOG("tags: %p..%p untagged in emergency mode", (void*)upper, (void*)before->second.upper);
+            } else if(before->second.upper > upper) {
+                try {
+                    _ranges.emplace_hint(it, upper, before->second);
+                } catch(const std::bad_alloc&) {
+                    _MEMMAP_LOG("tags: %p..%p untagged for lack of memory", (void*)upper, (void*)before->second.upper);
+                }
+            }
+            if(before->first == lower) {
+                _ranges.erase(before);
+            } else {
+                before->second.upper = lower;
+            }
+        }
+    }
+    while(it != _ranges.end() && it->first < upper) {
+        if(it->second.upper <= upper) {
+            it = _ranges.erase(it);
+        } else { // re-keyed in place: no allocation
+            auto node = _ranges.extract(it);
+            node.key() = upper;
+            _ranges.insert(std::move(node));
+            break;
+        }
+    }
+}
+
+/* Tags [lower, upper) with `tag` alone. Returns false (ENOMEM) if the range is left untagged. Call with the lock held. */
+bool Apply(uintptr_t lower, uintptr_t upper, uint16_t tag) {
+    Cut(lower, upper);
+    bool tagged = true;
+    if(tag != kUntagged) {
+        auto it = _ranges.lower_bound(lower);
+        auto before = (it != _ranges.begin()) ? std::prev(it) : _ranges.end();
+        if(before != _ranges.end() && before->second.upper == lower && before->second.tag == tag) {
+            before->second.upper = upper;
+        } else {
+            try {
+                before = _ranges.emplace_hint(it, lower, Tagged{upper, tag});
+            } catch(const std::bad_alloc&) {
+                before = _ranges.end();
+                tagged = false;
+            }
+        }
+        if(tagged && it != _ranges.end() && it->first == upper && it->second.tag == tag) {
+            before->second.upper = it->second.upper;
+            _ranges.erase(it);
+        }
+    }
+    _count = _ranges.size();
+    return tagged || (errno = ENOMEM, false);
+}
+
+/* Whole pages around [addr, addr+length). */
+void Pages(void* addr, size_t length, uintptr_t& lower, uintptr_t& upper) {
+    const uintptr_t page_size = getpagesize();
+    lower = (uintptr_t)addr / page_size * page_size;
+    upper = ((uintptr_t)addr + length + page_size - 1) / page_size * page_size;
+}
+
+/* The pages of [lower, upper) in the working set. */
+size_t Resident(uintptr_t lower, uintptr_t upper, size_t page_size) {
+    PSAPI_WORKING_SET_EX_INFORMATION batch[kBatch];
+    size_t resident = 0;
+    for(uintptr_t at = lower; at < upper;) {
+        const size_t pages = std::min<size_t>(kBatch, (upper - at) / page_size);
+        for(size_t i = 0; i < pages; ++i) batch[i].VirtualAddress = (void*)(at + i * page_size);
+        if(!QueryWorkingSetEx(GetCurrentProcess(), batch, (DWORD)(pages * sizeof(*batch)))) break;
+        for(size_t i = 0; i < pages; ++i) resident += batch[i].VirtualAttributes.Valid;
+        at += pages * page_size;
+    }
+    return resident;
+}
+
+} // anonymous
+
+namespace mem {
+
+std::vector<memmap_tag_usage> TagUsage() {
+    std::vector<memmap_tag_usage> usage;
+    for(size_t count = memmap_tag_usage_get(nullptr, 0); count > usage.size();) {
+        usage.resize(count);
+        count = memmap_tag_usage_get(usage.data(), usage.size());
+        if(count <= usage.size()) usage.resize(count); // a tag may have gone meanwhile
+    }
+    return usage;
+}
+
+namespace tags {
+
+void Created(void* addr, size_t length) {
+    const uint16_t tag = _thread_tag;
+    if(tag == kUntagged) return;
+    uintptr_t lower, upper;
+    Pages(addr, length, lower, upper);
+    mem::ExclusiveLock guard(_tags_lock);
+    Apply(lower, upper, tag);
+}
+
+void Unmapped(void* addr, size_t length, bool trusted) {
+    if(!_count.load(std::memory_order_relaxed)) return;
+    uintptr_t lower, upper;
+    Pages(addr, length, lower, upper);
+    mem::ExclusiveLock guard(_tags_lock);
+    Cut(lower, upper, trusted);
+    _count = _ranges.size();
+}
+
+const char* At(uintptr_t addr, uintptr_t& until) {
+    until = UINTPTR_MAX;
+    if(!_count.load(std::memory_order_relaxed)) return nullptr;
+    mem::SharedLock guard(_tags_lock);
+    auto it = _ranges.upper_bound(addr);
+    if(it != _ranges.end()) until = it->first;
+    if(it == _ranges.begin() || std::prev(it)->second.upper <= addr) return nullptr;
+    --it;
+    until = it->second.upper;
+    return _names[it->second.tag - 1].c_str();
+}
+
+} // namespace tags
+} // namespace mem
+
+extern "C" {
+
+int memmap_tag(void* addr, size_t length, const char* name) {
+    const long name_length = Check(name);
+    if(name_length < 0) return -1;
+    uintptr_t lower, upper;
+    Pages(addr, length, lower, upper);
+    if(!length || upper <= lower) return errno = EINVAL, -1; // empty, or wrapping around
+    mem::ExclusiveLock guard(_tags_lock);
+    const uint16_t tag = name_length ? Intern(name, name_length) : kUntagged;
+    if(name_length && tag == kUntagged) return -1;
+    return Apply(lower, upper, tag) ? 0 : -1;
+}
+
+int memmap_tag_thread(const char* name) {
+    const long name_length = Check(name);
+    if(name_length < 0) return -1;
+    uint16_t tag = kUntagged;
+    if(name_length) {
+        mem::ExclusiveLock guard(_tags_lock);
+        if((tag = Intern(name, name_length)) == kUntagged) return -1;
+    }
+    _thread_tag = tag;
+    return 0;
+}
+
+const char* memmap_tag_thread_get(void) {
+    if(_thread_tag == kUntagged) return nullptr;
+    mem::SharedLock guard(_tags_lock);
+    return _names[_thread_tag - 1].c_str();
+}
+
+const char* memmap_tag_get(const void* addr) {
+    uintptr_t until;
+    return mem::tags::At((uintptr_t)addr, until);
+}
+
+size_t memmap_tag_usage_get(memmap_tag_usage* usage, size_t count) {
+    const size_t page_size = getpagesize();
+    mem::SharedLock guard(_tags_lock);
+    std::vector<memmap_tag_usage> totals;
+    try {
+        totals.resize(_names.size(), memmap_tag_usage{nullptr, 0, 0, 0});
+    } catch(const std::bad_alloc&) {
+        return errno = ENOMEM, 0;
+    }
+    for(const auto& range : _ranges) {
+        memmap_tag_usage& total = totals[range.second.tag - 1];
+        total.name = _names[range.second.tag - 1].c_str(); // in use
+        const MEMMAP_RANGE bounds = {(void*)range.first, (void*)range.second.upper};
+        mem::TraverseInPlace(bounds, [&](const MEMORY_BASIC_INFORMATION& mbi, const MEMMAP_RANGE& region) {
+            const size_t size = MEMMAP_RANGE_SIZE(region);
+            total.reserved += size;
+            if(mbi.State != MEM_COMMIT) return;
+            total.committed += size;
+            total.resident += Resident((uintptr_t)region.lower, (uintptr_t)region.upper, page_size) * page_size;
+        }, &mem::Reserved);
+    }
+    size_t used = 0;
+    for(const memmap_tag_usage& total : totals) {
+        if(!total.name) continue;
+        if(used < count) usage[used] = total;
+        ++used;
+    }
+    return used;
+}
+
+} // extern "C"
@@ -0,0 +1,31 @@
+#ifndef _MEMMAP_SRC_TAGS_H_
+#define _MEMMAP_SRC_TAGS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Named mappings (see memmap/tags.h) */
+
+namespace mem {
+namespace tags {
+
+/* Tags a new anonymous mapping with the creating thread's tag, if any: one thread-local load otherwise. */
+void Created(void* addr, size_t length);
+
+/**
+ * Forgets the tags of [addr, addr+length): one atomic load while nothing is tagged.
+ * With `trusted` false (emergency mode) a range straddling both bounds is not split,
+ * since that allocates: its tail loses its tag as well.
+ */
+void Unmapped(void* addr, size_t length, bool trusted);
+
+/**
+ * The tag of `addr` or nullptr, and in `until` where the answer changes: the end of the
+ * tagged range, or the start of the next one. Never allocates (see maps.cpp).
+ */
+const char* At(uintptr_t addr, uintptr_t& until);
+
+} // namespace tags
+} // namespace mem
+
+#endif /* _MEMMAP_SRC_TAGS_H_ */
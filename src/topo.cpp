@@ -0,0 +1,91 @@
+#include "memmap/proc.h"
+
+#include "dbg.h" // tracing
+
+#include <windows.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+
+constexpr unsigned kDefaultCacheLine = 64;
+
+unsigned BitCount(ULONG_PTR mask) {
+    unsigned bits = 0;
+    for(; mask; mask &= mask - 1) ++bits;
+    return bits;
+}
+
+/* Cores and caches from GetLogicalProcessorInformation (Vista+; one processor group). */
+void ProbeProcessors(memmap_topology& t) {
+    DWORD size = 0;
+    GetLogicalProcessorInformation(nullptr, &size);
+    std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(size / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+    if(info.empty() || !GetLogicalProcessorInformation(info.data(), &size)) return;
+
+    unsigned cores = 0, threads = 0;
+    for(const SYSTEM_LOGICAL_PROCESSOR_INFORMATION& entry : info) {
+        if(entry.Relationship == RelationProcessorCore) {
+            ++cores;
+            threads += BitCount(entry.ProcessorMask);
+        } else if(entry.Relationship == RelationCache) {
+            const CACHE_DESCRIPTOR& cache = entry.Cache;
+            memmap_cache_info* slot =
+                (cache.Level == 1 && cache.Type == CacheInstruction) ? &t.l1i :
+                (cache.Level == 1 && cache.Type != CacheInstruction) ? &t.l1d :
+                (cache.Level == 2) ? &t.l2 :
+                (cache.Level == 3) ? &t.l3 : nullptr;
+            if(slot && !slot->size) { // every core reports its own: the first one will do
+                slot->size = cache.Size;
+                slot->line_size = cache.LineSize;
+                slot->associativity = cache.Associativity;
+            }
+        }
+    }
+    // processors in other groups are not listed, so scale what we saw
+    if(cores && threads) t.cores = (unsigned)((uint64_t)cores * t.processors / threads);
+}
+
+memmap_topology Probe() {
+    memmap_topology t;
+    memset(&t, 0, sizeof(t));
+
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    t.page_size = si.dwPageSize;
+    t.allocation_granularity = si.dwAllocationGranularity;
+    t.min_address = si.lpMinimumApplicationAddress;
+    t.max_address = si.lpMaximumApplicationAddress;
+    t.large_page_size = GetLargePageMinimum();
+
+#if _WIN32_WINNT >= 0x0601
+    t.processors = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+#endif
+    if(!t.processors) t.processors = si.dwNumberOfProcessors;
+    t.cores = t.processors;
+
+    ULONG highest = 0;
+    t.numa_nodes = GetNumaHighestNodeNumber(&highest) ? highest + 1 : 1;
+
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if(GlobalMemoryStatusEx(&status)) t.phys_pages = status.ullTotalPhys / t.page_size;
+
+    ProbeProcessors(t);
+    t.cache_line = t.l1d.line_size ? t.l1d.line_size : kDefaultCacheLine;
+    _MEMMAP_LOG("topology: %u processors, %u cores, %u nodes, %lu-byte lines",
+                t.processors, t.cores, t.numa_nodes, (unsigned long)t.cache_line);
+    return t;
+}
+
+} // anonymous
+
+extern "C" {
+
+const memmap_topology* memmap_topology_get(void) {
+    static const memmap_topology topology = Probe(); // once, thread safe
+    return &topology;
+}
+
+} // extern "C"
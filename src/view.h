@@ -0,0 +1,42 @@
+#ifndef _MEMMAP_SRC_VIEW_H_
+#define _MEMMAP_SRC_VIEW_H_
+
+#include <windows.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* The file-view half of `mmap`, shared with the streaming window (memmap/window.h) */
+
+namespace mem {
+namespace view {
+
+/* The file handle behind a POSIX file descriptor (see `set_handle_from_posix_fd_func`). */
+HANDLE FileHandle(int fd);
+
+/* PAGE_* protection for a view with these `mmap` protection and flags (copy-on-write included). */
+DWORD Protection(int prot, int flags);
+
+/**
+ * A section of the file with the given page protection (PAGE_*, already adjusted
+ * for copy-on-write). `max_size` 0 means the current file size; a larger one extends
+ * the file. Returns nullptr and sets `errno` on failure.
+ */
+HANDLE Section(HANDLE hfile, DWORD protection, int prot, uint64_t max_size = 0);
+
+/* FILE_MAP_* access for a view with these `mmap` protection and flags. */
+DWORD Access(int prot, int flags);
+
+/* Bytes between the start of the allocation granule containing `offset` and `offset`. */
+size_t Padding(uint64_t offset);
+
+/**
+ * Maps [offset, offset+length) of `section`. The view starts at the allocation
+ * granule containing `offset`; the returned address is shifted by the padding.
+ * Returns nullptr and sets `errno` on failure.
+ */
+void* Map(HANDLE section, uint64_t offset, size_t length, DWORD access, int flags);
+
+} // namespace view
+} // namespace mem
+
+#endif /* _MEMMAP_SRC_VIEW_H_ */
@@ -0,0 +1,172 @@
+#include "sys/mman.h"
+#include "memmap/window.h"
+#include "memmap/proc.h"
+
+#include "view.h"
+#include "dbg.h" // tracing
+
+#include <windows.h>
+#include <errno.h>
+#include <stdint.h>
+#include <new>
+
+extern "C" {
+
+#if _WIN32_WINNT < _WIN32_WINNT_WIN8
+  typedef struct _WIN32_MEMORY_RANGE_ENTRY {
+    PVOID VirtualAddress;
+    SIZE_T NumberOfBytes;
+  } WIN32_MEMORY_RANGE_ENTRY, *PWIN32_MEMORY_RANGE_ENTRY;
+
+  /* WINBASEAPI */ BOOL WINAPI PrefetchVirtualMemory (HANDLE hProcess, ULONG_PTR NumberOfEntries, PWIN32_MEMORY_RANGE_ENTRY VirtualAddresses, ULONG Flags) __attribute((weak));
+#endif
+
+} // extern "C"
+
+namespace {
+
+constexpr size_t kDefaultWindow = 64 << 20;
+constexpr size_t kDefaultSpan = 64 << 10;
+constexpr size_t kNone = SIZE_MAX;
+
+struct View {
+    size_t index = kNone; // window number: the view starts at index * window_size
+    char* data = nullptr;
+    size_t length = 0;
+};
+
+} // anonymous
+
+struct memmap_window {
+    HANDLE section;
+    uint64_t file_size;
+    size_t window_size;
+    size_t max_span;
+    View current;
+    View next;
+    PTP_WORK prefetch; // faults `next` in while the reader works on `current`
+};
+
+namespace {
+
+void Unmap(View& view) {
+    if(view.data) UnmapViewOfFile(view.data);
+    view = View();
+}
+
+bool Map(memmap_window& w, size_t index, View& view) {
+    const uint64_t offset = (uint64_t)index * w.window_size;
+    const uint64_t rest = w.file_size - offset;
+    const size_t length = rest < w.window_size + w.max_span ? (size_t)rest : w.window_size + w.max_span;
+    view.data = (char*)mem::view::Map(w.section, offset, length, FILE_MAP_READ, 0);
+    if(!view.data) return false;
+    view.index = index;
+    view.length = length;
+    return true;
+}
+
+/**
+ * Runs on the thread pool. PrefetchVirtualMemory (Windows 8+) queues large reads
+ * of the whole view; older systems fault it in one page at a time. Reads `next`
+ * without a lock: the reader waits for this callback before it changes `next`.
+ */
+void CALLBACK Prefetch(PTP_CALLBACK_INSTANCE, PVOID context, PTP_WORK) {
+    const View& view = ((memmap_window*)context)->next;
+    if(!view.data) return;
+    if(&PrefetchVirtualMemory) {
+        WIN32_MEMORY_RANGE_ENTRY range = {view.data, view.length};
+        if(PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0)) return;
+    }
+    const size_t page_size = getpagesize();
+    unsigned char sum = 0;
+    for(size_t offset = 0; offset < view.length; offset += page_size) {
+        sum += ((volatile const char*)view.data)[offset];
+    }
+    (void)sum;
+}
+
+/* Makes window `index` current, recycling the prefetched one if it matches. */
+bool MoveTo(memmap_window& w, size_t index) {
+    const bool sequential = w.next.index == index;
+    if(w.prefetch) WaitForThreadpoolWorkCallbacks(w.prefetch, !sequential); // a jump cancels pending prefetch
+    Unmap(w.current);
+    if(sequential) {
+        w.current = w.next;
+        w.next = View();
+    } else {
+        Unmap(w.next);
+        if(!Map(w, index, w.current)) return false;
+    }
+    _MEMMAP_LOG("window #%lu at %p (%lx bytes)", (unsigned long)index, w.current.data, (DWORD)w.current.length);
+
+    const uint64_t next_offset = (uint64_t)(index + 1) * w.window_size;
+    if(next_offset < w.file_size && Map(w, index + 1, w.next) && w.prefetch) {
+        SubmitThreadpoolWork(w.prefetch);
+    }
+    return true; // a failure to map ahead is retried when the reader gets there
+}
+
+} // anonymous
+
+extern "C" {
+
+memmap_window* memmap_window_open(int fd, size_t window_size, size_t max_span) {
+    const size_t granularity = get_allocation_granularity();
+    if(!window_size) window_size = kDefaultWindow;
+    if(!max_span) max_span = kDefaultSpan;
+    window_size += granularity - 1;
+    window_size -= window_size % granularity;
+
+    HANDLE hfile = mem::view::FileHandle(fd);
+    LARGE_INTEGER file_size;
+    if(hfile == INVALID_HANDLE_VALUE || !GetFileSizeEx(hfile, &file_size)) {
+        return errno = EBADF, nullptr;
+    }
+
+    memmap_window* window = new(std::nothrow) memmap_window();
+    if(!window) return errno = ENOMEM, nullptr;
+    window->file_size = file_size.QuadPart;
+    window->window_size = window_size;
+    window->max_span = max_span;
+    if(window->file_size) { // an empty file cannot be mapped, but it can be scanned
+        window->section = mem::view::Section(hfile, PAGE_READONLY, PROT_READ);
+        if(!window->section) {
+            delete window;
+            return nullptr;
+        }
+    }
+    window->prefetch = CreateThreadpoolWork(&Prefetch, window, nullptr); // optional
+    return window;
+}
+
+void memmap_window_close(memmap_window* window) {
+    if(!window) return;
+    if(window->prefetch) {
+        WaitForThreadpoolWorkCallbacks(window->prefetch, TRUE);
+        CloseThreadpoolWork(window->prefetch);
+    }
+    Unmap(window->current);
+    Unmap(window->next);
+    if(window->section) CloseHandle(window->section);
+    delete window;
+}
+
+uint64_t memmap_window_file_size(const memmap_window* window) {
+    return window->file_size;
+}
+
+const void* memmap_window_peek(memmap_window* window, uint64_t offset, size_t* available) {
+    if(offset >= window->file_size) return errno = EINVAL, nullptr;
+    const size_t index = (size_t)(offset / window->window_size);
+    if(window->current.index != index && !MoveTo(*window, index)) return nullptr;
+    const size_t within = (size_t)(offset - (uint64_t)index * window->window_size);
+    if(available) *available = window->current.length - within;
+    return window->current.data + within;
+}
+
+const void* memmap_window_span(memmap_window* window, uint64_t offset, size_t length) {
+    if(length > window->max_span || length > window->file_size - offset) return errno = EINVAL, nullptr;
+    return memmap_window_peek(window, offset, nullptr);
+}
+
+} // extern "C"